@@ -0,0 +1,216 @@
+#include "zcompressedstackblock.h"
+
+#include <cstring>
+#include <algorithm>
+#include <zlib.h>
+
+#include "zstack.hxx"
+#include "zintcuboid.h"
+
+namespace {
+
+const int MAX_PALETTE_SIZE = 16;
+
+int GetPaletteBitWidth(size_t paletteSize)
+{
+  if (paletteSize <= 2) {
+    return 1;
+  } else if (paletteSize <= 4) {
+    return 2;
+  }
+
+  return 4;
+}
+
+}
+
+ZCompressedStackBlock::ZCompressedStackBlock()
+{
+}
+
+void ZCompressedStackBlock::clear()
+{
+  m_encoding = EEncoding::NONE;
+  m_width = 0;
+  m_height = 0;
+  m_depth = 0;
+  m_bitWidth = 0;
+  m_offset.set(0, 0, 0);
+  m_palette.clear();
+  m_data.clear();
+}
+
+size_t ZCompressedStackBlock::getVoxelNumber() const
+{
+  return size_t(m_width) * m_height * m_depth;
+}
+
+ZIntCuboid ZCompressedStackBlock::getBoundBox() const
+{
+  ZIntCuboid box;
+  if (!isEmpty()) {
+    box.setFirstCorner(m_offset);
+    box.setSize(m_width, m_height, m_depth);
+  }
+
+  return box;
+}
+
+size_t ZCompressedStackBlock::getMemoryUsage() const
+{
+  return m_data.capacity() + m_palette.capacity();
+}
+
+void ZCompressedStackBlock::encode(
+    const uint8_t *data, int width, int height, int depth)
+{
+  ZIntPoint offset = m_offset;
+  clear();
+  m_offset = offset;
+
+  if (data == NULL || width <= 0 || height <= 0 || depth <= 0) {
+    return;
+  }
+
+  m_width = width;
+  m_height = height;
+  m_depth = depth;
+
+  const size_t voxelNumber = getVoxelNumber();
+
+  //Collect distinct values and stop as soon as the palette overflows
+  int paletteIndex[256];
+  std::fill(paletteIndex, paletteIndex + 256, -1);
+  for (size_t i = 0; i < voxelNumber; ++i) {
+    uint8_t v = data[i];
+    if (paletteIndex[v] < 0) {
+      if ((int) m_palette.size() == MAX_PALETTE_SIZE) {
+        m_palette.clear();
+        break;
+      }
+      paletteIndex[v] = m_palette.size();
+      m_palette.push_back(v);
+    }
+  }
+
+  if (m_palette.size() == 1) {
+    m_encoding = EEncoding::CONSTANT;
+  } else if (!m_palette.empty()) {
+    m_encoding = EEncoding::PALETTE;
+    m_bitWidth = GetPaletteBitWidth(m_palette.size());
+    const int valuePerByte = 8 / m_bitWidth;
+    m_data.resize((voxelNumber + valuePerByte - 1) / valuePerByte, 0);
+    for (size_t i = 0; i < voxelNumber; ++i) {
+      m_data[i / valuePerByte] |= uint8_t(
+            paletteIndex[data[i]] << ((i % valuePerByte) * m_bitWidth));
+    }
+  } else {
+    uLongf compressedSize = compressBound(voxelNumber);
+    m_data.resize(compressedSize);
+    if (compress2(m_data.data(), &compressedSize, data, voxelNumber,
+                  Z_BEST_SPEED) == Z_OK &&
+        compressedSize <= voxelNumber - voxelNumber / 8) {
+      m_encoding = EEncoding::DEFLATE;
+      m_data.resize(compressedSize);
+    } else {
+      m_encoding = EEncoding::RAW;
+      m_data.assign(data, data + voxelNumber);
+    }
+  }
+
+  m_data.shrink_to_fit();
+  m_palette.shrink_to_fit();
+}
+
+bool ZCompressedStackBlock::encode(const ZStack *stack)
+{
+  if (stack == NULL || stack->kind() != GREY || stack->channelNumber() != 1) {
+    clear();
+    return false;
+  }
+
+  m_offset = stack->getOffset();
+  encode(stack->array8(), stack->width(), stack->height(), stack->depth());
+
+  return true;
+}
+
+bool ZCompressedStackBlock::isRandomAccessible() const
+{
+  return m_encoding == EEncoding::CONSTANT ||
+      m_encoding == EEncoding::PALETTE || m_encoding == EEncoding::RAW;
+}
+
+int ZCompressedStackBlock::getPaletteIndex(size_t index) const
+{
+  const int valuePerByte = 8 / m_bitWidth;
+  return (m_data[index / valuePerByte] >> ((index % valuePerByte) * m_bitWidth)) &
+      ((1 << m_bitWidth) - 1);
+}
+
+int ZCompressedStackBlock::getValueLocal(int x, int y, int z) const
+{
+  switch (m_encoding) {
+  case EEncoding::CONSTANT:
+    return m_palette[0];
+  case EEncoding::PALETTE:
+    return m_palette[getPaletteIndex(getIndex(x, y, z))];
+  case EEncoding::RAW:
+    return m_data[getIndex(x, y, z)];
+  default:
+    break;
+  }
+
+  return 0;
+}
+
+bool ZCompressedStackBlock::decode(uint8_t *data) const
+{
+  if (data == NULL || isEmpty()) {
+    return false;
+  }
+
+  const size_t voxelNumber = getVoxelNumber();
+
+  switch (m_encoding) {
+  case EEncoding::CONSTANT:
+    memset(data, m_palette[0], voxelNumber);
+    break;
+  case EEncoding::PALETTE:
+    for (size_t i = 0; i < voxelNumber; ++i) {
+      data[i] = m_palette[getPaletteIndex(i)];
+    }
+    break;
+  case EEncoding::DEFLATE:
+  {
+    uLongf rawSize = voxelNumber;
+    if (uncompress(data, &rawSize, m_data.data(), m_data.size()) != Z_OK ||
+        rawSize != voxelNumber) {
+      return false;
+    }
+  }
+    break;
+  case EEncoding::RAW:
+    memcpy(data, m_data.data(), voxelNumber);
+    break;
+  default:
+    return false;
+  }
+
+  return true;
+}
+
+ZStack* ZCompressedStackBlock::toStack() const
+{
+  if (isEmpty()) {
+    return NULL;
+  }
+
+  ZStack *stack = new ZStack(GREY, getBoundBox(), 1);
+  if (!decode(stack->array8())) {
+    delete stack;
+    stack = NULL;
+  }
+
+  return stack;
+}
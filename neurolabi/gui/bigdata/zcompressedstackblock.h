@@ -0,0 +1,116 @@
+#ifndef ZCOMPRESSEDSTACKBLOCK_H
+#define ZCOMPRESSEDSTACKBLOCK_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "zintpoint.h"
+
+class ZStack;
+class ZIntCuboid;
+
+/*!
+ * \brief The class of compressed uint8 stack block
+ *
+ * A block is encoded with the first one that applies:
+ *   CONSTANT: all voxels have the same value, which is the only byte stored.
+ *   PALETTE: no more than 16 distinct values. Each voxel is stored as a 1, 2
+ *            or 4 bit index into the palette.
+ *   DEFLATE: zlib compressed when it saves at least 1/8 of the raw size.
+ *   RAW: voxel values as they are.
+ *
+ * Voxels of a CONSTANT, PALETTE or RAW block can be read without decoding the
+ * whole block. A DEFLATE block has to be decoded by decode() first.
+ */
+class ZCompressedStackBlock
+{
+public:
+  ZCompressedStackBlock();
+
+  enum class EEncoding {
+    NONE, CONSTANT, PALETTE, DEFLATE, RAW
+  };
+
+  void clear();
+  bool isEmpty() const { return m_encoding == EEncoding::NONE; }
+
+  /*!
+   * \brief Encode a block.
+   *
+   * \a data is stored in the x-y-z order with the size
+   * \a width x \a height x \a depth.
+   */
+  void encode(const uint8_t *data, int width, int height, int depth);
+
+  /*!
+   * \brief Encode a stack.
+   *
+   * The offset of \a stack is kept.
+   *
+   * \return false iff \a stack is not a single-channel GREY stack, in which
+   *         case the block is cleared.
+   */
+  bool encode(const ZStack *stack);
+
+  /*!
+   * \brief Decode the block into \a data, which must have at least
+   * getVoxelNumber() elements.
+   */
+  bool decode(uint8_t *data) const;
+
+  /*!
+   * \brief Make a stack from the block.
+   *
+   * The caller is responsible for deleting the returned pointer. It returns
+   * NULL if the block is empty.
+   */
+  ZStack* toStack() const;
+
+  /*!
+   * \brief Test if a voxel can be read without decoding the block.
+   */
+  bool isRandomAccessible() const;
+
+  /*!
+   * \brief Get a voxel value at a local position.
+   *
+   * The block must be random accessible.
+   */
+  int getValueLocal(int x, int y, int z) const;
+
+  EEncoding getEncoding() const { return m_encoding; }
+
+  int getWidth() const { return m_width; }
+  int getHeight() const { return m_height; }
+  int getDepth() const { return m_depth; }
+  size_t getVoxelNumber() const;
+
+  const ZIntPoint& getOffset() const { return m_offset; }
+  void setOffset(const ZIntPoint &offset) { m_offset = offset; }
+  ZIntCuboid getBoundBox() const;
+
+  /*!
+   * \brief Number of bytes used by the encoded data.
+   */
+  size_t getMemoryUsage() const;
+
+private:
+  size_t getIndex(int x, int y, int z) const {
+    return (size_t(z) * m_height + y) * m_width + x;
+  }
+
+  int getPaletteIndex(size_t index) const;
+
+private:
+  EEncoding m_encoding = EEncoding::NONE;
+  int m_width = 0;
+  int m_height = 0;
+  int m_depth = 0;
+  int m_bitWidth = 0;
+  ZIntPoint m_offset;
+  std::vector<uint8_t> m_palette;
+  std::vector<uint8_t> m_data;
+};
+
+#endif // ZCOMPRESSEDSTACKBLOCK_H
@@ -1,10 +1,17 @@
 #include "zstackblockgrid.h"
+
+#include <algorithm>
+#include <cstring>
+
 #include "zstack.hxx"
 #include "zintcuboid.h"
 #include "neutubeconfig.h"
 #include "core/utilities.h"
+#include "zobject3dscan.h"
+#include "zcompressedstackblock.h"
 
-ZStackBlockGrid::ZStackBlockGrid()
+ZStackBlockGrid::ZStackBlockGrid() :
+  m_decodedBlock(std::make_shared<DecodedBlock>())
 {
 }
 
@@ -20,6 +27,80 @@ void ZStackBlockGrid::clearStack()
     delete *iter;
   }
   m_stackArray.clear();
+
+  for (ZCompressedStackBlock *block : m_compressedArray) {
+    delete block;
+  }
+  m_compressedArray.clear();
+  invalidateDecodedBlock();
+}
+
+void ZStackBlockGrid::invalidateDecodedBlock()
+{
+  std::lock_guard<std::mutex> guard(m_decodedBlock->mutex);
+  m_decodedBlock->index = -1;
+}
+
+void ZStackBlockGrid::resizeBlockArray(size_t size)
+{
+  if (m_stackArray.size() < size) {
+    m_stackArray.resize(size, NULL);
+  }
+  if (m_compressedArray.size() < size) {
+    m_compressedArray.resize(size, NULL);
+  }
+}
+
+void ZStackBlockGrid::setBlock(int index, ZStack *stack)
+{
+  resizeBlockArray(index + 1);
+
+  ZStack *oldStack = m_stackArray[index];
+  if (oldStack != NULL && oldStack != stack) {
+    delete oldStack;
+  }
+  m_stackArray[index] = NULL;
+
+  if (m_compressedArray[index] != NULL) {
+    delete m_compressedArray[index];
+    m_compressedArray[index] = NULL;
+    std::lock_guard<std::mutex> guard(m_decodedBlock->mutex);
+    if (m_decodedBlock->index == index) {
+      m_decodedBlock->index = -1;
+    }
+  }
+
+  if (stack != NULL && m_compressing) {
+    ZCompressedStackBlock *block = new ZCompressedStackBlock;
+    if (block->encode(stack)) {
+      m_compressedArray[index] = block;
+      delete stack;
+      stack = NULL;
+    } else {
+      delete block;
+    }
+  }
+
+  m_stackArray[index] = stack;
+}
+
+size_t ZStackBlockGrid::getMemoryUsage() const
+{
+  size_t usage = 0;
+  for (const ZStack *stack : m_stackArray) {
+    if (stack != NULL) {
+      usage += stack->getVoxelNumber() * stack->kind() *
+          stack->channelNumber();
+    }
+  }
+
+  for (const ZCompressedStackBlock *block : m_compressedArray) {
+    if (block != NULL) {
+      usage += block->getMemoryUsage();
+    }
+  }
+
+  return usage;
 }
 
 void ZStackBlockGrid::consumeStack(
@@ -51,18 +132,9 @@ bool ZStackBlockGrid::consumeStack(const ZIntPoint &blockIndex, ZStack *stack)
       return false;
     }
 
-    if (index >= (int) m_stackArray.size()) {
-      m_stackArray.resize(index + 1, NULL);
-    } else {
-      ZStack *oldStack = m_stackArray[index];
-      if (oldStack != NULL && oldStack != stack) {
-        delete oldStack;
-      }
-    }
-
     //stack->setOffset(getBlockPosition(blockIndex));
 
-    m_stackArray[index] = stack;
+    setBlock(index, stack);
   } else {
 #ifdef _DEBUG_2
     stack->save(GET_DATA_DIR + "/test.tif");
@@ -94,14 +166,21 @@ void ZStackBlockGrid::consume(ZStackBlockGrid &grid)
   }
 
   if (compatible) {
-    if (grid.m_stackArray.size() > m_stackArray.size()) {
-      m_stackArray.resize(grid.m_stackArray.size(), NULL);
-      for (size_t i = 0; i < m_stackArray.size(); ++i) {
-        if (m_stackArray[i] == NULL && grid.m_stackArray[i] != NULL) {
-          m_stackArray[i] = grid.m_stackArray[i];
-          grid.m_stackArray[i] = NULL;
+    size_t blockCount =
+        std::max(grid.m_stackArray.size(), grid.m_compressedArray.size());
+    if (blockCount > m_stackArray.size()) {
+      resizeBlockArray(blockCount);
+      for (size_t i = 0; i < blockCount; ++i) {
+        if (!isBlockFilled(i)) {
+          if (i < grid.m_stackArray.size()) {
+            std::swap(m_stackArray[i], grid.m_stackArray[i]);
+          }
+          if (i < grid.m_compressedArray.size()) {
+            std::swap(m_compressedArray[i], grid.m_compressedArray[i]);
+          }
         }
       }
+      grid.invalidateDecodedBlock();
 
       for (int i = 0; i < 3; ++i) {
         if (m_size[i] < grid.m_size[i]) {
@@ -133,6 +212,85 @@ ZStack* ZStackBlockGrid::getStack(const ZIntPoint &blockIndex) const
   return stack;
 }
 
+ZStack* ZStackBlockGrid::makeStack(const ZIntPoint &blockIndex) const
+{
+  ZStack *stack = NULL;
+
+  int index = getHashIndex(blockIndex);
+  if (index >= 0) {
+    if (index < (int) m_stackArray.size() && m_stackArray[index] != NULL) {
+      stack = m_stackArray[index]->clone();
+    } else if (index < (int) m_compressedArray.size() &&
+               m_compressedArray[index] != NULL) {
+      stack = m_compressedArray[index]->toStack();
+    }
+  }
+
+  return stack;
+}
+
+bool ZStackBlockGrid::isBlockFilled(size_t index) const
+{
+  return (index < m_stackArray.size() && m_stackArray[index] != NULL) ||
+      (index < m_compressedArray.size() && m_compressedArray[index] != NULL);
+}
+
+bool ZStackBlockGrid::hasBlock(const ZIntPoint &blockIndex) const
+{
+  int index = getHashIndex(blockIndex);
+
+  return index >= 0 && isBlockFilled(index);
+}
+
+bool ZStackBlockGrid::hasData() const
+{
+  size_t blockCount = std::max(m_stackArray.size(), m_compressedArray.size());
+  for (size_t i = 0; i < blockCount; ++i) {
+    if (isBlockFilled(i)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+const uint8_t* ZStackBlockGrid::getBlockData(
+    int index, std::vector<uint8_t> *buffer) const
+{
+  if (index >= 0) {
+    if (index < (int) m_stackArray.size() && m_stackArray[index] != NULL) {
+      const ZStack *stack = m_stackArray[index];
+      if (stack->kind() == GREY) {
+        return stack->array8();
+      }
+    } else if (index < (int) m_compressedArray.size() &&
+               m_compressedArray[index] != NULL) {
+      const ZCompressedStackBlock *block = m_compressedArray[index];
+      buffer->resize(block->getVoxelNumber());
+      if (block->decode(buffer->data())) {
+        return buffer->data();
+      }
+    }
+  }
+
+  return NULL;
+}
+
+ZIntCuboid ZStackBlockGrid::getBlockDataBox(int index) const
+{
+  ZIntCuboid box;
+  if (index >= 0) {
+    if (index < (int) m_stackArray.size() && m_stackArray[index] != NULL) {
+      box = m_stackArray[index]->getBoundBox();
+    } else if (index < (int) m_compressedArray.size() &&
+               m_compressedArray[index] != NULL) {
+      box = m_compressedArray[index]->getBoundBox();
+    }
+  }
+
+  return box;
+}
+
 
 bool ZStackBlockGrid::hasStack(int x,int y,int z) const
 {
@@ -142,20 +300,111 @@ bool ZStackBlockGrid::hasStack(int x,int y,int z) const
 }
 
 
-int ZStackBlockGrid::getValue(int x, int y, int z) const
+int ZStackBlockGrid::getBlockValue(int index, const ZIntPoint &localPos) const
 {
-  Location location = getLocation(x, y, z);
-  ZStack *stack = getStack(location.getBlockIndex());
   int v = 0;
-  if (stack != NULL) {
-    v = stack->getIntValueLocal(location.getLocalPosition().getX(),
-                                location.getLocalPosition().getY(),
-                                location.getLocalPosition().getZ());
+  if (index >= 0) {
+    if (index < (int) m_stackArray.size() && m_stackArray[index] != NULL) {
+      v = m_stackArray[index]->getIntValueLocal(
+            localPos.getX(), localPos.getY(), localPos.getZ());
+    } else if (index < (int) m_compressedArray.size() &&
+               m_compressedArray[index] != NULL) {
+      const ZCompressedStackBlock *block = m_compressedArray[index];
+      if (block->isRandomAccessible()) {
+        v = block->getValueLocal(
+              localPos.getX(), localPos.getY(), localPos.getZ());
+      } else {
+        //Keep the last decoded block for neighboring queries
+        DecodedBlock &decoded = *m_decodedBlock;
+        std::lock_guard<std::mutex> guard(decoded.mutex);
+        if (decoded.index != index) {
+          decoded.buffer.resize(block->getVoxelNumber());
+          if (block->decode(decoded.buffer.data())) {
+            decoded.index = index;
+          } else {
+            decoded.index = -1;
+          }
+        }
+        if (decoded.index == index) {
+          v = decoded.buffer[
+              (size_t(localPos.getZ()) * block->getHeight() + localPos.getY()) *
+              block->getWidth() + localPos.getX()];
+        }
+      }
+    }
   }
 
   return v;
 }
 
+int ZStackBlockGrid::getValue(int x, int y, int z) const
+{
+  Location location = getLocation(x, y, z);
+
+  return getBlockValue(getHashIndex(location.getBlockIndex()),
+                       location.getLocalPosition());
+}
+
+void ZStackBlockGrid::readBlockRow(
+    int index, const ZIntPoint &localPos, int count, double *buffer,
+    double offset) const
+{
+  if (index < 0) {
+    return;
+  }
+
+  int x0 = localPos.getX();
+  int y = localPos.getY();
+  int z = localPos.getZ();
+
+  if (index < (int) m_stackArray.size() && m_stackArray[index] != NULL) {
+    const ZStack *stack = m_stackArray[index];
+    for (int i = 0; i < count; ++i) {
+      buffer[i] = stack->getIntValueLocal(x0 + i, y, z) + offset;
+    }
+  } else if (index < (int) m_compressedArray.size() &&
+             m_compressedArray[index] != NULL) {
+    const ZCompressedStackBlock *block = m_compressedArray[index];
+    if (block->isRandomAccessible()) {
+      for (int i = 0; i < count; ++i) {
+        buffer[i] = block->getValueLocal(x0 + i, y, z) + offset;
+      }
+    } else {
+      DecodedBlock &decoded = *m_decodedBlock;
+      std::lock_guard<std::mutex> guard(decoded.mutex);
+      if (decoded.index != index) {
+        decoded.buffer.resize(block->getVoxelNumber());
+        if (block->decode(decoded.buffer.data())) {
+          decoded.index = index;
+        } else {
+          decoded.index = -1;
+        }
+      }
+      if (decoded.index == index) {
+        const uint8_t *row = decoded.buffer.data() +
+            (size_t(z) * block->getHeight() + y) * block->getWidth() + x0;
+        for (int i = 0; i < count; ++i) {
+          buffer[i] = row[i] + offset;
+        }
+      }
+    }
+  }
+}
+
+void ZStackBlockGrid::readRow(
+    int x, int y, int z, int count, double *buffer, double offset) const
+{
+  int width = getBlockSize().getX();
+  int num = 0;
+  while (num < count) {
+    Location location = getLocation(x + num, y, z);
+    int n = std::min(count - num, width - location.getLocalPosition().getX());
+    readBlockRow(getHashIndex(location.getBlockIndex()),
+                 location.getLocalPosition(), n, buffer + num, offset);
+    num += n;
+  }
+}
+
 ZStack* ZStackBlockGrid::toStack() const
 {
   if (isEmpty()) {
@@ -176,12 +425,13 @@ ZStack* ZStackBlockGrid::toStack() const
   for (int z = 0; z < m_size.getZ(); ++z) {
     for (int y = 0; y < m_size.getY(); ++y) {
       for (int x = 0; x < m_size.getX(); ++x) {
-        ZStack *stack = getStack(ZIntPoint(x, y, z));
+        ZStack *stack = makeStack(ZIntPoint(x, y, z));
         if (stack != NULL) {
           ZIntCuboid box = getBlockBox(ZIntPoint(x, y, z));
           out->setBlockValue(box.getFirstCorner().getX(),
                              box.getFirstCorner().getY(),
                              box.getFirstCorner().getZ(), stack);
+          delete stack;
         }
       }
     }
@@ -227,18 +477,25 @@ ZStackBlockGrid* ZStackBlockGrid::makeDownsample(
 
   grid->setGridSize(getGridSize());
   grid->setMinPoint(getMinPoint() / ZIntPoint(xintv + 1, yintv + 1, zintv + 1));
+  grid->setCompressing(isCompressing());
 
   if (isEmpty()) {
     grid->clearStack();
   } else {
-    grid->m_stackArray.resize(m_stackArray.size(), NULL);
-    for (size_t i = 0; i < m_stackArray.size(); ++i) {
-      ZStack *stack = m_stackArray[i];
+    size_t blockCount = std::max(m_stackArray.size(), m_compressedArray.size());
+    grid->resizeBlockArray(blockCount);
+    for (size_t i = 0; i < blockCount; ++i) {
+      //Compressed blocks are decompressed one at a time
+      ZStack *dsStack = NULL;
+      if (i < m_stackArray.size() && m_stackArray[i] != NULL) {
+        dsStack = m_stackArray[i]->clone();
+      } else if (i < m_compressedArray.size() && m_compressedArray[i] != NULL) {
+        dsStack = m_compressedArray[i]->toStack();
+      }
 
-      if (stack != NULL) {
-        ZStack *dsStack = stack->clone();
+      if (dsStack != NULL) {
         dsStack->downsampleMin(xintv, yintv, zintv);
-        grid->m_stackArray[i] = dsStack;
+        grid->setBlock(i, dsStack);
       }
     }
   }
@@ -255,14 +512,13 @@ ZIntCuboid ZStackBlockGrid::getStackBoundBox() const
 {
   ZIntCuboid cuboid;
   bool isInitialized = false;
-  for (std::vector<ZStack*>::const_iterator iter = m_stackArray.begin();
-       iter != m_stackArray.end(); ++iter) {
-    const ZStack *stack = *iter;
-    if (stack != NULL) {
+  size_t blockCount = std::max(m_stackArray.size(), m_compressedArray.size());
+  for (size_t i = 0; i < blockCount; ++i) {
+    if (isBlockFilled(i)) {
       if (isInitialized) {
-        cuboid.join(stack->getBoundBox());
+        cuboid.join(getBlockDataBox(i));
       } else {
-        cuboid = stack->getBoundBox();
+        cuboid = getBlockDataBox(i);
         isInitialized = true;
       }
     }
@@ -283,14 +539,14 @@ void ZStackBlockGrid::read(std::istream &stream)
   neutube::read(stream, maxIndex);
 
   if (maxIndex >= 0) {
-    m_stackArray.resize(maxIndex + 1, 0);
+    resizeBlockArray(maxIndex + 1);
     for (int i = 0; i < count; ++i) {
       int index = -1;
       neutube::read(stream, index);
       if (index >= 0) {
         ZStack *stack = new ZStack;
         stack->read(stream);
-        m_stackArray[index] = stack;
+        setBlock(index, stack);
       }
     }
   }
@@ -304,9 +560,9 @@ void ZStackBlockGrid::write(std::ostream &stream) const
 
   int count = 0;
   int maxIndex = -1;
-  for (int i = 0; i < (int) m_stackArray.size(); ++i) {
-    ZStack *stack = m_stackArray[i];
-    if (stack != NULL) {
+  int blockCount = std::max(m_stackArray.size(), m_compressedArray.size());
+  for (int i = 0; i < blockCount; ++i) {
+    if (isBlockFilled(i)) {
       ++count;
       maxIndex = i;
     }
@@ -315,11 +571,146 @@ void ZStackBlockGrid::write(std::ostream &stream) const
   neutube::write(stream, count);
   neutube::write(stream, maxIndex);
 
-  for (int i = 0; i < (int) m_stackArray.size(); ++i) {
-    ZStack *stack = m_stackArray[i];
-    if (stack != NULL) {
+  for (int i = 0; i < blockCount; ++i) {
+    if (i < (int) m_stackArray.size() && m_stackArray[i] != NULL) {
+      neutube::write(stream, i);
+      m_stackArray[i]->write(stream);
+    } else if (isBlockFilled(i)) {
+      ZStack *stack = m_compressedArray[i]->toStack();
       neutube::write(stream, i);
       stack->write(stream);
+      delete stack;
     }
   }
 }
+
+/**************ZStackBlockGrid::MaskedSegmentIterator*****************/
+ZStackBlockGrid::MaskedSegmentIterator::MaskedSegmentIterator(
+    const ZStackBlockGrid *grid, const ZObject3dScan *mask) :
+  m_grid(grid), m_mask(mask)
+{
+  if (m_grid == NULL || m_mask == NULL || m_grid->isEmpty()) {
+    return;
+  }
+
+  //Stripe lookup requires sorted stripes with one stripe per (z, y)
+  if (!m_mask->isCanonized()) {
+    m_canonizedMask = new ZObject3dScan(*m_mask);
+    m_canonizedMask->canonize();
+    m_mask = m_canonizedMask;
+  }
+
+  for (size_t i = 0; i < m_mask->getStripeNumber(); ++i) {
+    const ZObject3dStripe &stripe = m_mask->getStripe(i);
+    for (int j = 0; j < stripe.getSegmentNumber(); ++j) {
+      ZIntPoint blockIndex = m_grid->getBlockIndex(
+            stripe.getSegmentStart(j), stripe.getY(), stripe.getZ());
+      ZIntPoint lastBlockIndex = m_grid->getBlockIndex(
+            stripe.getSegmentEnd(j), stripe.getY(), stripe.getZ());
+      for (; blockIndex.getX() <= lastBlockIndex.getX();
+           blockIndex.setX(blockIndex.getX() + 1)) {
+        if (m_blockArray.empty() || m_blockArray.back() != blockIndex) {
+          m_blockArray.push_back(blockIndex);
+        }
+      }
+    }
+  }
+
+  std::sort(m_blockArray.begin(), m_blockArray.end(),
+            [](const ZIntPoint &p1, const ZIntPoint &p2) {
+    if (p1.getZ() != p2.getZ()) {
+      return p1.getZ() < p2.getZ();
+    }
+    if (p1.getY() != p2.getY()) {
+      return p1.getY() < p2.getY();
+    }
+    return p1.getX() < p2.getX();
+  });
+  m_blockArray.erase(std::unique(m_blockArray.begin(), m_blockArray.end()),
+                     m_blockArray.end());
+
+  loadBlock();
+}
+
+ZStackBlockGrid::MaskedSegmentIterator::~MaskedSegmentIterator()
+{
+  delete m_canonizedMask;
+}
+
+void ZStackBlockGrid::MaskedSegmentIterator::loadBlock()
+{
+  m_segmentArray.clear();
+  m_nextSegment = 0;
+
+  //Skip blocks without any segment, which can happen near block corners
+  while (m_segmentArray.empty() && m_nextBlock < m_blockArray.size()) {
+    const ZIntPoint &blockIndex = m_blockArray[m_nextBlock++];
+    int index = m_grid->getHashIndex(blockIndex);
+    ZIntCuboid blockBox = m_grid->getBlockBox(blockIndex);
+
+    const uint8_t *data = m_grid->getBlockData(index, &m_buffer);
+    ZIntCuboid dataBox;
+    if (data != NULL) {
+      dataBox = m_grid->getBlockDataBox(index);
+    }
+
+    for (int z = blockBox.getFirstCorner().getZ();
+         z <= blockBox.getLastCorner().getZ(); ++z) {
+      //Stripes of the block rows are contiguous in the canonized mask
+      for (size_t stripeIndex = m_mask->lowerBoundStripe(
+             z, blockBox.getFirstCorner().getY());
+           stripeIndex < m_mask->getStripeNumber(); ++stripeIndex) {
+        const ZObject3dStripe &stripe = m_mask->getStripe(stripeIndex);
+        int y = stripe.getY();
+        if (stripe.getZ() != z || y > blockBox.getLastCorner().getY()) {
+          break;
+        }
+        for (int j = 0; j < stripe.getSegmentNumber(); ++j) {
+          Segment seg;
+          seg.x0 = std::max(stripe.getSegmentStart(j),
+                            blockBox.getFirstCorner().getX());
+          seg.x1 = std::min(stripe.getSegmentEnd(j),
+                            blockBox.getLastCorner().getX());
+          seg.y = y;
+          seg.z = z;
+          if (seg.x0 <= seg.x1) {
+            //Values are only available when the stored block covers the
+            //whole segment
+            if (data != NULL && dataBox.contains(seg.x0, y, z) &&
+                dataBox.contains(seg.x1, y, z)) {
+              const ZIntPoint &offset = dataBox.getFirstCorner();
+              seg.value = data +
+                  (size_t(z - offset.getZ()) * dataBox.getHeight() +
+                   (y - offset.getY())) * dataBox.getWidth() +
+                  (seg.x0 - offset.getX());
+            }
+            m_segmentArray.push_back(seg);
+          }
+        }
+      }
+    }
+  }
+}
+
+bool ZStackBlockGrid::MaskedSegmentIterator::hasNext() const
+{
+  return m_nextSegment < m_segmentArray.size();
+}
+
+const ZStackBlockGrid::MaskedSegmentIterator::Segment&
+ZStackBlockGrid::MaskedSegmentIterator::next()
+{
+  if (hasNext()) {
+    m_current = m_segmentArray[m_nextSegment++];
+    if (m_nextSegment == m_segmentArray.size()) {
+      //m_current may point to the decoded buffer, which is moved away before
+      //the next block is decoded
+      m_currentBuffer.swap(m_buffer);
+      loadBlock();
+    }
+  } else {
+    m_current = Segment();
+  }
+
+  return m_current;
+}
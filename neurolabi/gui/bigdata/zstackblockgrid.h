@@ -3,10 +3,15 @@
 
 #include <vector>
 #include <iostream>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 
 #include "zblockgrid.h"
 
 class ZStack;
+class ZObject3dScan;
+class ZCompressedStackBlock;
 
 class ZStackBlockGrid : public ZBlockGrid
 {
@@ -31,11 +36,59 @@ public:
 
   int getValue(int x, int y, int z) const;
 
+  /*!
+   * \brief Read \a count values of a row starting from (\a x, \a y, \a z).
+   *
+   * Each value is added by \a offset and stored in \a buffer. Values in
+   * blocks without data are left unchanged. No block is copied; a compressed
+   * block is decoded into the shared cache of the last decoded block.
+   */
+  void readRow(int x, int y, int z, int count, double *buffer,
+               double offset = 0.0) const;
+
+  /*!
+   * \brief Get the uncompressed stack of a block.
+   *
+   * It returns NULL if the block is compressed. Use makeStack() or getValue()
+   * to read any block.
+   */
   ZStack* getStack(const ZIntPoint &blockIndex) const;
 
+  /*!
+   * \brief Make a copy of the stack of a block.
+   *
+   * A compressed block is decompressed into the copy, which is not kept in
+   * the grid. The caller is responsible for deleting the returned pointer.
+   */
+  ZStack* makeStack(const ZIntPoint &blockIndex) const;
+
+  /*!
+   * \brief Test if a block has data, compressed or not.
+   */
+  bool hasBlock(const ZIntPoint &blockIndex) const;
+
+  /*!
+   * \brief Test if any block has data.
+   */
+  bool hasData() const;
+
   bool  hasStack(int x,int y,int z) const ;
   void clearStack();
 
+  /*!
+   * \brief Turn on or off block compression.
+   *
+   * When it is on, a stack consumed by the grid is stored as a
+   * ZCompressedStackBlock, which is decompressed on access.
+   */
+  void setCompressing(bool on) { m_compressing = on; }
+  bool isCompressing() const { return m_compressing; }
+
+  /*!
+   * \brief Number of bytes used by the block data.
+   */
+  size_t getMemoryUsage() const;
+
   ZStack* toStack() const;
 
   /*!
@@ -53,6 +106,11 @@ public:
   ZStackBlockGrid* makeDownsample(int xintv, int yintv, int zintv) const;
   ZStackBlockGrid* makeDownsample(const ZIntPoint &dsIntv) const;
 
+  /*!
+   * \brief Get the uncompressed stacks.
+   *
+   * Compressed blocks are not included.
+   */
   inline std::vector<ZStack*>& getStackArray() {
     return m_stackArray;
   }
@@ -64,8 +122,74 @@ public:
   void read(std::istream &stream);
   void write(std::ostream &stream) const;
 
+  /*!
+   * \brief Iterator of the mask segments with grid values
+   *
+   * The segments of a mask are visited block by block, so that each
+   * compressed block is decoded at most once and no dense volume is needed.
+   * Each returned segment lies in a single block. Its value array holds the
+   * grid values from x0 to x1 and is valid until the next call of next(). The
+   * value array is NULL if the block has no data.
+   */
+  class MaskedSegmentIterator {
+  public:
+    MaskedSegmentIterator(const ZStackBlockGrid *grid,
+                          const ZObject3dScan *mask);
+    ~MaskedSegmentIterator();
+
+    struct Segment {
+      int x0 = 0;
+      int x1 = -1;
+      int y = 0;
+      int z = 0;
+      const uint8_t *value = nullptr;
+    };
+
+    bool hasNext() const;
+    const Segment& next();
+
+  private:
+    void loadBlock();
+
+  private:
+    const ZStackBlockGrid *m_grid;
+    const ZObject3dScan *m_mask;
+    ZObject3dScan *m_canonizedMask = nullptr;
+    std::vector<ZIntPoint> m_blockArray;
+    size_t m_nextBlock = 0;
+    std::vector<Segment> m_segmentArray;
+    size_t m_nextSegment = 0;
+    std::vector<uint8_t> m_buffer;
+    std::vector<uint8_t> m_currentBuffer;
+    Segment m_current;
+  };
+
+private:
+  bool isBlockFilled(size_t index) const;
+  int getBlockValue(int index, const ZIntPoint &localPos) const;
+  void readBlockRow(int index, const ZIntPoint &localPos, int count,
+                    double *buffer, double offset) const;
+  void setBlock(int index, ZStack *stack);
+  void resizeBlockArray(size_t size);
+  const uint8_t* getBlockData(int index, std::vector<uint8_t> *buffer) const;
+  ZIntCuboid getBlockDataBox(int index) const;
+
+private:
+  //The last decoded block, shared by concurrent getValue() calls
+  struct DecodedBlock {
+    std::mutex mutex;
+    int index = -1;
+    std::vector<uint8_t> buffer;
+  };
+
+  void invalidateDecodedBlock();
+
 private:
   std::vector<ZStack*> m_stackArray;
+  std::vector<ZCompressedStackBlock*> m_compressedArray;
+  bool m_compressing = false;
+
+  std::shared_ptr<DecodedBlock> m_decodedBlock;
 };
 
 #endif // ZSTACKBLOCKGRID_H
@@ -0,0 +1,15 @@
+#include "core/cpufeature.h"
+
+bool neutube::HasAvx2()
+{
+#if defined(NT_AVX2_DISPATCH)
+  static const bool supported = []() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+  }();
+
+  return supported;
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,33 @@
+#ifndef CORE_CPUFEATURE_H
+#define CORE_CPUFEATURE_H
+
+/*
+ * The build does not enable AVX2 (gui.pro only adds -msse3 on some
+ * platforms), so AVX2 code is compiled per function with NT_AVX2_TARGET and
+ * chosen at run time:
+ *
+ *   #if defined(NT_AVX2_DISPATCH)
+ *   NT_AVX2_TARGET void fAvx2();
+ *   #endif
+ *
+ *   #if defined(NT_AVX2_DISPATCH)
+ *   if (neutube::HasAvx2()) { fAvx2(); }
+ *   #endif
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define NT_AVX2_DISPATCH 1
+#  define NT_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+namespace neutube {
+
+/*!
+ * \brief Check if the running CPU supports AVX2.
+ *
+ * It is always false when NT_AVX2_DISPATCH is not defined.
+ */
+bool HasAvx2();
+
+}
+
+#endif // CORE_CPUFEATURE_H
@@ -24,6 +24,7 @@
 #include "dvid/zdvidtarget.h"
 #include "dvid/zdvidreader.h"
 #include "dvid/zdvidsynapse.h"
+#include "dvid/zdvidsynapsestore.h"
 #include "dvid/zdvidroi.h"
 
 #include "flyembodyinfodialog.h"
@@ -250,16 +251,11 @@ void FlyEmBodyInfoDialog::setBodyList(const std::set<uint64_t> &bodyList)
         npre = reader.readSynapseLabelszBody(bodyId, ZDvid::INDEX_PRE_SYN);
         npost = reader.readSynapseLabelszBody(bodyId, ZDvid::INDEX_POST_SYN);
       } else {
-        std::vector<ZDvidSynapse> synapses = reader.readSynapse(
-              bodyId, flyem::EDvidAnnotationLoadMode::PARTNER_LOCATION);
+        ZDvidSynapseStore synapses;
+        reader.readSynapse(bodyId, false, &synapses);
 
-        for (size_t i=0; i<synapses.size(); i++) {
-          if (synapses[i].getKind() == ZDvidSynapse::EKind::KIND_PRE_SYN) {
-            npre++;
-          } else {
-            npost++;
-          }
-        }
+        npre = synapses.countKind(ZDvidSynapseStore::EKind::KIND_PRE_SYN);
+        npost = synapses.size() - npre;
       }
 
       bodyData.setEntry("body ID", bodyId);
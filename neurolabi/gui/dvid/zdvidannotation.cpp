@@ -1,6 +1,7 @@
 #include "zdvidannotation.h"
 
 #include <cmath>
+#include <cstdlib>
 #include <sstream>
 #include <QColor>
 
@@ -13,6 +14,7 @@
 #include "zcuboid.h"
 #include "zresolution.h"
 #include "zdvidutil.h"
+#include "zdvidsynapsestore.h"
 
 ZDvidAnnotation::ZDvidAnnotation()
 {
@@ -405,6 +407,57 @@ void ZDvidAnnotation::loadJsonObject(
   }
 }
 
+void ZDvidAnnotation::loadStore(
+    const ZDvidSynapseStore &store, size_t index,
+    flyem::EDvidAnnotationLoadMode mode)
+{
+  clear();
+
+  m_position = store.getPosition(index);
+  //The store kinds are in the same order
+  setKind(EKind(store.getKind(index)));
+
+  for (size_t i = 0; i < store.getTagNumber(index); ++i) {
+    addTag(store.getTag(index, i));
+  }
+
+  if (mode != flyem::EDvidAnnotationLoadMode::NO_PARTNER) {
+    const std::vector<ZDvidSynapseStore::Relation> &relationArray =
+        store.getRelationArray();
+    for (size_t relationIndex : store.getRelationIndex(index)) {
+      const ZIntPoint &to = relationArray[relationIndex].toPos;
+      switch (mode) {
+      case flyem::EDvidAnnotationLoadMode::PARTNER_RELJSON:
+        m_relJson.append(
+              MakeRelJson(to, store.getRelationName(relationIndex)));
+        break;
+      case flyem::EDvidAnnotationLoadMode::PARTNER_LOCATION:
+        addPartner(to.getX(), to.getY(), to.getZ());
+        break;
+      default:
+        break;
+      }
+    }
+  }
+
+  setDefaultRadius();
+  setDefaultColor();
+
+  for (size_t i = 0; i < store.getPropertyNumber(index); ++i) {
+    const ZDvidSynapseStore::Property &prop = store.getProperty(index, i);
+    const std::string &key = store.getString(prop.key);
+    const std::string &value = store.getString(prop.value);
+    if (!prop.isNumber) {
+      m_propertyJson.setEntry(key, value);
+    } else if (value.find_first_of(".eE") != std::string::npos) {
+      m_propertyJson.setEntry(key.c_str(), std::atof(value.c_str()));
+    } else {
+      m_propertyJson.setEntry(
+            key.c_str(), int64_t(std::strtoll(value.c_str(), NULL, 10)));
+    }
+  }
+}
+
 bool ZDvidAnnotation::isValid() const
 {
   return getKind() != EKind::KIND_INVALID;
@@ -13,6 +13,7 @@
 class ZJsonObject;
 class ZCuboid;
 class ZResolution;
+class ZDvidSynapseStore;
 
 /*
  * Annotation json example:
@@ -89,6 +90,14 @@ public:
   void loadJsonObject(
       const ZJsonObject &obj,
       flyem::EDvidAnnotationLoadMode mode);
+
+  /*!
+   * \brief Load the element \a index of a synapse store.
+   *
+   * It is equivalent to loading the JSON object of the element.
+   */
+  void loadStore(const ZDvidSynapseStore &store, size_t index,
+                 flyem::EDvidAnnotationLoadMode mode);
   ZJsonObject toJsonObject() const;
 
   void clearPartner();
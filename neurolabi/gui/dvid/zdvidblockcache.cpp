@@ -0,0 +1,551 @@
+#include "zdvidblockcache.h"
+
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <sstream>
+#include <zlib.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/file.h>
+#endif
+
+const uint64_t ZDvidBlockCache::DEFAULT_BYTE_BUDGET = 4000000000ull;
+const uint64_t ZDvidBlockCache::DEFAULT_SEGMENT_SIZE = 64000000ull;
+
+/* Segment file layout:
+ *   char[8]  SEGMENT_MAGIC
+ *   Entries, each aligned to 8 bytes:
+ *     uint32  ENTRY_MAGIC
+ *     uint32  Key size
+ *     uint32  Stored size
+ *     uint32  Raw size. The data are deflated iff it differs from the stored
+ *             size.
+ *     uint32  Adler-32 checksum of the key and the stored data
+ *     uint32  Reserved
+ *     Key
+ *     Stored data
+ * An entry whose magic or checksum does not match marks the end of a segment.
+ */
+namespace {
+
+const char SEGMENT_MAGIC[8] = {'N', 'T', 'B', 'C', 'S', 'E', 'G', '1'};
+const uint32_t ENTRY_MAGIC = 0x4b4c424e;
+const uint64_t SEGMENT_HEADER_SIZE = sizeof(SEGMENT_MAGIC);
+const uint64_t ENTRY_HEADER_SIZE = 6 * sizeof(uint32_t);
+
+struct EntryHeader {
+  uint32_t magic;
+  uint32_t keySize;
+  uint32_t storedSize;
+  uint32_t rawSize;
+  uint32_t checksum;
+  uint32_t reserved;
+};
+
+uint64_t AlignEntrySize(uint64_t size)
+{
+  return (size + 7) / 8 * 8;
+}
+
+uint32_t ComputeChecksum(const char *key, uint32_t keySize,
+                         const char *stored, uint32_t storedSize)
+{
+  uLong checksum = adler32(0L, Z_NULL, 0);
+  checksum = adler32(checksum, (const Bytef*) key, keySize);
+  checksum = adler32(checksum, (const Bytef*) stored, storedSize);
+
+  return uint32_t(checksum);
+}
+
+std::string GetNodeKey(const std::string &server, const std::string &uuid)
+{
+  return server + "/" + uuid;
+}
+
+#ifndef _WIN32
+/*!
+ * Reserve the disk space of a file, so that running out of space fails here
+ * instead of raising SIGBUS on writing into the mapped pages.
+ */
+bool AllocateFile(int fd, uint64_t size)
+{
+#if defined(__APPLE__)
+  fstore_t store = {F_ALLOCATEALL, F_PEOFPOSMODE, 0, off_t(size), 0};
+  if (fcntl(fd, F_PREALLOCATE, &store) == -1) {
+    return false;
+  }
+
+  return ftruncate(fd, size) == 0;
+#else
+  return posix_fallocate(fd, 0, size) == 0;
+#endif
+}
+#endif
+
+}
+
+std::string ZDvidBlockCache::Key::toString() const
+{
+  std::ostringstream stream;
+  stream << server << "/" << uuid << "/" << instance << "/" << zoom << "/"
+         << x << "_" << y << "_" << z;
+
+  return stream.str();
+}
+
+ZDvidBlockCache::ZDvidBlockCache()
+{
+}
+
+ZDvidBlockCache::~ZDvidBlockCache()
+{
+  close();
+}
+
+std::string ZDvidBlockCache::getSegmentPath(int id) const
+{
+  char name[32];
+  snprintf(name, sizeof(name), "segment_%08d.dat", id);
+
+  return m_dirPath + "/" + name;
+}
+
+bool ZDvidBlockCache::openSegment(Segment *segment, bool creating)
+{
+#ifndef _WIN32
+  int flags = O_RDWR;
+  if (creating) {
+    flags |= O_CREAT | O_TRUNC;
+  }
+
+  segment->fd = ::open(segment->path.c_str(), flags, 0644);
+  if (segment->fd < 0) {
+    return false;
+  }
+
+  if (creating) {
+    segment->capacity = m_segmentSize;
+    if (!AllocateFile(segment->fd, segment->capacity)) {
+      closeSegment(segment, true);
+      return false;
+    }
+  } else {
+    struct stat fileStat;
+    if (fstat(segment->fd, &fileStat) != 0) {
+      closeSegment(segment, false);
+      return false;
+    }
+    segment->capacity = fileStat.st_size;
+  }
+
+  if (segment->capacity < SEGMENT_HEADER_SIZE) {
+    closeSegment(segment, false);
+    return false;
+  }
+
+  void *data = mmap(NULL, segment->capacity, PROT_READ | PROT_WRITE,
+                    MAP_SHARED, segment->fd, 0);
+  if (data == MAP_FAILED) {
+    closeSegment(segment, false);
+    return false;
+  }
+  segment->data = (char*) data;
+
+  if (creating) {
+    memcpy(segment->data, SEGMENT_MAGIC, SEGMENT_HEADER_SIZE);
+  } else if (memcmp(segment->data, SEGMENT_MAGIC, SEGMENT_HEADER_SIZE) != 0) {
+    closeSegment(segment, false);
+    return false;
+  }
+  segment->used = SEGMENT_HEADER_SIZE;
+
+  return true;
+#else
+  return false;
+#endif
+}
+
+void ZDvidBlockCache::closeSegment(Segment *segment, bool removingFile)
+{
+#ifndef _WIN32
+  if (segment->data != nullptr) {
+    munmap(segment->data, segment->capacity);
+    segment->data = nullptr;
+  }
+  if (segment->fd >= 0) {
+    ::close(segment->fd);
+    segment->fd = -1;
+  }
+  if (removingFile) {
+    unlink(segment->path.c_str());
+  }
+#endif
+  segment->keyArray.clear();
+}
+
+void ZDvidBlockCache::loadSegment(Segment *segment)
+{
+  uint64_t offset = SEGMENT_HEADER_SIZE;
+  while (offset + ENTRY_HEADER_SIZE <= segment->capacity) {
+    EntryHeader header;
+    memcpy(&header, segment->data + offset, ENTRY_HEADER_SIZE);
+    uint64_t entrySize = AlignEntrySize(
+          ENTRY_HEADER_SIZE + uint64_t(header.keySize) + header.storedSize);
+    if (header.magic != ENTRY_MAGIC ||
+        offset + entrySize > segment->capacity) {
+      break;
+    }
+
+    const char *key = segment->data + offset + ENTRY_HEADER_SIZE;
+    if (ComputeChecksum(key, header.keySize, key + header.keySize,
+                        header.storedSize) != header.checksum) {
+      break;
+    }
+
+    std::string keyString(key, header.keySize);
+    Entry &entry = m_entryMap[keyString];
+    entry.segmentId = segment->id;
+    entry.offset = offset;
+    entry.storedSize = header.storedSize;
+    entry.rawSize = header.rawSize;
+    segment->keyArray.push_back(keyString);
+
+    offset += entrySize;
+  }
+
+  segment->used = offset;
+}
+
+bool ZDvidBlockCache::open(
+    const std::string &dirPath, uint64_t byteBudget, uint64_t segmentSize)
+{
+  close();
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+#ifndef _WIN32
+  DIR *dir = opendir(dirPath.c_str());
+  if (dir == NULL) {
+    return false;
+  }
+
+  //Only one process can use the directory. Others run without the cache.
+  m_lockFd = ::open((dirPath + "/lock").c_str(), O_RDWR | O_CREAT, 0644);
+  if (m_lockFd < 0 || flock(m_lockFd, LOCK_EX | LOCK_NB) != 0) {
+    closedir(dir);
+    if (m_lockFd >= 0) {
+      ::close(m_lockFd);
+      m_lockFd = -1;
+    }
+    return false;
+  }
+
+  std::vector<int> idArray;
+  while (struct dirent *item = readdir(dir)) {
+    int id = 0;
+    char tail = 0;
+    if (sscanf(item->d_name, "segment_%d.da%c", &id, &tail) == 2 &&
+        tail == 't') {
+      idArray.push_back(id);
+    }
+  }
+  closedir(dir);
+  std::sort(idArray.begin(), idArray.end());
+
+  m_dirPath = dirPath;
+  m_byteBudget = byteBudget;
+  m_segmentSize = std::max(segmentSize, uint64_t(4096));
+  m_maxSegmentNumber =
+      std::max(uint64_t(2), m_byteBudget / m_segmentSize);
+
+  for (int id : idArray) {
+    Segment segment;
+    segment.id = id;
+    segment.path = getSegmentPath(id);
+    if (openSegment(&segment, false)) {
+      m_segmentList.push_back(segment);
+      loadSegment(&m_segmentList.back());
+    } else {
+      unlink(segment.path.c_str());
+    }
+  }
+
+  while (m_segmentList.size() > m_maxSegmentNumber) {
+    dropOldestSegment();
+  }
+
+  m_isOpen = true;
+#endif
+
+  return m_isOpen;
+}
+
+void ZDvidBlockCache::close()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  for (Segment &segment : m_segmentList) {
+    closeSegment(&segment, false);
+  }
+  m_segmentList.clear();
+  m_entryMap.clear();
+  m_isOpen = false;
+
+#ifndef _WIN32
+  if (m_lockFd >= 0) {
+    flock(m_lockFd, LOCK_UN);
+    ::close(m_lockFd);
+    m_lockFd = -1;
+  }
+#endif
+}
+
+bool ZDvidBlockCache::isOpen() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  return m_isOpen;
+}
+
+void ZDvidBlockCache::clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  while (!m_segmentList.empty()) {
+    dropOldestSegment();
+  }
+  m_entryMap.clear();
+}
+
+ZDvidBlockCache::Segment* ZDvidBlockCache::getSegment(int id)
+{
+  //Segments are ordered by id, which may have gaps after reopening
+  auto iter = std::lower_bound(
+        m_segmentList.begin(), m_segmentList.end(), id,
+        [](const Segment &segment, int id) { return segment.id < id; });
+  if (iter != m_segmentList.end() && iter->id == id) {
+    return &(*iter);
+  }
+
+  return NULL;
+}
+
+void ZDvidBlockCache::dropOldestSegment()
+{
+  Segment &segment = m_segmentList.front();
+  for (const std::string &key : segment.keyArray) {
+    auto iter = m_entryMap.find(key);
+    if (iter != m_entryMap.end() && iter->second.segmentId == segment.id) {
+      m_entryMap.erase(iter);
+    }
+  }
+  closeSegment(&segment, true);
+  m_segmentList.pop_front();
+}
+
+ZDvidBlockCache::Segment* ZDvidBlockCache::prepareSegment(uint64_t entrySize)
+{
+  if (entrySize + SEGMENT_HEADER_SIZE > m_segmentSize) {
+    return NULL;
+  }
+
+  if (!m_segmentList.empty()) {
+    Segment &segment = m_segmentList.back();
+    if (segment.used + entrySize <= segment.capacity) {
+      return &segment;
+    }
+  }
+
+  while (m_segmentList.size() >= m_maxSegmentNumber) {
+    dropOldestSegment();
+  }
+
+  Segment segment;
+  segment.id = m_segmentList.empty() ? 1 : m_segmentList.back().id + 1;
+  segment.path = getSegmentPath(segment.id);
+  if (!openSegment(&segment, true)) {
+    return NULL;
+  }
+  m_segmentList.push_back(segment);
+
+  return &m_segmentList.back();
+}
+
+bool ZDvidBlockCache::append(
+    const std::string &keyString, const char *stored, uint32_t storedSize,
+    uint32_t rawSize)
+{
+  uint64_t entrySize = AlignEntrySize(
+        ENTRY_HEADER_SIZE + keyString.size() + storedSize);
+  Segment *segment = prepareSegment(entrySize);
+  if (segment == NULL) {
+    return false;
+  }
+
+  EntryHeader header;
+  header.magic = ENTRY_MAGIC;
+  header.keySize = keyString.size();
+  header.storedSize = storedSize;
+  header.rawSize = rawSize;
+  header.checksum = ComputeChecksum(
+        keyString.data(), header.keySize, stored, storedSize);
+  header.reserved = 0;
+
+  char *dst = segment->data + segment->used;
+  memcpy(dst, &header, ENTRY_HEADER_SIZE);
+  memcpy(dst + ENTRY_HEADER_SIZE, keyString.data(), keyString.size());
+  memcpy(dst + ENTRY_HEADER_SIZE + keyString.size(), stored, storedSize);
+
+  Entry &entry = m_entryMap[keyString];
+  entry.segmentId = segment->id;
+  entry.offset = segment->used;
+  entry.storedSize = storedSize;
+  entry.rawSize = rawSize;
+  segment->keyArray.push_back(keyString);
+  segment->used += entrySize;
+
+  //Make sure that leftover bytes are not taken as an entry
+  if (segment->used + ENTRY_HEADER_SIZE <= segment->capacity) {
+    memset(segment->data + segment->used, 0, ENTRY_HEADER_SIZE);
+  }
+
+  return true;
+}
+
+bool ZDvidBlockCache::put(const Key &key, const char *data, size_t size)
+{
+  if (data == NULL || size > UINT32_MAX) {
+    return false;
+  }
+
+  std::vector<char> buffer(compressBound(size));
+  uLongf storedSize = buffer.size();
+  const char *stored = data;
+  if (compress2((Bytef*) buffer.data(), &storedSize, (const Bytef*) data,
+                size, Z_BEST_SPEED) == Z_OK && storedSize < size) {
+    stored = buffer.data();
+  } else {
+    storedSize = size;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_isOpen) {
+    return false;
+  }
+
+  return append(key.toString(), stored, storedSize, size);
+}
+
+bool ZDvidBlockCache::get(const Key &key, std::vector<char> *data)
+{
+  std::string keyString = key.toString();
+  std::vector<char> stored;
+  uint32_t rawSize = 0;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto iter = m_entryMap.find(keyString);
+    if (iter == m_entryMap.end()) {
+      return false;
+    }
+
+    Entry entry = iter->second;
+    Segment *segment = getSegment(entry.segmentId);
+    if (segment == NULL) {
+      m_entryMap.erase(iter);
+      return false;
+    }
+
+    EntryHeader header;
+    const char *src = segment->data + entry.offset;
+    memcpy(&header, src, ENTRY_HEADER_SIZE);
+    const char *storedData = src + ENTRY_HEADER_SIZE + header.keySize;
+    if (header.magic != ENTRY_MAGIC ||
+        ComputeChecksum(src + ENTRY_HEADER_SIZE, header.keySize,
+                        storedData, header.storedSize) != header.checksum) {
+      m_entryMap.erase(iter);
+      return false;
+    }
+
+    stored.assign(storedData, storedData + entry.storedSize);
+    rawSize = entry.rawSize;
+
+    //Refresh the block by moving it into the newest segment
+    if (segment != &m_segmentList.back()) {
+      append(keyString, stored.data(), entry.storedSize, rawSize);
+    }
+  }
+
+  if (stored.size() == rawSize) {
+    data->swap(stored);
+  } else {
+    data->resize(rawSize);
+    uLongf size = rawSize;
+    if (uncompress((Bytef*) data->data(), &size, (const Bytef*) stored.data(),
+                   stored.size()) != Z_OK || size != rawSize) {
+      data->clear();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool ZDvidBlockCache::contains(const Key &key) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  return m_entryMap.count(key.toString()) > 0;
+}
+
+int ZDvidBlockCache::getNodeLockState(
+    const std::string &server, const std::string &uuid) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto iter = m_lockMap.find(GetNodeKey(server, uuid));
+  if (iter == m_lockMap.end()) {
+    return -1;
+  }
+
+  return iter->second ? 1 : 0;
+}
+
+void ZDvidBlockCache::setNodeLocked(
+    const std::string &server, const std::string &uuid, bool locked)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_lockMap[GetNodeKey(server, uuid)] = locked;
+}
+
+size_t ZDvidBlockCache::getBlockNumber() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  return m_entryMap.size();
+}
+
+size_t ZDvidBlockCache::getSegmentNumber() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  return m_segmentList.size();
+}
+
+uint64_t ZDvidBlockCache::getDiskUsage() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  uint64_t usage = 0;
+  for (const Segment &segment : m_segmentList) {
+    usage += segment.used;
+  }
+
+  return usage;
+}
@@ -0,0 +1,161 @@
+#ifndef ZDVIDBLOCKCACHE_H
+#define ZDVIDBLOCKCACHE_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+/*!
+ * \brief The class of persistent block cache for DVID data
+ *
+ * Blocks are keyed by (server, uuid, instance, zoom, block coordinate) and
+ * stored zlib-compressed in memory-mapped segment files under a cache
+ * directory, so that they survive across sessions. Only blocks of locked
+ * nodes should be put into the cache because a cached block is never checked
+ * against the server again.
+ *
+ * Each segment file has a fixed capacity and blocks are appended to the
+ * newest one. When a new segment would exceed the byte budget, the oldest
+ * segment is deleted with all its blocks. A block read from an older segment
+ * is copied into the newest segment, so the eviction follows the order of
+ * last use at the granularity of segments.
+ *
+ * The cache is thread safe. A cache directory is used by one process at a
+ * time. The cache is not available on Windows, where open() always fails.
+ */
+class ZDvidBlockCache
+{
+public:
+  ZDvidBlockCache();
+  ~ZDvidBlockCache();
+
+  static ZDvidBlockCache& GetInstance() {
+    static ZDvidBlockCache cache;
+
+    return cache;
+  }
+
+  struct Key {
+    std::string server;
+    std::string uuid;
+    std::string instance;
+    int zoom = 0;
+    int x = 0;
+    int y = 0;
+    int z = 0;
+
+    std::string toString() const;
+  };
+
+  const static uint64_t DEFAULT_BYTE_BUDGET;
+  const static uint64_t DEFAULT_SEGMENT_SIZE;
+
+  /*!
+   * \brief Open a cache directory.
+   *
+   * Existing segment files in \a dirPath are loaded. The directory must
+   * exist. The number of segments is limited to \a byteBudget / \a segmentSize
+   * and is at least 2. The directory is locked until close(), so it fails if
+   * the directory is used by another cache, e.g. in another process.
+   *
+   * \return true iff the cache is opened successfully.
+   */
+  bool open(const std::string &dirPath,
+            uint64_t byteBudget = DEFAULT_BYTE_BUDGET,
+            uint64_t segmentSize = DEFAULT_SEGMENT_SIZE);
+  void close();
+
+  bool isOpen() const;
+
+  /*!
+   * \brief Store a block.
+   *
+   * A block that is already cached is replaced.
+   *
+   * \return false if the cache is not open or the block does not fit into a
+   *         segment.
+   */
+  bool put(const Key &key, const char *data, size_t size);
+
+  /*!
+   * \brief Read a block.
+   *
+   * \return true iff the block is found and intact, in which case its
+   *         uncompressed bytes are stored in \a data.
+   */
+  bool get(const Key &key, std::vector<char> *data);
+
+  bool contains(const Key &key) const;
+
+  /*!
+   * \brief Remove all blocks and segment files.
+   */
+  void clear();
+
+  /*!
+   * \brief Lock state of a node
+   *
+   * The cache remembers which nodes are known to be locked so that readers
+   * do not need to ask the server again. The state is 1 for locked, 0 for
+   * unlocked and -1 for unknown.
+   */
+  int getNodeLockState(const std::string &server, const std::string &uuid) const;
+  void setNodeLocked(const std::string &server, const std::string &uuid,
+                     bool locked);
+
+  size_t getBlockNumber() const;
+  size_t getSegmentNumber() const;
+
+  /*!
+   * \brief Number of bytes written into the segment files.
+   */
+  uint64_t getDiskUsage() const;
+
+  uint64_t getByteBudget() const { return m_byteBudget; }
+
+private:
+  struct Segment {
+    int id = 0;
+    std::string path;
+    int fd = -1;
+    char *data = nullptr;
+    uint64_t capacity = 0;
+    uint64_t used = 0;
+    std::vector<std::string> keyArray;
+  };
+
+  struct Entry {
+    int segmentId = 0;
+    uint64_t offset = 0;
+    uint32_t storedSize = 0;
+    uint32_t rawSize = 0;
+  };
+
+  bool openSegment(Segment *segment, bool creating);
+  void closeSegment(Segment *segment, bool removingFile);
+  void loadSegment(Segment *segment);
+  Segment* getSegment(int id);
+  Segment* prepareSegment(uint64_t entrySize);
+  bool append(const std::string &keyString, const char *stored,
+              uint32_t storedSize, uint32_t rawSize);
+  void dropOldestSegment();
+  std::string getSegmentPath(int id) const;
+
+private:
+  mutable std::mutex m_mutex;
+  std::string m_dirPath;
+  uint64_t m_byteBudget = 0;
+  uint64_t m_segmentSize = 0;
+  size_t m_maxSegmentNumber = 0;
+  std::deque<Segment> m_segmentList; //from the oldest to the newest
+  std::unordered_map<std::string, Entry> m_entryMap;
+  std::map<std::string, bool> m_lockMap;
+  bool m_isOpen = false;
+  int m_lockFd = -1;
+};
+
+#endif // ZDVIDBLOCKCACHE_H
@@ -0,0 +1,167 @@
+#include "zdvidbodyidresolver.h"
+
+#include <string>
+#include <map>
+#include <algorithm>
+
+#include "zjsonarray.h"
+#include "zjsonparser.h"
+#include "zintcuboid.h"
+#include "dvid/zdvidurl.h"
+
+const size_t ZDvidBodyIdResolver::DEFAULT_CHUNK_SIZE = 1000;
+
+namespace {
+
+int FloorDivide(int v, int d)
+{
+  return (v >= 0) ? v / d : -((-v + d - 1) / d);
+}
+
+QByteArray MakePointPayload(
+    const std::vector<ZIntPoint> &ptArray,
+    std::vector<size_t>::const_iterator first,
+    std::vector<size_t>::const_iterator last)
+{
+  std::string payload = "[";
+  for (auto iter = first; iter != last; ++iter) {
+    const ZIntPoint &pt = ptArray[*iter];
+    if (iter != first) {
+      payload += ",";
+    }
+    payload += "[" + std::to_string(pt.getX()) + "," +
+        std::to_string(pt.getY()) + "," + std::to_string(pt.getZ()) + "]";
+  }
+  payload += "]";
+
+  return QByteArray(payload.c_str(), int(payload.size()));
+}
+
+}
+
+ZDvidBodyIdResolver::ZDvidBodyIdResolver(const ZDvidTarget &target) :
+  m_target(target), m_blockSize(64, 64, 64), m_chunkSize(DEFAULT_CHUNK_SIZE)
+{
+}
+
+void ZDvidBodyIdResolver::setBlockSize(const ZIntPoint &blockSize)
+{
+  if (blockSize.getX() > 0 && blockSize.getY() > 0 && blockSize.getZ() > 0) {
+    m_blockSize = blockSize;
+  }
+}
+
+void ZDvidBodyIdResolver::setChunkSize(size_t chunkSize)
+{
+  m_chunkSize = std::max(size_t(1), chunkSize);
+}
+
+void ZDvidBodyIdResolver::addLabelSource(const LabelSource &source)
+{
+  if (source) {
+    m_sourceArray.push_back(source);
+  }
+}
+
+ZIntPoint ZDvidBodyIdResolver::getBlockIndex(const ZIntPoint &pt) const
+{
+  return ZIntPoint(FloorDivide(pt.getX(), m_blockSize.getX()),
+                   FloorDivide(pt.getY(), m_blockSize.getY()),
+                   FloorDivide(pt.getZ(), m_blockSize.getZ()));
+}
+
+bool ZDvidBodyIdResolver::resolveLocally(
+    const ZIntPoint &pt, uint64_t *bodyId) const
+{
+  for (const LabelSource &source : m_sourceArray) {
+    if (source(pt, bodyId)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+std::vector<uint64_t> ZDvidBodyIdResolver::resolve(
+    const std::vector<ZIntPoint> &ptArray)
+{
+  m_statusCode = 200;
+  m_localCount = 0;
+  m_requestCount = 0;
+
+  std::vector<uint64_t> result(ptArray.size(), 0);
+
+  //Stage 1: group points by block
+  std::map<ZIntPoint, std::vector<size_t>> groupMap;
+  for (size_t i = 0; i < ptArray.size(); ++i) {
+    const ZIntPoint &pt = ptArray[i];
+    if (pt.isValid()) {
+      groupMap[getBlockIndex(pt)].push_back(i);
+    }
+  }
+
+  //Stage 2: local lookup
+  std::vector<size_t> remoteIndexArray;
+  for (const auto &group : groupMap) {
+    for (size_t index : group.second) {
+      if (resolveLocally(ptArray[index], &result[index])) {
+        ++m_localCount;
+      } else {
+        remoteIndexArray.push_back(index);
+      }
+    }
+  }
+
+  //Stage 3: parallel requests of the remaining points
+  if (!remoteIndexArray.empty()) {
+    std::string url = ZDvidUrl(m_target).getLocalBodyIdArrayUrl();
+    if (url.empty()) {
+      m_statusCode = 0;
+      return std::vector<uint64_t>();
+    }
+
+    std::vector<std::pair<size_t, ZDvidRequestEngine::Handle>> handleArray;
+    for (size_t start = 0; start < remoteIndexArray.size();
+         start += m_chunkSize) {
+      size_t end = std::min(start + m_chunkSize, remoteIndexArray.size());
+      ZDvidRequestEngine::Request request;
+      request.url = url.c_str();
+      request.method = "GET";
+      request.tryingCompress = true;
+      request.payload = MakePointPayload(
+            ptArray, remoteIndexArray.begin() + start,
+            remoteIndexArray.begin() + end);
+      handleArray.emplace_back(
+            start, ZDvidRequestEngine::GetInstance().submit(request));
+      ++m_requestCount;
+    }
+
+    for (auto &entry : handleArray) {
+      size_t start = entry.first;
+      size_t end = std::min(start + m_chunkSize, remoteIndexArray.size());
+      ZDvidRequestEngine::Result chunkResult = entry.second.getResult();
+      if (chunkResult.statusCode != 200) {
+        m_statusCode = chunkResult.statusCode;
+        continue;
+      }
+
+      ZJsonArray idJson;
+      idJson.decodeString(chunkResult.buffer.constData());
+      if (idJson.size() != end - start) {
+        m_statusCode = 0;
+        continue;
+      }
+
+      for (size_t i = start; i < end; ++i) {
+        result[remoteIndexArray[i]] =
+            (uint64_t) ZJsonParser::integerValue(idJson.at(i - start));
+      }
+    }
+
+    if (m_statusCode != 200) {
+      result.clear();
+    }
+  }
+
+  return result;
+}
@@ -0,0 +1,85 @@
+#ifndef ZDVIDBODYIDRESOLVER_H
+#define ZDVIDBODYIDRESOLVER_H
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+#include "zintpoint.h"
+#include "dvid/zdvidtarget.h"
+#include "dvid/zdvidrequestengine.h"
+
+/*!
+ * \brief The class of looking up body IDs of many points
+ *
+ * A batch of points is resolved in three stages:
+ *   1. Points are grouped by the label block they fall in.
+ *   2. Points are answered locally when possible by the label sources added
+ *      by addLabelSource(), such as the data of a loaded label slice.
+ *   3. The remaining points, still grouped by block, are sent to DVID in
+ *      chunks of getChunkSize() points. The chunks are requested in parallel
+ *      through the shared ZDvidRequestEngine.
+ *
+ * The body IDs are returned in the order of the input points.
+ */
+class ZDvidBodyIdResolver
+{
+public:
+  explicit ZDvidBodyIdResolver(const ZDvidTarget &target);
+
+  /*!
+   * \brief The function of looking up a label locally.
+   *
+   * It returns false if the label of the point is not available.
+   */
+  typedef std::function<bool(const ZIntPoint&, uint64_t*)> LabelSource;
+
+  const static size_t DEFAULT_CHUNK_SIZE;
+
+  void setBlockSize(const ZIntPoint &blockSize);
+  const ZIntPoint& getBlockSize() const { return m_blockSize; }
+
+  void setChunkSize(size_t chunkSize);
+  size_t getChunkSize() const { return m_chunkSize; }
+
+  void addLabelSource(const LabelSource &source);
+
+  /*!
+   * \brief Resolve body IDs of \a ptArray.
+   *
+   * \return Body IDs in the order of \a ptArray, or an empty array if any
+   *         remote request fails. An invalid point gets 0.
+   */
+  std::vector<uint64_t> resolve(const std::vector<ZIntPoint> &ptArray);
+
+  /*!
+   * \brief Status code of the last failed request, or 200 if all succeeded.
+   */
+  int getStatusCode() const { return m_statusCode; }
+
+  /*!
+   * \brief Number of points answered locally in the last resolve() call.
+   */
+  size_t getLocalCount() const { return m_localCount; }
+
+  /*!
+   * \brief Number of requests sent in the last resolve() call.
+   */
+  size_t getRequestCount() const { return m_requestCount; }
+
+private:
+  ZIntPoint getBlockIndex(const ZIntPoint &pt) const;
+  bool resolveLocally(const ZIntPoint &pt, uint64_t *bodyId) const;
+
+private:
+  ZDvidTarget m_target;
+  ZIntPoint m_blockSize;
+  size_t m_chunkSize;
+  std::vector<LabelSource> m_sourceArray;
+
+  int m_statusCode = 0;
+  size_t m_localCount = 0;
+  size_t m_requestCount = 0;
+};
+
+#endif // ZDVIDBODYIDRESOLVER_H
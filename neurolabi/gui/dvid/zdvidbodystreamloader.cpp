@@ -0,0 +1,275 @@
+#include "zdvidbodystreamloader.h"
+
+#include <algorithm>
+
+#include "zqslog.h"
+#include "zobject3dscan.h"
+#include "geometry/zgeometry.h"
+#include "dvid/zdvidreader.h"
+#include "dvid/zdvidurl.h"
+#include "dvid/zdvidinfo.h"
+#include "dvid/zdvidmetrics.h"
+
+const int ZDvidBodyStreamLoader::DEFAULT_PART_DEPTH = 256;
+const int ZDvidBodyStreamLoader::DEFAULT_MAX_PART_NUMBER = 64;
+const size_t ZDvidBodyStreamLoader::DEFAULT_MIN_BLOCK_NUMBER = 512;
+
+namespace {
+
+int FloorDivide(int v, int d)
+{
+  return (v >= 0) ? v / d : -((-v + d - 1) / d);
+}
+
+int CeilAlign(int v, int alignment)
+{
+  return (v + alignment - 1) / alignment * alignment;
+}
+
+}
+
+ZDvidBodyStreamLoader::ZDvidBodyStreamLoader(const ZDvidReader &reader) :
+  m_reader(reader), m_partDepth(DEFAULT_PART_DEPTH),
+  m_maxPartNumber(DEFAULT_MAX_PART_NUMBER),
+  m_minBlockNumber(DEFAULT_MIN_BLOCK_NUMBER)
+{
+}
+
+void ZDvidBodyStreamLoader::setPartDepth(int depth)
+{
+  m_partDepth = std::max(1, depth);
+}
+
+void ZDvidBodyStreamLoader::setMaxPartNumber(int n)
+{
+  m_maxPartNumber = std::max(1, n);
+}
+
+void ZDvidBodyStreamLoader::setMinBlockNumber(size_t n)
+{
+  m_minBlockNumber = n;
+}
+
+void ZDvidBodyStreamLoader::setRequestEngine(ZDvidRequestEngine *engine)
+{
+  m_engine = engine;
+}
+
+std::vector<std::pair<int, int>> ZDvidBodyStreamLoader::MakePartition(
+    int minZ, int maxZ, int alignment, int partDepth, int maxPartNumber)
+{
+  std::vector<std::pair<int, int>> partition;
+
+  if (minZ > maxZ || alignment <= 0) {
+    return partition;
+  }
+
+  int startZ = FloorDivide(minZ, alignment) * alignment;
+  int depth = CeilAlign(std::max(1, partDepth), alignment);
+  int totalDepth = maxZ - startZ + 1;
+  if (maxPartNumber > 0 && (totalDepth + depth - 1) / depth > maxPartNumber) {
+    depth = CeilAlign((totalDepth + maxPartNumber - 1) / maxPartNumber,
+                      alignment);
+  }
+
+  for (int z = startZ; z <= maxZ; z += depth) {
+    partition.emplace_back(z, std::min(maxZ, z + depth - 1));
+  }
+
+  return partition;
+}
+
+std::vector<std::pair<int, int>> ZDvidBodyStreamLoader::makePartition(
+    const ZObject3dScan &coarseBody, const ZDvidInfo &dvidInfo, int zoom) const
+{
+  if (coarseBody.isEmpty() || coarseBody.getVoxelNumber() < m_minBlockNumber) {
+    return std::vector<std::pair<int, int>>();
+  }
+
+  int blockDepth = dvidInfo.getBlockSize().getZ();
+  int minZ = dvidInfo.getCoordZ(coarseBody.getMinZ());
+  int maxZ = dvidInfo.getCoordZ(coarseBody.getMaxZ()) + blockDepth - 1;
+
+  //Aligned to blocks at the loading scale so that no block is cut
+  return MakePartition(minZ, maxZ, blockDepth * zgeom::GetZoomScale(zoom),
+                       m_partDepth, m_maxPartNumber);
+}
+
+void ZDvidBodyStreamLoader::cancel()
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  m_canceled = true;
+  for (ZDvidRequestEngine::Handle &handle : m_handleArray) {
+    handle.cancel();
+  }
+}
+
+bool ZDvidBodyStreamLoader::isCanceled() const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_canceled;
+}
+
+ZObject3dScan* ZDvidBodyStreamLoader::load(
+    uint64_t bodyId, flyem::EBodyLabelType labelType, int zoom,
+    bool canonizing, ZObject3dScan *result, const PartCallback &callback)
+{
+  m_statusCode = 200;
+  if (result != NULL) {
+    result->clear();
+  }
+
+  if (!m_reader.isReady()) {
+    return result;
+  }
+
+  if (result == NULL) {
+    result = new ZObject3dScan;
+  }
+
+  ZObject3dScan coarseBody = m_reader.readCoarseBody(bodyId, labelType);
+  if (coarseBody.isEmpty()) {
+    return result;
+  }
+
+  std::vector<std::pair<int, int>> partition =
+      makePartition(coarseBody, m_reader.readLabelInfo(), zoom);
+
+  ZDvidUrl::SparsevolConfig config;
+  config.bodyId = bodyId;
+  config.zoom = zoom;
+  config.labelType = labelType;
+  bool blockCoding = m_reader.getDvidTarget().hasBlockCoding();
+  if (blockCoding) {
+    config.format = "blocks";
+  }
+  ZDvidUrl dvidUrl(m_reader.getDvidTarget());
+  std::string url = dvidUrl.getSparsevolUrl(config);
+
+  std::vector<std::string> urlArray;
+  if (partition.empty()) { //Small body in one request
+    urlArray.push_back(url);
+  } else {
+    for (const std::pair<int, int> &part : partition) {
+      urlArray.push_back(ZDvidUrl::AppendRangeQuery(
+                           url, part.first, part.second, neutube::EAxis::Z,
+                           false));
+    }
+  }
+
+  loadParts(bodyId, urlArray, blockCoding, canonizing, result, callback);
+  if (!result->isEmpty()) {
+    result->setDsIntv(zgeom::GetZoomScale(zoom) - 1);
+  }
+
+  return result;
+}
+
+ZObject3dScan* ZDvidBodyStreamLoader::loadParts(
+    uint64_t bodyId, const std::vector<std::string> &urlArray,
+    bool blockCoding, bool canonizing, ZObject3dScan *result,
+    const PartCallback &callback)
+{
+  m_statusCode = 200;
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_canceled = false;
+    m_handleArray.clear();
+  }
+
+  if (result == NULL) {
+    result = new ZObject3dScan;
+  } else {
+    result->clear();
+  }
+
+  ZDvidRequestEngine &engine =
+      (m_engine == NULL) ? ZDvidRequestEngine::GetInstance() : *m_engine;
+
+  int partNumber = int(urlArray.size());
+  std::vector<std::shared_ptr<ZObject3dScan>> partArray(urlArray.size());
+  std::mutex callbackMutex;
+
+  for (int i = 0; i < partNumber; ++i) {
+    ZDvidRequestEngine::Request request;
+    request.url = urlArray[i].c_str();
+
+    //Decoded in the worker thread as soon as the part arrives
+    ZDvidRequestEngine::Handle handle = engine.submit(
+          request, [&, i](const ZDvidRequestEngine::Result &partResult) {
+      if (partResult.statusCode == 200 && !partResult.buffer.isEmpty()) {
+        std::shared_ptr<ZObject3dScan> partPtr =
+            std::make_shared<ZObject3dScan>();
+        ZObject3dScan &part = *partPtr;
+        ZDvidMetrics::Timer timer;
+        if (blockCoding) {
+          part.importDvidBlockBuffer(
+                partResult.buffer.constData(), partResult.buffer.size(),
+                canonizing);
+        } else {
+          part.importDvidObjectBuffer(
+                partResult.buffer.constData(), partResult.buffer.size());
+          if (canonizing) {
+            part.canonize();
+          }
+        }
+        ZDvidMetrics::GetInstance().recordDecode(
+              ZDvidMetrics::EEndpoint::SPARSEVOL, timer.elapsed());
+        part.setLabel(bodyId);
+        partArray[i] = partPtr;
+
+        if (callback && !isCanceled()) {
+          std::lock_guard<std::mutex> guard(callbackMutex);
+          callback(partPtr, i, partNumber);
+        }
+      }
+    });
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (m_canceled) {
+      handle.cancel();
+    }
+    m_handleArray.push_back(handle);
+  }
+
+  std::vector<ZDvidRequestEngine::Handle> handleArray;
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    handleArray = m_handleArray;
+  }
+
+  for (const ZDvidRequestEngine::Handle &handle : handleArray) {
+    ZDvidRequestEngine::Result partResult = handle.getResult();
+    //An empty part may be reported as not found
+    if (partResult.status != neutube::EReadStatus::CANCELED &&
+        partResult.statusCode != 200 && partResult.statusCode != 404) {
+      m_statusCode = partResult.statusCode;
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_handleArray.clear();
+  }
+
+  if (isCanceled()) {
+    return result;
+  }
+
+  if (m_statusCode != 200) {
+    LWARN() << "Failed to load body" << bodyId << "in" << partNumber
+            << "parts:" << m_statusCode;
+    return result;
+  }
+
+  //Parts are disjoint and sorted in z. Each part is released once merged.
+  for (std::shared_ptr<ZObject3dScan> &part : partArray) {
+    if (part) {
+      result->concat(*part);
+      part.reset();
+    }
+  }
+  result->setLabel(bodyId);
+
+  return result;
+}
@@ -0,0 +1,156 @@
+#ifndef ZDVIDBODYSTREAMLOADER_H
+#define ZDVIDBODYSTREAMLOADER_H
+
+#include <vector>
+#include <utility>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <cstdint>
+
+#include "neutube_def.h"
+#include "dvid/zdvidrequestengine.h"
+
+class ZDvidReader;
+class ZDvidInfo;
+class ZObject3dScan;
+
+/*!
+ * \brief The class of loading a body in parallel z partitions
+ *
+ * The z range of a body, which is obtained from its coarse body, is split into
+ * partitions aligned to label blocks. The sparsevol of each partition is
+ * requested through the shared ZDvidRequestEngine, so the partitions are
+ * downloaded in parallel. Each partition is decoded in a worker thread as soon
+ * as it arrives and then passed to the part callback, which allows a caller to
+ * show a large body progressively. Since the partitions are disjoint and
+ * sorted in z, the final body is a concatenation of the decoded parts.
+ *
+ * A body whose coarse body has fewer than getMinBlockNumber() blocks is loaded
+ * in one request, which is still passed to the callback as a single part.
+ */
+class ZDvidBodyStreamLoader
+{
+public:
+  /*!
+   * \brief Constructor
+   *
+   * \a reader is used in load() for reading the coarse body and label info.
+   * It must stay alive while load() is running.
+   */
+  explicit ZDvidBodyStreamLoader(const ZDvidReader &reader);
+
+  /*!
+   * \brief The function of receiving a decoded part.
+   *
+   * It is called in a worker thread, one call at a time, with the part, the
+   * index of the part and the total number of parts. Parts may arrive in any
+   * order. The part is shared with the loader, so the receiver can keep it
+   * without copying, but it must not change the voxels of the part. Setting
+   * its color is allowed.
+   */
+  typedef std::function<void(
+      const std::shared_ptr<ZObject3dScan>&, int, int)> PartCallback;
+
+  const static int DEFAULT_PART_DEPTH;
+  const static int DEFAULT_MAX_PART_NUMBER;
+  const static size_t DEFAULT_MIN_BLOCK_NUMBER;
+
+  /*!
+   * \brief Set the preferred depth of a partition in voxels at zoom 0.
+   *
+   * The actual depth is a multiple of the block depth at the loading zoom.
+   */
+  void setPartDepth(int depth);
+  int getPartDepth() const { return m_partDepth; }
+
+  void setMaxPartNumber(int n);
+  int getMaxPartNumber() const { return m_maxPartNumber; }
+
+  /*!
+   * \brief Set the minimal number of blocks of a body to be partitioned.
+   */
+  void setMinBlockNumber(size_t n);
+  size_t getMinBlockNumber() const { return m_minBlockNumber; }
+
+  /*!
+   * \brief Set the engine of running the part requests.
+   *
+   * The shared engine is used if \a engine is NULL.
+   */
+  void setRequestEngine(ZDvidRequestEngine *engine);
+
+  /*!
+   * \brief Load a body.
+   *
+   * A new object is created if \a result is NULL. The result is empty if the
+   * body cannot be loaded or the loading is canceled.
+   */
+  ZObject3dScan* load(
+      uint64_t bodyId, flyem::EBodyLabelType labelType, int zoom,
+      bool canonizing, ZObject3dScan *result,
+      const PartCallback &callback = PartCallback());
+
+  /*!
+   * \brief Load a body from the sparsevol urls of its parts.
+   *
+   * The parts must be disjoint and ordered in z. load() uses it after
+   * computing the urls from the coarse body of \a bodyId.
+   */
+  ZObject3dScan* loadParts(
+      uint64_t bodyId, const std::vector<std::string> &urlArray,
+      bool blockCoding, bool canonizing, ZObject3dScan *result,
+      const PartCallback &callback = PartCallback());
+
+  /*!
+   * \brief Get the z partition of a body at \a zoom.
+   *
+   * \a coarseBody is in the block space described by \a dvidInfo. It returns
+   * an empty partition if the coarse body has fewer than getMinBlockNumber()
+   * blocks.
+   */
+  std::vector<std::pair<int, int>> makePartition(
+      const ZObject3dScan &coarseBody, const ZDvidInfo &dvidInfo,
+      int zoom) const;
+
+  /*!
+   * \brief Cancel the current loading.
+   *
+   * It can be called from any thread. load() returns after the parts being
+   * downloaded are done.
+   */
+  void cancel();
+  bool isCanceled() const;
+
+  /*!
+   * \brief Status code of the last failed part, or 200 if all succeeded.
+   */
+  int getStatusCode() const { return m_statusCode; }
+
+  /*!
+   * \brief Split [\a minZ, \a maxZ] into partitions.
+   *
+   * Each partition starts at a multiple of \a alignment and has a depth of
+   * \a partDepth rounded up to \a alignment, which is increased when there
+   * would be more than \a maxPartNumber partitions.
+   *
+   * \return Inclusive z ranges in increasing order.
+   */
+  static std::vector<std::pair<int, int>> MakePartition(
+      int minZ, int maxZ, int alignment, int partDepth, int maxPartNumber);
+
+private:
+  const ZDvidReader &m_reader;
+  int m_partDepth;
+  int m_maxPartNumber;
+  size_t m_minBlockNumber;
+  ZDvidRequestEngine *m_engine = NULL;
+  int m_statusCode = 0;
+
+  mutable std::mutex m_mutex;
+  bool m_canceled = false;
+  std::vector<ZDvidRequestEngine::Handle> m_handleArray;
+};
+
+#endif // ZDVIDBODYSTREAMLOADER_H
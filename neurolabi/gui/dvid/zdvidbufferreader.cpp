@@ -18,6 +18,56 @@
 #include "flyem/zflyemmisc.h"
 #include "zdvidutil.h"
 #include "znetbufferreader.h"
+#include "dvid/zdvidrequestengine.h"
+#include "dvid/zdvidrequestcoalescer.h"
+#include "dvid/zdvidmetrics.h"
+
+#if defined(_ENABLE_LIBDVIDCPP_)
+namespace {
+
+/*!
+ * Borrows a service from the shared request engine and returns it when going
+ * out of scope.
+ */
+class PooledService
+{
+public:
+  explicit PooledService(const ZDvidTarget &target) : m_target(target) {
+    m_service = ZDvidRequestEngine::GetInstance().acquireService(target);
+  }
+
+  ~PooledService() {
+    if (m_reusable) {
+      ZDvidRequestEngine::GetInstance().releaseService(m_target, m_service);
+    }
+  }
+
+  /*!
+   * The service is dropped instead of being returned to the pool after an
+   * exception other than DVIDException, which may leave the connection in a
+   * bad state.
+   */
+  libdvid::BinaryDataPtr customRequest(
+      const std::string &endPoint, libdvid::BinaryDataPtr payload,
+      libdvid::ConnectionMethod method, bool compress) {
+    try {
+      return m_service->custom_request(endPoint, payload, method, compress);
+    } catch (libdvid::DVIDException &) {
+      throw;
+    } catch (std::exception &) {
+      m_reusable = false;
+      throw;
+    }
+  }
+
+private:
+  const ZDvidTarget &m_target;
+  ZSharedPointer<libdvid::DVIDNodeService> m_service;
+  bool m_reusable = true;
+};
+
+}
+#endif
 
 ZDvidBufferReader::ZDvidBufferReader()
 {
@@ -113,40 +163,54 @@ void ZDvidBufferReader::read(
   target.setFromUrl(url.toStdString());
 
   if (target.isValid()) {
-    try {
-      std::string endPoint = ZDvidUrl::GetPath(url.toStdString());
-      libdvid::BinaryDataPtr libdvidPayload =
-          libdvid::BinaryData::create_binary_data(payload.data(), payload.length());
-      libdvid::BinaryDataPtr data;
-
-      libdvid::ConnectionMethod connMeth = libdvid::GET;
-      if (method == "POST") {
-        connMeth = libdvid::POST;
-      } else if (method == "PUT") {
-        connMeth = libdvid::PUT;
-      }
-      if (m_service.get() != NULL) {
-        data = m_service->custom_request(
-              endPoint, libdvidPayload, connMeth, m_tryingCompress);
-      } else {
-#if 0
-        libdvid::DVIDNodeService service(
-              target.getAddressWithPort(), target.getUuid());
-#endif
-        ZSharedPointer<libdvid::DVIDNodeService> service =
-            ZDvid::MakeDvidNodeService(target);
-        data = service->custom_request(
-            endPoint, libdvidPayload, connMeth, m_tryingCompress);
+    auto fetcher = [&]() {
+      ZDvidRequestCoalescer::Result result;
+      result.status = neutube::EReadStatus::FAILED;
+      ZDvidMetrics::Timer timer;
+      try {
+        std::string endPoint = ZDvidUrl::GetPath(url.toStdString());
+        libdvid::BinaryDataPtr libdvidPayload =
+            libdvid::BinaryData::create_binary_data(
+              payload.data(), payload.length());
+        libdvid::BinaryDataPtr data;
+
+        libdvid::ConnectionMethod connMeth = libdvid::GET;
+        if (method == "POST") {
+          connMeth = libdvid::POST;
+        } else if (method == "PUT") {
+          connMeth = libdvid::PUT;
+        }
+        if (m_service.get() != NULL) {
+          data = m_service->custom_request(
+                endPoint, libdvidPayload, connMeth, m_tryingCompress);
+        } else {
+          PooledService service(target);
+          data = service.customRequest(
+                endPoint, libdvidPayload, connMeth, m_tryingCompress);
+        }
+
+        result.buffer.append(data->get_data().c_str(), data->length());
+        result.status = neutube::EReadStatus::OK;
+        result.statusCode = 200;
+      } catch (libdvid::DVIDException &e) {
+        STD_COUT << e.what() << std::endl;
+        result.statusCode = e.getStatus();
       }
-
-      m_buffer.append(data->get_data().c_str(), data->length());
-      m_status = neutube::EReadStatus::OK;
-      m_statusCode = 200;
-    } catch (libdvid::DVIDException &e) {
-      STD_COUT << e.what() << std::endl;
-      m_status = neutube::EReadStatus::FAILED;
-      m_statusCode = e.getStatus();
-    }
+      ZDvidMetrics::GetInstance().recordRequest(
+            url.toStdString(), timer.elapsed(), payload.size(),
+            result.buffer.size(), result.statusCode == 200);
+
+      return result;
+    };
+
+    //Only GET requests are safe to share
+    ZDvidRequestCoalescer::Result result = (method == "GET") ?
+          ZDvidRequestCoalescer::GetInstance().fetch(
+            ZDvidRequestCoalescer::MakeKey(url, payload, method), fetcher) :
+          fetcher();
+    m_buffer = result.buffer;
+    m_status = result.status;
+    m_statusCode = result.statusCode;
   }
 #endif
 }
@@ -166,6 +230,7 @@ void ZDvidBufferReader::readFromPath(const QString &path, bool outputingUrl)
   m_buffer.clear();
 
 #if defined(_ENABLE_LIBDVIDCPP_)
+  ZDvidMetrics::Timer timer;
   try {
     libdvid::BinaryDataPtr data;
     if (m_service.get() != NULL) {
@@ -182,10 +247,25 @@ void ZDvidBufferReader::readFromPath(const QString &path, bool outputingUrl)
     m_statusCode = e.getStatus();
     m_status = neutube::EReadStatus::FAILED;
   }
+  ZDvidMetrics::GetInstance().recordRequest(
+        path.toStdString(), timer.elapsed(), 0, m_buffer.size(),
+        m_statusCode == 200);
 #endif
 }
 
 void ZDvidBufferReader::read(const QString &url, bool outputingUrl)
+{
+  readUrl(url, 0, outputingUrl);
+}
+
+void ZDvidBufferReader::readCached(
+    const QString &url, int cacheLifetime, bool outputingUrl)
+{
+  readUrl(url, cacheLifetime, outputingUrl);
+}
+
+void ZDvidBufferReader::readUrl(
+    const QString &url, int cacheLifetime, bool outputingUrl)
 {
   m_statusCode = 0;
 
@@ -204,32 +284,48 @@ void ZDvidBufferReader::read(const QString &url, bool outputingUrl)
   target.setFromUrl(url.toStdString());
 
   if (target.isValid()) {
-    try {
-      libdvid::BinaryDataPtr data;
-      std::string endPoint = ZDvidUrl::GetPath(url.toStdString());
-      if (m_service.get() != NULL) {
-        data = m_service->custom_request(
-              endPoint, libdvid::BinaryDataPtr(), libdvid::GET, m_tryingCompress);
-      } else {
-        ZSharedPointer<libdvid::DVIDNodeService> service =
-            ZDvid::MakeDvidNodeService(target);
-        data = service->custom_request(
-              endPoint, libdvid::BinaryDataPtr(), libdvid::GET, m_tryingCompress);
+    //Identical GET requests in flight are merged into one
+    ZDvidRequestCoalescer::Result result =
+        ZDvidRequestCoalescer::GetInstance().fetch(
+          ZDvidRequestCoalescer::MakeKey(url), [&]() {
+      ZDvidRequestCoalescer::Result result;
+      result.status = neutube::EReadStatus::FAILED;
+      ZDvidMetrics::Timer timer;
+      try {
+        libdvid::BinaryDataPtr data;
+        std::string endPoint = ZDvidUrl::GetPath(url.toStdString());
+        if (m_service.get() != NULL) {
+          data = m_service->custom_request(
+                endPoint, libdvid::BinaryDataPtr(), libdvid::GET,
+                m_tryingCompress);
+        } else {
+          PooledService service(target);
+          data = service.customRequest(
+                endPoint, libdvid::BinaryDataPtr(), libdvid::GET,
+                m_tryingCompress);
+        }
+        qDebug() << "Reading done:" << url;
+
+        result.buffer.append(data->get_data().c_str(), data->length());
+        result.status = neutube::EReadStatus::OK;
+        result.statusCode = 200;
+      } catch (libdvid::DVIDException &e) {
+        STD_COUT << "Exception: " << e.what() << std::endl;
+        result.statusCode = e.getStatus();
+      } catch (std::exception &e) {
+        STD_COUT << "Any exception: " << e.what() << std::endl;
+        result.statusCode = 0;
       }
-      qDebug() << "Reading done:" << url;
-
-      m_buffer.append(data->get_data().c_str(), data->length());
-      m_status = neutube::EReadStatus::OK;
-      m_statusCode = 200;
-    } catch (libdvid::DVIDException &e) {
-      STD_COUT << "Exception: " << e.what() << std::endl;
-      m_statusCode = e.getStatus();
-      m_status = neutube::EReadStatus::FAILED;
-    } catch (std::exception &e) {
-      STD_COUT << "Any exception: " << e.what() << std::endl;
-      m_statusCode = 0;
-      m_status = neutube::EReadStatus::FAILED;
-    }
+      ZDvidMetrics::GetInstance().recordRequest(
+            url.toStdString(), timer.elapsed(), 0, result.buffer.size(),
+            result.statusCode == 200);
+
+      return result;
+    }, cacheLifetime);
+
+    m_buffer = result.buffer;
+    m_status = result.status;
+    m_statusCode = result.statusCode;
   } else {
 #if 0
     startReading();
@@ -491,6 +587,32 @@ void ZDvidBufferReader::endReading(neutube::EReadStatus status)
 #endif
 }
 
+ZDvidRequestEngine::Handle ZDvidBufferReader::readAsync(
+    const QString &url, const ZDvidRequestEngine::Callback &callback,
+    int priority) const
+{
+  ZDvidRequestEngine::Request request;
+  request.url = url;
+  request.tryingCompress = m_tryingCompress;
+  request.priority = priority;
+
+  return ZDvidRequestEngine::GetInstance().submit(request, callback);
+}
+
+ZDvidRequestEngine::Handle ZDvidBufferReader::readAsync(
+    const QString &url, const QByteArray &payload, const std::string &method,
+    const ZDvidRequestEngine::Callback &callback, int priority) const
+{
+  ZDvidRequestEngine::Request request;
+  request.url = url;
+  request.payload = payload;
+  request.method = method;
+  request.tryingCompress = m_tryingCompress;
+  request.priority = priority;
+
+  return ZDvidRequestEngine::GetInstance().submit(request, callback);
+}
+
 neutube::EReadStatus ZDvidBufferReader::getStatus() const
 {
   return m_status;
@@ -11,6 +11,8 @@
 
 #include "neutube_def.h"
 #include "zsharedpointer.h"
+#include "dvid/zdvidrequestengine.h"
+
 namespace libdvid{
 class DVIDNodeService;
 }
@@ -41,6 +43,36 @@ public:
   void read(const QString &url, const QByteArray &payload,
             const std::string &method,
             bool outputingUrl = true);
+
+  /*!
+   * \brief Read \a url with a short-lived response cache.
+   *
+   * A successful response of the same URL that is at most \a cacheLifetime
+   * milliseconds old is reused without contacting the server. It is meant for
+   * idempotent metadata such as data instance info.
+   */
+  void readCached(const QString &url, int cacheLifetime,
+                  bool outputingUrl = true);
+
+  /*!
+   * \brief Read \a url asynchronously.
+   *
+   * The request goes to the shared ZDvidRequestEngine and does not change the
+   * buffer or the status of the reader. \a callback, if provided, is called in
+   * a worker thread with the result. A request with higher \a priority is sent
+   * earlier.
+   */
+  ZDvidRequestEngine::Handle readAsync(
+      const QString &url,
+      const ZDvidRequestEngine::Callback &callback =
+      ZDvidRequestEngine::Callback(),
+      int priority = 0) const;
+  ZDvidRequestEngine::Handle readAsync(
+      const QString &url, const QByteArray &payload, const std::string &method,
+      const ZDvidRequestEngine::Callback &callback =
+      ZDvidRequestEngine::Callback(),
+      int priority = 0) const;
+
 //  void readHead(const QString &url);
 //  bool isReadable(const QString &url);
 //  bool hasHead(const QString &url);
@@ -93,6 +125,7 @@ private slots:
 
 private:
   void _init();
+  void readUrl(const QString &url, int cacheLifetime, bool outputingUrl);
 
   void startReading();
   void endReading(neutube::EReadStatus status);
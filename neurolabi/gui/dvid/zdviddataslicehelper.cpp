@@ -3,6 +3,8 @@
 #include "zintcuboid.h"
 #include "misc/miscutility.h"
 #include "zarbsliceviewparam.h"
+#include "zstack.hxx"
+#include "zarray.h"
 
 ZDvidDataSliceHelper::ZDvidDataSliceHelper(ZDvidData::ERole role) :
   m_dataRole(role)
@@ -18,6 +20,7 @@ void ZDvidDataSliceHelper::setDvidTarget(const ZDvidTarget &target)
 {
   m_reader.open(target);
   updateCenterCut();
+  m_prefetchReader = std::make_shared<ZDvidReader>();
 }
 
 void ZDvidDataSliceHelper::setMaxZoom(int maxZoom)
@@ -468,3 +471,134 @@ void ZDvidDataSliceHelper::inferUpdatePolicy(neutube::EAxis axis)
     }
   }
 }
+
+ZDvidSlicePrefetcher::SliceKey ZDvidDataSliceHelper::makeSliceKey(
+    int x0, int y0, int z0, int width, int height,
+    int zoom, int cx, int cy, bool centerCut) const
+{
+  ZDvidSlicePrefetcher::SliceKey key;
+
+  const ZDvidTarget &target = getDvidTarget();
+  key.source = target.getAddressWithPort() + "/" + target.getUuid() + "/";
+  switch (m_dataRole) {
+  case ZDvidData::ROLE_GRAY_SCALE:
+    key.source += target.getGrayScaleName();
+    break;
+  case ZDvidData::ROLE_LABEL_BLOCK:
+    key.source += target.getSegmentationName();
+    break;
+  default:
+    key.source.clear();
+    break;
+  }
+
+  key.x0 = x0;
+  key.y0 = y0;
+  key.z = z0;
+  key.width = width;
+  key.height = height;
+  key.zoom = zoom;
+  key.centerCutX = cx;
+  key.centerCutY = cy;
+  key.centerCut = centerCut;
+
+  return key;
+}
+
+ZDvidSlicePrefetcher::Loader ZDvidDataSliceHelper::makePrefetchLoader() const
+{
+  std::shared_ptr<ZDvidReader> reader = m_prefetchReader;
+  ZDvidTarget target = getDvidTarget();
+  ZDvidData::ERole role = m_dataRole;
+
+  return [reader, target, role](const ZDvidSlicePrefetcher::SliceKey &key) {
+    ZDvidSlicePrefetcher::SliceData data;
+    if (!reader->good()) {
+      reader->open(target);
+    }
+
+    if (reader->good()) {
+      if (role == ZDvidData::ROLE_GRAY_SCALE) {
+        data.stack.reset(reader->readGrayScaleLowtis(
+                           key.x0, key.y0, key.z, key.width, key.height,
+                           key.zoom, key.centerCutX, key.centerCutY,
+                           key.centerCut));
+      } else {
+        data.array.reset(reader->readLabels64Lowtis(
+                           key.x0, key.y0, key.z, key.width, key.height,
+                           key.zoom, key.centerCutX, key.centerCutY,
+                           key.centerCut));
+      }
+    }
+
+    return data;
+  };
+}
+
+ZStack* ZDvidDataSliceHelper::readGrayScaleLowtis(
+    int x0, int y0, int z0, int width, int height,
+    int zoom, int cx, int cy, bool centerCut) const
+{
+  ZDvidSlicePrefetcher::SliceKey key =
+      makeSliceKey(x0, y0, z0, width, height, zoom, cx, cy, centerCut);
+
+  ZDvidSlicePrefetcher &prefetcher = ZDvidSlicePrefetcher::GetInstance();
+  ZDvidSlicePrefetcher::SliceData data = prefetcher.get(key);
+  if (data.stack) {
+    return data.stack->clone();
+  }
+
+  ZStack *stack = getDvidReader().readGrayScaleLowtis(
+        x0, y0, z0, width, height, zoom, cx, cy, centerCut);
+  if (stack != NULL && !key.source.empty()) {
+    data.stack.reset(stack->clone());
+    prefetcher.put(key, data);
+  }
+
+  return stack;
+}
+
+ZArray* ZDvidDataSliceHelper::readLabels64Lowtis(
+    int x0, int y0, int z0, int width, int height,
+    int zoom, int cx, int cy, bool centerCut) const
+{
+  ZDvidSlicePrefetcher::SliceKey key =
+      makeSliceKey(x0, y0, z0, width, height, zoom, cx, cy, centerCut);
+
+  ZDvidSlicePrefetcher &prefetcher = ZDvidSlicePrefetcher::GetInstance();
+  ZDvidSlicePrefetcher::SliceData data = prefetcher.get(key);
+  if (data.array) {
+    return new ZArray(*data.array);
+  }
+
+  ZArray *array = getDvidReader().readLabels64Lowtis(
+        x0, y0, z0, width, height, zoom, cx, cy, centerCut);
+  if (array != NULL && !key.source.empty()) {
+    data.array.reset(new ZArray(*array));
+    prefetcher.put(key, data);
+  }
+
+  return array;
+}
+
+void ZDvidDataSliceHelper::prefetch(
+    int x0, int y0, int z0, int width, int height,
+    int zoom, int cx, int cy, bool centerCut) const
+{
+  if (m_prefetchReader) {
+    ZDvidSlicePrefetcher::SliceKey key =
+        makeSliceKey(x0, y0, z0, width, height, zoom, cx, cy, centerCut);
+    if (!key.source.empty()) {
+      ZDvidSlicePrefetcher::GetInstance().notifyView(
+            key, makePrefetchLoader());
+    }
+  }
+}
+
+void ZDvidDataSliceHelper::invalidateSliceCache() const
+{
+  ZDvidSlicePrefetcher::SliceKey key = makeSliceKey(0, 0, 0, 0, 0, 0, 0, 0, false);
+  if (!key.source.empty()) {
+    ZDvidSlicePrefetcher::GetInstance().invalidate(key.source);
+  }
+}
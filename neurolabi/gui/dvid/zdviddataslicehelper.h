@@ -1,9 +1,12 @@
 #ifndef ZDVIDDATASLICEHELPER_H
 #define ZDVIDDATASLICEHELPER_H
 
+#include <memory>
+
 #include "zdvidreader.h"
 #include "zstackviewparam.h"
 #include "zdviddata.h"
+#include "zdvidsliceprefetcher.h"
 
 class QRect;
 class ZIntCuboid;
@@ -124,6 +127,43 @@ public:
   void setPreferredUpdatePolicy(flyem::EDataSliceUpdatePolicy policy);
   flyem::EDataSliceUpdatePolicy getPreferredUpdatePolicy() const;
 
+  /*!
+   * \brief Read a grayscale slice through the shared slice cache.
+   *
+   * The caller owns the returned stack.
+   */
+  ZStack* readGrayScaleLowtis(
+      int x0, int y0, int z0, int width, int height,
+      int zoom, int cx, int cy, bool centerCut) const;
+
+  /*!
+   * \brief Read a label slice through the shared slice cache.
+   *
+   * The caller owns the returned array.
+   */
+  ZArray* readLabels64Lowtis(
+      int x0, int y0, int z0, int width, int height,
+      int zoom, int cx, int cy, bool centerCut) const;
+
+  /*!
+   * \brief Report the slice being shown for prefetching the slices ahead.
+   *
+   * See ZDvidSlicePrefetcher for how the slices to prefetch are decided.
+   */
+  void prefetch(int x0, int y0, int z0, int width, int height,
+                int zoom, int cx, int cy, bool centerCut) const;
+
+  /*!
+   * \brief Drop cached and prefetching slices of the data.
+   */
+  void invalidateSliceCache() const;
+
+private:
+  ZDvidSlicePrefetcher::SliceKey makeSliceKey(
+      int x0, int y0, int z0, int width, int height,
+      int zoom, int cx, int cy, bool centerCut) const;
+  ZDvidSlicePrefetcher::Loader makePrefetchLoader() const;
+
 private:
   /*!
    * After canonizing, there is always a combination of lowres and highres areas
@@ -159,6 +199,8 @@ public:
   flyem::EDataSliceUpdatePolicy m_preferredUpdatePolicy = flyem::EDataSliceUpdatePolicy::LOWRES;
 
   ZDvidReader m_reader;
+  //Reader used in the prefetching thread only
+  std::shared_ptr<ZDvidReader> m_prefetchReader;
 };
 
 #endif // ZDVIDDATASLICEHELPER_H
@@ -415,7 +415,7 @@ void ZDvidGraySlice::forceUpdate(const QRect &viewPort, int z)
 
     int scale = zgeom::GetZoomScale(zoom);
     int remain = z % scale;
-    stack = getDvidReader().readGrayScaleLowtis(
+    stack = getHelper()->readGrayScaleLowtis(
           box.getFirstCorner().getX(), box.getFirstCorner().getY(),
           z, box.getWidth(), box.getHeight(),
           getZoom(), cx, cy, true);
@@ -423,7 +423,7 @@ void ZDvidGraySlice::forceUpdate(const QRect &viewPort, int z)
       if (remain > 0) {
         //        int z1 = z + scale - remain;
         int z1 = z - remain + scale;
-        ZStack *stack2 = getDvidReader().readGrayScaleLowtis(
+        ZStack *stack2 = getHelper()->readGrayScaleLowtis(
               box.getFirstCorner().getX(), box.getFirstCorner().getY(),
               z1, box.getWidth(), box.getHeight(), getZoom(), cx, cy,
               true);
@@ -437,6 +437,9 @@ void ZDvidGraySlice::forceUpdate(const QRect &viewPort, int z)
 
     getHelper()->setActualQuality(
           getZoom(), cx, cy, true);
+    getHelper()->prefetch(
+          box.getFirstCorner().getX(), box.getFirstCorner().getY(),
+          z, box.getWidth(), box.getHeight(), getZoom(), cx, cy, true);
   }
 
   updateImage(stack);
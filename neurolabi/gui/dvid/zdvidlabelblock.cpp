@@ -0,0 +1,701 @@
+#include "zdvidlabelblock.h"
+
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+#include <zlib.h>
+
+#include "zarray.h"
+#include "zintcuboid.h"
+#include "zobject3dscan.h"
+
+namespace {
+
+const int SUB_BLOCK_VOXEL_NUMBER = 512;
+const int MAX_BIT_WIDTH = 9;
+
+//Far above the serialized size of a 128^3 block with a label per voxel
+const size_t MAX_SERIALIZED_SIZE = size_t(64) << 20;
+
+int GetBitWidth(int paletteSize)
+{
+  int bits = 0;
+  if (paletteSize > 1) {
+    --paletteSize;
+    while (paletteSize > 0) {
+      paletteSize >>= 1;
+      ++bits;
+    }
+  }
+
+  return bits;
+}
+
+template<typename T>
+bool ReadValue(const char *data, size_t size, size_t *pos, T *value)
+{
+  if (*pos + sizeof(T) > size) {
+    return false;
+  }
+
+  memcpy(value, data + *pos, sizeof(T));
+  *pos += sizeof(T);
+
+  return true;
+}
+
+template<typename T>
+void WriteValue(const T &value, std::vector<char> *data)
+{
+  const char *p = reinterpret_cast<const char*>(&value);
+  data->insert(data->end(), p, p + sizeof(T));
+}
+
+}
+
+ZDvidLabelBlock::ZDvidLabelBlock()
+{
+}
+
+void ZDvidLabelBlock::clear()
+{
+  m_gx = 0;
+  m_gy = 0;
+  m_gz = 0;
+  m_offset.set(0, 0, 0);
+  m_labelArray.clear();
+  m_paletteSize.clear();
+  m_paletteIndex.clear();
+  m_voxelIndex.clear();
+  m_paletteStart.clear();
+  m_voxelStart.clear();
+}
+
+size_t ZDvidLabelBlock::getVoxelNumber() const
+{
+  return size_t(getWidth()) * getHeight() * getDepth();
+}
+
+ZIntCuboid ZDvidLabelBlock::getBoundBox() const
+{
+  ZIntCuboid box;
+  if (!isEmpty()) {
+    box.setFirstCorner(m_offset);
+    box.setSize(getWidth(), getHeight(), getDepth());
+  }
+
+  return box;
+}
+
+size_t ZDvidLabelBlock::getMemoryUsage() const
+{
+  return m_labelArray.size() * sizeof(uint64_t) +
+      m_paletteSize.size() * sizeof(uint16_t) +
+      m_paletteIndex.size() * sizeof(uint32_t) +
+      m_voxelIndex.size() +
+      (m_paletteStart.size() + m_voxelStart.size()) * sizeof(uint32_t);
+}
+
+void ZDvidLabelBlock::prepareSubBlockStart()
+{
+  m_paletteStart.clear();
+  m_voxelStart.clear();
+
+  if (!isSolid()) {
+    m_paletteStart.resize(m_paletteSize.size());
+    m_voxelStart.resize(m_paletteSize.size());
+    uint32_t paletteStart = 0;
+    uint32_t voxelStart = 0;
+    for (size_t i = 0; i < m_paletteSize.size(); ++i) {
+      m_paletteStart[i] = paletteStart;
+      m_voxelStart[i] = voxelStart;
+      paletteStart += m_paletteSize[i];
+      voxelStart += GetBitWidth(m_paletteSize[i]) * SUB_BLOCK_VOXEL_NUMBER / 8;
+    }
+  }
+}
+
+bool ZDvidLabelBlock::load(const char *data, size_t size)
+{
+  clear();
+
+  size_t pos = 0;
+  uint32_t gx = 0;
+  uint32_t gy = 0;
+  uint32_t gz = 0;
+  uint32_t labelNumber = 0;
+  if (!ReadValue(data, size, &pos, &gx) || !ReadValue(data, size, &pos, &gy) ||
+      !ReadValue(data, size, &pos, &gz) ||
+      !ReadValue(data, size, &pos, &labelNumber)) {
+    return false;
+  }
+
+  //Up to 1024^3 voxels
+  if (gx == 0 || gy == 0 || gz == 0 || gx > 128 || gy > 128 || gz > 128 ||
+      labelNumber == 0 || (size - pos) / sizeof(uint64_t) < labelNumber) {
+    return false;
+  }
+
+  m_gx = gx;
+  m_gy = gy;
+  m_gz = gz;
+  m_labelArray.resize(labelNumber);
+  memcpy(m_labelArray.data(), data + pos, labelNumber * sizeof(uint64_t));
+  pos += labelNumber * sizeof(uint64_t);
+
+  if (labelNumber > 1) {
+    size_t subBlockNumber = size_t(gx) * gy * gz;
+    if ((size - pos) / sizeof(uint16_t) < subBlockNumber) {
+      clear();
+      return false;
+    }
+    m_paletteSize.resize(subBlockNumber);
+    memcpy(m_paletteSize.data(), data + pos, subBlockNumber * sizeof(uint16_t));
+    pos += subBlockNumber * sizeof(uint16_t);
+
+    size_t paletteIndexNumber = 0;
+    size_t voxelIndexSize = 0;
+    for (uint16_t paletteSize : m_paletteSize) {
+      if (paletteSize > SUB_BLOCK_VOXEL_NUMBER) {
+        clear();
+        return false;
+      }
+      paletteIndexNumber += paletteSize;
+      voxelIndexSize += GetBitWidth(paletteSize) * SUB_BLOCK_VOXEL_NUMBER / 8;
+    }
+
+    if ((size - pos) / sizeof(uint32_t) < paletteIndexNumber) {
+      clear();
+      return false;
+    }
+    m_paletteIndex.resize(paletteIndexNumber);
+    memcpy(m_paletteIndex.data(), data + pos,
+           paletteIndexNumber * sizeof(uint32_t));
+    pos += paletteIndexNumber * sizeof(uint32_t);
+
+    for (uint32_t index : m_paletteIndex) {
+      if (index >= labelNumber) {
+        clear();
+        return false;
+      }
+    }
+
+    if (size - pos < voxelIndexSize) {
+      clear();
+      return false;
+    }
+    m_voxelIndex.assign(data + pos, data + pos + voxelIndexSize);
+  }
+
+  prepareSubBlockStart();
+
+  return true;
+}
+
+bool ZDvidLabelBlock::loadCompressed(const char *data, size_t size)
+{
+  clear();
+
+  if (data == NULL || size == 0) {
+    return false;
+  }
+
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  //16 + MAX_WBITS for the gzip header
+  if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+    return false;
+  }
+
+  std::vector<char> buffer(std::max(size * 4, size_t(4096)));
+  stream.next_in = (Bytef*) data;
+  stream.avail_in = size;
+  int status = Z_OK;
+  while (status == Z_OK) {
+    if (stream.total_out == buffer.size()) {
+      if (buffer.size() >= MAX_SERIALIZED_SIZE) {
+        break;
+      }
+      buffer.resize(std::min(buffer.size() * 2, MAX_SERIALIZED_SIZE));
+    }
+    stream.next_out = (Bytef*) buffer.data() + stream.total_out;
+    stream.avail_out = buffer.size() - stream.total_out;
+    status = inflate(&stream, Z_NO_FLUSH);
+  }
+  size_t decodedSize = stream.total_out;
+  inflateEnd(&stream);
+
+  if (status != Z_STREAM_END) {
+    return false;
+  }
+
+  return load(buffer.data(), decodedSize);
+}
+
+std::vector<char> ZDvidLabelBlock::toByteArray() const
+{
+  std::vector<char> data;
+  if (!isEmpty()) {
+    data.reserve(getMemoryUsage() + 16);
+    WriteValue(uint32_t(m_gx), &data);
+    WriteValue(uint32_t(m_gy), &data);
+    WriteValue(uint32_t(m_gz), &data);
+    WriteValue(uint32_t(m_labelArray.size()), &data);
+    for (uint64_t label : m_labelArray) {
+      WriteValue(label, &data);
+    }
+    if (!isSolid()) {
+      for (uint16_t paletteSize : m_paletteSize) {
+        WriteValue(paletteSize, &data);
+      }
+      for (uint32_t index : m_paletteIndex) {
+        WriteValue(index, &data);
+      }
+      data.insert(data.end(), m_voxelIndex.begin(), m_voxelIndex.end());
+    }
+  }
+
+  return data;
+}
+
+bool ZDvidLabelBlock::encode(
+    const uint64_t *data, int width, int height, int depth)
+{
+  ZIntPoint offset = m_offset;
+  clear();
+  m_offset = offset;
+
+  if (data == NULL || width <= 0 || height <= 0 || depth <= 0 ||
+      width % SUB_BLOCK_SIZE != 0 || height % SUB_BLOCK_SIZE != 0 ||
+      depth % SUB_BLOCK_SIZE != 0) {
+    return false;
+  }
+
+  m_gx = width / SUB_BLOCK_SIZE;
+  m_gy = height / SUB_BLOCK_SIZE;
+  m_gz = depth / SUB_BLOCK_SIZE;
+
+  size_t voxelNumber = getVoxelNumber();
+  if (std::all_of(data, data + voxelNumber,
+                  [&](uint64_t v) { return v == data[0]; })) {
+    m_labelArray.push_back(data[0]);
+    return true;
+  }
+
+  std::unordered_map<uint64_t, uint32_t> labelIndexMap;
+  std::unordered_map<uint64_t, uint32_t> localIndexMap;
+  std::vector<uint64_t> localLabelArray;
+  std::vector<uint32_t> localIndexArray(SUB_BLOCK_VOXEL_NUMBER);
+
+  m_paletteSize.resize(size_t(m_gx) * m_gy * m_gz);
+  for (int sz = 0; sz < m_gz; ++sz) {
+    for (int sy = 0; sy < m_gy; ++sy) {
+      for (int sx = 0; sx < m_gx; ++sx) {
+        localIndexMap.clear();
+        localLabelArray.clear();
+        size_t index = 0;
+        for (int z = 0; z < SUB_BLOCK_SIZE; ++z) {
+          const uint64_t *row = data +
+              (size_t(sz * SUB_BLOCK_SIZE + z) * height +
+               sy * SUB_BLOCK_SIZE) * width + sx * SUB_BLOCK_SIZE;
+          for (int y = 0; y < SUB_BLOCK_SIZE; ++y) {
+            for (int x = 0; x < SUB_BLOCK_SIZE; ++x) {
+              uint64_t label = row[x];
+              auto iter = localIndexMap.find(label);
+              if (iter == localIndexMap.end()) {
+                iter = localIndexMap.emplace(
+                      label, uint32_t(localLabelArray.size())).first;
+                localLabelArray.push_back(label);
+              }
+              localIndexArray[index++] = iter->second;
+            }
+            row += width;
+          }
+        }
+
+        m_paletteSize[getSubBlockIndex(sx, sy, sz)] =
+            uint16_t(localLabelArray.size());
+        for (uint64_t label : localLabelArray) {
+          auto iter = labelIndexMap.find(label);
+          if (iter == labelIndexMap.end()) {
+            iter = labelIndexMap.emplace(
+                  label, uint32_t(m_labelArray.size())).first;
+            m_labelArray.push_back(label);
+          }
+          m_paletteIndex.push_back(iter->second);
+        }
+
+        //Pack the indices from the most significant bit
+        int bits = GetBitWidth(int(localLabelArray.size()));
+        if (bits > 0) {
+          uint32_t buffer = 0;
+          int bufferBits = 0;
+          for (uint32_t localIndex : localIndexArray) {
+            buffer = (buffer << bits) | localIndex;
+            bufferBits += bits;
+            while (bufferBits >= 8) {
+              bufferBits -= 8;
+              m_voxelIndex.push_back(uint8_t(buffer >> bufferBits));
+            }
+            buffer &= (1u << bufferBits) - 1;
+          }
+        }
+      }
+    }
+  }
+
+  prepareSubBlockStart();
+
+  return true;
+}
+
+int ZDvidLabelBlock::getBitWidth(int subBlockIndex) const
+{
+  return GetBitWidth(m_paletteSize[subBlockIndex]);
+}
+
+uint32_t ZDvidLabelBlock::getVoxelIndex(int subBlockIndex, int voxelIndex) const
+{
+  int bits = getBitWidth(subBlockIndex);
+  if (bits == 0) {
+    return 0;
+  }
+
+  uint32_t bitPos = uint32_t(voxelIndex) * bits;
+  const uint8_t *p = m_voxelIndex.data() + m_voxelStart[subBlockIndex] +
+      (bitPos >> 3);
+  int head = bitPos & 7;
+  uint32_t value = uint32_t(p[0]) << 8;
+  if (head + bits > 8) {
+    value |= p[1];
+  }
+
+  return (value >> (16 - head - bits)) & ((1u << bits) - 1);
+}
+
+void ZDvidLabelBlock::getPalette(
+    int subBlockIndex, std::vector<uint64_t> *palette) const
+{
+  //Indices that are out of the palette read as 0
+  palette->assign(size_t(1) << MAX_BIT_WIDTH, 0);
+  if (isSolid()) {
+    (*palette)[0] = m_labelArray[0];
+  } else {
+    const uint32_t *index = m_paletteIndex.data() + m_paletteStart[subBlockIndex];
+    for (int i = 0; i < m_paletteSize[subBlockIndex]; ++i) {
+      (*palette)[i] = m_labelArray[index[i]];
+    }
+  }
+}
+
+uint64_t ZDvidLabelBlock::getValueLocal(int x, int y, int z) const
+{
+  if (isSolid()) {
+    return m_labelArray[0];
+  }
+
+  int subBlockIndex = getSubBlockIndex(
+        x / SUB_BLOCK_SIZE, y / SUB_BLOCK_SIZE, z / SUB_BLOCK_SIZE);
+  int paletteSize = m_paletteSize[subBlockIndex];
+  if (paletteSize == 0) {
+    return 0;
+  }
+
+  uint32_t index = getVoxelIndex(
+        subBlockIndex,
+        ((z % SUB_BLOCK_SIZE) * SUB_BLOCK_SIZE + y % SUB_BLOCK_SIZE) *
+        SUB_BLOCK_SIZE + x % SUB_BLOCK_SIZE);
+  if (index >= uint32_t(paletteSize)) {
+    return 0;
+  }
+
+  return m_labelArray[m_paletteIndex[m_paletteStart[subBlockIndex] + index]];
+}
+
+uint64_t ZDvidLabelBlock::getValue(int x, int y, int z) const
+{
+  x -= m_offset.getX();
+  y -= m_offset.getY();
+  z -= m_offset.getZ();
+
+  if (isEmpty() || x < 0 || y < 0 || z < 0 ||
+      x >= getWidth() || y >= getHeight() || z >= getDepth()) {
+    return 0;
+  }
+
+  return getValueLocal(x, y, z);
+}
+
+void ZDvidLabelBlock::decode(uint64_t *data) const
+{
+  if (isEmpty()) {
+    return;
+  }
+
+  if (isSolid()) {
+    std::fill(data, data + getVoxelNumber(), m_labelArray[0]);
+    return;
+  }
+
+  int width = getWidth();
+  int height = getHeight();
+  std::vector<uint64_t> palette;
+  for (int sz = 0; sz < m_gz; ++sz) {
+    for (int sy = 0; sy < m_gy; ++sy) {
+      for (int sx = 0; sx < m_gx; ++sx) {
+        int subBlockIndex = getSubBlockIndex(sx, sy, sz);
+        getPalette(subBlockIndex, &palette);
+        int index = 0;
+        for (int z = 0; z < SUB_BLOCK_SIZE; ++z) {
+          uint64_t *row = data +
+              (size_t(sz * SUB_BLOCK_SIZE + z) * height +
+               sy * SUB_BLOCK_SIZE) * width + sx * SUB_BLOCK_SIZE;
+          for (int y = 0; y < SUB_BLOCK_SIZE; ++y) {
+            for (int x = 0; x < SUB_BLOCK_SIZE; ++x) {
+              row[x] = palette[getVoxelIndex(subBlockIndex, index++)];
+            }
+            row += width;
+          }
+        }
+      }
+    }
+  }
+}
+
+ZArray* ZDvidLabelBlock::toArray() const
+{
+  if (isEmpty()) {
+    return NULL;
+  }
+
+  mylib::Dimn_Type arrayDims[3];
+  arrayDims[0] = getWidth();
+  arrayDims[1] = getHeight();
+  arrayDims[2] = getDepth();
+  ZArray *array = new ZArray(mylib::UINT64_TYPE, 3, arrayDims);
+  decode(array->getDataPointer<uint64_t>());
+  array->setStartCoordinate(0, m_offset.getX());
+  array->setStartCoordinate(1, m_offset.getY());
+  array->setStartCoordinate(2, m_offset.getZ());
+
+  return array;
+}
+
+bool ZDvidLabelBlock::extractSlice(
+    neutube::EAxis axis, int index, uint64_t *out) const
+{
+  if (isEmpty() || index < 0) {
+    return false;
+  }
+
+  //(u, v, w): the two axes of the slice and the slice axis in sub-blocks
+  int gu = 0;
+  int gv = 0;
+  switch (axis) {
+  case neutube::EAxis::X:
+    gu = m_gy;
+    gv = m_gz;
+    break;
+  case neutube::EAxis::Y:
+    gu = m_gx;
+    gv = m_gz;
+    break;
+  case neutube::EAxis::Z:
+    gu = m_gx;
+    gv = m_gy;
+    break;
+  default:
+    return false;
+  }
+
+  int depth = (axis == neutube::EAxis::X) ? getWidth() :
+                ((axis == neutube::EAxis::Y) ? getHeight() : getDepth());
+  if (index >= depth) {
+    return false;
+  }
+
+  int width = gu * SUB_BLOCK_SIZE;
+  if (isSolid()) {
+    std::fill(out, out + size_t(width) * gv * SUB_BLOCK_SIZE, m_labelArray[0]);
+    return true;
+  }
+
+  int sw = index / SUB_BLOCK_SIZE;
+  int w = index % SUB_BLOCK_SIZE;
+  std::vector<uint64_t> palette;
+  for (int sv = 0; sv < gv; ++sv) {
+    for (int su = 0; su < gu; ++su) {
+      int subBlockIndex = 0;
+      switch (axis) {
+      case neutube::EAxis::X:
+        subBlockIndex = getSubBlockIndex(sw, su, sv);
+        break;
+      case neutube::EAxis::Y:
+        subBlockIndex = getSubBlockIndex(su, sw, sv);
+        break;
+      default:
+        subBlockIndex = getSubBlockIndex(su, sv, sw);
+        break;
+      }
+
+      getPalette(subBlockIndex, &palette);
+      for (int v = 0; v < SUB_BLOCK_SIZE; ++v) {
+        uint64_t *row = out + size_t(sv * SUB_BLOCK_SIZE + v) * width +
+            su * SUB_BLOCK_SIZE;
+        for (int u = 0; u < SUB_BLOCK_SIZE; ++u) {
+          int voxelIndex = 0;
+          switch (axis) {
+          case neutube::EAxis::X:
+            voxelIndex = (v * SUB_BLOCK_SIZE + u) * SUB_BLOCK_SIZE + w;
+            break;
+          case neutube::EAxis::Y:
+            voxelIndex = (v * SUB_BLOCK_SIZE + w) * SUB_BLOCK_SIZE + u;
+            break;
+          default:
+            voxelIndex = (w * SUB_BLOCK_SIZE + v) * SUB_BLOCK_SIZE + u;
+            break;
+          }
+          row[u] = palette[getVoxelIndex(subBlockIndex, voxelIndex)];
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+bool ZDvidLabelBlock::hasLabel(uint64_t label) const
+{
+  return std::find(m_labelArray.begin(), m_labelArray.end(), label) !=
+      m_labelArray.end();
+}
+
+std::set<uint64_t> ZDvidLabelBlock::getLabelSet() const
+{
+  return std::set<uint64_t>(m_labelArray.begin(), m_labelArray.end());
+}
+
+size_t ZDvidLabelBlock::appendObject(uint64_t label, ZObject3dScan *obj) const
+{
+  return appendObject(label, getBoundBox(), obj, true);
+}
+
+size_t ZDvidLabelBlock::appendObject(
+    uint64_t label, const ZIntCuboid &range, ZObject3dScan *obj,
+    bool canonizing) const
+{
+  if (obj == NULL || !hasLabel(label)) {
+    return 0;
+  }
+
+  //Local range to scan
+  ZIntCuboid box = getBoundBox();
+  box.intersect(range);
+  if (box.isEmpty()) {
+    return 0;
+  }
+  box.translate(-m_offset);
+  const int minX = box.getFirstCorner().getX();
+  const int maxX = box.getLastCorner().getX();
+
+  enum EMatch {
+    MATCH_NONE, MATCH_ALL, MATCH_PARTIAL
+  };
+
+  //Classify sub-blocks so that only partial ones need decoding
+  size_t subBlockNumber = size_t(m_gx) * m_gy * m_gz;
+  std::vector<EMatch> matchArray(subBlockNumber, MATCH_ALL);
+  std::vector<std::vector<bool>> localMatchArray(subBlockNumber);
+  if (!isSolid()) {
+    for (size_t i = 0; i < subBlockNumber; ++i) {
+      const uint32_t *index = m_paletteIndex.data() + m_paletteStart[i];
+      int paletteSize = m_paletteSize[i];
+      int matchCount = 0;
+      std::vector<bool> &localMatch = localMatchArray[i];
+      localMatch.assign(size_t(1) << getBitWidth(i), false);
+      for (int j = 0; j < paletteSize; ++j) {
+        if (m_labelArray[index[j]] == label) {
+          localMatch[j] = true;
+          ++matchCount;
+        }
+      }
+      if (matchCount == 0) {
+        matchArray[i] = MATCH_NONE;
+      } else if (matchCount < paletteSize) {
+        matchArray[i] = MATCH_PARTIAL;
+      }
+    }
+  }
+
+  size_t voxelCount = 0;
+  for (int z = box.getFirstCorner().getZ(); z <= box.getLastCorner().getZ();
+       ++z) {
+    int sz = z / SUB_BLOCK_SIZE;
+    for (int y = box.getFirstCorner().getY(); y <= box.getLastCorner().getY();
+         ++y) {
+      int sy = y / SUB_BLOCK_SIZE;
+      int rowStart = getSubBlockIndex(0, sy, sz);
+      if (std::all_of(matchArray.begin() + rowStart,
+                      matchArray.begin() + rowStart + m_gx,
+                      [](EMatch m) { return m == MATCH_NONE; })) {
+        continue;
+      }
+
+      int voxelRowStart =
+          ((z % SUB_BLOCK_SIZE) * SUB_BLOCK_SIZE + y % SUB_BLOCK_SIZE) *
+          SUB_BLOCK_SIZE;
+      int segStart = -1;
+      auto addSegment = [&](int segEnd) {
+        segStart = std::max(segStart, minX);
+        segEnd = std::min(segEnd, maxX);
+        if (segStart <= segEnd) {
+          obj->addSegment(z + m_offset.getZ(), y + m_offset.getY(),
+                          segStart + m_offset.getX(), segEnd + m_offset.getX(),
+                          false);
+          voxelCount += segEnd - segStart + 1;
+        }
+        segStart = -1;
+      };
+
+      for (int sx = 0; sx < m_gx; ++sx) {
+        int subBlockIndex = rowStart + sx;
+        int x0 = sx * SUB_BLOCK_SIZE;
+        switch (matchArray[subBlockIndex]) {
+        case MATCH_NONE:
+          if (segStart >= 0) {
+            addSegment(x0 - 1);
+          }
+          break;
+        case MATCH_ALL:
+          if (segStart < 0) {
+            segStart = x0;
+          }
+          break;
+        case MATCH_PARTIAL:
+        {
+          const std::vector<bool> &localMatch = localMatchArray[subBlockIndex];
+          for (int x = 0; x < SUB_BLOCK_SIZE; ++x) {
+            if (localMatch[getVoxelIndex(subBlockIndex, voxelRowStart + x)]) {
+              if (segStart < 0) {
+                segStart = x0 + x;
+              }
+            } else if (segStart >= 0) {
+              addSegment(x0 + x - 1);
+            }
+          }
+        }
+          break;
+        }
+      }
+      if (segStart >= 0) {
+        addSegment(getWidth() - 1);
+      }
+    }
+  }
+
+  if (canonizing) {
+    obj->canonize();
+  }
+
+  return voxelCount;
+}
@@ -0,0 +1,193 @@
+#ifndef ZDVIDLABELBLOCK_H
+#define ZDVIDLABELBLOCK_H
+
+#include <vector>
+#include <set>
+#include <cstdint>
+#include <cstddef>
+
+#include "neutube_def.h"
+#include "zintpoint.h"
+
+class ZObject3dScan;
+class ZArray;
+class ZIntCuboid;
+
+/*!
+ * \brief The class of label block kept in the DVID labelarray encoding
+ *
+ * A block is divided into 8x8x8 sub-blocks. Each sub-block has a palette of
+ * indices into the label list of the block and stores every voxel as a packed
+ * index of ceil(log2(palette size)) bits. A block with only one label stores
+ * nothing but the label. A typical 64x64x64 block takes tens of kilobytes
+ * instead of the 2 MB of its uint64 array.
+ *
+ * Voxels, slices and the voxels of a single label are read from the encoded
+ * data directly. Slice and label extraction decode only the sub-blocks that
+ * are involved.
+ *
+ * Serialized format (little endian), which is the same as DVID's:
+ *   uint32 x 3: number of sub-blocks along x, y and z (gx, gy, gz)
+ *   uint32: number of labels (N)
+ *   uint64 x N: labels
+ *   Only for N > 1:
+ *   uint16 x Nsb: palette size of each sub-block, Nsb = gx * gy * gz
+ *   uint32 x (sum of palette sizes): label indices of the sub-block palettes
+ *   packed voxel indices of each sub-block, MSB first, in the x-y-z order
+ */
+class ZDvidLabelBlock
+{
+public:
+  ZDvidLabelBlock();
+
+  const static int SUB_BLOCK_SIZE = 8;
+
+  void clear();
+  bool isEmpty() const { return m_labelArray.empty(); }
+
+  /*!
+   * \brief Load serialized data.
+   *
+   * \return false if the data is not a valid block, in which case the block is
+   *         cleared.
+   */
+  bool load(const char *data, size_t size);
+
+  /*!
+   * \brief Load gzip-compressed serialized data.
+   *
+   * It is the block format returned by DVID with compression=blocks.
+   */
+  bool loadCompressed(const char *data, size_t size);
+
+  /*!
+   * \brief Serialize the block.
+   */
+  std::vector<char> toByteArray() const;
+
+  /*!
+   * \brief Encode a label volume.
+   *
+   * \a data is stored in the x-y-z order with the size
+   * \a width x \a height x \a depth. Each dimension must be a positive multiple
+   * of SUB_BLOCK_SIZE.
+   */
+  bool encode(const uint64_t *data, int width, int height, int depth);
+
+  /*!
+   * \brief Decode the block into \a data, which must have at least
+   * getVoxelNumber() elements.
+   */
+  void decode(uint64_t *data) const;
+
+  /*!
+   * \brief Make a uint64 array from the block.
+   *
+   * The start coordinate of the array is the offset of the block. The caller
+   * is responsible for deleting the returned pointer. It returns NULL if the
+   * block is empty.
+   */
+  ZArray* toArray() const;
+
+  /*!
+   * \brief Get the label at a local position.
+   *
+   * The position must be inside the block.
+   */
+  uint64_t getValueLocal(int x, int y, int z) const;
+
+  /*!
+   * \brief Get the label at a global position.
+   *
+   * It returns 0 for a position outside the block.
+   */
+  uint64_t getValue(int x, int y, int z) const;
+
+  /*!
+   * \brief Extract a slice.
+   *
+   * \a index is the local slice index along \a axis. The slice is written into
+   * \a out in the order of the two remaining axes, with the lower axis running
+   * faster, i.e. (x, y) for Z, (x, z) for Y and (y, z) for X.
+   *
+   * \return false if the block is empty, the axis is not X, Y or Z, or the
+   *         index is out of range.
+   */
+  bool extractSlice(neutube::EAxis axis, int index, uint64_t *out) const;
+
+  /*!
+   * \brief Test if a label exists in the block.
+   */
+  bool hasLabel(uint64_t label) const;
+
+  /*!
+   * \brief Labels of the block.
+   *
+   * It may contain labels that are not used by any voxel.
+   */
+  std::set<uint64_t> getLabelSet() const;
+
+  /*!
+   * \brief Append the voxels of a label to \a obj as segments.
+   *
+   * Sub-blocks that do not contain the label are skipped without decoding.
+   * The segments are in the global coordinates. \a obj is canonized
+   * afterwards.
+   *
+   * \return Number of voxels appended.
+   */
+  size_t appendObject(uint64_t label, ZObject3dScan *obj) const;
+
+  /*!
+   * \brief Append the voxels of a label within \a range to \a obj.
+   *
+   * \a obj is canonized afterwards only when \a canonizing is true, which
+   * allows appending multiple blocks before one canonization.
+   */
+  size_t appendObject(uint64_t label, const ZIntCuboid &range,
+                      ZObject3dScan *obj, bool canonizing = true) const;
+
+  int getWidth() const { return m_gx * SUB_BLOCK_SIZE; }
+  int getHeight() const { return m_gy * SUB_BLOCK_SIZE; }
+  int getDepth() const { return m_gz * SUB_BLOCK_SIZE; }
+  size_t getVoxelNumber() const;
+
+  const ZIntPoint& getOffset() const { return m_offset; }
+  void setOffset(const ZIntPoint &offset) { m_offset = offset; }
+  ZIntCuboid getBoundBox() const;
+
+  /*!
+   * \brief Number of bytes used by the encoded data.
+   */
+  size_t getMemoryUsage() const;
+
+private:
+  bool isSolid() const { return m_labelArray.size() == 1; }
+  int getSubBlockIndex(int sx, int sy, int sz) const {
+    return (sz * m_gy + sy) * m_gx + sx;
+  }
+  int getBitWidth(int subBlockIndex) const;
+  uint32_t getVoxelIndex(int subBlockIndex, int voxelIndex) const;
+  void prepareSubBlockStart();
+
+  /*!
+   * \brief Decode the labels of a sub-block palette into \a palette.
+   */
+  void getPalette(int subBlockIndex, std::vector<uint64_t> *palette) const;
+
+private:
+  int m_gx = 0;
+  int m_gy = 0;
+  int m_gz = 0;
+  ZIntPoint m_offset;
+  std::vector<uint64_t> m_labelArray;
+  std::vector<uint16_t> m_paletteSize;
+  std::vector<uint32_t> m_paletteIndex;
+  std::vector<uint8_t> m_voxelIndex;
+
+  //Start of each sub-block in m_paletteIndex and m_voxelIndex
+  std::vector<uint32_t> m_paletteStart;
+  std::vector<uint32_t> m_voxelStart;
+};
+
+#endif // ZDVIDLABELBLOCK_H
@@ -0,0 +1,331 @@
+#include "zdvidlabelcolorizer.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+#include <algorithm>
+
+#include "core/cpufeature.h"
+
+#if defined(NT_AVX2_DISPATCH)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+//Fields smaller than this are processed in a single band
+const size_t MIN_BAND_PIXEL_NUMBER = 65536;
+
+#if defined(NT_AVX2_DISPATCH)
+NT_AVX2_TARGET size_t GatherColorAvx2(
+    const uint32_t *index, size_t n, const uint32_t *color, uint32_t *out)
+{
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i indexVec = _mm256_loadu_si256((const __m256i*) (index + i));
+    __m256i colorVec = _mm256_i32gather_epi32(
+          (const int*) color, indexVec, 4);
+    _mm256_storeu_si256((__m256i*) (out + i), colorVec);
+  }
+
+  return i;
+}
+#endif
+
+void GatherColor(
+    const uint32_t *index, size_t n, const uint32_t *color, uint32_t *out)
+{
+  size_t i = 0;
+#if defined(NT_AVX2_DISPATCH)
+  if (neutube::HasAvx2()) {
+    i = GatherColorAvx2(index, n, color, out);
+  }
+#endif
+  for (; i < n; ++i) {
+    out[i] = color[index[i]];
+  }
+}
+
+/*!
+ * \brief Worker threads shared by all colorizers
+ *
+ * The threads are started on the first call and live until the program
+ * exits, so that repainting a slice does not create threads.
+ */
+class BandThreadPool
+{
+public:
+  static BandThreadPool& GetInstance()
+  {
+    static BandThreadPool pool;
+    return pool;
+  }
+
+  /*!
+   * \brief Run f(0), ..., f(n - 1) and wait for them to finish.
+   *
+   * The calling thread takes part in the work.
+   */
+  void run(size_t n, const std::function<void(size_t)> &f);
+
+private:
+  BandThreadPool();
+  ~BandThreadPool();
+
+  void work();
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_taskCondition;
+  std::deque<std::function<void()>> m_taskQueue;
+  std::vector<std::thread> m_threadArray;
+  bool m_stopping = false;
+};
+
+BandThreadPool::BandThreadPool()
+{
+  int threadNumber = int(std::thread::hardware_concurrency()) - 1;
+  for (int i = 0; i < threadNumber; ++i) {
+    m_threadArray.emplace_back(&BandThreadPool::work, this);
+  }
+}
+
+BandThreadPool::~BandThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_stopping = true;
+  }
+  m_taskCondition.notify_all();
+  for (std::thread &thread : m_threadArray) {
+    thread.join();
+  }
+}
+
+void BandThreadPool::work()
+{
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_taskCondition.wait(lock, [this]() {
+        return m_stopping || !m_taskQueue.empty(); });
+      if (m_taskQueue.empty()) {
+        return;
+      }
+      task = std::move(m_taskQueue.front());
+      m_taskQueue.pop_front();
+    }
+    task();
+  }
+}
+
+void BandThreadPool::run(size_t n, const std::function<void (size_t)> &f)
+{
+  struct State {
+    std::atomic<size_t> next{0};
+    size_t finished = 0;
+    std::mutex mutex;
+    std::condition_variable condition;
+  };
+
+  //A queued task may start after run() has returned, in which case it finds
+  //no index left and does not touch f.
+  std::shared_ptr<State> state = std::make_shared<State>();
+  auto task = [state, n, &f]() {
+    size_t finished = 0;
+    for (size_t i = state->next++; i < n; i = state->next++) {
+      f(i);
+      ++finished;
+    }
+    if (finished > 0) {
+      std::lock_guard<std::mutex> guard(state->mutex);
+      state->finished += finished;
+      if (state->finished == n) {
+        state->condition.notify_all();
+      }
+    }
+  };
+
+  size_t helperNumber = std::min(n - 1, m_threadArray.size());
+  if (helperNumber > 0) {
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      for (size_t i = 0; i < helperNumber; ++i) {
+        m_taskQueue.push_back(task);
+      }
+    }
+    m_taskCondition.notify_all();
+  }
+
+  task();
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->condition.wait(lock, [&]() { return state->finished == n; });
+}
+
+}
+
+ZDvidLabelColorizer::ZDvidLabelColorizer()
+{
+}
+
+void ZDvidLabelColorizer::setThreadNumber(int n)
+{
+  m_threadNumber = n;
+}
+
+int ZDvidLabelColorizer::getThreadNumber() const
+{
+  if (m_threadNumber > 0) {
+    return m_threadNumber;
+  }
+
+  return std::max(1, int(std::thread::hardware_concurrency()));
+}
+
+void ZDvidLabelColorizer::clear()
+{
+  m_width = 0;
+  m_height = 0;
+  m_index.clear();
+  m_bandArray.clear();
+  m_labelArray.clear();
+  m_colorArray.clear();
+}
+
+bool ZDvidLabelColorizer::isEmpty() const
+{
+  return m_index.empty();
+}
+
+void ZDvidLabelColorizer::runBands(
+    const std::function<void (size_t)> &f) const
+{
+  if (m_bandArray.size() == 1) {
+    f(0);
+  } else if (!m_bandArray.empty()) {
+    BandThreadPool::GetInstance().run(m_bandArray.size(), f);
+  }
+}
+
+void ZDvidLabelColorizer::setLabelField(
+    const uint64_t *data, int width, int height)
+{
+  clear();
+
+  if (data == NULL || width <= 0 || height <= 0) {
+    return;
+  }
+
+  m_width = width;
+  m_height = height;
+  size_t pixelNumber = size_t(width) * height;
+  m_index.resize(pixelNumber);
+
+  int bandNumber = int(std::min(
+        size_t(getThreadNumber()),
+        std::max(size_t(1), pixelNumber / MIN_BAND_PIXEL_NUMBER)));
+  bandNumber = std::min(bandNumber, height);
+  m_bandArray.resize(bandNumber);
+  for (int i = 0; i < bandNumber; ++i) {
+    m_bandArray[i].startRow = int(int64_t(height) * i / bandNumber);
+    m_bandArray[i].endRow = int(int64_t(height) * (i + 1) / bandNumber);
+  }
+
+  //Neighboring pixels mostly share the same label, so the hash table is only
+  //probed when the label changes.
+  runBands([&](size_t bandIndex) {
+    Band &band = m_bandArray[bandIndex];
+    std::unordered_map<uint64_t, uint32_t> indexMap;
+    size_t start = size_t(band.startRow) * width;
+    size_t end = size_t(band.endRow) * width;
+    uint64_t currentLabel = 0;
+    uint32_t currentIndex = 0;
+    for (size_t i = start; i < end; ++i) {
+      uint64_t label = data[i];
+      if (i == start || label != currentLabel) {
+        auto result = indexMap.insert(
+              std::make_pair(label, uint32_t(band.labelArray.size())));
+        if (result.second) {
+          band.labelArray.push_back(label);
+        }
+        currentLabel = label;
+        currentIndex = result.first->second;
+      }
+      m_index[i] = currentIndex;
+    }
+  });
+
+  std::unordered_map<uint64_t, uint32_t> globalMap;
+  for (Band &band : m_bandArray) {
+    band.globalIndex.resize(band.labelArray.size());
+    for (size_t i = 0; i < band.labelArray.size(); ++i) {
+      uint64_t label = band.labelArray[i];
+      auto result = globalMap.insert(
+            std::make_pair(label, uint32_t(m_labelArray.size())));
+      if (result.second) {
+        m_labelArray.push_back(label);
+      }
+      band.globalIndex[i] = result.first->second;
+    }
+  }
+}
+
+void ZDvidLabelColorizer::updateColor(const ColorFunction &f)
+{
+  m_colorArray.resize(m_labelArray.size());
+  for (size_t i = 0; i < m_labelArray.size(); ++i) {
+    m_colorArray[i] = f(m_labelArray[i]);
+  }
+}
+
+void ZDvidLabelColorizer::makeBandColor(
+    const Band &band, std::vector<uint32_t> &color) const
+{
+  color.resize(band.globalIndex.size());
+  for (size_t i = 0; i < band.globalIndex.size(); ++i) {
+    color[i] = m_colorArray[band.globalIndex[i]];
+  }
+}
+
+void ZDvidLabelColorizer::paint(uint32_t *out, size_t stride) const
+{
+  if (out == NULL || isEmpty() || m_colorArray.size() != m_labelArray.size()) {
+    return;
+  }
+
+  runBands([&](size_t bandIndex) {
+    const Band &band = m_bandArray[bandIndex];
+    std::vector<uint32_t> color;
+    makeBandColor(band, color);
+    for (int y = band.startRow; y < band.endRow; ++y) {
+      GatherColor(m_index.data() + size_t(y) * m_width, m_width, color.data(),
+                  out + y * stride);
+    }
+  });
+}
+
+void ZDvidLabelColorizer::paintTranspose(uint32_t *out, size_t stride) const
+{
+  if (out == NULL || isEmpty() || m_colorArray.size() != m_labelArray.size()) {
+    return;
+  }
+
+  runBands([&](size_t bandIndex) {
+    const Band &band = m_bandArray[bandIndex];
+    std::vector<uint32_t> color;
+    makeBandColor(band, color);
+    for (int y = band.startRow; y < band.endRow; ++y) {
+      const uint32_t *index = m_index.data() + size_t(y) * m_width;
+      uint32_t *column = out + y;
+      for (int x = 0; x < m_width; ++x) {
+        column[x * stride] = color[index[x]];
+      }
+    }
+  });
+}
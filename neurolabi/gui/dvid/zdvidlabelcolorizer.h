@@ -0,0 +1,101 @@
+#ifndef ZDVIDLABELCOLORIZER_H
+#define ZDVIDLABELCOLORIZER_H
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+/*!
+ * \brief The class of coloring a label field through a compact label index
+ *
+ * A label slice usually has only a few thousand distinct labels even when it
+ * has millions of pixels. setLabelField() replaces each pixel with the index
+ * of its label, so that the selection, the merge map and the color of a label
+ * are resolved only once per distinct label in updateColor(). paint() then
+ * writes ARGB pixels by gathering colors through the index.
+ *
+ * The field is processed in bands of rows, each of which has its own local
+ * index, so that both indexing and painting run in parallel on worker threads
+ * shared by all colorizers. The index stays valid until the label field
+ * changes, which means changing selection or colors only needs updateColor()
+ * and paint().
+ */
+class ZDvidLabelColorizer
+{
+public:
+  ZDvidLabelColorizer();
+
+  typedef std::function<uint32_t(uint64_t)> ColorFunction;
+
+  /*!
+   * \brief Set the number of threads.
+   *
+   * The number of hardware threads is used if \a n <= 0.
+   */
+  void setThreadNumber(int n);
+  int getThreadNumber() const;
+
+  /*!
+   * \brief Index a label field of \a width x \a height in the row-major order.
+   *
+   * The data are not referenced after the call.
+   */
+  void setLabelField(const uint64_t *data, int width, int height);
+
+  /*!
+   * \brief Drop the index and the colors.
+   */
+  void clear();
+
+  bool isEmpty() const;
+
+  int getWidth() const { return m_width; }
+  int getHeight() const { return m_height; }
+
+  /*!
+   * \brief Get the distinct labels of the field.
+   */
+  const std::vector<uint64_t>& getLabelArray() const { return m_labelArray; }
+
+  /*!
+   * \brief Resolve the color of each distinct label with \a f.
+   */
+  void updateColor(const ColorFunction &f);
+
+  /*!
+   * \brief Paint the field into an ARGB buffer.
+   *
+   * A pixel (x, y) of the field is written to out[y * stride + x]. It does
+   * nothing if updateColor() has not been called since the field was set.
+   */
+  void paint(uint32_t *out, size_t stride) const;
+
+  /*!
+   * \brief Paint the transposed field, i.e. (x, y) is written to
+   * out[x * stride + y].
+   */
+  void paintTranspose(uint32_t *out, size_t stride) const;
+
+private:
+  struct Band {
+    int startRow = 0;
+    int endRow = 0;
+    std::vector<uint64_t> labelArray; //Local index -> label
+    std::vector<uint32_t> globalIndex; //Local index -> global index
+  };
+
+  void runBands(const std::function<void(size_t)> &f) const;
+  void makeBandColor(const Band &band, std::vector<uint32_t> &color) const;
+
+private:
+  int m_threadNumber = 0;
+  int m_width = 0;
+  int m_height = 0;
+  std::vector<uint32_t> m_index; //Local index of each pixel
+  std::vector<Band> m_bandArray;
+  std::vector<uint64_t> m_labelArray;
+  std::vector<uint32_t> m_colorArray;
+};
+
+#endif // ZDVIDLABELCOLORIZER_H
@@ -24,6 +24,8 @@
 #include "zdviddataslicehelper.h"
 #include "misc/miscutility.h"
 #include "flyem/zdvidlabelslicehighrestask.h"
+#include "dvid/zdvidlabelblock.h"
+#include "zdvidinfo.h"
 
 /* Implementation details:
  *
@@ -53,7 +55,6 @@ ZDvidLabelSlice::~ZDvidLabelSlice()
 {
   delete m_paintBuffer;
   delete m_labelArray;
-  delete m_mappedLabelArray;
 }
 
 void ZDvidLabelSlice::init(int maxWidth, int maxHeight  , neutube::EAxis sliceAxis)
@@ -73,7 +74,6 @@ void ZDvidLabelSlice::init(int maxWidth, int maxHeight  , neutube::EAxis sliceAx
   m_paintBuffer = NULL;
 //  m_paintBuffer = new ZImage(m_maxWidth, m_maxHeight, QImage::Format_ARGB32);
   m_labelArray = NULL;
-  m_mappedLabelArray = NULL;
 
   m_selectionFrozen = false;
 //  m_isFullView = false;
@@ -282,6 +282,44 @@ void ZDvidLabelSlice::updateRgbTable()
   }
 }
 
+ZDvidLabelColorizer::ColorFunction ZDvidLabelSlice::getLabelColorFunction()
+    const
+{
+  bool highlighting =
+      hasVisualEffect(neutube::display::LabelField::VE_HIGHLIGHT_SELECTED);
+  ZFlyEmBodyMerger::TLabelMap bodyMap = getLabelMap();
+  bool customColor = (m_customColorScheme.get() != NULL);
+  QHash<uint64_t, int> idMap;
+  if (customColor) {
+    idMap = m_customColorScheme->getColorIndexMap();
+  }
+  const std::set<uint64_t> &selected = m_selectedOriginal;
+  const QVector<int> &rgbTable = m_rgbTable;
+
+  return [=, &selected, &rgbTable](uint64_t label) -> uint32_t {
+    if (selected.count(label) > 0) {
+      if (!highlighting) {
+        return 0xFFFFFFFF;
+      }
+    } else if (highlighting) {
+      return 0;
+    }
+
+    uint64_t mappedLabel = bodyMap.value(label, label);
+    if (customColor) {
+      mappedLabel = idMap.value(mappedLabel, 0);
+    }
+
+    if (mappedLabel == 0) {
+      return 0;
+    } else if (mappedLabel == flyem::LABEL_ID_SELECTION) {
+      return 0xFFFFFFFF;
+    }
+
+    return rgbTable[mappedLabel % rgbTable.size()];
+  };
+}
+
 void ZDvidLabelSlice::paintBufferUnsync()
 {
   if (m_labelArray != NULL && m_paintBuffer != NULL) {
@@ -289,29 +327,28 @@ void ZDvidLabelSlice::paintBufferUnsync()
         m_paintBuffer->width() * m_paintBuffer->height()) {
       updateRgbTable();
 
-      // TODO: Consider a way to use m_customColorScheme without remapId(), because remapId()
-      // takes around 3 ms on a Macbook Pro.  That may not sound like much but it is about
-      // 20% of the budget per frame for 60 frames/sec.
-
-      remapId();
-
-      uint64_t *labelArray = NULL;
-
-      if (m_paintBuffer->isVisible()) {
-        if (m_selectedOriginal.empty() && getLabelMap().empty() &&
-            m_customColorScheme.get() == NULL) {
-          labelArray = m_labelArray->getDataPointer<uint64_t>();
-        } else {
-          labelArray = m_mappedLabelArray->getDataPointer<uint64_t>();
+      //Nothing to show when no selected body is highlighted
+      m_paintBuffer->setVisible(
+            !(m_selectedOriginal.empty() && hasVisualEffect(
+                neutube::display::LabelField::VE_HIGHLIGHT_SELECTED)));
+
+      if (m_paintBuffer->isVisible() && !m_rgbTable.isEmpty()) {
+        //The label index is kept until the labels change, so that selection
+        //and color changes are resolved per distinct label only.
+        if (m_labelColorizer.isEmpty()) {
+          int width = m_labelArray->getDim(0);
+          m_labelColorizer.setLabelField(
+                m_labelArray->getDataPointer<uint64_t>(), width,
+                int(m_labelArray->getElementNumber() / width));
         }
-      }
+        m_labelColorizer.updateColor(getLabelColorFunction());
 
-      if (labelArray != NULL) {
+        uint32_t *buffer = (uint32_t*) m_paintBuffer->bits();
+        size_t stride = m_paintBuffer->bytesPerLine() / sizeof(uint32_t);
         if (getSliceAxis() == neutube::EAxis::X) {
-          m_paintBuffer->drawLabelFieldTranspose(
-                labelArray, m_rgbTable, 0, 0xFFFFFFFF);
+          m_labelColorizer.paintTranspose(buffer, stride);
         } else {
-          m_paintBuffer->drawLabelField(labelArray, m_rgbTable, 0, 0xFFFFFFFF);
+          m_labelColorizer.paint(buffer, stride);
         }
       }
     }
@@ -328,12 +365,34 @@ void ZDvidLabelSlice::clearLabelData()
 {
   delete m_labelArray;
   m_labelArray = NULL;
-  delete m_mappedLabelArray;
-  m_mappedLabelArray = NULL;
+  m_hitBlock.reset();
+  m_labelColorizer.clear();
+}
+
+uint64_t ZDvidLabelSlice::readOriginalLabel(int x, int y, int z)
+{
+  const ZDvidReader &reader = getHelper()->getDvidReader();
+  if (!reader.getDvidTarget().hasBlockCoding()) {
+    return reader.readBodyIdAt(x, y, z);
+  }
+
+  if (!m_hitBlock || !m_hitBlock->getBoundBox().contains(x, y, z)) {
+    ZIntPoint blockIndex = reader.readLabelInfo().getBlockIndex(x, y, z);
+    m_hitBlock.reset(reader.readCompressedLabelBlock(
+                       blockIndex.getX(), blockIndex.getY(), blockIndex.getZ(),
+                       0));
+    if (!m_hitBlock) {
+      return reader.readBodyIdAt(x, y, z);
+    }
+  }
+
+  return m_hitBlock->getValue(x, y, z);
 }
 
 void ZDvidLabelSlice::forceUpdate(bool ignoringHidden)
 {
+  //Labels may have been changed
+  getHelper()->invalidateSliceCache();
   forceUpdate(getHelper()->getViewParam(), ignoringHidden);
 }
 
@@ -417,7 +476,7 @@ void ZDvidLabelSlice::forceUpdate(const QRect &viewPort, int z, int zoom)
     if (!viewPort.isEmpty()) {
       ZIntCuboid box = ZDvidDataSliceHelper::GetBoundBox(viewPort, z);
       if (getSliceAxis() == neutube::EAxis::Z) {
-        m_labelArray = getHelper()->getDvidReader().readLabels64Lowtis(
+        m_labelArray = getHelper()->readLabels64Lowtis(
               box.getFirstCorner().getX(), box.getFirstCorner().getY(),
               box.getFirstCorner().getZ(), box.getWidth(), box.getHeight(),
               zoom, getHelper()->getCenterCutWidth(),
@@ -425,6 +484,11 @@ void ZDvidLabelSlice::forceUpdate(const QRect &viewPort, int z, int zoom)
         getHelper()->setActualQuality(
               zoom, getHelper()->getCenterCutWidth(),
               getHelper()->getCenterCutHeight(), getHelper()->usingCenterCut());
+        getHelper()->prefetch(
+              box.getFirstCorner().getX(), box.getFirstCorner().getY(),
+              box.getFirstCorner().getZ(), box.getWidth(), box.getHeight(),
+              zoom, getHelper()->getCenterCutWidth(),
+              getHelper()->getCenterCutHeight(), getHelper()->usingCenterCut());
       } else {
         int zoomRatio = pow(2, zoom);
         int width = box.getWidth() / zoomRatio;
@@ -675,252 +739,36 @@ void ZDvidLabelSlice::assignColorMap()
   }
 }
 
-void ZDvidLabelSlice::remapId()
+bool ZDvidLabelSlice::getOriginalLabel(
+    int x, int y, int z, uint64_t *label) const
 {
-//  QMutexLocker locker(&m_updateMutex);
-  if (m_labelArray != NULL && m_mappedLabelArray == NULL) {
-    m_mappedLabelArray = new ZArray(m_labelArray->valueType(),
-                                    m_labelArray->ndims(),
-                                    m_labelArray->dims());
-  }
-  remapId(m_mappedLabelArray);
-}
-
-void ZDvidLabelSlice::remapId(
-    uint64_t *array, const uint64_t *originalArray, uint64_t v)
-{
-  if (m_customColorScheme.get() != NULL) {
-
-    QHash<uint64_t, int> idMap;
-
-    idMap = m_customColorScheme->getColorIndexMap();
-
-    if (hasVisualEffect(neutube::display::LabelField::VE_HIGHLIGHT_SELECTED)) {
-      for (size_t i = 0; i < v; ++i) {
-        array[i] = 0;
-      }
-    } else {
-      for (size_t i = 0; i < v; ++i) {
-        array[i] = originalArray[i];
-        if (idMap.contains(array[i])) {
-          array[i] = idMap[array[i]];
-        } else {
-          array[i] = 0;
-        }
-      }
-    }
-  }
-}
-
-
-void ZDvidLabelSlice::remapId(
-    uint64_t *array, const uint64_t *originalArray, uint64_t v,
-    std::set<uint64_t> &selected)
-{
-  if (m_customColorScheme.get() != NULL) {
-
-    QHash<uint64_t, int> idMap;
-
-    idMap = m_customColorScheme->getColorIndexMap();
-
-    if (hasVisualEffect(neutube::display::LabelField::VE_HIGHLIGHT_SELECTED)) {
-      for (size_t i = 0; i < v; ++i) {
-        if (selected.count(originalArray[i]) > 0) {
-          array[i] = originalArray[i];
-          if (idMap.contains(array[i])) {
-            array[i] = idMap[array[i]];
-          } else {
-            array[i] = 0;
-          }
-        } else {
-          array[i] = 0;
-        }
-      }
-    } else {
-      for (size_t i = 0; i < v; ++i) {
-        if (selected.count(originalArray[i]) > 0) {
-          array[i] = flyem::LABEL_ID_SELECTION;
-        } else {
-          array[i] = originalArray[i];
-          if (idMap.contains(array[i])) {
-            array[i] = idMap[array[i]];
-          } else {
-            array[i] = 0;
-          }
-        }
-      }
-    }
-  } else {
-    if (hasVisualEffect(neutube::display::LabelField::VE_HIGHLIGHT_SELECTED)) {
-      for (size_t i = 0; i < v; ++i) {
-        if (selected.count(originalArray[i]) > 0) {
-          array[i] = originalArray[i];
-        } else {
-          array[i] = 0;
-        }
-      }
-    } else {
-      for (size_t i = 0; i < v; ++i) {
-        if (selected.count(originalArray[i]) > 0) {
-          array[i] = flyem::LABEL_ID_SELECTION;
-        } else {
-          array[i] = originalArray[i];
-        }
-      }
-    }
+  if (m_labelArray == NULL || label == NULL ||
+      getSliceAxis() == neutube::EAxis::ARB) {
+    return false;
   }
-}
-
-void ZDvidLabelSlice::remapId(
-    uint64_t *array, const uint64_t *originalArray, uint64_t v,
-    const ZFlyEmBodyMerger::TLabelMap &bodyMap)
-{
-
-  if (m_customColorScheme.get() != NULL) {
-    QHash<uint64_t, int> idMap;
-
-    idMap = m_customColorScheme->getColorIndexMap();
 
-    if (hasVisualEffect(neutube::display::LabelField::VE_HIGHLIGHT_SELECTED)) {
-      m_paintBuffer->setVisible(false);
-    } else {
-      for (size_t i = 0; i < v; ++i) {
-        if (bodyMap.count(originalArray[i]) > 0) {
-          array[i] = bodyMap[originalArray[i]];
-        } else {
-          array[i] = originalArray[i];
-        }
-        if (idMap.contains(array[i])) {
-          array[i] = idMap[array[i]];
-        } else {
-          array[i] = 0;
-        }
-      }
-    }
-  } else {
-    if (hasVisualEffect(neutube::display::LabelField::VE_HIGHLIGHT_SELECTED)) {
-      m_paintBuffer->setVisible(false);
-    } else {
-      for (size_t i = 0; i < v; ++i) {
-        if (bodyMap.count(originalArray[i]) > 0) {
-          array[i] = bodyMap[originalArray[i]];
-        } else {
-          array[i] = originalArray[i];
-        }
-      }
-    }
+  //Low-resolution labels are not reliable for a single voxel
+  if (getHelper()->getActualZoom() != 0 ||
+      getHelper()->m_actualUsingCenterCut) {
+    return false;
   }
-}
 
-void ZDvidLabelSlice::remapId(
-    uint64_t *array, const uint64_t *originalArray, uint64_t v,
-    std::set<uint64_t> &selected, const ZFlyEmBodyMerger::TLabelMap &bodyMap)
-{
-  if (m_customColorScheme.get() != NULL) {
-    QHash<uint64_t, int> idMap;
+  int dx = x - m_labelArray->getStartCoordinate(0);
+  int dy = y - m_labelArray->getStartCoordinate(1);
+  int dz = z - m_labelArray->getStartCoordinate(2);
+  int width = m_labelArray->getDim(0);
+  int height = m_labelArray->getDim(1);
+  int depth = m_labelArray->getDim(2);
 
-
-    idMap = m_customColorScheme->getColorIndexMap();
-
-    std::set<uint64_t> selectedSet = selected;
-
-    if (hasVisualEffect(neutube::display::LabelField::VE_HIGHLIGHT_SELECTED)) {
-      for (size_t i = 0; i < v; ++i) {
-        if (selectedSet.count(originalArray[i]) > 0) {
-          if (bodyMap.count(originalArray[i]) > 0) {
-            array[i] = bodyMap[originalArray[i]];
-          } else {
-            array[i] = originalArray[i];
-          }
-          if (idMap.contains(array[i])) {
-            array[i] = idMap[array[i]];
-          } else {
-            array[i] = 0;
-          }
-        } else {
-          array[i] = 0;
-        }
-      }
-    } else {
-      for (size_t i = 0; i < v; ++i) {
-        if (selectedSet.count(originalArray[i]) > 0) {
-          array[i] = flyem::LABEL_ID_SELECTION;
-        } else if (bodyMap.count(originalArray[i]) > 0) {
-          array[i] = bodyMap[originalArray[i]];
-          if (idMap.contains(array[i])) {
-            array[i] = idMap[array[i]];
-          } else {
-            array[i] = 0;
-          }
-        } else {
-          array[i] = originalArray[i];
-          if (idMap.contains(array[i])) {
-            array[i] = idMap[array[i]];
-          } else {
-            array[i] = 0;
-          }
-        }
-      }
-    }
-  } else {
-    std::set<uint64_t> selectedSet = selected;
-
-    if (hasVisualEffect(neutube::display::LabelField::VE_HIGHLIGHT_SELECTED)) {
-      for (size_t i = 0; i < v; ++i) {
-        if (selectedSet.count(originalArray[i]) > 0) {
-          if (bodyMap.count(originalArray[i]) > 0) {
-            array[i] = bodyMap[originalArray[i]];
-          } else {
-            array[i] = originalArray[i];
-          }
-        } else {
-          array[i] = 0;
-        }
-      }
-    } else {
-      for (size_t i = 0; i < v; ++i) {
-        if (selectedSet.count(originalArray[i]) > 0) {
-          array[i] = flyem::LABEL_ID_SELECTION;
-        } else if (bodyMap.count(originalArray[i]) > 0) {
-          array[i] = bodyMap[originalArray[i]];
-        } else {
-          array[i] = originalArray[i];
-        }
-      }
-    }
+  if (dx < 0 || dy < 0 || dz < 0 ||
+      dx >= width || dy >= height || dz >= depth) {
+    return false;
   }
-}
 
-void ZDvidLabelSlice::remapId(ZArray *label)
-{
-  if (m_paintBuffer != NULL) {
-    m_paintBuffer->setVisible(true);
-  }
+  *label = m_labelArray->getDataPointer<uint64_t>()[
+      ((size_t) dz * height + dy) * width + dx];
 
-  if (m_labelArray != NULL && label != NULL) {
-    ZFlyEmBodyMerger::TLabelMap bodyMap = getLabelMap();
-    uint64_t *array = label->getDataPointer<uint64_t>();
-    const uint64_t *originalArray = m_labelArray->getDataPointer<uint64_t>();
-    size_t v = label->getElementNumber();
-    if (!bodyMap.empty() || !m_selectedOriginal.empty()) {
-      if (bodyMap.empty()) {
-        remapId(array, originalArray, v, m_selectedOriginal);
-      } else if (m_selectedOriginal.empty()) {
-        remapId(array, originalArray, v, bodyMap);
-      } else {
-        remapId(array, originalArray, v, m_selectedOriginal, bodyMap);
-      }
-    } else {
-      if (m_customColorScheme.get() != NULL) {
-        remapId(array, originalArray, v);
-      }
-      if (hasVisualEffect(neutube::display::LabelField::VE_HIGHLIGHT_SELECTED)) {
-        if (m_paintBuffer != NULL) {
-          m_paintBuffer->setVisible(false);
-        }
-      }
-    }
-  }
+  return true;
 }
 
 bool ZDvidLabelSlice::hit(double x, double y, double z)
@@ -958,11 +806,13 @@ bool ZDvidLabelSlice::hit(double x, double y, double z)
     }
 
     if (withinRange) {
-      if (getHelper()->getDvidReader().isReady()) {
+      uint64_t label = 0;
+      if (getOriginalLabel(nx, ny, nz, &label)) {
+        m_hitLabel = getMappedLabel(label, neutube::EBodyLabelType::ORIGINAL);
+      } else if (getHelper()->getDvidReader().isReady()) {
 //        ZGeometry::shiftSliceAxis(nx, ny, nz, m_sliceAxis);
         m_hitLabel = getMappedLabel(
-              getHelper()->getDvidReader().readBodyIdAt(nx, ny, nz),
-              neutube::EBodyLabelType::ORIGINAL);
+              readOriginalLabel(nx, ny, nz), neutube::EBodyLabelType::ORIGINAL);
       }
 
       return m_hitLabel > 0;
@@ -17,6 +17,7 @@
 #include "zsharedpointer.h"
 #include "flyem/zflyembodycolorscheme.h"
 #include "flyem/zflyembodymerger.h"
+#include "dvid/zdvidlabelcolorizer.h"
 
 class QColor;
 class ZArray;
@@ -26,6 +27,7 @@ class ZStackViewParam;
 class ZArbSliceViewParam;
 class ZTask;
 class ZStackDoc;
+class ZDvidLabelBlock;
 
 class ZDvidLabelSlice : public ZStackObject
 {
@@ -61,6 +63,14 @@ public:
 
   bool hit(double x, double y, double z);
 
+  /*!
+   * \brief Get the original label at (\a x, \a y, \a z) from the loaded data.
+   *
+   * It returns false if the point is not covered by full-resolution label data
+   * of the slice, in which case \a label is not touched.
+   */
+  bool getOriginalLabel(int x, int y, int z, uint64_t *label) const;
+
   void selectHit(bool appending = false);
 //  void selectLabel(uint64_t bodyId, bool appending = false);
 
@@ -184,17 +194,12 @@ private:
   QColor getCustomColor(uint64_t label) const;
 
   void paintBufferUnsync();
-  void remapId(ZArray *label);
-  void remapId();
-
-  void remapId(uint64_t *array, const uint64_t *originalArray, uint64_t v);
-  void remapId(uint64_t *array, const uint64_t *originalArray, uint64_t v,
-               std::set<uint64_t> &selected);
-  void remapId(uint64_t *array, const uint64_t *originalArray, uint64_t v,
-               const ZFlyEmBodyMerger::TLabelMap &bodyMap);
-  void remapId(uint64_t *array, const uint64_t *originalArray, uint64_t v,
-               std::set<uint64_t> &selected,
-               const ZFlyEmBodyMerger::TLabelMap &bodyMap);
+
+  /*!
+   * \brief Get the function of resolving the display color of an original
+   * label with the current selection, merge map and color scheme.
+   */
+  ZDvidLabelColorizer::ColorFunction getLabelColorFunction() const;
 
   void updateRgbTable();
 
@@ -220,6 +225,14 @@ private:
 
   bool hasValidPaintBuffer() const;
 
+  /*!
+   * \brief Read the original label at a point out of the label data.
+   *
+   * The compressed block containing the point is kept for later hits when
+   * the segmentation supports block coding.
+   */
+  uint64_t readOriginalLabel(int x, int y, int z);
+
 private:
   ZObject3dScanArray m_objArray;
 
@@ -234,7 +247,8 @@ private:
   ZImage *m_paintBuffer;
 
   ZArray *m_labelArray;
-  ZArray *m_mappedLabelArray;
+  std::unique_ptr<ZDvidLabelBlock> m_hitBlock; //Last block read by hit test
+  ZDvidLabelColorizer m_labelColorizer;
   QMutex m_updateMutex;
 
   std::set<uint64_t> m_prevSelectedOriginal;
@@ -0,0 +1,297 @@
+#include "zdvidmesharchivedecoder.h"
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <cstdlib>
+#include <algorithm>
+
+#include <QThreadPool>
+#include <QRunnable>
+
+#include <archive.h>
+#include <archive_entry.h>
+
+#include "zmesh.h"
+#include "zmeshio.h"
+
+const int ZDvidMeshArchiveDecoder::DEFAULT_WINDOW_SIZE = 64;
+
+namespace {
+
+bool ReadArchiveEntry(
+    struct archive *arc, ZDvidMeshArchiveDecoder::Entry &entry)
+{
+  struct archive_entry *archiveEntry;
+  if (archive_read_next_header(arc, &archiveEntry) != ARCHIVE_OK) {
+    return false;
+  }
+
+  entry.name = archive_entry_pathname(archiveEntry);
+
+  const struct stat *s = archive_entry_stat(archiveEntry);
+  entry.data.resize(s->st_size);
+  if (!entry.data.empty()) {
+    archive_read_data(arc, entry.data.data(), entry.data.size());
+  }
+
+  return true;
+}
+
+struct DecodeJob {
+  ZDvidMeshArchiveDecoder::Entry entry;
+  size_t byteNumber = 0;
+  ZMesh *mesh = NULL;
+};
+
+class DecodeWorker : public QRunnable
+{
+public:
+  explicit DecodeWorker(const std::function<void()> &f) : m_run(f) {
+    setAutoDelete(true);
+  }
+
+  void run() override {
+    m_run();
+  }
+
+private:
+  std::function<void()> m_run;
+};
+
+}
+
+ZDvidMeshArchiveDecoder::ZDvidMeshArchiveDecoder() :
+  m_windowSize(DEFAULT_WINDOW_SIZE), m_decode(DecodeDraco), m_canceled(false)
+{
+}
+
+void ZDvidMeshArchiveDecoder::setThreadNumber(int n)
+{
+  m_threadNumber = n;
+}
+
+int ZDvidMeshArchiveDecoder::getThreadNumber() const
+{
+  if (m_threadNumber > 0) {
+    return m_threadNumber;
+  }
+
+  return std::max(1, QThreadPool::globalInstance()->maxThreadCount());
+}
+
+void ZDvidMeshArchiveDecoder::setWindowSize(int n)
+{
+  m_windowSize = std::max(1, n);
+}
+
+void ZDvidMeshArchiveDecoder::setDecodeFunction(const DecodeFunction &f)
+{
+  m_decode = f ? f : DecodeFunction(DecodeDraco);
+}
+
+void ZDvidMeshArchiveDecoder::setPostProcess(const MeshCallback &f)
+{
+  m_postProcess = f;
+}
+
+void ZDvidMeshArchiveDecoder::cancel()
+{
+  m_canceled = true;
+}
+
+bool ZDvidMeshArchiveDecoder::isCanceled() const
+{
+  return m_canceled;
+}
+
+uint64_t ZDvidMeshArchiveDecoder::GetMeshId(const std::string &entryName)
+{
+  return std::strtoull(entryName.c_str(), NULL, 10);
+}
+
+ZMesh* ZDvidMeshArchiveDecoder::DecodeDraco(const Entry &entry)
+{
+  //No copy of the entry data
+  QByteArray buffer = QByteArray::fromRawData(
+        entry.data.data(), int(entry.data.size()));
+
+  return ZMeshIO::instance().loadFromMemory(buffer, "drc");
+}
+
+size_t ZDvidMeshArchiveDecoder::decode(
+    struct archive *arc, const MeshCallback &callback,
+    const ProgressCallback &progress, size_t bytesTotal)
+{
+  if (arc == NULL) {
+    return 0;
+  }
+
+  return decode([arc](Entry &entry) { return ReadArchiveEntry(arc, entry); },
+                callback, progress, bytesTotal);
+}
+
+size_t ZDvidMeshArchiveDecoder::decode(
+    const EntryReader &reader, const MeshCallback &callback,
+    const ProgressCallback &progress, size_t bytesTotal)
+{
+  m_canceled = false;
+
+  std::mutex mutex;
+  std::condition_variable jobCondition;
+  std::condition_variable doneCondition;
+  std::deque<DecodeJob> jobQueue;
+  std::vector<DecodeJob> doneArray;
+  bool reading = true;
+  int inFlight = 0;
+  int workerNumber = 0;
+
+  //Jobs taken after canceling are passed through without decoding.
+  auto runJob = [&](DecodeJob &job) {
+    if (!m_canceled) {
+      try {
+        job.mesh = m_decode(job.entry);
+        if (job.mesh != NULL) {
+          job.mesh->setLabel(GetMeshId(job.entry.name));
+          if (m_postProcess) {
+            m_postProcess(job.mesh);
+          }
+        }
+      } catch (...) {
+        delete job.mesh;
+        job.mesh = NULL;
+      }
+    }
+    job.entry.data = std::vector<char>(); //Release the buffer early
+  };
+
+  //A worker keeps taking jobs until reading is done
+  auto runWorker = [&]() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      jobCondition.wait(lock, [&]() { return !jobQueue.empty() || !reading; });
+      if (jobQueue.empty()) {
+        break;
+      }
+
+      DecodeJob job = std::move(jobQueue.front());
+      jobQueue.pop_front();
+      lock.unlock();
+
+      runJob(job);
+
+      lock.lock();
+      doneArray.push_back(std::move(job));
+      doneCondition.notify_one();
+    }
+    --workerNumber;
+    doneCondition.notify_all();
+  };
+
+  //Workers only take free threads of the shared pool, so none of them is
+  //left queued after decode() returns. The calling thread decodes jobs itself
+  //when no worker is available, e.g. when it runs in the pool.
+  QThreadPool *pool = QThreadPool::globalInstance();
+  int threadNumber = std::min(getThreadNumber(), m_windowSize);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  for (int i = 0; i < threadNumber; ++i) {
+    DecodeWorker *worker = new DecodeWorker(runWorker);
+    if (!pool->tryStart(worker)) {
+      delete worker;
+      break;
+    }
+    ++workerNumber;
+  }
+
+  size_t meshCount = 0;
+  size_t doneBytes = 0;
+  size_t readBytes = 0;
+
+  //Pass decoded meshes to the callback without holding the lock. An entry
+  //leaves the window only after its mesh is delivered.
+  auto deliver = [&]() {
+    std::vector<DecodeJob> jobArray;
+    jobArray.swap(doneArray);
+    lock.unlock();
+
+    for (DecodeJob &job : jobArray) {
+      doneBytes += job.byteNumber;
+      if (job.mesh != NULL) {
+        if (m_canceled || !callback) {
+          delete job.mesh;
+        } else {
+          callback(job.mesh);
+          ++meshCount;
+        }
+      }
+      if (progress && !m_canceled) {
+        progress(doneBytes, std::max(bytesTotal, readBytes));
+      }
+    }
+
+    lock.lock();
+    inFlight -= int(jobArray.size());
+  };
+
+  //Wait for a decoded job, or decode one in the calling thread if it is not
+  //taken by any worker.
+  auto deliverNext = [&]() {
+    if (doneArray.empty() && !jobQueue.empty()) {
+      DecodeJob job = std::move(jobQueue.front());
+      jobQueue.pop_front();
+      lock.unlock();
+      runJob(job);
+      lock.lock();
+      doneArray.push_back(std::move(job));
+    }
+    doneCondition.wait(lock, [&]() { return !doneArray.empty(); });
+    deliver();
+  };
+
+  while (!m_canceled) {
+    while (inFlight >= m_windowSize) {
+      deliverNext();
+    }
+
+    if (m_canceled) {
+      break;
+    }
+
+    //Workers keep decoding while the next entry is being read
+    DecodeJob job;
+    lock.unlock();
+    bool hasEntry = reader(job.entry);
+    lock.lock();
+
+    if (!hasEntry) {
+      break;
+    }
+
+    job.byteNumber = job.entry.data.size();
+    readBytes += job.byteNumber;
+    jobQueue.push_back(std::move(job));
+    ++inFlight;
+    jobCondition.notify_one();
+
+    if (!doneArray.empty()) {
+      deliver();
+    }
+  }
+
+  reading = false;
+  jobCondition.notify_all();
+
+  while (inFlight > 0) {
+    deliverNext();
+  }
+
+  doneCondition.wait(lock, [&]() { return workerNumber == 0; });
+  lock.unlock();
+
+  if (progress && !m_canceled && doneBytes > 0) {
+    progress(doneBytes, doneBytes);
+  }
+
+  return meshCount;
+}
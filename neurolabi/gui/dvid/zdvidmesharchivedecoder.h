@@ -0,0 +1,126 @@
+#ifndef ZDVIDMESHARCHIVEDECODER_H
+#define ZDVIDMESHARCHIVEDECODER_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+class ZMesh;
+struct archive;
+
+/*!
+ * \brief The class of decoding a mesh archive in a pipeline
+ *
+ * The calling thread reads the entries of an archive one by one. Workers
+ * running in free threads of the global QThreadPool decode the entries in
+ * parallel, and the calling thread decodes entries itself when no worker is
+ * available. A mesh is passed to the mesh callback in the calling thread as
+ * soon as it is decoded, so a caller can show the meshes progressively.
+ *
+ * At most getWindowSize() entries are in flight at any time. An entry is in
+ * flight from when it is read until its mesh has been passed to the callback.
+ * This bounds the memory used by decompressed entry buffers and by meshes that
+ * have not been delivered yet. It does not bound the archive itself, which is
+ * read by the caller, or the meshes kept by the callback.
+ */
+class ZDvidMeshArchiveDecoder
+{
+public:
+  ZDvidMeshArchiveDecoder();
+
+  struct Entry {
+    std::string name;
+    std::vector<char> data;
+  };
+
+  /*!
+   * \brief The function of reading the next entry.
+   *
+   * It returns false if there is no more entry.
+   */
+  typedef std::function<bool(Entry&)> EntryReader;
+
+  /*!
+   * \brief The function of decoding an entry, which is called in worker
+   * threads. It returns NULL if the entry cannot be decoded.
+   */
+  typedef std::function<ZMesh*(const Entry&)> DecodeFunction;
+
+  /*!
+   * \brief The function of receiving a mesh.
+   *
+   * The callback takes the ownership of the mesh.
+   */
+  typedef std::function<void(ZMesh*)> MeshCallback;
+
+  /*!
+   * \brief The function of receiving progress as (done bytes, total bytes).
+   */
+  typedef std::function<void(size_t, size_t)> ProgressCallback;
+
+  const static int DEFAULT_WINDOW_SIZE;
+
+  /*!
+   * \brief Set the maximal number of workers.
+   *
+   * The maximal thread count of the global QThreadPool is used if \a n <= 0.
+   */
+  void setThreadNumber(int n);
+  int getThreadNumber() const;
+
+  void setWindowSize(int n);
+  int getWindowSize() const { return m_windowSize; }
+
+  /*!
+   * \brief Set the function of decoding an entry. The default is Draco
+   * decoding.
+   */
+  void setDecodeFunction(const DecodeFunction &f);
+
+  /*!
+   * \brief Set a function to process each decoded mesh in the worker threads
+   * before it is passed to the mesh callback.
+   */
+  void setPostProcess(const MeshCallback &f);
+
+  /*!
+   * \brief Decode all remaining entries of an archive.
+   *
+   * The label of a mesh is set to the number in the name of its entry, which
+   * is the supervoxel ID in a DVID mesh archive. \a progress is called in the
+   * calling thread after each mesh is delivered. \a bytesTotal is the expected
+   * number of bytes to decode, such as the size of the archive.
+   *
+   * \return Number of meshes passed to \a callback.
+   */
+  size_t decode(struct archive *arc, const MeshCallback &callback,
+                const ProgressCallback &progress = ProgressCallback(),
+                size_t bytesTotal = 0);
+  size_t decode(const EntryReader &reader, const MeshCallback &callback,
+                const ProgressCallback &progress = ProgressCallback(),
+                size_t bytesTotal = 0);
+
+  /*!
+   * \brief Stop decoding.
+   *
+   * It can be called from any thread. Entries that have not been decoded are
+   * dropped and decode() returns after the running workers are done.
+   */
+  void cancel();
+  bool isCanceled() const;
+
+  static ZMesh* DecodeDraco(const Entry &entry);
+  static uint64_t GetMeshId(const std::string &entryName);
+
+private:
+  int m_threadNumber = 0;
+  int m_windowSize;
+  DecodeFunction m_decode;
+  MeshCallback m_postProcess;
+  std::atomic<bool> m_canceled;
+};
+
+#endif // ZDVIDMESHARCHIVEDECODER_H
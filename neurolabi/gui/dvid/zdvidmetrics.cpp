@@ -0,0 +1,327 @@
+#include "zdvidmetrics.h"
+
+#include <sstream>
+
+#include "zjsonobject.h"
+#include "zjsonarray.h"
+
+namespace {
+
+uint64_t ToMicrosecond(double ms)
+{
+  return (ms > 0.0) ? uint64_t(ms * 1000.0 + 0.5) : 0;
+}
+
+double ToMillisecond(uint64_t us)
+{
+  return double(us) / 1000.0;
+}
+
+int64_t GetCurrentMillisecond()
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::vector<std::string> SplitPath(const std::string &url)
+{
+  std::string path = url;
+  size_t pos = path.find("://");
+  if (pos != std::string::npos) {
+    pos = path.find('/', pos + 3);
+    path = (pos == std::string::npos) ? std::string() : path.substr(pos);
+  }
+  pos = path.find('?');
+  if (pos != std::string::npos) {
+    path = path.substr(0, pos);
+  }
+
+  std::vector<std::string> segmentArray;
+  std::istringstream stream(path);
+  std::string segment;
+  while (std::getline(stream, segment, '/')) {
+    if (!segment.empty()) {
+      segmentArray.push_back(segment);
+    }
+  }
+
+  return segmentArray;
+}
+
+}
+
+ZDvidMetrics::Counter::Counter() :
+  histogram(GetHistogramBound().size() + 1)
+{
+  reset();
+}
+
+void ZDvidMetrics::Counter::reset()
+{
+  requestCount = 0;
+  failureCount = 0;
+  sentByteCount = 0;
+  receivedByteCount = 0;
+  latency = 0;
+  decodeCount = 0;
+  decodeTime = 0;
+  for (std::atomic<uint64_t> &count : histogram) {
+    count = 0;
+  }
+}
+
+double ZDvidMetrics::Stat::getMeanLatency() const
+{
+  return (requestCount > 0) ? latency / requestCount : 0.0;
+}
+
+ZDvidMetrics::Timer::Timer()
+{
+  restart();
+}
+
+void ZDvidMetrics::Timer::restart()
+{
+  m_start = std::chrono::steady_clock::now();
+}
+
+double ZDvidMetrics::Timer::elapsed() const
+{
+  return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - m_start).count();
+}
+
+ZDvidMetrics::ZDvidMetrics() :
+  m_counterArray(ENDPOINT_NUMBER), m_enabled(true), m_logInterval(0),
+  m_nextLogTime(0)
+{
+}
+
+ZDvidMetrics& ZDvidMetrics::GetInstance()
+{
+  static ZDvidMetrics metrics;
+
+  return metrics;
+}
+
+const std::vector<double>& ZDvidMetrics::GetHistogramBound()
+{
+  static const std::vector<double> bound = {
+    1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000 };
+
+  return bound;
+}
+
+std::string ZDvidMetrics::GetEndpointName(EEndpoint endpoint)
+{
+  switch (endpoint) {
+  case EEndpoint::SPARSEVOL:
+    return "sparsevol";
+  case EEndpoint::TILE:
+    return "tile";
+  case EEndpoint::BLOCKS:
+    return "blocks";
+  case EEndpoint::LABELS:
+    return "labels";
+  case EEndpoint::VOXELS:
+    return "voxels";
+  case EEndpoint::KEYVALUE:
+    return "keyvalue";
+  case EEndpoint::ANNOTATION:
+    return "annotation";
+  case EEndpoint::OTHER:
+    break;
+  }
+
+  return "other";
+}
+
+ZDvidMetrics::EEndpoint ZDvidMetrics::GetEndpoint(const std::string &url)
+{
+  std::vector<std::string> segmentArray = SplitPath(url);
+
+  //api/node/<uuid>/<data name>/<endpoint>
+  size_t index = 0;
+  while (index < segmentArray.size() && segmentArray[index] != "node") {
+    ++index;
+  }
+  index += 3;
+  if (index >= segmentArray.size()) {
+    return EEndpoint::OTHER;
+  }
+
+  const std::string &name = segmentArray[index];
+  if (name.compare(0, 9, "sparsevol") == 0) {
+    return EEndpoint::SPARSEVOL;
+  } else if (name == "tile") {
+    return EEndpoint::TILE;
+  } else if (name == "blocks" || name == "specificblocks") {
+    return EEndpoint::BLOCKS;
+  } else if (name == "label") {
+    //An annotation label query ends with a plain body ID while a label
+    //query of labelmap has coordinates such as x_y_z.
+    if (index + 1 < segmentArray.size() &&
+        segmentArray[index + 1].find('_') == std::string::npos) {
+      return EEndpoint::ANNOTATION;
+    }
+    return EEndpoint::LABELS;
+  } else if (name == "labels" || name == "mapping" || name == "supervoxels" ||
+             name == "size" || name == "sizes" || name == "maxlabel" ||
+             name == "nextlabel") {
+    return EEndpoint::LABELS;
+  } else if (name == "raw" || name == "isotropic") {
+    return EEndpoint::VOXELS;
+  } else if (name == "key" || name == "keys" || name == "keyvalues" ||
+             name == "keyrange" || name == "keyrangevalues") {
+    return EEndpoint::KEYVALUE;
+  } else if (name == "elements" || name == "element" || name == "tag" ||
+             name == "all-elements") {
+    return EEndpoint::ANNOTATION;
+  }
+
+  return EEndpoint::OTHER;
+}
+
+void ZDvidMetrics::recordRequest(
+    EEndpoint endpoint, double latency, size_t sentBytes,
+    size_t receivedBytes, bool succ)
+{
+  if (!m_enabled) {
+    return;
+  }
+
+  Counter &counter = m_counterArray[int(endpoint)];
+  ++counter.requestCount;
+  if (!succ) {
+    ++counter.failureCount;
+  }
+  counter.sentByteCount += sentBytes;
+  counter.receivedByteCount += receivedBytes;
+  counter.latency += ToMicrosecond(latency);
+
+  const std::vector<double> &bound = GetHistogramBound();
+  size_t bin = 0;
+  while (bin < bound.size() && latency > bound[bin]) {
+    ++bin;
+  }
+  ++counter.histogram[bin];
+
+  logIfDue();
+}
+
+void ZDvidMetrics::recordRequest(
+    const std::string &url, double latency, size_t sentBytes,
+    size_t receivedBytes, bool succ)
+{
+  if (m_enabled) {
+    recordRequest(GetEndpoint(url), latency, sentBytes, receivedBytes, succ);
+  }
+}
+
+void ZDvidMetrics::recordDecode(EEndpoint endpoint, double time)
+{
+  if (!m_enabled) {
+    return;
+  }
+
+  Counter &counter = m_counterArray[int(endpoint)];
+  ++counter.decodeCount;
+  counter.decodeTime += ToMicrosecond(time);
+}
+
+ZDvidMetrics::Stat ZDvidMetrics::getStat(EEndpoint endpoint) const
+{
+  const Counter &counter = m_counterArray[int(endpoint)];
+
+  Stat stat;
+  stat.requestCount = counter.requestCount;
+  stat.failureCount = counter.failureCount;
+  stat.sentByteCount = counter.sentByteCount;
+  stat.receivedByteCount = counter.receivedByteCount;
+  stat.latency = ToMillisecond(counter.latency);
+  stat.decodeCount = counter.decodeCount;
+  stat.decodeTime = ToMillisecond(counter.decodeTime);
+  for (const std::atomic<uint64_t> &count : counter.histogram) {
+    stat.histogram.push_back(count);
+  }
+
+  return stat;
+}
+
+void ZDvidMetrics::reset()
+{
+  for (Counter &counter : m_counterArray) {
+    counter.reset();
+  }
+}
+
+ZJsonObject ZDvidMetrics::toJsonObject() const
+{
+  ZJsonObject obj;
+
+  ZJsonArray boundJson;
+  for (double bound : GetHistogramBound()) {
+    boundJson.append(bound);
+  }
+  obj.setEntry("histogram_bound_ms", boundJson);
+
+  for (int i = 0; i < ENDPOINT_NUMBER; ++i) {
+    EEndpoint endpoint = EEndpoint(i);
+    Stat stat = getStat(endpoint);
+    if (stat.requestCount == 0 && stat.decodeCount == 0) {
+      continue;
+    }
+
+    ZJsonObject statJson;
+    statJson.setEntry("count", stat.requestCount);
+    statJson.setEntry("failure", stat.failureCount);
+    statJson.setEntry("sent_bytes", stat.sentByteCount);
+    statJson.setEntry("received_bytes", stat.receivedByteCount);
+    statJson.setEntry("latency_ms", stat.latency);
+    statJson.setEntry("mean_latency_ms", stat.getMeanLatency());
+    statJson.setEntry("decode_count", stat.decodeCount);
+    statJson.setEntry("decode_ms", stat.decodeTime);
+
+    ZJsonArray histogramJson;
+    for (uint64_t count : stat.histogram) {
+      histogramJson.append(count);
+    }
+    statJson.setEntry("histogram", histogramJson);
+
+    obj.setEntry(GetEndpointName(endpoint).c_str(), statJson);
+  }
+
+  return obj;
+}
+
+std::string ZDvidMetrics::toJsonString() const
+{
+  return toJsonObject().dumpString(0);
+}
+
+void ZDvidMetrics::setLogger(const Logger &logger, int interval)
+{
+  std::lock_guard<std::mutex> guard(m_loggerMutex);
+  m_logger = logger;
+  m_logInterval = (logger && interval > 0) ? int64_t(interval) * 1000 : 0;
+  m_nextLogTime = GetCurrentMillisecond() + m_logInterval;
+}
+
+void ZDvidMetrics::logIfDue()
+{
+  if (m_logInterval <= 0) {
+    return;
+  }
+
+  int64_t now = GetCurrentMillisecond();
+  int64_t nextLogTime = m_nextLogTime;
+  //Only one thread wins the slot of logging
+  if (now >= nextLogTime &&
+      m_nextLogTime.compare_exchange_strong(
+        nextLogTime, now + m_logInterval)) {
+    std::lock_guard<std::mutex> guard(m_loggerMutex);
+    if (m_logger) {
+      m_logger(toJsonString());
+    }
+  }
+}
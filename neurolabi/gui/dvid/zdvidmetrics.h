@@ -0,0 +1,148 @@
+#ifndef ZDVIDMETRICS_H
+#define ZDVIDMETRICS_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+class ZJsonObject;
+
+/*!
+ * \brief The class of DVID request metrics
+ *
+ * The registry keeps, for each endpoint type, the number of requests and
+ * failures, the number of bytes sent and received, the accumulated latency
+ * with a latency histogram, and the accumulated time of decoding responses.
+ * Recording only updates atomic counters, so it can be done for every request
+ * from any thread.
+ *
+ * The metrics can be dumped as JSON by toJsonObject(). With a logger set by
+ * setLogger(), they are also passed to the logger periodically while requests
+ * are being recorded.
+ */
+class ZDvidMetrics
+{
+public:
+  ZDvidMetrics();
+
+  /*!
+   * \brief The registry shared by all readers and writers.
+   */
+  static ZDvidMetrics& GetInstance();
+
+  enum class EEndpoint {
+    SPARSEVOL, TILE, BLOCKS, LABELS, VOXELS, KEYVALUE, ANNOTATION, OTHER
+  };
+
+  const static int ENDPOINT_NUMBER = int(EEndpoint::OTHER) + 1;
+
+  /*!
+   * \brief Snapshot of the metrics of an endpoint type.
+   *
+   * Times are in milliseconds. histogram[i] is the number of requests with a
+   * latency no more than GetHistogramBound()[i], except that the last bin
+   * counts all requests beyond the last bound.
+   */
+  struct Stat {
+    uint64_t requestCount = 0;
+    uint64_t failureCount = 0;
+    uint64_t sentByteCount = 0;
+    uint64_t receivedByteCount = 0;
+    double latency = 0.0;
+    uint64_t decodeCount = 0;
+    double decodeTime = 0.0;
+    std::vector<uint64_t> histogram;
+
+    double getMeanLatency() const;
+  };
+
+  /*!
+   * \brief The class of measuring elapsed time.
+   */
+  class Timer {
+  public:
+    Timer();
+    void restart();
+    double elapsed() const; //in milliseconds
+
+  private:
+    std::chrono::steady_clock::time_point m_start;
+  };
+
+  /*!
+   * \brief Record a finished request.
+   *
+   * \a latency is in milliseconds.
+   */
+  void recordRequest(EEndpoint endpoint, double latency, size_t sentBytes,
+                     size_t receivedBytes, bool succ);
+  void recordRequest(const std::string &url, double latency, size_t sentBytes,
+                     size_t receivedBytes, bool succ);
+
+  /*!
+   * \brief Record the time of decoding a response in milliseconds.
+   */
+  void recordDecode(EEndpoint endpoint, double time);
+
+  Stat getStat(EEndpoint endpoint) const;
+
+  void reset();
+
+  void setEnabled(bool on) { m_enabled = on; }
+  bool isEnabled() const { return m_enabled; }
+
+  ZJsonObject toJsonObject() const;
+  std::string toJsonString() const;
+
+  typedef std::function<void(const std::string&)> Logger;
+
+  /*!
+   * \brief Pass the JSON string of the metrics to \a logger every \a interval
+   * seconds while requests are recorded. Periodic logging is off if \a logger
+   * is empty or \a interval <= 0.
+   */
+  void setLogger(const Logger &logger, int interval);
+
+  /*!
+   * \brief Get the endpoint type of a DVID URL or path.
+   *
+   * It is decided by the endpoint name following the data name in
+   * /api/node/<uuid>/<data name>/<endpoint>.
+   */
+  static EEndpoint GetEndpoint(const std::string &url);
+  static std::string GetEndpointName(EEndpoint endpoint);
+  static const std::vector<double>& GetHistogramBound();
+
+private:
+  struct Counter {
+    std::atomic<uint64_t> requestCount;
+    std::atomic<uint64_t> failureCount;
+    std::atomic<uint64_t> sentByteCount;
+    std::atomic<uint64_t> receivedByteCount;
+    std::atomic<uint64_t> latency; //in microseconds
+    std::atomic<uint64_t> decodeCount;
+    std::atomic<uint64_t> decodeTime; //in microseconds
+    std::vector<std::atomic<uint64_t>> histogram;
+
+    Counter();
+    void reset();
+  };
+
+  void logIfDue();
+
+private:
+  std::vector<Counter> m_counterArray;
+  std::atomic<bool> m_enabled;
+
+  mutable std::mutex m_loggerMutex;
+  Logger m_logger;
+  std::atomic<int64_t> m_logInterval; //in milliseconds
+  std::atomic<int64_t> m_nextLogTime; //in milliseconds since the epoch
+};
+
+#endif // ZDVIDMETRICS_H
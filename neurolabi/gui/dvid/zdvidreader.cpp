@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <ctime>
+#include <sstream>
 #include <future>
 
 #include <archive.h>
@@ -31,6 +32,7 @@
 #include "dvid/zdvidtile.h"
 #include "zdvidtileinfo.h"
 #include "zobject3dscan.h"
+#include "zobject3dscancompact.h"
 #include "zsparsestack.h"
 #include "zdvidversiondag.h"
 #include "dvid/zdvidsparsestack.h"
@@ -40,7 +42,13 @@
 #include "neutubeconfig.h"
 #include "flyem/zflyemmisc.h"
 #include "zdvidutil.h"
+#include "dvid/zdvidblockcache.h"
+#include "dvid/zdvidlabelblock.h"
+#include "dvid/zdvidrequestcoalescer.h"
+#include "dvid/zdvidbodyidresolver.h"
 #include "dvid/zdvidroi.h"
+#include "dvid/zdvidsynapsestore.h"
+#include "dvid/zdvidmesharchivedecoder.h"
 #include "zflyemutilities.h"
 #include "zobject3dscanarray.h"
 #include "zdvidpath.h"
@@ -55,6 +63,27 @@
 #include "zarrayfactory.h"
 #include "zobject3dfactory.h"
 #include "dvid/zdvidstackblockfactory.h"
+#include "dvid/zdvidmetrics.h"
+
+namespace {
+
+ZDvidBlockCache::Key MakeBlockCacheKey(
+    const ZDvidTarget &target, const std::string &dataName, int zoom,
+    const ZIntPoint &blockIndex)
+{
+  ZDvidBlockCache::Key key;
+  key.server = target.getAddressWithPort();
+  key.uuid = target.getUuid();
+  key.instance = dataName;
+  key.zoom = zoom;
+  key.x = blockIndex.getX();
+  key.y = blockIndex.getY();
+  key.z = blockIndex.getZ();
+
+  return key;
+}
+
+}
 
 ZDvidReader::ZDvidReader(/*QObject *parent*/) :
   /*QObject(parent),*/ m_verbose(true)
@@ -397,57 +426,37 @@ ZObject3dScan *ZDvidReader::readBody(
   return result;
 }
 
-ZObject3dScan* ZDvidReader::readBodyWithPartition(
-    uint64_t bodyId, flyem::EBodyLabelType labelType, ZObject3dScan *result) const
+ZObject3dScan* ZDvidReader::readBodyStreaming(
+    uint64_t bodyId, flyem::EBodyLabelType labelType, int zoom,
+    bool canonizing, ZObject3dScan *result,
+    const ZDvidBodyStreamLoader::PartCallback &callback) const
 {
   if (result != NULL) {
     result->clear();
   }
 
   if (isReady()) {
-    if (result == NULL) {
-      result = new ZObject3dScan;
-    }
-
-    const ZObject3dScan &coarseBody = readCoarseBody(bodyId, labelType);
-    ZDvidInfo dvidInfo = readLabelInfo();
-    int minZ = dvidInfo.getCoordZ(coarseBody.getMinZ());
-    int maxZ = dvidInfo.getCoordZ(coarseBody.getMaxZ()) +
-        dvidInfo.getBlockSize().getZ() - 1;
-
-    int dz = 1024 / dvidInfo.getBlockSize().getZ() *
-        dvidInfo.getBlockSize().getZ() - 1;
+    ZDvidBodyStreamLoader loader(*this);
+    result = loader.load(bodyId, labelType, zoom, canonizing, result, callback);
+    setStatusCode(loader.getStatusCode());
 
-    int startZ = minZ;
-    int endZ = (startZ + dz) / dvidInfo.getBlockSize().getZ() *
-        dvidInfo.getBlockSize().getZ() - 1;
-    ZObject3dScan part;
-    while (startZ <= maxZ) {
-      if (endZ > maxZ) {
-        endZ = maxZ;
-      }
-      if (startZ == minZ) {
-#ifdef _DEBUG_
-        STD_COUT << "Read first part: " << startZ << "--" << endZ << std::endl;
-#endif
-        readBody(bodyId, labelType, startZ, endZ, true, neutube::EAxis::Z, result);
-      } else {
-#ifdef _DEBUG_
-        STD_COUT << "Read part: " << startZ << "--" << endZ << std::endl;
-#endif
-        readBody(bodyId, labelType, startZ, endZ, true, neutube::EAxis::Z, &part);
-        if (!part.isEmpty()) {
-          result->unify(part);
-        }
-      }
-      startZ = endZ + 1;
-      endZ = startZ + dz;
+    //No coarse body or a failed partition
+    if (result->isEmpty()) {
+      result = readBody(
+            bodyId, labelType, zoom, ZIntCuboid(), canonizing, result);
+      result->setDsIntv(zgeom::GetZoomScale(zoom) - 1);
     }
   }
 
   return result;
 }
 
+ZObject3dScan* ZDvidReader::readBodyWithPartition(
+    uint64_t bodyId, flyem::EBodyLabelType labelType, ZObject3dScan *result) const
+{
+  return readBodyStreaming(bodyId, labelType, 0, true, result);
+}
+
 ZObject3dScan* ZDvidReader::readBodyWithPartition(
     uint64_t bodyId, ZObject3dScan *result) const
 {
@@ -702,7 +711,10 @@ ZObject3dScan *ZDvidReader::readBody(
 
       ZDvidUrl dvidUrl(getDvidTarget());
       QByteArray buffer = readBuffer(dvidUrl.getSparsevolUrl(config));
+      ZDvidMetrics::Timer timer;
       result->importDvidBlockBuffer(buffer.data(), buffer.size(), canonizing);
+      ZDvidMetrics::GetInstance().recordDecode(
+            ZDvidMetrics::EEndpoint::SPARSEVOL, timer.elapsed());
     } else {
       readBodyRle(bodyId, labelType, zoom, box, canonizing, result);
     }
@@ -751,14 +763,23 @@ ZObject3dScan *ZDvidReader::readBodyRle(
         ZObject3dScan coarseBody;
         readCoarseBody(bodyId, labelType, box, &coarseBody);
         int scale = zgeom::GetZoomScale(zoom);
-        coarseBody.downsampleMax(scale - 1, scale -1, scale -1);
-        std::vector<ZArray*> blockArray = readLabelBlock(coarseBody, zoom);
+        coarseBody.downsampleToPyramidLevel(zoom);
 
         ZIntCuboid range = box;
         range.scaleDown(scale);
-        ZObject3dFactory::MakeObject3dScan(blockArray, bodyId, range, result);
-        for (ZArray *array : blockArray) {
-          delete array;
+        if (getDvidTarget().hasBlockCoding()) {
+          std::vector<ZDvidLabelBlock*> blockArray =
+              readCompressedLabelBlock(coarseBody, zoom);
+          for (ZDvidLabelBlock *block : blockArray) {
+            block->appendObject(bodyId, range, result, false);
+            delete block;
+          }
+        } else {
+          std::vector<ZArray*> blockArray = readLabelBlock(coarseBody, zoom);
+          ZObject3dFactory::MakeObject3dScan(blockArray, bodyId, range, result);
+          for (ZArray *array : blockArray) {
+            delete array;
+          }
         }
         buffered = false;
       }
@@ -771,7 +792,10 @@ ZObject3dScan *ZDvidReader::readBodyRle(
 
     if (buffered) {
       const QByteArray &buffer = reader.getBuffer();
+      ZDvidMetrics::Timer timer;
       result->importDvidObjectBuffer(buffer.data(), buffer.size());
+      ZDvidMetrics::GetInstance().recordDecode(
+            ZDvidMetrics::EEndpoint::SPARSEVOL, timer.elapsed());
     }
 
     reader.clearBuffer();
@@ -886,6 +910,17 @@ QByteArray ZDvidReader::readBuffer(const std::string &url) const
   return m_bufferReader.getBuffer();
 }
 
+ZDvidRequestEngine::Handle ZDvidReader::readBufferAsync(
+    const std::string &url, const ZDvidRequestEngine::Callback &callback,
+    int priority) const
+{
+  if (isVerbose()) {
+    std::cout << "Reading asynchronously " << url << std::endl;
+  }
+
+  return m_bufferReader.readAsync(url.c_str(), callback, priority);
+}
+
 QByteArray ZDvidReader::readDataFromEndpoint(
     const std::string &endPoint, bool tryingCompress) const
 {
@@ -1103,6 +1138,60 @@ ZObject3dScan *ZDvidReader::readBody(
   return result;
 }
 
+ZObject3dScanCompact* ZDvidReader::readBodyCompact(
+    uint64_t bodyId, flyem::EBodyLabelType labelType, bool canonizing,
+    ZObject3dScanCompact *result) const
+{
+  if (result != NULL) {
+    result->clear();
+  }
+
+  if (!isReady()) {
+    return NULL;
+  }
+
+  ZDvidBufferReader &reader = m_bufferReader;
+
+  reader.tryCompress(true);
+  ZDvidUrl dvidUrl(getDvidTarget());
+
+  switch (labelType) {
+  case flyem::EBodyLabelType::BODY:
+    reader.read(dvidUrl.getSparsevolUrl(bodyId).c_str(), isVerbose());
+    break;
+  case flyem::EBodyLabelType::SUPERVOXEL:
+    reader.read(dvidUrl.getSupervoxelUrl(bodyId).c_str(), isVerbose());
+    break;
+  }
+
+  reader.tryCompress(false);
+
+  if (reader.getStatus() != neutube::EReadStatus::FAILED) {
+    bool created = false;
+    if (result == NULL) {
+      result = new ZObject3dScanCompact;
+      created = true;
+    }
+
+    const QByteArray &buffer = reader.getBuffer();
+    if (result->importDvidObjectBuffer(buffer.data(), buffer.size())) {
+      if (canonizing) {
+        result->canonize();
+      }
+    } else {
+      if (created) {
+        delete result;
+      }
+      result = NULL;
+    }
+  } else {
+    result = NULL;
+  }
+  reader.clearBuffer();
+
+  return result;
+}
+
 ZObject3dScanArray* ZDvidReader::readBody(const std::set<uint64_t> &bodySet) const
 {
   ZObject3dScanArray *objArray = NULL;
@@ -1270,79 +1359,24 @@ ZMesh *ZDvidReader::readMeshArchiveNext(struct archive *arc, size_t &bytesJustRe
   return mesh;
 }
 
-namespace {
-struct BodyIdStrAndBuffer
-{
-  BodyIdStrAndBuffer(const std::string& bid = "", const QByteArray& bu = QByteArray())
-    : bodyIdStr(bid), buffer(bu) {}
-  std::string bodyIdStr;
-  QByteArray buffer;
-};
-}
-
 void ZDvidReader::readMeshArchiveAsync(archive *arc, std::vector<ZMesh *> &results,
                                        const std::function<void(size_t, size_t)>& progress) const
 {
   QTime timer;
   timer.start();
 
-  // Read all the compressed meshes into a vector of buffers.
-
-  QVector<BodyIdStrAndBuffer> buffers;
-  struct archive_entry *entry;
-  while (archive_read_next_header(arc, &entry) == ARCHIVE_OK) {
-    std::string pathname = archive_entry_pathname(entry);
-    auto i = pathname.find_last_of('.');
-    std::string bodyIdStr = (i != std::string::npos) ? pathname.substr(0, i) : pathname;
-
-    const struct stat *s = archive_entry_stat(entry);
-    size_t size = s->st_size;
-
-    QByteArray buffer(size, 0);
-    archive_read_data(arc, buffer.data(), size);
-
-    buffers.push_back(BodyIdStrAndBuffer(bodyIdStr, buffer));
-  }
-
-  // This function will decompress one buffer in the vector, and it will be applied in parallel.
-
-  std::function<ZMesh*(const BodyIdStrAndBuffer&)> buildMesh = [](const BodyIdStrAndBuffer& idBuf) {
-    ZMesh *mesh = nullptr;
-    try {
-      mesh = ZMeshIO::instance().loadFromMemory(idBuf.buffer, "drc");
-    } catch (...) {}
-    if (mesh) {
-      mesh->setLabel(std::stoull(idBuf.bodyIdStr));
-    }
-    return mesh;
-  };
-
-  // Decompress the meshes in parallel.  This Qt function does use a thread pool, so it does not
-  // have the problem that std::async() has on Linux (as of 2018), that std::launch::async is necessary
-  // to get parallelism but it will allow unlimited thread creation until the limit is reached an
-  // exception is generated.
+  // Entries are decompressed in parallel while the archive is being read,
+  // with a bounded number of decompressed entries in memory. The archive
+  // itself has been downloaded as a whole by readMeshArchiveStart().
 
-  QFuture<ZMesh*> futures = QtConcurrent::mapped(buffers, buildMesh);
-
-  // Get each decompressed mesh from the QFuture, with progress reporting.  Despite the Qt documentation,
-  // it seems to be necssary to use the QFuture::resultAt() function to get a result when it is ready.
-  // The QFuture::const_iterator API causes a crash.
-
-  for (int i = 0; i < buffers.size(); ++i) {
-    ZMesh *mesh = futures.resultAt(i);
-    if (mesh) {
-      results.push_back(mesh);
-    }
-
-    if (progress) {
-      progress(i+1, buffers.size());
-    }
-  }
+  ZDvidMeshArchiveDecoder decoder;
+  size_t count = decoder.decode(
+        arc, [&](ZMesh *mesh) { results.push_back(mesh); }, progress);
 
-  if (buffers.size() == 1) {
+  if (count == 1) {
     LINFO() << "Decompressing the mesh archive (1 mesh) took " << timer.elapsed() << " ms.";
   } else {
-    LINFO() << "Decompressing the mesh archive (" << buffers.size() << " meshes) took " << timer.elapsed() << " ms.";
+    LINFO() << "Decompressing the mesh archive (" << count << " meshes) took " << timer.elapsed() << " ms.";
   }
 }
 
@@ -1353,8 +1387,19 @@ void ZDvidReader::readMeshArchiveEnd(struct archive *arc) const
 }
 
 ZObject3dScan* ZDvidReader::readMultiscaleBody(
-    uint64_t bodyId, int zoom, bool canonizing, ZObject3dScan *result) const
+    uint64_t bodyId, int zoom, bool canonizing, ZObject3dScan *result,
+    const ZDvidBodyStreamLoader::PartCallback &callback) const
 {
+  //Full-resolution bodies are large enough to benefit from parallel parts
+  if (zoom == 0) {
+    result = readBodyStreaming(
+          bodyId, flyem::EBodyLabelType::BODY, zoom, canonizing, result,
+          callback);
+    if (result != NULL) {
+      return result;
+    }
+  }
+
   result = readBody(
         bodyId, flyem::EBodyLabelType::BODY, zoom, ZIntCuboid(), canonizing, result);
   int scale = zgeom::GetZoomScale(zoom);
@@ -1568,6 +1613,37 @@ std::vector<ZStack*> ZDvidReader::readGrayScaleBlock(
 {
   std::vector<ZStack*> stackArray(blockNumber, NULL);
 
+  ZDvidBlockCache *cache = getBlockCache();
+  std::string dataName = getDvidTarget().getGrayScaleName(zoom);
+  if (cache != NULL) {
+    bool allCached = true;
+    std::vector<char> buffer;
+    ZIntCuboid currentBox = dvidInfo.getBlockBox(blockIndex);
+    for (int i = 0; i < blockNumber && allCached; ++i) {
+      if (cache->get(MakeBlockCacheKey(getDvidTarget(), dataName, zoom,
+                                       blockIndex + ZIntPoint(i, 0, 0)),
+                     &buffer) &&
+          buffer.size() == size_t(currentBox.getVolume())) {
+        ZStack *stack = new ZStack(GREY, currentBox, 1);
+        stack->copyValueFrom(buffer.data(), buffer.size(), stack->array8());
+        stackArray[i] = stack;
+        currentBox.translateX(currentBox.getWidth());
+      } else {
+        allCached = false;
+      }
+    }
+
+    if (allCached) {
+      setStatusCode(200);
+      return stackArray;
+    }
+
+    for (ZStack *stack : stackArray) {
+      delete stack;
+    }
+    stackArray.assign(blockNumber, NULL);
+  }
+
   bool processed = false;
 #if defined(_ENABLE_LIBDVIDCPP_)
   if (m_service != NULL && getDvidTarget().getMaxLabelZoom() == 0) {
@@ -1617,12 +1693,38 @@ std::vector<ZStack*> ZDvidReader::readGrayScaleBlock(
     stackArray = readGrayScaleBlockOld(blockIndex, dvidInfo, blockNumber);
   }
 
+  //The fallback reads full resolution blocks only
+  if (cache != NULL && (processed || zoom == 0)) {
+    for (int i = 0; i < blockNumber; ++i) {
+      const ZStack *stack = stackArray[i];
+      if (stack != NULL) {
+        cache->put(MakeBlockCacheKey(getDvidTarget(), dataName, zoom,
+                                     blockIndex + ZIntPoint(i, 0, 0)),
+                   (const char*) stack->array8(), stack->getVoxelNumber());
+      }
+    }
+  }
+
   return stackArray;
 }
 
 ZStack* ZDvidReader::readGrayScaleBlock(
     const ZIntPoint &blockIndex, const ZDvidInfo &dvidInfo) const
 {
+  ZDvidBlockCache *cache = getBlockCache();
+  ZDvidBlockCache::Key cacheKey = MakeBlockCacheKey(
+        getDvidTarget(), getDvidTarget().getGrayScaleName(), 0, blockIndex);
+  if (cache != NULL) {
+    std::vector<char> buffer;
+    if (cache->get(cacheKey, &buffer)) {
+      ZStack *stack = ZStackFactory::MakeZeroStack(
+            GREY, dvidInfo.getBlockBox(blockIndex));
+      stack->copyValueFrom(buffer.data(), buffer.size(), stack->array8());
+      setStatusCode(200);
+      return stack;
+    }
+  }
+
   ZDvidBufferReader &bufferReader = m_bufferReader;
   ZDvidUrl dvidUrl(getDvidTarget());
   bufferReader.read(dvidUrl.getGrayScaleBlockUrl(blockIndex.getX(),
@@ -1642,6 +1744,9 @@ ZStack* ZDvidReader::readGrayScaleBlock(
       STD_COUT << data.length() << " " << stack->getVoxelNumber() << std::endl;
 #endif
       stack->copyValueFrom(data.constData() + 4, data.length() - 4, stack->array8());
+      if (cache != NULL) {
+        cache->put(cacheKey, data.constData() + 4, data.length() - 4);
+      }
     }
 
     bufferReader.clearBuffer();
@@ -1694,33 +1799,18 @@ std::vector<ZStack*> ZDvidReader::readGrayScaleBlock(
 {
   std::vector<ZStack*> result;
 
-  std::vector<libdvid::DVIDCompressedBlock> c_blocks;
-
-  std::vector<int> blockcoords;
-  ZObject3dScan::ConstVoxelIterator objIter(&blockObj);
-  while (objIter.hasNext()) {
-    ZIntPoint pt = objIter.next();
-    blockcoords.push_back(pt.getX());
-    blockcoords.push_back(pt.getY());
-    blockcoords.push_back(pt.getZ());
-  }
-
   try {
-    m_service->get_specificblocks3D(
-          getDvidTarget().getGrayScaleName(), blockcoords, false, c_blocks, zoom);
-
     ZDvidInfo info = readLabelInfo();
-    for (libdvid::DVIDCompressedBlock &block : c_blocks) {
-      libdvid::BinaryDataPtr data = block.get_uncompressed_data();
-
-      std::vector<int> offset = block.get_offset();
-      ZIntPoint startCoord(offset[0], offset[1], offset[2]);
+    readSpecificBlocks(
+          getDvidTarget().getGrayScaleName(), blockObj, zoom,
+          info.getBlockSize(),
+          [&](const ZIntPoint &startCoord, const char *data, size_t size) {
       ZStack *stack = ZStackFactory::MakeZeroStack(
             GREY, ZIntCuboid(startCoord, startCoord + info.getBlockSize() - 1));
-      stack->copyValueFrom(data->get_raw(), data->length());
+      stack->copyValueFrom(data, size);
 
       result.push_back(stack);
-    }
+    });
   } catch(libdvid::DVIDException &e) {
     LERROR() << e.what();
     m_statusCode = e.getStatus();
@@ -1834,6 +1924,7 @@ ZSparseStack* ZDvidReader::readSparseStack(uint64_t bodyId, int zoom) const
     ZDvidInfo dvidInfo = readDataInfo(getDvidTarget().getGrayScaleName());
     ZObject3dScan blockObj = dvidInfo.getBlockIndex(*body);;
     ZStackBlockGrid *grid = new ZStackBlockGrid;
+    grid->setCompressing(true);
     spStack->setGreyScale(grid);
 //    grid->setMinPoint(dvidInfo.getStartCoordinates());
     grid->setBlockSize(dvidInfo.getBlockSize());
@@ -1934,6 +2025,7 @@ ZSparseStack* ZDvidReader::readSparseStack(uint64_t bodyId) const
     ZDvidInfo dvidInfo = readDataInfo(getDvidTarget().getGrayScaleName());
     ZObject3dScan blockObj = dvidInfo.getBlockIndex(*body);;
     ZStackBlockGrid *grid = new ZStackBlockGrid;
+    grid->setCompressing(true);
     spStack->setGreyScale(grid);
 //    grid->setMinPoint(dvidInfo.getStartCoordinates());
     grid->setBlockSize(dvidInfo.getBlockSize());
@@ -2173,14 +2265,14 @@ ZJsonObject ZDvidReader::readInfo() const
 {
   ZDvidUrl url(getDvidTarget());
 
-  return readJsonObject(url.getInfoUrl());
+  return readCachedJsonObject(url.getInfoUrl());
 }
 
 ZJsonObject ZDvidReader::readInfo(const std::string &dataName) const
 {
  std::string url = ZDvidUrl(getDvidTarget()).getInfoUrl(dataName);
 
- return readJsonObject(url);
+ return readCachedJsonObject(url);
 }
 
 ZDvidInfo ZDvidReader::readDataInfo(const std::string &dataName) const
@@ -3206,37 +3298,25 @@ std::vector<ZArray*> ZDvidReader::readLabelBlock(
 {
   std::vector<ZArray*> result;
 
-  std::vector<libdvid::DVIDCompressedBlock> c_blocks;
-
-  std::vector<int> blockcoords;
-  ZObject3dScan::ConstVoxelIterator objIter(&blockObj);
-  while (objIter.hasNext()) {
-    ZIntPoint pt = objIter.next();
-    blockcoords.push_back(pt.getX());
-    blockcoords.push_back(pt.getY());
-    blockcoords.push_back(pt.getZ());
-  }
-
   try {
-    m_service->get_specificblocks3D(
-          getDvidTarget().getSegmentationName(), blockcoords, false, c_blocks, zoom);
-
     ZDvidInfo info = readLabelInfo();
-    for (libdvid::DVIDCompressedBlock &block : c_blocks) {
-      libdvid::BinaryDataPtr data = block.get_uncompressed_data();
-
-      std::vector<int> offset = block.get_offset();
-
-      mylib::Dimn_Type arrayDims[3];
-      arrayDims[0] = info.getBlockSize().getX();
-      arrayDims[1] = info.getBlockSize().getY();
-      arrayDims[2] = info.getBlockSize().getZ();
+    mylib::Dimn_Type arrayDims[3];
+    arrayDims[0] = info.getBlockSize().getX();
+    arrayDims[1] = info.getBlockSize().getY();
+    arrayDims[2] = info.getBlockSize().getZ();
+
+    readSpecificBlocks(
+          getDvidTarget().getSegmentationName(), blockObj, zoom,
+          info.getBlockSize(),
+          [&](const ZIntPoint &offset, const char *data, size_t /*size*/) {
       ZArray *array = new ZArray(mylib::UINT64_TYPE, 3, arrayDims);
-      array->copyDataFrom(data->get_raw());
-      array->setStartCoordinate(offset);
+      array->copyDataFrom(data);
+      array->setStartCoordinate(0, offset.getX());
+      array->setStartCoordinate(1, offset.getY());
+      array->setStartCoordinate(2, offset.getZ());
 
       result.push_back(array);
-    }
+    });
   } catch(libdvid::DVIDException &e) {
     LERROR() << e.what();
     m_statusCode = e.getStatus();
@@ -3250,31 +3330,119 @@ std::vector<ZArray*> ZDvidReader::readLabelBlock(
 
 ZArray* ZDvidReader::readLabelBlock(int bx, int by, int bz, int zoom) const
 {
-  std::vector<int> blockcoords;
-  blockcoords.push_back(bx);
-  blockcoords.push_back(by);
-  blockcoords.push_back(bz);
+  ZObject3dScan blockObj;
+  blockObj.addSegment(bz, by, bx, bx);
 
-  std::vector<libdvid::DVIDCompressedBlock> c_blocks;
-  m_service->get_specificblocks3D(
-        getDvidTarget().getSegmentationName(), blockcoords, false, c_blocks, zoom);
+  ZDvidInfo info = readLabelInfo();
 
   ZArray *array = NULL;
-  if (c_blocks.size() == 1) {
-    libdvid::DVIDCompressedBlock &block = c_blocks[0];
-    libdvid::BinaryDataPtr data = block.get_uncompressed_data();
-    std::vector<int> offset = block.get_offset();
+  readSpecificBlocks(
+        getDvidTarget().getSegmentationName(), blockObj, zoom,
+        info.getBlockSize(),
+        [&](const ZIntPoint &offset, const char *data, size_t /*size*/) {
+    if (array == NULL) {
+      ZIntCuboid box;
+      box.setFirstCorner(offset);
+      box.setSize(info.getBlockSize());
+      array = ZArrayFactory::MakeArray(box, mylib::UINT64_TYPE);
+      array->copyDataFrom(data);
+    }
+  });
 
-    ZDvidInfo info = readLabelInfo();
+  return array;
+}
 
-    ZIntCuboid box;
-    box.setFirstCorner(offset[0], offset[1], offset[2]);
-    box.setSize(info.getBlockSize());
-    array = ZArrayFactory::MakeArray(box, mylib::UINT64_TYPE);
-    array->copyDataFrom(data->get_raw());
+std::vector<ZDvidLabelBlock*> ZDvidReader::readCompressedLabelBlock(
+    const ZObject3dScan &blockObj, int zoom) const
+{
+  std::vector<ZDvidLabelBlock*> result;
+
+  std::string dataName = getDvidTarget().getSegmentationName();
+  if (!getDvidTarget().hasBlockCoding() || dataName.empty()) {
+    return result;
   }
 
-  return array;
+  ZDvidInfo info = readLabelInfo();
+  ZIntPoint blockSize = info.getBlockSize();
+
+  //Keep the query string of a request in a reasonable length
+  const size_t maxBlockNumber = 512;
+
+  ZDvidUrl dvidUrl(getDvidTarget());
+  ZDvidBufferReader &reader = m_bufferReader;
+  reader.tryCompress(false);
+
+  std::vector<int> blockcoords;
+  ZObject3dScan::ConstVoxelIterator objIter(&blockObj);
+  while (objIter.hasNext()) {
+    ZIntPoint pt = objIter.next();
+    blockcoords.push_back(pt.getX());
+    blockcoords.push_back(pt.getY());
+    blockcoords.push_back(pt.getZ());
+  }
+
+  for (size_t start = 0; start < blockcoords.size();
+       start += maxBlockNumber * 3) {
+    std::vector<int> batch(
+          blockcoords.begin() + start,
+          blockcoords.begin() +
+          std::min(start + maxBlockNumber * 3, blockcoords.size()));
+    reader.read(dvidUrl.getSpecificBlocksUrl(dataName, batch, zoom).c_str(),
+                isVerbose());
+    setStatusCode(reader.getStatusCode());
+
+    if (reader.getStatus() == neutube::EReadStatus::OK) {
+      //Each block: int32 x 3 (block index), int32 N, N bytes of gzip data
+      const QByteArray &buffer = reader.getBuffer();
+      const char *data = buffer.constData();
+      size_t size = buffer.size();
+      size_t pos = 0;
+      int32_t header[4];
+      while (size - pos >= sizeof(header)) {
+        memcpy(header, data + pos, sizeof(header));
+        pos += sizeof(header);
+        if (header[3] < 0 || size_t(header[3]) > size - pos) {
+          LWARN() << "Corrupted block data from" << dataName.c_str();
+          break;
+        }
+
+        ZDvidLabelBlock *block = new ZDvidLabelBlock;
+        if (block->loadCompressed(data + pos, header[3])) {
+          block->setOffset(
+                ZIntPoint(header[0], header[1], header[2]) * blockSize);
+          result.push_back(block);
+        } else {
+          delete block;
+        }
+        pos += header[3];
+      }
+    } else {
+      break;
+    }
+  }
+
+  clearBuffer();
+
+  return result;
+}
+
+ZDvidLabelBlock* ZDvidReader::readCompressedLabelBlock(
+    int bx, int by, int bz, int zoom) const
+{
+  ZObject3dScan blockObj;
+  blockObj.addSegment(bz, by, bx, bx);
+
+  ZDvidLabelBlock *block = NULL;
+  std::vector<ZDvidLabelBlock*> blockArray =
+      readCompressedLabelBlock(blockObj, zoom);
+  if (!blockArray.empty()) {
+    block = blockArray.front();
+    for (size_t i = 1; i < blockArray.size(); ++i) {
+      delete blockArray[i];
+    }
+  }
+
+  return block;
 }
 
 bool ZDvidReader::refreshLabelBuffer() const
@@ -4388,6 +4556,86 @@ ZDvidVersionDag ZDvidReader::readVersionDag(const std::string &uuid) const
   return dag;
 }
 
+bool ZDvidReader::isNodeLocked() const
+{
+  const ZDvidTarget &target = getDvidTarget();
+  if (target.getUuid().empty()) {
+    return false;
+  }
+
+  ZDvidBlockCache &cache = ZDvidBlockCache::GetInstance();
+  int state = cache.getNodeLockState(
+        target.getAddressWithPort(), target.getUuid());
+  if (state < 0) {
+    ZDvidVersionDag dag = readVersionDag();
+    if (getStatusCode() == 200) {
+      state = dag.isLocked(
+            target.getUuid().substr(0, DVID_UUID_COMMON_LENGTH));
+    } else {
+      //Taken as unlocked for the session so that block reads do not ask again
+      LWARN() << "Failed to read the version DAG of" << target.getUuid()
+              << "; the block cache is not used for it.";
+      state = 0;
+    }
+    cache.setNodeLocked(
+          target.getAddressWithPort(), target.getUuid(), state > 0);
+  }
+
+  return state > 0;
+}
+
+ZDvidBlockCache* ZDvidReader::getBlockCache() const
+{
+  if (isNodeLocked()) {
+    return ZDvid::GetBlockCache(getDvidTarget());
+  }
+
+  return NULL;
+}
+
+void ZDvidReader::readSpecificBlocks(
+    const std::string &dataName, const ZObject3dScan &blockObj, int zoom,
+    const ZIntPoint &blockSize,
+    const std::function<void(const ZIntPoint&, const char*, size_t)>
+    &loadBlock) const
+{
+  ZDvidBlockCache *cache = getBlockCache();
+
+  std::vector<int> blockcoords;
+  std::vector<char> buffer;
+  ZObject3dScan::ConstVoxelIterator objIter(&blockObj);
+  while (objIter.hasNext()) {
+    ZIntPoint pt = objIter.next();
+    if (cache != NULL && cache->get(
+          MakeBlockCacheKey(getDvidTarget(), dataName, zoom, pt), &buffer)) {
+      loadBlock(pt * blockSize, buffer.data(), buffer.size());
+    } else {
+      blockcoords.push_back(pt.getX());
+      blockcoords.push_back(pt.getY());
+      blockcoords.push_back(pt.getZ());
+    }
+  }
+
+  if (!blockcoords.empty()) {
+    std::vector<libdvid::DVIDCompressedBlock> c_blocks;
+    m_service->get_specificblocks3D(
+          dataName, blockcoords, false, c_blocks, zoom);
+
+    for (libdvid::DVIDCompressedBlock &block : c_blocks) {
+      libdvid::BinaryDataPtr data = block.get_uncompressed_data();
+      std::vector<int> offset = block.get_offset();
+      ZIntPoint startCoord(offset[0], offset[1], offset[2]);
+      const char *raw = (const char*) data->get_raw();
+      if (cache != NULL) {
+        cache->put(MakeBlockCacheKey(
+                     getDvidTarget(), dataName, zoom, startCoord / blockSize),
+                   raw, data->length());
+      }
+      loadBlock(startCoord, raw, data->length());
+    }
+  }
+}
+
 int ZDvidReader::readBodyBlockCount(uint64_t bodyId) const
 {
   int count = 0;
@@ -4686,44 +4934,9 @@ std::vector<uint64_t> ZDvidReader::readBodyIdAt(
   std::vector<uint64_t> bodyArray;
 
   if (!ptArray.empty()) {
-    ZDvidBufferReader &bufferReader = m_bufferReader;
-    ZDvidUrl dvidUrl(m_dvidTarget);
-
-    ZJsonArray queryObj;
-
-    for (std::vector<ZIntPoint>::const_iterator iter = ptArray.begin();
-         iter != ptArray.end(); ++iter) {
-      const ZIntPoint &pt = *iter;
-      ZJsonArray coordObj;
-      coordObj.append(pt.getX());
-      coordObj.append(pt.getY());
-      coordObj.append(pt.getZ());
-
-      queryObj.append(coordObj);
-    }
-
-    QString queryForm = queryObj.dumpString(0).c_str();
-
-#ifdef _DEBUG_
-    STD_COUT << "Payload: " << queryForm.toStdString() << std::endl;
-#endif
-
-    QByteArray payload;
-    payload.append(queryForm);
-
-    bufferReader.read(
-          dvidUrl.getLocalBodyIdArrayUrl().data(), payload, "GET", true);
-    setStatusCode(bufferReader.getStatusCode());
-
-    ZJsonArray infoJson;
-    infoJson.decodeString(bufferReader.getBuffer().data());
-
-    if (infoJson.size() == ptArray.size()) {
-      for (size_t i = 0; i < infoJson.size(); ++i) {
-        uint64_t bodyId = (uint64_t) ZJsonParser::integerValue(infoJson.at(i));
-        bodyArray.push_back(bodyId);
-      }
-    }
+    ZDvidBodyIdResolver resolver(getDvidTarget());
+    bodyArray = resolver.resolve(ptArray);
+    setStatusCode(resolver.getStatusCode());
   }
 
   return bodyArray;
@@ -4919,6 +5132,27 @@ ZJsonObject ZDvidReader::readJsonObject(const std::string &url) const
   return obj;
 }
 
+ZJsonObject ZDvidReader::readCachedJsonObject(const std::string &url) const
+{
+  ZJsonObject obj;
+
+  if (ZString(url).startsWith("http:")) {
+    ZDvidBufferReader &bufferReader = m_bufferReader;
+    bufferReader.readCached(
+          url.c_str(), ZDvidRequestCoalescer::METADATA_CACHE_LIFETIME,
+          isVerbose());
+    setStatusCode(bufferReader.getStatusCode());
+    const QByteArray &buffer = bufferReader.getBuffer();
+    if (!buffer.isEmpty()) {
+      obj.decodeString(buffer.constData());
+    }
+  } else {
+    obj = readJsonObject(url);
+  }
+
+  return obj;
+}
+
 ZJsonObject ZDvidReader::readJsonObjectFromKey(
     const QString &dataName, const QString &key) const
 {
@@ -4981,23 +5215,83 @@ ZJsonArray ZDvidReader::readJsonArray(
 std::vector<ZIntPoint> ZDvidReader::readSynapsePosition(
     const ZIntCuboid &box) const
 {
+  ZDvidSynapseStore store;
+  readSynapse(box, &store);
+
+  std::vector<ZIntPoint> posArray(store.size());
+  for (size_t i = 0; i < store.size(); ++i) {
+    posArray[i] = store.getPosition(i);
+  }
+
+  return posArray;
+}
+
+namespace {
+
+bool DecodeSynapseBuffer(const QByteArray &buffer, ZDvidSynapseStore *store)
+{
+  ZDvidMetrics::Timer timer;
+  bool succ = store->decode(buffer.constData(), buffer.size());
+  ZDvidMetrics::GetInstance().recordDecode(
+        ZDvidMetrics::EEndpoint::ANNOTATION, timer.elapsed());
+
+  if (!succ) {
+    LWARN() << "Invalid synapse data";
+    return false;
+  }
+
+  return true;
+}
+
+}
+
+bool ZDvidReader::readSynapse(
+    const ZIntCuboid &box, ZDvidSynapseStore *store) const
+{
+  if (store == NULL) {
+    return false;
+  }
+
   ZDvidUrl dvidUrl(m_dvidTarget);
-  ZJsonArray obj = readJsonArray(dvidUrl.getSynapseUrl(box));
+  QByteArray buffer = readBuffer(dvidUrl.getSynapseUrl(box));
+  setStatusCode(m_bufferReader.getStatusCode());
+  if (getStatusCode() != 200) {
+    return false;
+  }
 
-  std::vector<ZIntPoint> posArray;
+  return DecodeSynapseBuffer(buffer, store);
+}
 
-  for (size_t i = 0; i < obj.size(); ++i) {
-    ZJsonObject synapseJson(obj.at(i), ZJsonValue::SET_INCREASE_REF_COUNT);
-    if (synapseJson.hasKey("Pos")) {
-      ZJsonArray posJson(synapseJson.value("Pos"));
-      int x = ZJsonParser::integerValue(posJson.at(0));
-      int y = ZJsonParser::integerValue(posJson.at(1));
-      int z = ZJsonParser::integerValue(posJson.at(2));
-      posArray.push_back(ZIntPoint(x, y, z));
-    }
+bool ZDvidReader::readSynapse(
+    uint64_t label, bool relation, ZDvidSynapseStore *store) const
+{
+  if (store == NULL) {
+    return false;
   }
 
-  return posArray;
+  ZDvidUrl dvidUrl(m_dvidTarget);
+  QByteArray buffer = readBuffer(dvidUrl.getSynapseUrl(label, relation));
+  setStatusCode(m_bufferReader.getStatusCode());
+  if (getStatusCode() != 200) {
+    return false;
+  }
+
+  return DecodeSynapseBuffer(buffer, store);
+}
+
+namespace {
+
+std::vector<ZDvidSynapse> MakeSynapseArray(
+    const ZDvidSynapseStore &store, flyem::EDvidAnnotationLoadMode mode)
+{
+  std::vector<ZDvidSynapse> synapseArray(store.size());
+  for (size_t i = 0; i < store.size(); ++i) {
+    synapseArray[i].loadStore(store, i, mode);
+  }
+
+  return synapseArray;
+}
+
 }
 
 ZJsonObject ZDvidReader::readSynapseJson(const ZIntPoint &pt) const
@@ -5021,17 +5315,10 @@ ZJsonObject ZDvidReader::readSynapseJson(int x, int y, int z) const
 std::vector<ZDvidSynapse> ZDvidReader::readSynapse(
     const ZIntCuboid &box, flyem::EDvidAnnotationLoadMode mode) const
 {
-  ZDvidUrl dvidUrl(m_dvidTarget);
-  ZJsonArray obj = readJsonArray(dvidUrl.getSynapseUrl(box));
-
-  std::vector<ZDvidSynapse> synapseArray(obj.size());
+  ZDvidSynapseStore store;
+  readSynapse(box, &store);
 
-  for (size_t i = 0; i < obj.size(); ++i) {
-    ZJsonObject synapseJson(obj.at(i), ZJsonValue::SET_INCREASE_REF_COUNT);
-    synapseArray[i].loadJsonObject(synapseJson, mode);
-  }
-
-  return synapseArray;
+  return MakeSynapseArray(store, mode);
 }
 
 ZJsonArray ZDvidReader::readSynapseLabelsz(int n, ZDvid::ELabelIndexType index) const
@@ -5073,17 +5360,13 @@ ZJsonArray ZDvidReader::readSynapseLabelszThreshold(int threshold, ZDvid::ELabel
 std::vector<ZDvidSynapse> ZDvidReader::readSynapse(
     uint64_t label, flyem::EDvidAnnotationLoadMode mode) const
 {
-  ZDvidUrl dvidUrl(m_dvidTarget);
-
-  ZJsonArray obj = readJsonArray(
-        dvidUrl.getSynapseUrl(label, mode != flyem::EDvidAnnotationLoadMode::NO_PARTNER));
-
-  std::vector<ZDvidSynapse> synapseArray(obj.size());
+  ZDvidSynapseStore store;
+  readSynapse(
+        label, mode != flyem::EDvidAnnotationLoadMode::NO_PARTNER, &store);
 
-  for (size_t i = 0; i < obj.size(); ++i) {
-    ZJsonObject synapseJson(obj.at(i), ZJsonValue::SET_INCREASE_REF_COUNT);
-    synapseArray[i].loadJsonObject(synapseJson, mode);
-    synapseArray[i].setBodyId(label);
+  std::vector<ZDvidSynapse> synapseArray = MakeSynapseArray(store, mode);
+  for (ZDvidSynapse &synapse : synapseArray) {
+    synapse.setBodyId(label);
   }
 
   return synapseArray;
@@ -5093,19 +5376,22 @@ std::vector<ZDvidSynapse> ZDvidReader::readSynapse(
     uint64_t label, const ZDvidRoi &roi,
     flyem::EDvidAnnotationLoadMode mode) const
 {
-  ZDvidUrl dvidUrl(m_dvidTarget);
+  ZDvidSynapseStore store;
+  readSynapse(
+        label, mode != flyem::EDvidAnnotationLoadMode::NO_PARTNER, &store);
 
-  ZJsonArray obj = readJsonArray(
-        dvidUrl.getSynapseUrl(label, mode != flyem::EDvidAnnotationLoadMode::NO_PARTNER));
+  std::vector<ZIntPoint> positionArray(store.size());
+  for (size_t i = 0; i < store.size(); ++i) {
+    positionArray[i] = store.getPosition(i);
+  }
+  std::vector<bool> inRoi = roi.containsBatch(positionArray);
 
+  //Only synapses in the ROI are made
   std::vector<ZDvidSynapse> synapseArray;
-
-  for (size_t i = 0; i < obj.size(); ++i) {
-    ZJsonObject synapseJson(obj.at(i), ZJsonValue::SET_INCREASE_REF_COUNT);
-    ZIntPoint position = ZDvidAnnotation::GetPosition(synapseJson);
-    if (roi.contains(position)) {
+  for (size_t i = 0; i < store.size(); ++i) {
+    if (inRoi[i]) {
       synapseArray.resize(synapseArray.size() + 1);
-      synapseArray.back().loadJsonObject(synapseJson, mode);
+      synapseArray.back().loadStore(store, i, mode);
       synapseArray.back().setBodyId(label);
     }
   }
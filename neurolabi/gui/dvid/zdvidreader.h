@@ -12,6 +12,7 @@
 #include <string>
 #include <vector>
 #include <tuple>
+#include <functional>
 
 //#include "zdvidclient.h"
 #include "flyem/zflyem.h"
@@ -21,6 +22,7 @@
 #include "dvid/zdvidsynapse.h"
 #include "dvid/zdvidbufferreader.h"
 #include "dvid/zdvidurl.h"
+#include "dvid/zdvidbodystreamloader.h"
 
 
 #if defined(_ENABLE_LOWTIS_)
@@ -35,6 +37,7 @@ class ZDvidTile;
 class ZDvidTileInfo;
 class ZSwcTree;
 class ZObject3dScan;
+class ZObject3dScanCompact;
 class ZSparseStack;
 class ZDvidVersionDag;
 class ZDvidSparseStack;
@@ -46,6 +49,9 @@ class ZObject3dScanArray;
 class ZMesh;
 class ZStack;
 class ZAffineRect;
+class ZDvidBlockCache;
+class ZDvidLabelBlock;
+class ZDvidSynapseStore;
 
 struct archive;
 
@@ -181,6 +187,31 @@ public:
                              int zoom, const ZIntCuboid &box, bool canonizing,
                              ZObject3dScan *result) const;
 
+  /*!
+   * \brief Read a body into compact storage
+   *
+   * The sparsevol payload is decoded directly into \a result without going
+   * through per-stripe allocation. It returns NULL if the reader is not ready
+   * or the payload cannot be parsed. A new object is created if \a result is
+   * NULL.
+   */
+  ZObject3dScanCompact* readBodyCompact(
+      uint64_t bodyId, flyem::EBodyLabelType labelType, bool canonizing,
+      ZObject3dScanCompact *result) const;
+
+  /*!
+   * \brief Read a body in parallel z partitions
+   *
+   * See ZDvidBodyStreamLoader for details. \a callback receives decoded parts
+   * in worker threads as they arrive. It falls back to reading the body in one
+   * request if the partitions are not available.
+   */
+  ZObject3dScan* readBodyStreaming(
+      uint64_t bodyId, flyem::EBodyLabelType labelType, int zoom,
+      bool canonizing, ZObject3dScan *result,
+      const ZDvidBodyStreamLoader::PartCallback &callback =
+      ZDvidBodyStreamLoader::PartCallback()) const;
+
   ZObject3dScan* readBodyWithPartition(uint64_t bodyId, ZObject3dScan *result) const;
   ZObject3dScan* readBodyWithPartition(
       uint64_t bodyId, flyem::EBodyLabelType labelType, ZObject3dScan *result) const;
@@ -189,10 +220,13 @@ public:
    * \brief Read a body at a given scale
    *
    * The scale information will be stored in the result object as its downsampling
-   * interval.
+   * interval. A body at zoom 0 is read by readBodyStreaming(), which passes
+   * the decoded parts to \a callback.
    */
   ZObject3dScan* readMultiscaleBody(
-      uint64_t bodyId, int zoom, bool canonizing, ZObject3dScan *result) const;
+      uint64_t bodyId, int zoom, bool canonizing, ZObject3dScan *result,
+      const ZDvidBodyStreamLoader::PartCallback &callback =
+      ZDvidBodyStreamLoader::PartCallback()) const;
 
   ZObject3dScanArray* readBody(const std::set<uint64_t> &bodySet) const;
 
@@ -218,6 +252,9 @@ public:
    * Draco-compressed meshes.  The new "tarsupervoxels" data instance will be used
    * unless useOldMeshesTars is true, to force use of the old key-value instance
    * for backwards compatibility.
+   *
+   * The whole archive is downloaded into the buffer of the reader before it is
+   * opened. The buffer is released by readMeshArchiveEnd().
    */
   struct archive *readMeshArchiveStart(uint64_t bodyId,
                                        bool useOldMeshesTars = false) const;
@@ -227,8 +264,10 @@ public:
   ZMesh *readMeshArchiveNext(struct archive *arc, size_t &bytesJustRead) const;
 
   /*!
-   * \brief An alternative to repeated calls to readMeshArchiveNext(), which uses
-   * std::async and std::future to decompress the meshes in parallel.
+   * \brief An alternative to repeated calls to readMeshArchiveNext(), which
+   * decompresses the meshes in parallel with ZDvidMeshArchiveDecoder.
+   *
+   * \a progress receives the numbers of decoded and read bytes.
    */
   void readMeshArchiveAsync(struct archive *arc, std::vector<ZMesh*>& results,
                             const std::function<void(size_t, size_t)>& progress = {}) const;
@@ -345,6 +384,20 @@ public:
   std::vector<ZArray*> readLabelBlock(const ZObject3dScan &blockObj, int zoom) const;
   ZArray* readLabelBlock(int bx, int by, int bz, int zoom) const;
 
+  /*!
+   * \brief Read label blocks in the compressed form
+   *
+   * The blocks are fetched in the native block encoding of DVID and kept as
+   * they are, which usually takes a small fraction of the transfer and memory
+   * of readLabelBlock(). It returns nothing if the segmentation does not
+   * support block coding. The caller is responsible for deleting the returned
+   * blocks.
+   */
+  std::vector<ZDvidLabelBlock*> readCompressedLabelBlock(
+      const ZObject3dScan &blockObj, int zoom) const;
+  ZDvidLabelBlock* readCompressedLabelBlock(
+      int bx, int by, int bz, int zoom) const;
+
 #if defined(_ENABLE_LOWTIS_)
   //Read label data
   ZArray* readLabels64Lowtis(int x0, int y0, int z0,
@@ -442,6 +495,14 @@ public:
 
   uint64_t readBodyIdAt(int x, int y, int z) const;
   uint64_t readBodyIdAt(const ZIntPoint &pt) const;
+
+  /*!
+   * \brief Read body IDs of a batch of points.
+   *
+   * The points are grouped by label block and sent in parallel chunks. See
+   * ZDvidBodyIdResolver for reading with local label data. It returns an
+   * empty array if reading fails.
+   */
   std::vector<uint64_t> readBodyIdAt(
       const std::vector<ZIntPoint> &ptArray) const;
   std::vector<std::vector<uint64_t> > readBodyIdAt(
@@ -462,6 +523,15 @@ public:
   ZDvidTile *readTile(int resLevel, int xi0, int yi0, int z0) const;
 
   ZDvidVersionDag readVersionDag(const std::string &uuid) const;
+
+  /*!
+   * \brief Test if the node of the reader is locked.
+   *
+   * The state is read from the server only once per node and then kept by
+   * the block cache. Blocks of a locked node are cached on disk by the block
+   * reading functions (see ZDvid::GetBlockCache()).
+   */
+  bool isNodeLocked() const;
   ZDvidVersionDag readVersionDag() const;
 
   ZObject3dScan readCoarseBody(uint64_t bodyId) const;
@@ -515,6 +585,13 @@ public:
       const std::string &dataName, int x, int y, int z) const;
 
   std::vector<ZIntPoint> readSynapsePosition(const ZIntCuboid &box) const;
+
+  /*!
+   * \brief Read synapses as annotation objects.
+   *
+   * The response is decoded into a ZDvidSynapseStore first, from which the
+   * synapse objects are made.
+   */
   std::vector<ZDvidSynapse> readSynapse(
       const ZIntCuboid &box,
       flyem::EDvidAnnotationLoadMode mode = flyem::EDvidAnnotationLoadMode::NO_PARTNER) const;
@@ -525,6 +602,18 @@ public:
       uint64_t label, const ZDvidRoi &roi,
       flyem::EDvidAnnotationLoadMode mode) const;
 
+  /*!
+   * \brief Read synapses into a compact store.
+   *
+   * The response is decoded directly into \a store without building JSON
+   * objects. The synapses are appended to \a store.
+   *
+   * \return false if the synapses cannot be read or decoded.
+   */
+  bool readSynapse(const ZIntCuboid &box, ZDvidSynapseStore *store) const;
+  bool readSynapse(
+      uint64_t label, bool relation, ZDvidSynapseStore *store) const;
+
   ZDvidSynapse readSynapse(
       int x, int y, int z,
       flyem::EDvidAnnotationLoadMode mode = flyem::EDvidAnnotationLoadMode::NO_PARTNER) const;
@@ -589,6 +678,18 @@ public:
 #endif
 
   QByteArray readBuffer(const std::string &url) const;
+
+  /*!
+   * \brief Asynchronous reading
+   *
+   * It submits the request to ZDvidRequestEngine and returns immediately. The
+   * callback is called in a worker thread after the data arrive. It is not
+   * called if the request is canceled.
+   */
+  ZDvidRequestEngine::Handle readBufferAsync(
+      const std::string &url, const ZDvidRequestEngine::Callback &callback,
+      int priority = 0) const;
+
   QByteArray readDataFromEndpoint(
       const std::string &endPoint, bool tryingCompress = false) const;
 
@@ -690,6 +791,25 @@ private:
   template<typename T>
   void configureLowtis(T *config, const std::string &dataName) const;
 
+  ZDvidBlockCache* getBlockCache() const;
+
+  /*!
+   * \brief Read a json object of metadata, which may come from the short-lived
+   * response cache.
+   */
+  ZJsonObject readCachedJsonObject(const std::string &url) const;
+
+  /*!
+   * Reads the blocks of \a blockObj through the block cache. Cached blocks are
+   * passed to \a loadBlock directly and the rest are fetched in one request.
+   * \a loadBlock takes the voxel offset and uncompressed data of a block.
+   */
+  void readSpecificBlocks(
+      const std::string &dataName, const ZObject3dScan &blockObj, int zoom,
+      const ZIntPoint &blockSize,
+      const std::function<void(const ZIntPoint&, const char*, size_t)>
+      &loadBlock) const;
+
 protected:
   ZDvidTarget m_dvidTarget;
   bool m_verbose;
@@ -733,50 +853,12 @@ template <typename InputIterator>
 std::vector<uint64_t> ZDvidReader::readBodyIdAt(
     const InputIterator &first, const InputIterator &last) const
 {
-  std::vector<uint64_t> bodyArray;
-
-  if (first != last) {
-    ZDvidBufferReader &bufferReader = m_bufferReader;
-#if defined(_ENABLE_LIBDVIDCPP_)
-    bufferReader.setService(m_service);
-#endif
-    ZDvidUrl dvidUrl(m_dvidTarget);
-
-    ZJsonArray queryObj;
-
-    for (InputIterator iter = first; iter != last; ++iter) {
-      const ZIntPoint &pt = *iter;
-      ZJsonArray coordObj;
-      coordObj.append(pt.getX());
-      coordObj.append(pt.getY());
-      coordObj.append(pt.getZ());
-
-      queryObj.append(coordObj);
-    }
-
-    QString queryForm = queryObj.dumpString(0).c_str();
-
-#ifdef _DEBUG_
-    std::cout << "Payload: " << queryForm.toStdString() << std::endl;
-#endif
-
-    QByteArray payload;
-    payload.append(queryForm);
-
-    bufferReader.read(
-          dvidUrl.getLocalBodyIdArrayUrl().data(), payload, "GET", true);
-    setStatusCode(bufferReader.getStatusCode());
-
-    ZJsonArray infoJson;
-    infoJson.decodeString(bufferReader.getBuffer().data());
-
-    for (size_t i = 0; i < infoJson.size(); ++i) {
-      uint64_t bodyId = (uint64_t) ZJsonParser::integerValue(infoJson.at(i));
-      bodyArray.push_back(bodyId);
-    }
+  std::vector<ZIntPoint> ptArray;
+  for (InputIterator iter = first; iter != last; ++iter) {
+    ptArray.push_back(*iter);
   }
 
-  return bodyArray;
+  return readBodyIdAt(ptArray);
 }
 
 #endif // ZDVIDREADER_H
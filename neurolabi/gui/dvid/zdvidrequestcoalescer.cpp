@@ -0,0 +1,172 @@
+#include "zdvidrequestcoalescer.h"
+
+#include <algorithm>
+
+#include <QStringList>
+#include <QCryptographicHash>
+
+const int ZDvidRequestCoalescer::METADATA_CACHE_LIFETIME = 5000;
+
+ZDvidRequestCoalescer::ZDvidRequestCoalescer()
+{
+}
+
+ZDvidRequestCoalescer& ZDvidRequestCoalescer::GetInstance()
+{
+  static ZDvidRequestCoalescer coalescer;
+
+  return coalescer;
+}
+
+QString ZDvidRequestCoalescer::NormalizeUrl(const QString &url)
+{
+  QString location = url.trimmed();
+  QString query;
+  int queryPos = location.indexOf('?');
+  if (queryPos >= 0) {
+    query = location.mid(queryPos + 1);
+    location = location.left(queryPos);
+  }
+
+  //Scheme and host are case insensitive
+  int pathPos = 0;
+  int schemePos = location.indexOf("://");
+  if (schemePos >= 0) {
+    pathPos = location.indexOf('/', schemePos + 3);
+    if (pathPos < 0) {
+      pathPos = location.size();
+    }
+  }
+  QString path = location.mid(pathPos);
+  location = location.left(pathPos).toLower();
+
+  while (path.contains("//")) {
+    path.replace("//", "/");
+  }
+  while (path.endsWith('/')) {
+    path.chop(1);
+  }
+  location += path;
+
+  if (!query.isEmpty()) {
+    QStringList itemList = query.split('&', QString::SkipEmptyParts);
+    std::sort(itemList.begin(), itemList.end());
+    if (!itemList.isEmpty()) {
+      location += "?" + itemList.join("&");
+    }
+  }
+
+  return location;
+}
+
+std::string ZDvidRequestCoalescer::MakeKey(
+    const QString &url, const QByteArray &payload, const std::string &method)
+{
+  std::string key = method + " " + NormalizeUrl(url).toStdString();
+  if (!payload.isEmpty()) {
+    key += " " + QCryptographicHash::hash(
+          payload, QCryptographicHash::Sha1).toHex().toStdString() +
+        ":" + std::to_string(payload.size());
+  }
+
+  return key;
+}
+
+ZDvidRequestCoalescer::Result ZDvidRequestCoalescer::fetch(
+    const std::string &key, const Fetcher &fetcher, int cacheLifetime)
+{
+  std::shared_ptr<Pending> pending;
+
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (cacheLifetime > 0) {
+      auto iter = m_cache.find(key);
+      if (iter != m_cache.end()) {
+        if (std::chrono::steady_clock::now() - iter->second.time <=
+            std::chrono::milliseconds(cacheLifetime)) {
+          ++m_cacheHitCount;
+          return iter->second.result;
+        }
+      }
+    }
+
+    auto iter = m_pendingMap.find(key);
+    if (iter != m_pendingMap.end()) {
+      std::shared_ptr<Pending> current = iter->second;
+      ++m_coalescedCount;
+      m_condition.wait(lock, [&]() { return current->done; });
+      return current->result;
+    }
+
+    pending = std::make_shared<Pending>();
+    m_pendingMap[key] = pending;
+    ++m_fetchCount;
+  }
+
+  Result result;
+  try {
+    result = fetcher();
+  } catch (...) {
+    Result failed;
+    failed.status = neutube::EReadStatus::FAILED;
+    finish(key, pending, failed, 0);
+    throw;
+  }
+
+  finish(key, pending, result, cacheLifetime);
+
+  return result;
+}
+
+void ZDvidRequestCoalescer::finish(
+    const std::string &key, const std::shared_ptr<Pending> &pending,
+    const Result &result, int cacheLifetime)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+
+  pending->result = result;
+  pending->done = true;
+  m_pendingMap.erase(key);
+
+  if (cacheLifetime > 0 && result.statusCode == 200) {
+    if (m_cache.size() >= m_maxCacheSize && m_cache.count(key) == 0) {
+      auto oldest = std::min_element(
+            m_cache.begin(), m_cache.end(),
+            [](const std::pair<const std::string, CacheEntry> &e1,
+            const std::pair<const std::string, CacheEntry> &e2) {
+        return e1.second.time < e2.second.time;
+      });
+      m_cache.erase(oldest);
+    }
+
+    CacheEntry &entry = m_cache[key];
+    entry.result = result;
+    entry.time = std::chrono::steady_clock::now();
+  }
+
+  m_condition.notify_all();
+}
+
+void ZDvidRequestCoalescer::clearCache()
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  m_cache.clear();
+}
+
+size_t ZDvidRequestCoalescer::getFetchCount() const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_fetchCount;
+}
+
+size_t ZDvidRequestCoalescer::getCoalescedCount() const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_coalescedCount;
+}
+
+size_t ZDvidRequestCoalescer::getCacheHitCount() const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_cacheHitCount;
+}
@@ -0,0 +1,103 @@
+#ifndef ZDVIDREQUESTCOALESCER_H
+#define ZDVIDREQUESTCOALESCER_H
+
+#include <string>
+#include <map>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include <QString>
+#include <QByteArray>
+
+#include "dvid/zdvidrequestengine.h"
+
+/*!
+ * \brief The class of merging identical DVID requests of the whole process
+ *
+ * Each request is identified by a key made from its method, its normalized URL
+ * and its payload. When a request is fetched while another one with the same
+ * key is in flight, it waits for the pending one and takes its result instead
+ * of going to the server again.
+ *
+ * A fetch can also ask for a short-lived response cache, which is meant for
+ * idempotent metadata such as data instance info. Only successful responses
+ * are cached.
+ */
+class ZDvidRequestCoalescer
+{
+public:
+  ZDvidRequestCoalescer();
+
+  static ZDvidRequestCoalescer& GetInstance();
+
+  typedef ZDvidRequestEngine::Result Result;
+  typedef std::function<Result()> Fetcher;
+
+  /*!
+   * \brief Make the key of a request.
+   */
+  static std::string MakeKey(const QString &url,
+                             const QByteArray &payload = QByteArray(),
+                             const std::string &method = "GET");
+
+  /*!
+   * \brief Normalize a URL.
+   *
+   * The scheme and the host are turned into lower case, the path is cleaned
+   * up and the query items are sorted, so that URLs with the same meaning have
+   * the same form.
+   */
+  static QString NormalizeUrl(const QString &url);
+
+  /*!
+   * \brief Fetch a response.
+   *
+   * \a fetcher is called in the current thread unless a request with the same
+   * \a key is in flight, or \a cacheLifetime is positive and a response of
+   * \a key that is at most \a cacheLifetime milliseconds old is cached.
+   * Exceptions of \a fetcher are passed to the caller, while the waiting
+   * duplicates get a failed result.
+   */
+  Result fetch(const std::string &key, const Fetcher &fetcher,
+               int cacheLifetime = 0);
+
+  /*!
+   * \brief Remove all cached responses.
+   */
+  void clearCache();
+
+  size_t getFetchCount() const;
+  size_t getCoalescedCount() const;
+  size_t getCacheHitCount() const;
+
+  const static int METADATA_CACHE_LIFETIME; //in milliseconds
+
+private:
+  struct Pending {
+    bool done = false;
+    Result result;
+  };
+
+  struct CacheEntry {
+    Result result;
+    std::chrono::steady_clock::time_point time;
+  };
+
+  void finish(const std::string &key, const std::shared_ptr<Pending> &pending,
+              const Result &result, int cacheLifetime);
+
+private:
+  mutable std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::map<std::string, std::shared_ptr<Pending>> m_pendingMap;
+  std::map<std::string, CacheEntry> m_cache;
+  size_t m_maxCacheSize = 256;
+  size_t m_fetchCount = 0;
+  size_t m_coalescedCount = 0;
+  size_t m_cacheHitCount = 0;
+};
+
+#endif // ZDVIDREQUESTCOALESCER_H
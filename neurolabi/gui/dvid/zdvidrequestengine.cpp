@@ -0,0 +1,447 @@
+#include "zdvidrequestengine.h"
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+
+#include <QUrl>
+
+#include "zqslog.h"
+#include "dvid/libdvidheader.h"
+#include "dvid/zdvidtarget.h"
+#include "dvid/zdvidurl.h"
+#include "zdvidutil.h"
+#include "znetbufferreader.h"
+#include "dvid/zdvidrequestcoalescer.h"
+#include "dvid/zdvidmetrics.h"
+
+struct ZDvidRequestEngine::Task {
+  enum class EState {
+    PENDING, RUNNING, DONE
+  };
+
+  Request request;
+  Callback callback;
+  std::string server;
+
+  std::mutex mutex;
+  std::condition_variable doneCondition;
+  EState state = EState::PENDING;
+  bool canceled = false;
+  Result result;
+};
+
+namespace {
+
+void SetCanceled(ZDvidRequestEngine::Result *result)
+{
+  result->buffer.clear();
+  result->status = neutube::EReadStatus::CANCELED;
+  result->statusCode = 0;
+}
+
+}
+
+ZDvidRequestEngine::ZDvidRequestEngine(
+    int maxInFlight, int maxConnectionPerServer) :
+  m_maxConnectionPerServer(std::max(1, maxConnectionPerServer))
+{
+  maxInFlight = std::max(1, maxInFlight);
+  for (int i = 0; i < maxInFlight; ++i) {
+    m_workerArray.emplace_back(&ZDvidRequestEngine::runWorker, this);
+  }
+}
+
+ZDvidRequestEngine::~ZDvidRequestEngine()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_taskCondition.notify_all();
+
+  cancelAll();
+
+  for (std::thread &worker : m_workerArray) {
+    worker.join();
+  }
+}
+
+ZDvidRequestEngine& ZDvidRequestEngine::GetInstance()
+{
+  static ZDvidRequestEngine engine;
+
+  return engine;
+}
+
+bool ZDvidRequestEngine::Handle::isValid() const
+{
+  return m_task.get() != NULL;
+}
+
+bool ZDvidRequestEngine::Handle::isDone() const
+{
+  if (!isValid()) {
+    return true;
+  }
+
+  std::lock_guard<std::mutex> lock(m_task->mutex);
+
+  return m_task->state == Task::EState::DONE;
+}
+
+void ZDvidRequestEngine::Handle::wait() const
+{
+  if (isValid()) {
+    std::unique_lock<std::mutex> lock(m_task->mutex);
+    m_task->doneCondition.wait(lock, [this]() {
+      return m_task->state == Task::EState::DONE; });
+  }
+}
+
+bool ZDvidRequestEngine::Handle::waitFor(int msec) const
+{
+  if (isValid()) {
+    std::unique_lock<std::mutex> lock(m_task->mutex);
+    return m_task->doneCondition.wait_for(
+          lock, std::chrono::milliseconds(msec), [this]() {
+      return m_task->state == Task::EState::DONE; });
+  }
+
+  return true;
+}
+
+ZDvidRequestEngine::Result ZDvidRequestEngine::Handle::getResult() const
+{
+  if (!isValid()) {
+    return Result();
+  }
+
+  std::unique_lock<std::mutex> lock(m_task->mutex);
+  m_task->doneCondition.wait(lock, [this]() {
+    return m_task->state == Task::EState::DONE; });
+
+  return m_task->result;
+}
+
+bool ZDvidRequestEngine::Handle::cancel()
+{
+  if (!isValid()) {
+    return false;
+  }
+
+  std::unique_lock<std::mutex> lock(m_task->mutex);
+  if (m_task->state == Task::EState::DONE) {
+    return false;
+  }
+
+  if (m_task->state == Task::EState::PENDING) {
+    //The queue entry is dropped when a worker runs into it
+    m_task->state = Task::EState::DONE;
+    m_task->callback = Callback();
+    SetCanceled(&m_task->result);
+  }
+  m_task->canceled = true;
+  lock.unlock();
+
+  m_task->doneCondition.notify_all();
+
+  return true;
+}
+
+std::string ZDvidRequestEngine::GetServerKey(const QString &url)
+{
+  ZDvidTarget target;
+  target.setFromUrl(url.toStdString());
+  if (target.isValid()) {
+    return target.getAddressWithPort();
+  }
+
+  return QUrl(url).authority().toStdString();
+}
+
+ZDvidRequestEngine::Handle ZDvidRequestEngine::submit(
+    const Request &request, const Callback &callback)
+{
+  std::shared_ptr<Task> task = std::make_shared<Task>();
+  task->request = request;
+  task->callback = callback;
+  task->server = GetServerKey(request.url);
+
+  Handle handle(task);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_stopping) {
+    lock.unlock();
+    handle.cancel();
+  } else {
+    m_queue[QueueKey(-request.priority, m_sequence++)] = task;
+    lock.unlock();
+    m_taskCondition.notify_one();
+  }
+
+  return handle;
+}
+
+ZDvidRequestEngine::Handle ZDvidRequestEngine::submit(
+    const QString &url, int priority, const Callback &callback)
+{
+  Request request;
+  request.url = url;
+  request.priority = priority;
+
+  return submit(request, callback);
+}
+
+void ZDvidRequestEngine::cancelAll()
+{
+  std::map<QueueKey, std::shared_ptr<Task>> queue;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    queue.swap(m_queue);
+  }
+
+  for (auto &entry : queue) {
+    Handle(entry.second).cancel();
+  }
+}
+
+size_t ZDvidRequestEngine::getPendingNumber() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  size_t count = 0;
+  for (const auto &entry : m_queue) {
+    std::lock_guard<std::mutex> taskLock(entry.second->mutex);
+    if (entry.second->state == Task::EState::PENDING) {
+      ++count;
+    }
+  }
+
+  return count;
+}
+
+int ZDvidRequestEngine::getInFlightNumber() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  return m_inFlightNumber;
+}
+
+void ZDvidRequestEngine::setHandler(const Handler &handler)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_handler = handler;
+}
+
+std::shared_ptr<ZDvidRequestEngine::Task> ZDvidRequestEngine::takeNextTask()
+{
+  for (auto iter = m_queue.begin(); iter != m_queue.end();) {
+    std::shared_ptr<Task> task = iter->second;
+    std::lock_guard<std::mutex> taskLock(task->mutex);
+    if (task->state != Task::EState::PENDING) {
+      iter = m_queue.erase(iter);
+    } else {
+      auto load = m_serverLoad.find(task->server);
+      if (load != m_serverLoad.end() &&
+          load->second >= m_maxConnectionPerServer) {
+        ++iter;
+      } else {
+        task->state = Task::EState::RUNNING;
+        m_queue.erase(iter);
+        return task;
+      }
+    }
+  }
+
+  return std::shared_ptr<Task>();
+}
+
+void ZDvidRequestEngine::runWorker()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!m_stopping) {
+    std::shared_ptr<Task> task = takeNextTask();
+    if (!task) {
+      m_taskCondition.wait(lock);
+      continue;
+    }
+
+    ++m_inFlightNumber;
+    ++m_serverLoad[task->server];
+    Handler handler = m_handler;
+    lock.unlock();
+
+    Result result = (handler && !task->request.job) ?
+          handler(task->request) : run(task->request);
+
+    Callback callback;
+    {
+      std::lock_guard<std::mutex> taskLock(task->mutex);
+      if (!task->canceled) {
+        callback = task->callback;
+      }
+    }
+
+    if (callback) {
+      callback(result);
+    }
+
+    {
+      std::lock_guard<std::mutex> taskLock(task->mutex);
+      task->state = Task::EState::DONE;
+      task->callback = Callback();
+      if (task->canceled) {
+        SetCanceled(&task->result);
+      } else {
+        task->result = result;
+      }
+    }
+    task->doneCondition.notify_all();
+
+    lock.lock();
+    --m_inFlightNumber;
+    if (--m_serverLoad[task->server] == 0) {
+      m_serverLoad.erase(task->server);
+    }
+    //A freed server slot may unblock a request skipped by other workers
+    m_taskCondition.notify_all();
+  }
+}
+
+#if defined(_ENABLE_LIBDVIDCPP_)
+namespace {
+
+std::string GetNodeKey(const ZDvidTarget &target)
+{
+  return target.getAddressWithPort() + "/" + target.getUuid();
+}
+
+}
+
+ZSharedPointer<libdvid::DVIDNodeService> ZDvidRequestEngine::acquireService(
+    const ZDvidTarget &target)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_poolMutex);
+    auto iter = m_servicePool.find(GetNodeKey(target));
+    if (iter != m_servicePool.end() && !iter->second.empty()) {
+      ZSharedPointer<libdvid::DVIDNodeService> service = iter->second.back();
+      iter->second.pop_back();
+      return service;
+    }
+  }
+
+  return ZDvid::MakeDvidNodeService(target);
+}
+
+void ZDvidRequestEngine::releaseService(
+    const ZDvidTarget &target,
+    const ZSharedPointer<libdvid::DVIDNodeService> &service)
+{
+  if (service.get() != NULL) {
+    std::lock_guard<std::mutex> lock(m_poolMutex);
+    std::vector<ZSharedPointer<libdvid::DVIDNodeService>> &pool =
+        m_servicePool[GetNodeKey(target)];
+    if (int(pool.size()) < m_maxConnectionPerServer) {
+      pool.push_back(service);
+    }
+  }
+}
+#endif
+
+ZDvidRequestEngine::Result ZDvidRequestEngine::run(const Request &request)
+{
+  if (request.job) {
+    return request.job();
+  }
+
+  //Duplicate GET requests share the response of the one in flight
+  if (request.method == "GET") {
+    return ZDvidRequestCoalescer::GetInstance().fetch(
+          ZDvidRequestCoalescer::MakeKey(
+            request.url, request.payload, request.method),
+          [&]() { return runDirectly(request); });
+  }
+
+  return runDirectly(request);
+}
+
+ZDvidRequestEngine::Result ZDvidRequestEngine::runDirectly(
+    const Request &request)
+{
+  Result result;
+  result.status = neutube::EReadStatus::FAILED;
+
+  if (request.url.isEmpty()) {
+    return result;
+  }
+
+#if defined(_ENABLE_LIBDVIDCPP_)
+  ZDvidTarget target;
+  target.setFromUrl(request.url.toStdString());
+
+  if (target.isValid()) {
+    ZSharedPointer<libdvid::DVIDNodeService> service;
+    bool reusable = true;
+    ZDvidMetrics::Timer timer;
+    try {
+      service = acquireService(target);
+      libdvid::ConnectionMethod connMeth = libdvid::GET;
+      if (request.method == "POST") {
+        connMeth = libdvid::POST;
+      } else if (request.method == "PUT") {
+        connMeth = libdvid::PUT;
+      }
+
+      libdvid::BinaryDataPtr payload;
+      if (connMeth != libdvid::GET || !request.payload.isEmpty()) {
+        payload = libdvid::BinaryData::create_binary_data(
+              request.payload.data(), request.payload.length());
+      }
+
+      libdvid::BinaryDataPtr data = service->custom_request(
+            ZDvidUrl::GetPath(request.url.toStdString()), payload, connMeth,
+            request.tryingCompress);
+      result.buffer.append(data->get_data().c_str(), data->length());
+      result.status = neutube::EReadStatus::OK;
+      result.statusCode = 200;
+    } catch (libdvid::DVIDException &e) {
+      LWARN() << "Request failed:" << request.url << e.what();
+      result.statusCode = e.getStatus();
+    } catch (std::exception &e) {
+      LWARN() << "Request failed:" << request.url << e.what();
+      //The connection may be left in a bad state
+      reusable = false;
+    }
+
+    if (reusable) {
+      releaseService(target, service);
+    }
+
+    ZDvidMetrics::GetInstance().recordRequest(
+          request.url.toStdString(), timer.elapsed(), request.payload.size(),
+          result.buffer.size(), result.statusCode == 200);
+
+    return result;
+  }
+#endif
+
+  //The network reader only supports POST and plain GET
+  ZNetBufferReader reader;
+  if (request.method == "POST") {
+    reader.post(request.url, request.payload);
+  } else if (request.method == "GET" && request.payload.isEmpty()) {
+    reader.read(request.url, false);
+  } else {
+    LERROR() << "Unsupported request without libdvid:" << request.method.c_str()
+             << request.url << "with" << request.payload.size()
+             << "bytes of payload";
+    return result;
+  }
+  result.buffer = reader.getBuffer();
+  result.status = reader.getStatus();
+  result.statusCode = reader.getStatusCode();
+
+  return result;
+}
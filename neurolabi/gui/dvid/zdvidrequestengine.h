@@ -0,0 +1,234 @@
+#ifndef ZDVIDREQUESTENGINE_H
+#define ZDVIDREQUESTENGINE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
+
+#include <QByteArray>
+#include <QString>
+
+#include "neutube_def.h"
+#include "zsharedpointer.h"
+
+namespace libdvid{
+class DVIDNodeService;
+}
+
+class ZDvidTarget;
+
+/*!
+ * \brief The class of running DVID requests asynchronously
+ *
+ * Requests are run by a fixed number of worker threads, which is also the
+ * maximum number of requests in flight. Pending requests are taken in the
+ * order of decreasing priority and then in the order of submission, skipping
+ * those whose server already has getMaxConnectionPerServer() requests in
+ * flight.
+ *
+ * The libdvid services that carry the requests are kept in a pool after use,
+ * so that later requests to the same node reuse the connection instead of
+ * setting up a new one. The pool is also available to synchronous readers
+ * through acquireService() and releaseService().
+ *
+ * A callback passed to submit() is called in a worker thread after the
+ * request is done. It is not called if the request is canceled.
+ */
+class ZDvidRequestEngine
+{
+public:
+  explicit ZDvidRequestEngine(int maxInFlight = 8,
+                              int maxConnectionPerServer = 4);
+  ~ZDvidRequestEngine();
+
+  /*!
+   * \brief The engine shared by all readers.
+   */
+  static ZDvidRequestEngine& GetInstance();
+
+  struct Result {
+    QByteArray buffer;
+    neutube::EReadStatus status = neutube::EReadStatus::NONE;
+    int statusCode = 0;
+  };
+
+  struct Request {
+    QString url;
+    QByteArray payload;
+    //PUT and GET with a payload are only supported with libdvid
+    std::string method = "GET";
+    bool tryingCompress = false;
+    int priority = 0;
+
+    /*!
+     * \brief The function run in place of sending the request.
+     *
+     * It is for reading that is not a plain URL request, such as reading
+     * through lowtis. It takes precedence over the handler of the engine.
+     * \a url still decides which server the request is counted against.
+     */
+    std::function<Result()> job;
+  };
+
+  typedef std::function<void(const Result&)> Callback;
+
+  /*!
+   * \brief The function that runs a request in a worker thread.
+   */
+  typedef std::function<Result(const Request&)> Handler;
+
+private:
+  struct Task;
+
+public:
+  /*!
+   * \brief The handle of a submitted request
+   *
+   * A handle can be copied and all copies refer to the same request. A default
+   * constructed handle is invalid, for which isDone() returns true.
+   */
+  class Handle {
+  public:
+    Handle() {}
+
+    bool isValid() const;
+
+    /*!
+     * \brief Test if the request is finished or canceled.
+     */
+    bool isDone() const;
+
+    /*!
+     * \brief Wait until the request is done.
+     *
+     * The callback of the request, if any, has returned when it returns.
+     */
+    void wait() const;
+
+    /*!
+     * \brief Wait for at most \a msec milliseconds.
+     *
+     * \return true iff the request is done.
+     */
+    bool waitFor(int msec) const;
+
+    /*!
+     * \brief Get the result of the request.
+     *
+     * It waits until the request is done. The status of the result is
+     * neutube::EReadStatus::CANCELED if the request has been canceled.
+     */
+    Result getResult() const;
+
+    /*!
+     * \brief Cancel the request.
+     *
+     * A pending request is removed from the queue. A running request cannot
+     * be interrupted, but its result is discarded and its callback is skipped.
+     *
+     * \return true iff the request was not done yet.
+     */
+    bool cancel();
+
+  private:
+    friend class ZDvidRequestEngine;
+    explicit Handle(const std::shared_ptr<Task> &task) : m_task(task) {}
+
+  private:
+    std::shared_ptr<Task> m_task;
+  };
+
+  /*!
+   * \brief Submit a request.
+   *
+   * It returns immediately. \a callback is called with the result in a worker
+   * thread unless the request is canceled.
+   */
+  Handle submit(const Request &request, const Callback &callback = Callback());
+  Handle submit(const QString &url, int priority = 0,
+                const Callback &callback = Callback());
+
+  /*!
+   * \brief Cancel all pending requests.
+   */
+  void cancelAll();
+
+  size_t getPendingNumber() const;
+  int getInFlightNumber() const;
+
+  int getMaxInFlight() const { return int(m_workerArray.size()); }
+  int getMaxConnectionPerServer() const { return m_maxConnectionPerServer; }
+
+  /*!
+   * \brief Replace the function of running requests.
+   *
+   * An empty handler restores the default one, which sends the request to
+   * DVID through pooled services.
+   */
+  void setHandler(const Handler &handler);
+
+#if defined(_ENABLE_LIBDVIDCPP_)
+  /*!
+   * \brief Take a service of \a target from the pool.
+   *
+   * A new service is created if no idle one is available. The caller has the
+   * exclusive use of the service until it is returned by releaseService().
+   * It throws the same exceptions as ZDvid::MakeDvidNodeService() if a new
+   * service cannot be created.
+   */
+  ZSharedPointer<libdvid::DVIDNodeService> acquireService(
+      const ZDvidTarget &target);
+
+  /*!
+   * \brief Return a service to the pool.
+   *
+   * The service is dropped if the pool of the node is full.
+   */
+  void releaseService(const ZDvidTarget &target,
+                      const ZSharedPointer<libdvid::DVIDNodeService> &service);
+#endif
+
+  /*!
+   * \brief Run a request in the calling thread with the default handler.
+   *
+   * A GET request is merged with an identical one in flight, see
+   * ZDvidRequestCoalescer. The job of the request is run instead if it is
+   * not empty.
+   */
+  Result run(const Request &request);
+
+private:
+  typedef std::pair<int, uint64_t> QueueKey; //(-priority, sequence)
+
+  void runWorker();
+  Result runDirectly(const Request &request);
+  std::shared_ptr<Task> takeNextTask();
+  static std::string GetServerKey(const QString &url);
+
+private:
+  std::vector<std::thread> m_workerArray;
+  int m_maxConnectionPerServer = 4;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_taskCondition;
+  std::map<QueueKey, std::shared_ptr<Task>> m_queue;
+  std::map<std::string, int> m_serverLoad;
+  uint64_t m_sequence = 0;
+  int m_inFlightNumber = 0;
+  bool m_stopping = false;
+  Handler m_handler;
+
+#if defined(_ENABLE_LIBDVIDCPP_)
+  std::mutex m_poolMutex;
+  std::map<std::string, std::vector<ZSharedPointer<libdvid::DVIDNodeService>>>
+  m_servicePool;
+#endif
+};
+
+#endif // ZDVIDREQUESTENGINE_H
@@ -70,3 +70,19 @@ bool ZDvidRoi::contains(int x, int y, int z) const
   return const_cast<ZObject3dScan&>(m_roi).contains(x, y, z);
 }
 
+std::vector<bool> ZDvidRoi::containsBatch(
+    const std::vector<ZIntPoint> &ptArray) const
+{
+  if (isEmpty()) {
+    return std::vector<bool>(ptArray.size(), false);
+  }
+
+  std::vector<ZIntPoint> blockArray = ptArray;
+  for (ZIntPoint &pt : blockArray) {
+    pt.set(pt.getX() / m_blockSize.getX(), pt.getY() / m_blockSize.getY(),
+           pt.getZ() / m_blockSize.getZ());
+  }
+
+  return const_cast<ZObject3dScan&>(m_roi).containsBatch(blockArray);
+}
+
@@ -33,6 +33,14 @@ public:
   bool contains(int x, int y, int z) const;
   bool contains(const ZIntPoint &pt) const;
 
+  /*!
+   * \brief Test if a list of points are contained in the ROI
+   *
+   * \return An array with the same size as \a ptArray. The i-th element is
+   *         true iff the i-th point is in the ROI.
+   */
+  std::vector<bool> containsBatch(const std::vector<ZIntPoint> &ptArray) const;
+
 private:
   ZObject3dScan m_roi;
   ZIntPoint m_blockSize;
@@ -0,0 +1,476 @@
+#include "zdvidsliceprefetcher.h"
+
+#include <cmath>
+#include <tuple>
+#include <vector>
+#include <algorithm>
+
+#include "zstack.hxx"
+#include "zarray.h"
+
+const size_t ZDvidSlicePrefetcher::DEFAULT_CACHE_SIZE = 256 * 1024 * 1024;
+const int ZDvidSlicePrefetcher::DEFAULT_PREFETCH_COUNT = 8;
+const int ZDvidSlicePrefetcher::PREFETCH_PRIORITY = -1;
+
+namespace {
+
+//Scroll time in seconds that prefetched slices are expected to cover
+const double PREFETCH_LOOKAHEAD = 1.0;
+const int MIN_PREFETCH_COUNT = 2;
+
+}
+
+bool ZDvidSlicePrefetcher::SliceKey::operator< (const SliceKey &key) const
+{
+  return std::tie(source, z, zoom, x0, y0, width, height,
+                  centerCutX, centerCutY, centerCut) <
+      std::tie(key.source, key.z, key.zoom, key.x0, key.y0, key.width,
+               key.height, key.centerCutX, key.centerCutY, key.centerCut);
+}
+
+bool ZDvidSlicePrefetcher::SliceKey::operator== (const SliceKey &key) const
+{
+  return isSameView(key) && z == key.z;
+}
+
+bool ZDvidSlicePrefetcher::SliceKey::isSameView(const SliceKey &key) const
+{
+  return std::tie(source, zoom, x0, y0, width, height,
+                  centerCutX, centerCutY, centerCut) ==
+      std::tie(key.source, key.zoom, key.x0, key.y0, key.width,
+               key.height, key.centerCutX, key.centerCutY, key.centerCut);
+}
+
+bool ZDvidSlicePrefetcher::SliceData::isEmpty() const
+{
+  return stack.get() == NULL && array.get() == NULL;
+}
+
+size_t ZDvidSlicePrefetcher::SliceData::getByteNumber() const
+{
+  size_t byteNumber = 0;
+  if (stack.get() != NULL) {
+    byteNumber += stack->getByteNumber();
+  }
+  if (array.get() != NULL) {
+    byteNumber += array->getByteNumber();
+  }
+
+  return byteNumber;
+}
+
+ZDvidSlicePrefetcher::ZDvidSlicePrefetcher() :
+  m_prefetchCount(DEFAULT_PREFETCH_COUNT), m_cacheSize(DEFAULT_CACHE_SIZE)
+{
+}
+
+ZDvidSlicePrefetcher::~ZDvidSlicePrefetcher()
+{
+  std::vector<ZDvidRequestEngine::Handle> handleArray;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.clear();
+    for (auto &entry : m_running) {
+      entry.second.handle.cancel();
+      handleArray.push_back(entry.second.handle);
+    }
+    m_running.clear();
+  }
+
+  //A job that has started before canceling still refers to this object
+  for (const ZDvidRequestEngine::Handle &handle : handleArray) {
+    handle.wait();
+  }
+}
+
+ZDvidSlicePrefetcher& ZDvidSlicePrefetcher::GetInstance()
+{
+  static ZDvidSlicePrefetcher prefetcher;
+
+  return prefetcher;
+}
+
+void ZDvidSlicePrefetcher::setRequestEngine(ZDvidRequestEngine *engine)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_engine = engine;
+}
+
+ZDvidRequestEngine& ZDvidSlicePrefetcher::getRequestEngine() const
+{
+  return (m_engine == NULL) ? ZDvidRequestEngine::GetInstance() : *m_engine;
+}
+
+void ZDvidSlicePrefetcher::setCacheSize(size_t byteNumber)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_cacheSize = byteNumber;
+  shrinkCacheUnsync();
+}
+
+size_t ZDvidSlicePrefetcher::getCacheSize() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_cacheSize;
+}
+
+size_t ZDvidSlicePrefetcher::getCacheUsage() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_cacheUsage;
+}
+
+void ZDvidSlicePrefetcher::setPrefetchCount(int count)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_prefetchCount = std::max(0, count);
+}
+
+int ZDvidSlicePrefetcher::getPrefetchCount() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_prefetchCount;
+}
+
+void ZDvidSlicePrefetcher::setEnabled(bool on)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_enabled = on;
+  }
+
+  if (!on) {
+    cancelAll();
+  }
+}
+
+bool ZDvidSlicePrefetcher::isEnabled() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_enabled;
+}
+
+ZDvidSlicePrefetcher::SliceData ZDvidSlicePrefetcher::get(const SliceKey &key)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto iter = m_cache.find(key);
+  if (iter != m_cache.end()) {
+    m_lruList.splice(m_lruList.begin(), m_lruList, iter->second.lruIter);
+    return iter->second.data;
+  }
+
+  return SliceData();
+}
+
+bool ZDvidSlicePrefetcher::contains(const SliceKey &key) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_cache.count(key) > 0;
+}
+
+void ZDvidSlicePrefetcher::put(const SliceKey &key, const SliceData &data)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  putUnsync(key, data);
+}
+
+void ZDvidSlicePrefetcher::putUnsync(const SliceKey &key, const SliceData &data)
+{
+  if (data.isEmpty()) {
+    return;
+  }
+
+  auto iter = m_cache.find(key);
+  if (iter != m_cache.end()) {
+    m_cacheUsage -= iter->second.data.getByteNumber();
+    m_lruList.erase(iter->second.lruIter);
+    m_cache.erase(iter);
+  }
+
+  size_t byteNumber = data.getByteNumber();
+  if (byteNumber <= m_cacheSize) {
+    m_lruList.push_front(key);
+    CacheEntry &entry = m_cache[key];
+    entry.data = data;
+    entry.lruIter = m_lruList.begin();
+    m_cacheUsage += byteNumber;
+    shrinkCacheUnsync();
+  }
+}
+
+void ZDvidSlicePrefetcher::shrinkCacheUnsync()
+{
+  while (m_cacheUsage > m_cacheSize && !m_lruList.empty()) {
+    auto iter = m_cache.find(m_lruList.back());
+    m_cacheUsage -= iter->second.data.getByteNumber();
+    m_cache.erase(iter);
+    m_lruList.pop_back();
+  }
+}
+
+void ZDvidSlicePrefetcher::clearCache()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_cache.clear();
+  m_lruList.clear();
+  m_cacheUsage = 0;
+}
+
+int ZDvidSlicePrefetcher::GetPrefetchCount(double speed, int maxCount)
+{
+  int count = int(std::ceil(speed * PREFETCH_LOOKAHEAD));
+
+  return std::min(maxCount, std::max(MIN_PREFETCH_COUNT, count));
+}
+
+void ZDvidSlicePrefetcher::notifyView(const SliceKey &key, const Loader &loader)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_enabled || !loader) {
+    return;
+  }
+
+  Clock::time_point now = Clock::now();
+
+  auto stateIter = m_scrollState.find(key.source);
+  if (stateIter == m_scrollState.end() ||
+      !stateIter->second.key.isSameView(key)) {
+    //A new view restarts tracking
+    cancelPending(key.source, std::set<int>());
+    ScrollState &state = m_scrollState[key.source];
+    state.key = key;
+    state.time = now;
+    state.speed = 0.0;
+    return;
+  }
+
+  ScrollState &state = stateIter->second;
+  int dz = key.z - state.key.z;
+  if (dz == 0) {
+    return;
+  }
+
+  double dt = std::max(
+        0.001, std::chrono::duration<double>(now - state.time).count());
+  double speed = std::abs(dz) / dt;
+  state.speed = (state.speed > 0.0) ? (state.speed + speed) * 0.5 : speed;
+  state.key = key;
+  state.time = now;
+
+  int count = GetPrefetchCount(state.speed, m_prefetchCount);
+  int step = dz;
+
+  std::set<int> keptZ;
+  for (int i = 1; i <= count; ++i) {
+    keptZ.insert(key.z + step * i);
+  }
+  cancelPending(key.source, keptZ);
+
+  auto runningIter = m_running.find(key.source);
+  std::deque<Job> queue;
+  for (int i = 1; i <= count; ++i) {
+    Job job;
+    job.key = key;
+    job.key.z = key.z + step * i;
+    if (m_cache.count(job.key) == 0 &&
+        !(runningIter != m_running.end() && !runningIter->second.canceled &&
+          runningIter->second.key == job.key)) {
+      job.loader = loader;
+      job.generation = m_generation[key.source];
+      queue.push_back(job);
+    }
+  }
+
+  if (queue.empty()) {
+    m_queue.erase(key.source);
+  } else {
+    m_queue[key.source].swap(queue);
+    submitNext(key.source);
+  }
+}
+
+void ZDvidSlicePrefetcher::submitNext(const std::string &source)
+{
+  auto runningIter = m_running.find(source);
+  if (runningIter != m_running.end()) {
+    //A running job is done only if the engine canceled it before it started
+    if (!runningIter->second.handle.isDone()) {
+      return;
+    }
+    m_running.erase(runningIter);
+  }
+
+  auto queueIter = m_queue.find(source);
+  if (queueIter == m_queue.end()) {
+    return;
+  }
+
+  std::deque<Job> &queue = queueIter->second;
+  while (!queue.empty() && m_cache.count(queue.front().key) > 0) {
+    queue.pop_front();
+  }
+
+  if (!queue.empty()) {
+    Job job = queue.front();
+    queue.pop_front();
+
+    uint64_t id = ++m_sequence;
+
+    ZDvidRequestEngine::Request request;
+    //The source starts with the server address, which decides the connection
+    //slot the slice takes
+    request.url = QString::fromStdString("http://" + source);
+    request.priority = PREFETCH_PRIORITY;
+    //The job reports back by itself because a canceled request has no
+    //callback, and the source must stay busy until its loader returns.
+    request.job = [this, job, id]() {
+      SliceData data;
+      try {
+        data = job.loader(job.key);
+      } catch (...) {
+        data = SliceData();
+      }
+      finishJob(job, id, data);
+
+      ZDvidRequestEngine::Result result;
+      if (data.isEmpty()) {
+        result.status = neutube::EReadStatus::FAILED;
+      } else {
+        result.status = neutube::EReadStatus::OK;
+        result.statusCode = 200;
+      }
+
+      return result;
+    };
+
+    ZDvidRequestEngine::Handle handle = getRequestEngine().submit(request);
+
+    //The job cannot finish while the lock is held, so a done handle means
+    //that the engine has refused the request.
+    if (!handle.isDone()) {
+      RunningJob &running = m_running[source];
+      running.key = job.key;
+      running.id = id;
+      running.handle = handle;
+    }
+  }
+
+  if (queue.empty()) {
+    m_queue.erase(queueIter);
+  }
+}
+
+void ZDvidSlicePrefetcher::finishJob(
+    const Job &job, uint64_t id, const SliceData &data)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto iter = m_running.find(job.key.source);
+  if (iter != m_running.end() && iter->second.id == id) {
+    bool canceled = iter->second.canceled;
+    m_running.erase(iter);
+    if (!canceled && job.generation == m_generation[job.key.source]) {
+      putUnsync(job.key, data);
+    }
+    submitNext(job.key.source);
+  }
+
+  m_idleCondition.notify_all();
+}
+
+void ZDvidSlicePrefetcher::cancelPending(
+    const std::string &source, const std::set<int> &keptZ)
+{
+  auto queueIter = m_queue.find(source);
+  if (queueIter != m_queue.end()) {
+    std::deque<Job> &queue = queueIter->second;
+    queue.erase(std::remove_if(queue.begin(), queue.end(), [&](const Job &job) {
+      return keptZ.count(job.key.z) == 0; }), queue.end());
+    if (queue.empty()) {
+      m_queue.erase(queueIter);
+    }
+  }
+
+  auto runningIter = m_running.find(source);
+  if (runningIter != m_running.end() &&
+      keptZ.count(runningIter->second.key.z) == 0) {
+    cancelRunning(source);
+  }
+}
+
+void ZDvidSlicePrefetcher::cancelRunning(const std::string &source)
+{
+  auto iter = m_running.find(source);
+  if (iter != m_running.end()) {
+    iter->second.handle.cancel();
+    //A job that has started keeps the source busy until its loader returns
+    if (iter->second.handle.isDone()) {
+      m_running.erase(iter);
+    } else {
+      iter->second.canceled = true;
+    }
+  }
+}
+
+void ZDvidSlicePrefetcher::cancel(const std::string &source)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  cancelPending(source, std::set<int>());
+  m_scrollState.erase(source);
+  m_idleCondition.notify_all();
+}
+
+void ZDvidSlicePrefetcher::cancelAll()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_queue.clear();
+  std::vector<std::string> sourceArray;
+  for (const auto &entry : m_running) {
+    sourceArray.push_back(entry.first);
+  }
+  for (const std::string &source : sourceArray) {
+    cancelRunning(source);
+  }
+  m_scrollState.clear();
+  m_idleCondition.notify_all();
+}
+
+void ZDvidSlicePrefetcher::invalidate(const std::string &source)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  cancelPending(source, std::set<int>());
+  ++m_generation[source];
+
+  for (auto iter = m_lruList.begin(); iter != m_lruList.end();) {
+    if (iter->source == source) {
+      auto entryIter = m_cache.find(*iter);
+      m_cacheUsage -= entryIter->second.data.getByteNumber();
+      m_cache.erase(entryIter);
+      iter = m_lruList.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+  m_idleCondition.notify_all();
+}
+
+size_t ZDvidSlicePrefetcher::getPendingNumber() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  size_t count = m_running.size();
+  for (const auto &entry : m_queue) {
+    count += entry.second.size();
+  }
+
+  return count;
+}
+
+bool ZDvidSlicePrefetcher::waitForIdle(int msec) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_idleCondition.wait_for(
+        lock, std::chrono::milliseconds(msec), [this]() {
+    return m_queue.empty() && m_running.empty(); });
+}
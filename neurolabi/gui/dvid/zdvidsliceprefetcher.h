@@ -0,0 +1,217 @@
+#ifndef ZDVIDSLICEPREFETCHER_H
+#define ZDVIDSLICEPREFETCHER_H
+
+#include <string>
+#include <map>
+#include <set>
+#include <list>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+
+#include "dvid/zdvidrequestengine.h"
+
+class ZStack;
+class ZArray;
+
+/*!
+ * \brief The class of prefetching DVID slices ahead of z-scrolling
+ *
+ * Each slice layer reports the slice it is showing by notifyView(). When the
+ * z position keeps moving in one direction with the same viewport and zoom,
+ * the next slices in that direction are loaded in the background and kept in
+ * a cache bounded by getCacheSize() bytes, which is shared by all layers. The
+ * number of slices to load grows with the scroll speed up to
+ * getPrefetchCount().
+ *
+ * Slices are loaded through ZDvidRequestEngine with PREFETCH_PRIORITY, so
+ * that they never delay requests of what is being shown. Each layer has at
+ * most one slice in flight because its loader is not expected to be thread
+ * safe. The nearest slices are loaded first, and the slices that fall out of
+ * the prefetch range of a layer are canceled when the layer moves. A canceled
+ * slice that is already loading is discarded when it is done.
+ */
+class ZDvidSlicePrefetcher
+{
+public:
+  ZDvidSlicePrefetcher();
+  ~ZDvidSlicePrefetcher();
+
+  /*!
+   * \brief The prefetcher shared by all slice layers.
+   */
+  static ZDvidSlicePrefetcher& GetInstance();
+
+  struct SliceKey {
+    std::string source; //Data source, such as a DVID data instance
+    int x0 = 0;
+    int y0 = 0;
+    int width = 0;
+    int height = 0;
+    int z = 0;
+    int zoom = 0;
+    int centerCutX = 0;
+    int centerCutY = 0;
+    bool centerCut = false;
+
+    bool operator< (const SliceKey &key) const;
+    bool operator== (const SliceKey &key) const;
+
+    /*!
+     * \brief Test if two keys differ only in z.
+     */
+    bool isSameView(const SliceKey &key) const;
+  };
+
+  /*!
+   * \brief Slice data of either grayscale or labels.
+   */
+  struct SliceData {
+    std::shared_ptr<ZStack> stack;
+    std::shared_ptr<ZArray> array;
+
+    bool isEmpty() const;
+    size_t getByteNumber() const;
+  };
+
+  /*!
+   * \brief The function of loading a slice, which is called in a worker
+   * thread of the request engine.
+   */
+  typedef std::function<SliceData(const SliceKey&)> Loader;
+
+  const static size_t DEFAULT_CACHE_SIZE;
+  const static int DEFAULT_PREFETCH_COUNT;
+  const static int PREFETCH_PRIORITY;
+
+  /*!
+   * \brief Set the engine of running the loaders.
+   *
+   * The shared engine is used if \a engine is NULL. It should be set before
+   * any slice is prefetched.
+   */
+  void setRequestEngine(ZDvidRequestEngine *engine);
+
+  void setCacheSize(size_t byteNumber);
+  size_t getCacheSize() const;
+  size_t getCacheUsage() const;
+
+  void setPrefetchCount(int count);
+  int getPrefetchCount() const;
+
+  void setEnabled(bool on);
+  bool isEnabled() const;
+
+  /*!
+   * \brief Get a slice from the cache.
+   *
+   * It returns empty data if the slice is not cached. The returned data are
+   * shared with the cache and must not be modified.
+   */
+  SliceData get(const SliceKey &key);
+  bool contains(const SliceKey &key) const;
+  void put(const SliceKey &key, const SliceData &data);
+  void clearCache();
+
+  /*!
+   * \brief Report the slice shown by a layer.
+   *
+   * It updates the scroll state of the source of \a key and schedules the
+   * slices ahead to be loaded by \a loader.
+   */
+  void notifyView(const SliceKey &key, const Loader &loader);
+
+  /*!
+   * \brief Cancel pending slices of \a source and reset its scroll state.
+   */
+  void cancel(const std::string &source);
+  void cancelAll();
+
+  /*!
+   * \brief Remove cached slices of \a source and cancel its pending slices.
+   *
+   * It is needed after the data of \a source are modified. A slice of
+   * \a source being loaded at the time is discarded when it is done.
+   */
+  void invalidate(const std::string &source);
+
+  /*!
+   * \brief Number of slices waiting to be submitted or in flight.
+   */
+  size_t getPendingNumber() const;
+
+  /*!
+   * \brief Wait until no slice is pending or loading.
+   *
+   * \return true iff the prefetcher becomes idle within \a msec milliseconds.
+   */
+  bool waitForIdle(int msec) const;
+
+  /*!
+   * \brief Number of prefetching slices for a scroll speed.
+   *
+   * \a speed is in slices per second.
+   */
+  static int GetPrefetchCount(double speed, int maxCount);
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Job {
+    SliceKey key;
+    Loader loader;
+    uint64_t generation = 0;
+  };
+
+  struct RunningJob {
+    SliceKey key;
+    uint64_t id = 0;
+    bool canceled = false;
+    ZDvidRequestEngine::Handle handle;
+  };
+
+  struct ScrollState {
+    SliceKey key;
+    Clock::time_point time;
+    double speed = 0.0; //slices per second
+  };
+
+  struct CacheEntry {
+    SliceData data;
+    std::list<SliceKey>::iterator lruIter;
+  };
+
+  ZDvidRequestEngine& getRequestEngine() const;
+  void cancelPending(const std::string &source, const std::set<int> &keptZ);
+  void cancelRunning(const std::string &source);
+  void submitNext(const std::string &source);
+  void finishJob(const Job &job, uint64_t id, const SliceData &data);
+  void putUnsync(const SliceKey &key, const SliceData &data);
+  void shrinkCacheUnsync();
+
+private:
+  mutable std::mutex m_mutex;
+  mutable std::condition_variable m_idleCondition;
+  bool m_enabled = true;
+  ZDvidRequestEngine *m_engine = NULL;
+
+  //Slices to load of each source, the nearest first
+  std::map<std::string, std::deque<Job>> m_queue;
+  std::map<std::string, RunningJob> m_running;
+  uint64_t m_sequence = 0;
+
+  std::map<std::string, ScrollState> m_scrollState;
+  std::map<std::string, uint64_t> m_generation; //Increased by invalidate()
+  int m_prefetchCount;
+
+  std::map<SliceKey, CacheEntry> m_cache;
+  std::list<SliceKey> m_lruList; //Most recently used first
+  size_t m_cacheSize;
+  size_t m_cacheUsage = 0;
+};
+
+#endif // ZDVIDSLICEPREFETCHER_H
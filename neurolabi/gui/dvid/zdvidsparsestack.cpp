@@ -100,6 +100,7 @@ void ZDvidSparseStack::initBlockGrid()
   if (reader.good()) {
     ZDvidInfo dvidInfo = reader.readGrayScaleInfo();
     ZStackBlockGrid *grid = new ZStackBlockGrid;
+    grid->setCompressing(true);
     m_sparseStack.setGreyScale(grid);
 //    grid->setMinPoint(dvidInfo.getStartCoordinates());
     grid->setBlockSize(dvidInfo.getBlockSize());
@@ -122,16 +123,13 @@ int ZDvidSparseStack::getValue(int x, int y, int z) const
   if (stackGrid != NULL) {
     ZStackBlockGrid::Location location = stackGrid->getLocation(x, y, z);
     const ZIntPoint& blockIndex = location.getBlockIndex();
-    if (stackGrid->getStack(blockIndex) == NULL) {
+    if (!stackGrid->hasBlock(blockIndex)) {
       ZIntCuboid box = stackGrid->getBlockBox(blockIndex);
       ZStack *stack = m_dvidReader.readGrayScale(box);
       stackGrid->consumeStack(blockIndex, stack);
     }
 
-    ZStack *blockStack = stackGrid->getStack(blockIndex);
-    v = blockStack->getIntValueLocal(location.getLocalPosition().getX(),
-                                     location.getLocalPosition().getY(),
-                                     location.getLocalPosition().getZ());
+    v = stackGrid->getValue(x, y, z);
   }
 
   return v;
@@ -146,6 +144,10 @@ void ZDvidSparseStack::display(
     ZPainter &painter, int slice, EDisplayStyle option, neutube::EAxis sliceAxis) const
 {
   if (loadingObjectMask()) {
+    if (displayLoadedPart(painter, slice, option, sliceAxis)) {
+      return;
+    }
+
     ZObject3dScan *obj = m_dvidReader.readBody(
           getLabel(), getLabelType(), painter.getZ(slice),
           neutube::EAxis::Z, true, NULL);
@@ -160,6 +162,26 @@ void ZDvidSparseStack::display(
   }
 }
 
+bool ZDvidSparseStack::displayLoadedPart(
+    ZPainter &painter, int slice, EDisplayStyle option,
+    neutube::EAxis sliceAxis) const
+{
+  //Parts are z partitions, so a part covers every voxel of a z slice in its
+  //range
+  if (sliceAxis == neutube::EAxis::Z) {
+    int z = painter.getZ(slice);
+    QMutexLocker locker(&m_loadedPartMutex);
+    for (const std::shared_ptr<ZObject3dScan> &part : m_loadedPartArray) {
+      if (z >= part->getMinZ() && z <= part->getMaxZ()) {
+        part->display(painter, slice, option, sliceAxis);
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
 void ZDvidSparseStack::setCancelFillValue(bool flag)
 {
   m_cancelingValueFill = flag;
@@ -246,10 +268,26 @@ void ZDvidSparseStack::loadBody(uint64_t bodyId, bool canonizing)
   std::cout << "Label type: " << labelType << std::endl;
 #endif
 
-  getMaskReader().readBody(bodyId, labelType, canonizing, obj);
+  {
+    QMutexLocker locker(&m_loadedPartMutex);
+    m_loadedPartArray.clear();
+  }
+
+  QColor color = getColor();
+  getMaskReader().readBodyStreaming(
+        bodyId, labelType, 0, canonizing, obj,
+        [&](const std::shared_ptr<ZObject3dScan> &part, int /*index*/,
+        int /*partNumber*/) {
+    part->setColor(color);
+    QMutexLocker locker(&m_loadedPartMutex);
+    m_loadedPartArray.push_back(part);
+  });
 
   m_sparseStack.setObjectMask(obj);
   setLabel(bodyId);
+
+  QMutexLocker locker(&m_loadedPartMutex);
+  m_loadedPartArray.clear();
 }
 
 void ZDvidSparseStack::setObjectMask(ZObject3dScan *obj)
@@ -424,7 +462,7 @@ bool ZDvidSparseStack::fillValue(
             }
 
             if (isValidBlock) {
-              if (grid->getStack(blockIndex) == NULL) {
+              if (!grid->hasBlock(blockIndex)) {
                 if (blockSpan.empty())  {
                   blockSpan.push_back(x);
                   blockSpan.push_back(x);
@@ -550,6 +588,7 @@ bool ZDvidSparseStack::fillValue(
 //      ZStackBlockGrid *grid = m_sparseStack.getStackGrid();
 
       ZStackBlockGrid *grid = new ZStackBlockGrid;
+      grid->setCompressing(true);
 
       size_t stripeNumber = blockObj.getStripeNumber();
       ZIntCuboid blockBox;
@@ -590,7 +629,7 @@ bool ZDvidSparseStack::fillValue(
             }
 
             if (isValidBlock) {
-              if (grid->getStack(blockIndex) == NULL) {
+              if (!grid->hasBlock(blockIndex)) {
                 if (blockSpan.empty())  {
                   blockSpan.push_back(x);
                   blockSpan.push_back(x);
@@ -709,7 +748,7 @@ bool ZDvidSparseStack::fillValue(bool cancelable)
             const ZIntPoint blockIndex =
                 ZIntPoint(x, y, z) - dvidInfo.getStartBlockIndex();
 
-            if (grid->getStack(blockIndex) == NULL) {
+            if (!grid->hasBlock(blockIndex)) {
               ZIntCuboid box = grid->getBlockBox(blockIndex);
               ZStack *stack = m_dvidReader.readGrayScale(box);
               grid->consumeStack(blockIndex, stack);
@@ -1,6 +1,7 @@
 #ifndef ZDVIDSPARSESTACK_H
 #define ZDVIDSPARSESTACK_H
 
+#include <memory>
 #include <QMutex>
 #include <QMap>
 
@@ -9,6 +10,7 @@
 #include "zdvidtarget.h"
 #include "dvid/zdvidreader.h"
 #include "zthreadfuturemap.h"
+#include "zobject3dscan.h"
 
 class ZIntCuboid;
 
@@ -148,6 +150,8 @@ private:
   void pushMaskColor();
   void pushLabel();
   bool loadingObjectMask() const;
+  bool displayLoadedPart(ZPainter &painter, int slice, EDisplayStyle option,
+                         neutube::EAxis sliceAxis) const;
   void finishObjectMaskLoading();
   void syncObjectMask();
   void pushAttribute();
@@ -180,6 +184,10 @@ private:
   bool m_cancelingValueFill;
 
   mutable QMutex m_fillValueMutex;
+
+  //Parts of the mask arrived while it is being loaded
+  mutable QMutex m_loadedPartMutex;
+  std::vector<std::shared_ptr<ZObject3dScan>> m_loadedPartArray;
 };
 
 #endif // ZDVIDSPARSESTACK_H
@@ -7,6 +7,7 @@
 
 
 #include "zdvidurl.h"
+#include "zdvidsynapsestore.h"
 #include "zpainter.h"
 #include "tz_math.h"
 #include "dvid/zdvidwriter.h"
@@ -67,19 +68,17 @@ ZIntCuboid ZDvidSynapseEnsemble::updateUnsync(const ZIntCuboid &box)
   }
 
   if (!dataBox.isEmpty()) {
-    ZDvidUrl dvidUrl(m_dvidTarget);
     QElapsedTimer timer;
     timer.start();
-    ZJsonArray obj = m_reader.readJsonArray(dvidUrl.getSynapseUrl(dataBox));
+    ZDvidSynapseStore store;
+    m_reader.readSynapse(dataBox, &store);
     LINFO() << "Synapse reading time: " << timer.elapsed();
 
-    for (size_t i = 0; i < obj.size(); ++i) {
-      ZJsonObject synapseJson(obj.at(i), ZJsonValue::SET_INCREASE_REF_COUNT);
-      if (synapseJson.hasKey("Pos")) {
-        ZDvidSynapse synapse;
-        synapse.loadJsonObject(synapseJson, flyem::EDvidAnnotationLoadMode::NO_PARTNER);
-        addSynapseUnsync(synapse, DATA_LOCAL);
-      }
+    //Elements without a position are not in the store
+    for (size_t i = 0; i < store.size(); ++i) {
+      ZDvidSynapse synapse;
+      synapse.loadStore(store, i, flyem::EDvidAnnotationLoadMode::NO_PARTNER);
+      addSynapseUnsync(synapse, DATA_LOCAL);
     }
   }
 
@@ -327,13 +326,13 @@ bool ZDvidSynapseEnsemble::isReady() const
 
 void ZDvidSynapseEnsemble::downloadForLabelUnsync(uint64_t label)
 {
-  ZDvidUrl dvidUrl(m_dvidTarget);
-  ZJsonArray obj = m_reader.readJsonArray(dvidUrl.getSynapseUrl(label, false));
+  ZDvidSynapseStore store;
+  m_reader.readSynapse(label, false, &store);
 
-  for (size_t i = 0; i < obj.size(); ++i) {
-    ZJsonObject synapseJson(obj.at(i), ZJsonValue::SET_INCREASE_REF_COUNT);
+  for (size_t i = 0; i < store.size(); ++i) {
     ZDvidSynapse synapse;
-    synapse.loadJsonObject(synapseJson, flyem::EDvidAnnotationLoadMode::PARTNER_LOCATION);
+    synapse.loadStore(
+          store, i, flyem::EDvidAnnotationLoadMode::PARTNER_LOCATION);
     if (synapse.isValid()) {
       addSynapse(synapse, DATA_LOCAL);
     }
@@ -0,0 +1,799 @@
+#include "zdvidsynapsestore.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+const int ZDvidSynapseStore::NO_INDEX;
+
+namespace {
+
+const int MAX_JSON_DEPTH = 256;
+
+void AppendUtf8(std::string &str, uint32_t code)
+{
+  if (code < 0x80) {
+    str.push_back(char(code));
+  } else if (code < 0x800) {
+    str.push_back(char(0xC0 | (code >> 6)));
+    str.push_back(char(0x80 | (code & 0x3F)));
+  } else if (code < 0x10000) {
+    str.push_back(char(0xE0 | (code >> 12)));
+    str.push_back(char(0x80 | ((code >> 6) & 0x3F)));
+    str.push_back(char(0x80 | (code & 0x3F)));
+  } else {
+    str.push_back(char(0xF0 | (code >> 18)));
+    str.push_back(char(0x80 | ((code >> 12) & 0x3F)));
+    str.push_back(char(0x80 | ((code >> 6) & 0x3F)));
+    str.push_back(char(0x80 | (code & 0x3F)));
+  }
+}
+
+int HexValue(char c)
+{
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+
+  return -1;
+}
+
+}
+
+/*!
+ * \brief One-pass JSON decoder of DVID elements
+ *
+ * Every function returns false on a syntax error and leaves the cursor after
+ * the value it has consumed otherwise.
+ */
+class ZDvidSynapseStore::Decoder
+{
+public:
+  Decoder(const char *data, size_t length, ZDvidSynapseStore &store) :
+    m_cur(data), m_end(data + length), m_store(store) {
+  }
+
+  bool run();
+
+private:
+  void skipSpace();
+  bool peek(char c);
+  bool consume(char c);
+  bool consumeLiteral(const char *literal);
+  bool readString(std::string &str);
+  bool readNumber(double &v);
+  bool readNumber(double &v, std::string &text);
+  bool readPoint(ZIntPoint &pt);
+  bool skipValue(int depth);
+  bool readElement();
+  bool readTags();
+  bool readProp(float &confidence, uint32_t &user);
+  void addProperty(const std::string &key, const std::string &value,
+                   bool isNumber);
+  bool readRelations();
+
+  /*!
+   * \brief Iterate over an object and call \a handler with each key.
+   *
+   * The handler must consume the value.
+   */
+  template <typename Handler>
+  bool readObject(const Handler &handler);
+
+  template <typename Handler>
+  bool readArray(const Handler &handler);
+
+private:
+  const char *m_cur;
+  const char *m_end;
+  ZDvidSynapseStore &m_store;
+
+  //Buffers reused across elements
+  std::string m_key;
+  std::string m_value;
+  std::vector<uint32_t> m_tagBuffer;
+  std::vector<Property> m_propBuffer;
+  std::vector<Relation> m_relationBuffer;
+};
+
+void ZDvidSynapseStore::Decoder::skipSpace()
+{
+  while (m_cur < m_end &&
+         (*m_cur == ' ' || *m_cur == '\n' || *m_cur == '\r' || *m_cur == '\t')) {
+    ++m_cur;
+  }
+}
+
+bool ZDvidSynapseStore::Decoder::peek(char c)
+{
+  skipSpace();
+  return m_cur < m_end && *m_cur == c;
+}
+
+bool ZDvidSynapseStore::Decoder::consume(char c)
+{
+  if (peek(c)) {
+    ++m_cur;
+    return true;
+  }
+
+  return false;
+}
+
+bool ZDvidSynapseStore::Decoder::consumeLiteral(const char *literal)
+{
+  skipSpace();
+  size_t length = strlen(literal);
+  if (size_t(m_end - m_cur) >= length && strncmp(m_cur, literal, length) == 0) {
+    m_cur += length;
+    return true;
+  }
+
+  return false;
+}
+
+bool ZDvidSynapseStore::Decoder::readString(std::string &str)
+{
+  str.clear();
+  if (!consume('"')) {
+    return false;
+  }
+
+  while (m_cur < m_end) {
+    const char *start = m_cur;
+    while (m_cur < m_end && *m_cur != '"' && *m_cur != '\\') {
+      ++m_cur;
+    }
+    str.append(start, m_cur);
+
+    if (m_cur >= m_end) {
+      break;
+    }
+
+    if (*m_cur == '"') {
+      ++m_cur;
+      return true;
+    }
+
+    //Escape sequence
+    ++m_cur;
+    if (m_cur >= m_end) {
+      break;
+    }
+    char c = *m_cur++;
+    switch (c) {
+    case '"': case '\\': case '/':
+      str.push_back(c);
+      break;
+    case 'b':
+      str.push_back('\b');
+      break;
+    case 'f':
+      str.push_back('\f');
+      break;
+    case 'n':
+      str.push_back('\n');
+      break;
+    case 'r':
+      str.push_back('\r');
+      break;
+    case 't':
+      str.push_back('\t');
+      break;
+    case 'u':
+    {
+      uint32_t code = 0;
+      for (int pass = 0; pass < 2; ++pass) {
+        if (m_end - m_cur < 4) {
+          return false;
+        }
+        uint32_t unit = 0;
+        for (int i = 0; i < 4; ++i) {
+          int h = HexValue(m_cur[i]);
+          if (h < 0) {
+            return false;
+          }
+          unit = (unit << 4) | h;
+        }
+        m_cur += 4;
+
+        if (pass == 0) {
+          code = unit;
+          //High surrogate followed by a low surrogate
+          if (unit >= 0xD800 && unit < 0xDC00 && m_end - m_cur >= 6 &&
+              m_cur[0] == '\\' && m_cur[1] == 'u') {
+            m_cur += 2;
+          } else {
+            break;
+          }
+        } else {
+          if (unit >= 0xDC00 && unit < 0xE000) {
+            code = 0x10000 + ((code - 0xD800) << 10) + (unit - 0xDC00);
+          } else {
+            return false;
+          }
+        }
+      }
+      AppendUtf8(str, code);
+    }
+      break;
+    default:
+      return false;
+    }
+  }
+
+  return false;
+}
+
+bool ZDvidSynapseStore::Decoder::readNumber(double &v)
+{
+  skipSpace();
+
+  char buffer[64];
+  size_t length = 0;
+  while (m_cur + length < m_end && length < sizeof(buffer) - 1) {
+    char c = m_cur[length];
+    if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' ||
+        c == 'e' || c == 'E') {
+      buffer[length++] = c;
+    } else {
+      break;
+    }
+  }
+
+  if (length == 0) {
+    return false;
+  }
+  buffer[length] = '\0';
+
+  char *numberEnd = NULL;
+  v = strtod(buffer, &numberEnd);
+  if (numberEnd != buffer + length) {
+    return false;
+  }
+  m_cur += length;
+
+  return true;
+}
+
+bool ZDvidSynapseStore::Decoder::readNumber(double &v, std::string &text)
+{
+  skipSpace();
+  const char *start = m_cur;
+  if (!readNumber(v)) {
+    return false;
+  }
+  text.assign(start, m_cur);
+
+  return true;
+}
+
+template <typename Handler>
+bool ZDvidSynapseStore::Decoder::readObject(const Handler &handler)
+{
+  if (!consume('{')) {
+    return false;
+  }
+
+  if (consume('}')) {
+    return true;
+  }
+
+  do {
+    if (!readString(m_key) || !consume(':')) {
+      return false;
+    }
+    if (!handler(m_key)) {
+      return false;
+    }
+  } while (consume(','));
+
+  return consume('}');
+}
+
+template <typename Handler>
+bool ZDvidSynapseStore::Decoder::readArray(const Handler &handler)
+{
+  if (!consume('[')) {
+    return false;
+  }
+
+  if (consume(']')) {
+    return true;
+  }
+
+  do {
+    if (!handler()) {
+      return false;
+    }
+  } while (consume(','));
+
+  return consume(']');
+}
+
+bool ZDvidSynapseStore::Decoder::readPoint(ZIntPoint &pt)
+{
+  int index = 0;
+  int coords[3] = {0, 0, 0};
+  bool succ = readArray([&]() {
+    double v = 0.0;
+    if (!readNumber(v)) {
+      return false;
+    }
+    if (index < 3) {
+      coords[index] = int(v);
+    }
+    ++index;
+    return true;
+  });
+
+  if (succ && index == 3) {
+    pt.set(coords[0], coords[1], coords[2]);
+  } else {
+    pt.invalidate();
+  }
+
+  return succ;
+}
+
+bool ZDvidSynapseStore::Decoder::skipValue(int depth)
+{
+  if (depth > MAX_JSON_DEPTH) {
+    return false;
+  }
+
+  skipSpace();
+  if (m_cur >= m_end) {
+    return false;
+  }
+
+  switch (*m_cur) {
+  case '{':
+    return readObject([&](const std::string &/*key*/) {
+      return skipValue(depth + 1);
+    });
+  case '[':
+    return readArray([&]() { return skipValue(depth + 1); });
+  case '"':
+    return readString(m_value);
+  case 't':
+    return consumeLiteral("true");
+  case 'f':
+    return consumeLiteral("false");
+  case 'n':
+    return consumeLiteral("null");
+  default:
+    break;
+  }
+
+  double v = 0.0;
+
+  return readNumber(v);
+}
+
+bool ZDvidSynapseStore::Decoder::readTags()
+{
+  if (consumeLiteral("null")) {
+    return true;
+  }
+
+  return readArray([&]() {
+    if (peek('"')) {
+      if (!readString(m_value)) {
+        return false;
+      }
+      m_tagBuffer.push_back(m_store.intern(m_value));
+      return true;
+    }
+    return skipValue(1);
+  });
+}
+
+void ZDvidSynapseStore::Decoder::addProperty(
+    const std::string &key, const std::string &value, bool isNumber)
+{
+  Property prop;
+  prop.key = m_store.intern(key);
+  prop.value = m_store.intern(value);
+  prop.isNumber = isNumber;
+  m_propBuffer.push_back(prop);
+}
+
+bool ZDvidSynapseStore::Decoder::readProp(float &confidence, uint32_t &user)
+{
+  if (consumeLiteral("null")) {
+    return true;
+  }
+
+  bool hasConfidence = false;
+
+  return readObject([&](const std::string &key) {
+    double v = 0.0;
+    bool isNumber = false;
+    if (peek('"')) {
+      if (!readString(m_value)) {
+        return false;
+      }
+      v = std::atof(m_value.c_str());
+    } else if (peek('-') ||
+               (m_cur < m_end && *m_cur >= '0' && *m_cur <= '9')) {
+      if (!readNumber(v, m_value)) {
+        return false;
+      }
+      isNumber = true;
+    } else {
+      return skipValue(1);
+    }
+
+    addProperty(key, m_value, isNumber);
+
+    bool isConfidence = (key == "confidence");
+    //"confidence" takes precedence over "conf"
+    if (isConfidence || (key == "conf" && !hasConfidence)) {
+      confidence = float(v);
+      hasConfidence = hasConfidence || isConfidence;
+    } else if (key == "user" && !isNumber) {
+      user = m_store.intern(m_value);
+    }
+
+    return true;
+  });
+}
+
+bool ZDvidSynapseStore::Decoder::readRelations()
+{
+  if (consumeLiteral("null")) {
+    return true;
+  }
+
+  return readArray([&]() {
+    if (!peek('{')) {
+      return skipValue(1);
+    }
+
+    Relation relation;
+    bool succ = readObject([&](const std::string &key) {
+      if (key == "Rel" && peek('"')) {
+        if (!readString(m_value)) {
+          return false;
+        }
+        relation.type = GetRelation(m_value);
+        relation.name = m_store.intern(m_value);
+        return true;
+      } else if (key == "To" && peek('[')) {
+        return readPoint(relation.toPos);
+      }
+      return skipValue(1);
+    });
+
+    if (succ && relation.toPos.isValid()) {
+      m_relationBuffer.push_back(relation);
+    }
+
+    return succ;
+  });
+}
+
+bool ZDvidSynapseStore::Decoder::readElement()
+{
+  ZIntPoint pos;
+  pos.invalidate();
+  EKind kind = EKind::KIND_INVALID;
+  float confidence = 1.0f;
+  uint32_t user = 0;
+  m_tagBuffer.clear();
+  m_propBuffer.clear();
+  m_relationBuffer.clear();
+  size_t stringNumber = m_store.getStringNumber();
+
+  bool succ = readObject([&](const std::string &key) {
+    if (key == "Pos" && peek('[')) {
+      return readPoint(pos);
+    } else if (key == "Kind" && peek('"')) {
+      if (!readString(m_value)) {
+        return false;
+      }
+      kind = GetKind(m_value);
+      return true;
+    } else if (key == "Tags") {
+      return readTags();
+    } else if (key == "Prop") {
+      return readProp(confidence, user);
+    } else if (key == "Rels") {
+      return readRelations();
+    }
+
+    return skipValue(1);
+  });
+
+  if (succ && pos.isValid()) {
+    uint32_t index = m_store.size();
+    m_store.m_xArray.push_back(pos.getX());
+    m_store.m_yArray.push_back(pos.getY());
+    m_store.m_zArray.push_back(pos.getZ());
+    m_store.m_kindArray.push_back(kind);
+    m_store.m_confidenceArray.push_back(confidence);
+    m_store.m_userArray.push_back(user);
+    m_store.m_tagArray.insert(m_store.m_tagArray.end(),
+                              m_tagBuffer.begin(), m_tagBuffer.end());
+    m_store.m_tagOffset.push_back(m_store.m_tagArray.size());
+    m_store.m_propArray.insert(m_store.m_propArray.end(),
+                               m_propBuffer.begin(), m_propBuffer.end());
+    m_store.m_propOffset.push_back(m_store.m_propArray.size());
+    for (Relation &relation : m_relationBuffer) {
+      relation.from = index;
+      m_store.m_relationArray.push_back(relation);
+    }
+  } else {
+    //Strings only used by an ignored element are dropped
+    m_store.truncateString(stringNumber);
+  }
+
+  return succ;
+}
+
+bool ZDvidSynapseStore::Decoder::run()
+{
+  skipSpace();
+  if (m_cur >= m_end || *m_cur == '\0') {
+    return true;
+  }
+
+  bool succ = false;
+  if (consumeLiteral("null")) {
+    succ = true;
+  } else {
+    succ = readArray([&]() {
+      if (peek('{')) {
+        return readElement();
+      }
+      return skipValue(1);
+    });
+  }
+
+  //Trailing characters are not allowed except a terminating zero
+  skipSpace();
+
+  return succ && (m_cur == m_end || *m_cur == '\0');
+}
+
+///////////////////////////////////////
+
+ZDvidSynapseStore::ZDvidSynapseStore()
+{
+  clear();
+}
+
+size_t ZDvidSynapseStore::PointHash::operator() (const ZIntPoint &pt) const
+{
+  size_t h = std::hash<int>()(pt.getX());
+  h = h * 1000003 ^ std::hash<int>()(pt.getY());
+  h = h * 1000003 ^ std::hash<int>()(pt.getZ());
+
+  return h;
+}
+
+void ZDvidSynapseStore::clear()
+{
+  m_xArray.clear();
+  m_yArray.clear();
+  m_zArray.clear();
+  m_kindArray.clear();
+  m_confidenceArray.clear();
+  m_userArray.clear();
+  m_tagOffset.assign(1, 0);
+  m_tagArray.clear();
+  m_propOffset.assign(1, 0);
+  m_propArray.clear();
+  m_relationArray.clear();
+  m_stringArray.assign(1, std::string());
+  m_stringMap.clear();
+  m_stringMap[std::string()] = 0;
+  m_indexMap.clear();
+}
+
+uint32_t ZDvidSynapseStore::intern(const std::string &str)
+{
+  auto iter = m_stringMap.find(str);
+  if (iter != m_stringMap.end()) {
+    return iter->second;
+  }
+
+  uint32_t index = m_stringArray.size();
+  m_stringArray.push_back(str);
+  m_stringMap[str] = index;
+
+  return index;
+}
+
+void ZDvidSynapseStore::truncateString(size_t n)
+{
+  for (size_t i = n; i < m_stringArray.size(); ++i) {
+    m_stringMap.erase(m_stringArray[i]);
+  }
+  m_stringArray.resize(n);
+}
+
+bool ZDvidSynapseStore::decode(const char *data, size_t length)
+{
+  if (data == NULL) {
+    return length == 0;
+  }
+
+  size_t oldSize = size();
+  size_t oldTagNumber = m_tagArray.size();
+  size_t oldPropNumber = m_propArray.size();
+  size_t oldRelationNumber = m_relationArray.size();
+  size_t oldStringNumber = m_stringArray.size();
+
+  Decoder decoder(data, length, *this);
+  if (!decoder.run()) {
+    //Roll back
+    m_xArray.resize(oldSize);
+    m_yArray.resize(oldSize);
+    m_zArray.resize(oldSize);
+    m_kindArray.resize(oldSize);
+    m_confidenceArray.resize(oldSize);
+    m_userArray.resize(oldSize);
+    m_tagOffset.resize(oldSize + 1);
+    m_tagArray.resize(oldTagNumber);
+    m_propOffset.resize(oldSize + 1);
+    m_propArray.resize(oldPropNumber);
+    m_relationArray.resize(oldRelationNumber);
+    truncateString(oldStringNumber);
+
+    return false;
+  }
+
+  resolveRelation(oldSize, oldRelationNumber);
+
+  return true;
+}
+
+void ZDvidSynapseStore::resolveRelation(
+    size_t startIndex, size_t startRelation)
+{
+  for (size_t i = startIndex; i < size(); ++i) {
+    m_indexMap.emplace(getPosition(i), uint32_t(i)); //The first one wins
+  }
+
+  //Old relations only need to be checked if there are new elements
+  size_t first = (startIndex < size()) ? 0 : startRelation;
+  for (size_t i = first; i < m_relationArray.size(); ++i) {
+    Relation &relation = m_relationArray[i];
+    if (relation.to == NO_INDEX) {
+      relation.to = findIndex(relation.toPos);
+    }
+  }
+}
+
+ZIntPoint ZDvidSynapseStore::getPosition(size_t index) const
+{
+  return ZIntPoint(m_xArray[index], m_yArray[index], m_zArray[index]);
+}
+
+const std::string& ZDvidSynapseStore::getUser(size_t index) const
+{
+  return m_stringArray[m_userArray[index]];
+}
+
+size_t ZDvidSynapseStore::getTagNumber(size_t index) const
+{
+  return m_tagOffset[index + 1] - m_tagOffset[index];
+}
+
+const std::string& ZDvidSynapseStore::getTag(
+    size_t index, size_t tagIndex) const
+{
+  return m_stringArray[m_tagArray[m_tagOffset[index] + tagIndex]];
+}
+
+bool ZDvidSynapseStore::hasTag(size_t index, const std::string &tag) const
+{
+  auto iter = m_stringMap.find(tag);
+  if (iter == m_stringMap.end()) {
+    return false;
+  }
+
+  return std::find(m_tagArray.begin() + m_tagOffset[index],
+                   m_tagArray.begin() + m_tagOffset[index + 1],
+                   iter->second) != m_tagArray.begin() + m_tagOffset[index + 1];
+}
+
+size_t ZDvidSynapseStore::getPropertyNumber(size_t index) const
+{
+  return m_propOffset[index + 1] - m_propOffset[index];
+}
+
+const ZDvidSynapseStore::Property& ZDvidSynapseStore::getProperty(
+    size_t index, size_t propIndex) const
+{
+  return m_propArray[m_propOffset[index] + propIndex];
+}
+
+const std::string& ZDvidSynapseStore::getRelationName(
+    size_t relationIndex) const
+{
+  return m_stringArray[m_relationArray[relationIndex].name];
+}
+
+int ZDvidSynapseStore::findIndex(const ZIntPoint &pos) const
+{
+  auto iter = m_indexMap.find(pos);
+  if (iter != m_indexMap.end()) {
+    return int(iter->second);
+  }
+
+  return NO_INDEX;
+}
+
+size_t ZDvidSynapseStore::countKind(EKind kind) const
+{
+  return std::count(m_kindArray.begin(), m_kindArray.end(), kind);
+}
+
+std::vector<size_t> ZDvidSynapseStore::getRelationIndex(size_t index) const
+{
+  //Relations are stored in the order of their elements
+  auto iter = std::lower_bound(
+        m_relationArray.begin(), m_relationArray.end(), uint32_t(index),
+        [](const Relation &relation, uint32_t from) {
+    return relation.from < from;
+  });
+
+  std::vector<size_t> indexArray;
+  for (; iter != m_relationArray.end() && iter->from == index; ++iter) {
+    indexArray.push_back(iter - m_relationArray.begin());
+  }
+
+  return indexArray;
+}
+
+size_t ZDvidSynapseStore::getByteNumber() const
+{
+  size_t byteNumber = size() * (sizeof(int) * 3 + sizeof(EKind) +
+                                sizeof(float) + sizeof(uint32_t) * 2);
+  byteNumber += m_tagArray.size() * sizeof(uint32_t);
+  byteNumber += size() * sizeof(uint32_t) + m_propArray.size() * sizeof(Property);
+  byteNumber += m_relationArray.size() * sizeof(Relation);
+  for (const std::string &str : m_stringArray) {
+    byteNumber += sizeof(std::string) + str.capacity();
+  }
+
+  return byteNumber;
+}
+
+ZDvidSynapseStore::EKind ZDvidSynapseStore::GetKind(const std::string &name)
+{
+  if (name == "PostSyn") {
+    return EKind::KIND_POST_SYN;
+  } else if (name == "PreSyn") {
+    return EKind::KIND_PRE_SYN;
+  } else if (name == "Note") {
+    return EKind::KIND_NOTE;
+  } else if (name == "Unknown") {
+    return EKind::KIND_UNKNOWN;
+  }
+
+  return EKind::KIND_INVALID;
+}
+
+ZDvidSynapseStore::ERelation ZDvidSynapseStore::GetRelation(
+    const std::string &name)
+{
+  if (name == "PostSynTo") {
+    return ERelation::RELATION_POSTSYN_TO;
+  } else if (name == "PreSynTo") {
+    return ERelation::RELATION_PRESYN_TO;
+  } else if (name == "ConvergentTo") {
+    return ERelation::RELATION_CONVERGENT_TO;
+  } else if (name == "GroupedWith") {
+    return ERelation::RELATION_GROUPED_WITH;
+  }
+
+  return ERelation::RELATION_UNKNOWN;
+}
@@ -0,0 +1,182 @@
+#ifndef ZDVIDSYNAPSESTORE_H
+#define ZDVIDSYNAPSESTORE_H
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+#include "zintpoint.h"
+
+/*!
+ * \brief The class of compact columnar synapse storage
+ *
+ * The store keeps the synapse elements returned by DVID in parallel arrays
+ * instead of one annotation object per synapse. Users and tags are interned in
+ * a string table shared by all elements, and relations are kept as pairs of
+ * element indices.
+ *
+ * decode() parses a DVID elements response (a JSON array of annotations) in
+ * one pass without building a JSON tree. String and number properties are
+ * kept as interned key-value pairs, and the confidence and the user are also
+ * kept in their own arrays for fast access. Other property values are
+ * skipped.
+ *
+ * ZDvidAnnotation::loadStore() makes an annotation object of an element, so
+ * a caller that needs annotation objects can build them only for the
+ * elements it keeps.
+ */
+class ZDvidSynapseStore
+{
+public:
+  ZDvidSynapseStore();
+
+  /*!
+   * \brief Element kind, in the same order as ZDvidAnnotation::EKind.
+   */
+  enum class EKind : uint8_t {
+    KIND_POST_SYN, KIND_PRE_SYN, KIND_NOTE, KIND_UNKNOWN, KIND_INVALID
+  };
+
+  /*!
+   * \brief Relation type, in the same order as
+   * ZDvidAnnotation::Relation::ERelation.
+   */
+  enum class ERelation : uint8_t {
+    RELATION_UNKNOWN, RELATION_POSTSYN_TO, RELATION_PRESYN_TO,
+    RELATION_CONVERGENT_TO, RELATION_GROUPED_WITH
+  };
+
+  const static int NO_INDEX = -1;
+
+  struct Relation {
+    uint32_t from = 0; //Index of the element that has the relation
+    int to = NO_INDEX; //Index of the partner, or NO_INDEX if not in the store
+    ERelation type = ERelation::RELATION_UNKNOWN;
+    uint32_t name = 0; //Index of the relation name in the string table
+    ZIntPoint toPos; //Partner position
+  };
+
+  struct Property {
+    uint32_t key = 0; //Index of the key in the string table
+    uint32_t value = 0; //Index of the value text in the string table
+    bool isNumber = false; //The value text is a JSON number
+  };
+
+  void clear();
+  size_t size() const { return m_kindArray.size(); }
+  bool isEmpty() const { return m_kindArray.empty(); }
+
+  /*!
+   * \brief Decode a DVID elements response and append the elements.
+   *
+   * Elements without a position are ignored. Relations of the new elements are
+   * resolved against all elements in the store, and so are the relations
+   * pointing to them from existing elements.
+   *
+   * \return false if the data is not a valid JSON array of elements, in which
+   *         case the store is left unchanged. An empty buffer or "null" is
+   *         taken as an empty array.
+   */
+  bool decode(const char *data, size_t length);
+
+  ZIntPoint getPosition(size_t index) const;
+  int getX(size_t index) const { return m_xArray[index]; }
+  int getY(size_t index) const { return m_yArray[index]; }
+  int getZ(size_t index) const { return m_zArray[index]; }
+  EKind getKind(size_t index) const { return m_kindArray[index]; }
+
+  /*!
+   * \brief Confidence of an element, which is 1.0 if it is not specified.
+   */
+  double getConfidence(size_t index) const { return m_confidenceArray[index]; }
+
+  /*!
+   * \brief User of an element, or an empty string if there is no user.
+   */
+  const std::string& getUser(size_t index) const;
+
+  size_t getTagNumber(size_t index) const;
+  const std::string& getTag(size_t index, size_t tagIndex) const;
+  bool hasTag(size_t index, const std::string &tag) const;
+
+  size_t getPropertyNumber(size_t index) const;
+  const Property& getProperty(size_t index, size_t propIndex) const;
+
+  /*!
+   * \brief Index of the element at a position.
+   *
+   * \return NO_INDEX if no element is at \a pos.
+   */
+  int findIndex(const ZIntPoint &pos) const;
+
+  size_t countKind(EKind kind) const;
+
+  const std::vector<Relation>& getRelationArray() const {
+    return m_relationArray;
+  }
+
+  /*!
+   * \brief Indices of the relations of an element in getRelationArray().
+   */
+  std::vector<size_t> getRelationIndex(size_t index) const;
+
+  /*!
+   * \brief Name of a relation as it is in the decoded data.
+   */
+  const std::string& getRelationName(size_t relationIndex) const;
+
+  /*!
+   * \brief String of an index in the string table.
+   */
+  const std::string& getString(uint32_t stringIndex) const {
+    return m_stringArray[stringIndex];
+  }
+
+  size_t getStringNumber() const { return m_stringArray.size(); }
+
+  /*!
+   * \brief Approximate memory used by the store in bytes.
+   */
+  size_t getByteNumber() const;
+
+  static EKind GetKind(const std::string &name);
+  static ERelation GetRelation(const std::string &name);
+
+private:
+  struct PointHash {
+    size_t operator() (const ZIntPoint &pt) const;
+  };
+
+  class Decoder;
+  friend class Decoder;
+
+  uint32_t intern(const std::string &str);
+  void truncateString(size_t n);
+  void resolveRelation(size_t startIndex, size_t startRelation);
+
+private:
+  std::vector<int> m_xArray;
+  std::vector<int> m_yArray;
+  std::vector<int> m_zArray;
+  std::vector<EKind> m_kindArray;
+  std::vector<float> m_confidenceArray;
+  std::vector<uint32_t> m_userArray; //Index into m_stringArray, 0 for no user
+
+  //Tags of element i are m_tagArray[m_tagOffset[i] .. m_tagOffset[i+1])
+  std::vector<uint32_t> m_tagOffset;
+  std::vector<uint32_t> m_tagArray;
+
+  //Properties of element i are m_propArray[m_propOffset[i] .. m_propOffset[i+1])
+  std::vector<uint32_t> m_propOffset;
+  std::vector<Property> m_propArray;
+
+  std::vector<Relation> m_relationArray;
+
+  std::vector<std::string> m_stringArray; //The first one is always empty
+  std::unordered_map<std::string, uint32_t> m_stringMap;
+  std::unordered_map<ZIntPoint, uint32_t, PointHash> m_indexMap;
+};
+
+#endif // ZDVIDSYNAPSESTORE_H
@@ -15,10 +15,66 @@
 #include "zdvidurl.h"
 #include "zdvidtileinfo.h"
 #include "zdvidreader.h"
+#include "zdvidmetrics.h"
 //#include "zstackview.h"
 #include "zrect2d.h"
 #include "libdvidheader.h"
 
+namespace {
+
+/*!
+ * Make the 8-bit form of a grayscale tile image. It returns an empty pointer
+ * if the image is not grayscale.
+ */
+ZDvidTileCache::ImagePtr MakeCacheImage(const QImage &image)
+{
+  std::vector<uint8_t> valueMap;
+  if (image.format() == QImage::Format_Indexed8) {
+    QVector<QRgb> colorTable = image.colorTable();
+    valueMap.resize(256, 0);
+    for (int i = 0; i < colorTable.size() && i < 256; ++i) {
+      QRgb color = colorTable[i];
+      if (qRed(color) != qGreen(color) || qRed(color) != qBlue(color)) {
+        return ZDvidTileCache::ImagePtr();
+      }
+      valueMap[i] = qRed(color);
+    }
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+  } else if (image.format() != QImage::Format_Grayscale8) {
+    return ZDvidTileCache::ImagePtr();
+#else
+  } else {
+    return ZDvidTileCache::ImagePtr();
+#endif
+  }
+
+  if (image.isNull()) {
+    return ZDvidTileCache::ImagePtr();
+  }
+
+  std::shared_ptr<ZDvidTileCache::Image> cacheImage =
+      std::make_shared<ZDvidTileCache::Image>();
+  cacheImage->width = image.width();
+  cacheImage->height = image.height();
+  cacheImage->data.resize(size_t(image.width()) * image.height());
+  uint8_t *data = cacheImage->data.data();
+  for (int j = 0; j < image.height(); ++j) {
+    const uchar *line = image.constScanLine(j);
+    if (valueMap.empty()) {
+      memcpy(data, line, image.width());
+    } else {
+      for (int i = 0; i < image.width(); ++i) {
+        data[i] = valueMap[line[i]];
+      }
+    }
+    data += image.width();
+  }
+
+  return cacheImage;
+}
+
+}
+
 ZDvidTile::ZDvidTile() : m_ix(0), m_iy(0), m_z(0)
 {
   setTarget(ZStackObject::TARGET_OBJECT_CANVAS);
@@ -43,6 +99,7 @@ void ZDvidTile::clear()
   m_dvidTarget.clear();
   delete m_image;
   m_image = NULL;
+  m_decodedImage.reset();
 
 //  delete m_pixmap;
 //  m_pixmap = NULL;
@@ -51,55 +108,86 @@ void ZDvidTile::clear()
 void ZDvidTile::loadDvidSlice(
     const uchar *buf, int length, int z, bool highContrast)
 {
-  bool loading = true;
-
-  bool modified = false;
-  if (loading) {
-    if (m_image == NULL) {
-      m_image = new ZImage;
-    }
+  if (m_image == NULL) {
+    m_image = new ZImage;
+  }
 
 #ifdef _DEBUG_2
-    std::cout << "Decoding tile ..." << std::endl;
+  std::cout << "Decoding tile ..." << std::endl;
 #endif
-    if (!m_image->loadFromData(buf, length)) {
-      LWARN() << "Failed to decode tile data";
-    }
-    m_image->setScale(1.0 / m_res.getScale(), 1.0 / m_res.getScale());
-    m_image->setOffset(-getX(), -getY());
-
-    modified = true;
+  ZDvidMetrics::Timer timer;
+  bool decoded = m_image->loadFromData(buf, length);
+  ZDvidMetrics::GetInstance().recordDecode(
+        ZDvidMetrics::EEndpoint::TILE, timer.elapsed());
+
+  if (decoded) {
+    //Taken before contrast enhancement, which may change the pixels
+    m_decodedImage = MakeCacheImage(*m_image);
+  } else {
+    LWARN() << "Failed to decode tile data";
+    m_decodedImage.reset();
+  }
 
-//    m_image->enhanceContrast(
-//          hasVisualEffect(NeuTube::Display::Image::VE_HIGH_CONTRAST));
+  finishLoading(z, highContrast);
+}
 
-#ifdef _DEBUG_2
-    std::cout << "Format: " << m_image->format() << std::endl;
-    setVisualEffect(NeuTube::Display::Image::VE_HIGH_CONTRAST);
-#endif
-    m_z = z;
+void ZDvidTile::loadDvidImage(
+    const ZDvidTileCache::ImagePtr &image, int z, bool highContrast)
+{
+  if (image.get() == NULL || image->isEmpty()) {
+    return;
   }
 
-  if (hasVisualEffect(neutube::display::image::VE_HIGH_CONTRAST) != highContrast) {
-    if (highContrast) {
-      addVisualEffect(neutube::display::image::VE_HIGH_CONTRAST);
-    } else {
-      removeVisualEffect(neutube::display::image::VE_HIGH_CONTRAST);
+  if (m_image != NULL) {
+    if (m_image->width() != image->width ||
+        m_image->height() != image->height ||
+        m_image->format() != QImage::Format_Indexed8) {
+      delete m_image;
+      m_image = NULL;
     }
-    modified = true;
   }
 
-#ifdef _DEBUG_2
-  modified = false;
-#endif
+  if (m_image == NULL) {
+    m_image = new ZImage(image->width, image->height, QImage::Format_Indexed8);
+  }
+
+  QVector<QRgb> colorTable(256);
+  for (int i = 0; i < 256; ++i) {
+    colorTable[i] = qRgb(i, i, i);
+  }
+  m_image->setColorTable(colorTable);
+
+  const uint8_t *data = image->data.data();
+  for (int j = 0; j < image->height; ++j) {
+    memcpy(m_image->scanLine(j), data, image->width);
+    data += image->width;
+  }
+
+  m_decodedImage = image;
+
+  finishLoading(z, highContrast);
+}
+
+void ZDvidTile::finishLoading(int z, bool highContrast)
+{
+  m_image->setScale(1.0 / m_res.getScale(), 1.0 / m_res.getScale());
+  m_image->setOffset(-getX(), -getY());
+  m_z = z;
 
-  if (modified && (m_image != NULL)) {
-    m_image->loadHighContrastProtocal(m_contrastProtocal);
-    m_image->enhanceContrast(
-          hasVisualEffect(neutube::display::image::VE_HIGH_CONTRAST));
-//    m_image->enhanceContrast(highContrast);
-    updatePixmap();
+  if (highContrast) {
+    addVisualEffect(neutube::display::image::VE_HIGH_CONTRAST);
+  } else {
+    removeVisualEffect(neutube::display::image::VE_HIGH_CONTRAST);
   }
+
+  m_image->setContrastProtocol(m_contrastProtocol);
+  m_image->enhanceContrast(highContrast);
+  updatePixmap();
+}
+
+ZDvidTileCache::ImagePtr ZDvidTile::getDecodedImage() const
+{
+  return m_decodedImage;
 }
 
 void ZDvidTile::updatePixmap()
@@ -128,7 +216,7 @@ void ZDvidTile::enhanceContrast(bool high, bool updatingPixmap)
     }
 
     if (m_image != NULL) {
-      m_image->loadHighContrastProtocal(m_contrastProtocal);
+      m_image->setContrastProtocol(m_contrastProtocol);
       m_image->enhanceContrast(
             hasVisualEffect(neutube::display::image::VE_HIGH_CONTRAST));
       if (updatingPixmap) {
@@ -140,7 +228,13 @@ void ZDvidTile::enhanceContrast(bool high, bool updatingPixmap)
 
 void ZDvidTile::setContrastProtocal(const ZJsonObject &obj)
 {
-  m_contrastProtocal = obj;
+  m_contrastProtocol = ZContrastProtocol();
+  m_contrastProtocol.load(obj);
+}
+
+void ZDvidTile::setContrastProtocol(const ZContrastProtocol &cp)
+{
+  m_contrastProtocol = cp;
 }
 
 /*
@@ -12,6 +12,8 @@
 #include "dvid/zdvidtileinfo.h"
 #include "zpixmap.h"
 #include "zjsonobject.h"
+#include "zcontrastprotocol.h"
+#include "dvid/zdvidtilecache.h"
 
 class ZPainter;
 class ZStack;
@@ -44,6 +46,19 @@ public:
   void loadDvidSlice(const QByteArray &buffer, int z, bool highConstrast);
   void loadDvidSlice(const uchar *buf, int length, int z, bool highContrast);
 
+  /*!
+   * \brief Load a tile from its cached 8-bit form.
+   */
+  void loadDvidImage(const ZDvidTileCache::ImagePtr &image, int z,
+                     bool highContrast);
+
+  /*!
+   * \brief Get the 8-bit form of the loaded tile before contrast enhancement.
+   *
+   * It is empty if the tile is not grayscale.
+   */
+  ZDvidTileCache::ImagePtr getDecodedImage() const;
+
 //  void setTileOffset(int x, int y, int z);
 
   virtual const std::string& className() const;
@@ -79,11 +94,16 @@ public:
 
   void enhanceContrast(bool high, bool updatingPixmap);
   void setContrastProtocal(const ZJsonObject &obj);
+  void setContrastProtocol(const ZContrastProtocol &cp);
 
   void updatePixmap();
 
+private:
+  void finishLoading(int z, bool highContrast);
+
 private:
   ZImage *m_image;
+  ZDvidTileCache::ImagePtr m_decodedImage;
   ZPixmap m_pixmap;
   int m_ix;
   int m_iy;
@@ -92,7 +112,7 @@ private:
   ZDvidResolution m_res;
   ZDvidTileInfo m_tilingInfo;
   ZDvidTarget m_dvidTarget;
-  ZJsonObject m_contrastProtocal;
+  ZContrastProtocol m_contrastProtocol;
 
   QMutex m_pixmapMutex;
 
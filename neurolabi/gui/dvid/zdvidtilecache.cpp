@@ -0,0 +1,116 @@
+#include "zdvidtilecache.h"
+
+#include <tuple>
+
+const size_t ZDvidTileCache::DEFAULT_CACHE_SIZE = 256 * 1024 * 1024;
+
+ZDvidTileCache::Key::Key(int resLevel, int ix, int iy, int z) :
+  resLevel(resLevel), ix(ix), iy(iy), z(z)
+{
+}
+
+bool ZDvidTileCache::Key::operator< (const Key &key) const
+{
+  return std::tie(z, resLevel, ix, iy) <
+      std::tie(key.z, key.resLevel, key.ix, key.iy);
+}
+
+bool ZDvidTileCache::Image::isEmpty() const
+{
+  return data.empty();
+}
+
+size_t ZDvidTileCache::Image::getByteNumber() const
+{
+  return data.size();
+}
+
+ZDvidTileCache::ZDvidTileCache() : m_cacheSize(DEFAULT_CACHE_SIZE)
+{
+}
+
+void ZDvidTileCache::setCacheSize(size_t byteNumber)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_cacheSize = byteNumber;
+  shrinkUnsync();
+}
+
+size_t ZDvidTileCache::getCacheSize() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_cacheSize;
+}
+
+size_t ZDvidTileCache::getCacheUsage() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_cacheUsage;
+}
+
+ZDvidTileCache::ImagePtr ZDvidTileCache::get(const Key &key)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto iter = m_cache.find(key);
+  if (iter != m_cache.end()) {
+    m_lruList.splice(m_lruList.begin(), m_lruList, iter->second.lruIter);
+    return iter->second.image;
+  }
+
+  return ImagePtr();
+}
+
+bool ZDvidTileCache::contains(const Key &key) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_cache.count(key) > 0;
+}
+
+void ZDvidTileCache::put(const Key &key, const ImagePtr &image)
+{
+  if (image.get() == NULL || image->isEmpty()) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto iter = m_cache.find(key);
+  if (iter != m_cache.end()) {
+    m_cacheUsage -= iter->second.image->getByteNumber();
+    m_lruList.erase(iter->second.lruIter);
+    m_cache.erase(iter);
+  }
+
+  size_t byteNumber = image->getByteNumber();
+  if (byteNumber <= m_cacheSize) {
+    m_lruList.push_front(key);
+    Entry &entry = m_cache[key];
+    entry.image = image;
+    entry.lruIter = m_lruList.begin();
+    m_cacheUsage += byteNumber;
+    shrinkUnsync();
+  }
+}
+
+void ZDvidTileCache::shrinkUnsync()
+{
+  while (m_cacheUsage > m_cacheSize && !m_lruList.empty()) {
+    auto iter = m_cache.find(m_lruList.back());
+    m_cacheUsage -= iter->second.image->getByteNumber();
+    m_cache.erase(iter);
+    m_lruList.pop_back();
+  }
+}
+
+void ZDvidTileCache::clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_cache.clear();
+  m_lruList.clear();
+  m_cacheUsage = 0;
+}
+
+size_t ZDvidTileCache::size() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_cache.size();
+}
@@ -0,0 +1,91 @@
+#ifndef ZDVIDTILECACHE_H
+#define ZDVIDTILECACHE_H
+
+#include <vector>
+#include <map>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+/*!
+ * \brief The class of caching decoded DVID tiles across slices
+ *
+ * Tiles are keyed by (resolution level, tile index, z) and stored as 8-bit
+ * grayscale images, which are much smaller than the pixmaps used for display.
+ * When the total size exceeds getCacheSize() bytes, the least recently used
+ * tiles are removed.
+ *
+ * The cache is thread safe.
+ */
+class ZDvidTileCache
+{
+public:
+  ZDvidTileCache();
+
+  struct Key {
+    int resLevel = 0;
+    int ix = 0;
+    int iy = 0;
+    int z = 0;
+
+    Key() {}
+    Key(int resLevel, int ix, int iy, int z);
+
+    bool operator< (const Key &key) const;
+  };
+
+  /*!
+   * \brief 8-bit image of a tile in the row-major order.
+   */
+  struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> data;
+
+    bool isEmpty() const;
+    size_t getByteNumber() const;
+  };
+
+  typedef std::shared_ptr<const Image> ImagePtr;
+
+  const static size_t DEFAULT_CACHE_SIZE;
+
+  void setCacheSize(size_t byteNumber);
+  size_t getCacheSize() const;
+  size_t getCacheUsage() const;
+
+  /*!
+   * \brief Get a tile.
+   *
+   * It returns an empty pointer if the tile is not cached.
+   */
+  ImagePtr get(const Key &key);
+  bool contains(const Key &key) const;
+
+  /*!
+   * \brief Add a tile, which replaces the cached tile with the same key.
+   */
+  void put(const Key &key, const ImagePtr &image);
+
+  void clear();
+  size_t size() const;
+
+private:
+  struct Entry {
+    ImagePtr image;
+    std::list<Key>::iterator lruIter;
+  };
+
+  void shrinkUnsync();
+
+private:
+  mutable std::mutex m_mutex;
+  std::map<Key, Entry> m_cache;
+  std::list<Key> m_lruList; //Most recently used first
+  size_t m_cacheSize;
+  size_t m_cacheUsage = 0;
+};
+
+#endif // ZDVIDTILECACHE_H
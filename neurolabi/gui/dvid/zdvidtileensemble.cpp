@@ -16,6 +16,7 @@
 #include "flyem/zdvidtileupdatetaskmanager.h"
 #include "flyem/zflyemmisc.h"
 #include "zdvidutil.h"
+#include "dvid/zdvidblockcache.h"
 #include "zdvidpatchdatafetcher.h"
 #include "zdviddataslicehelper.h"
 #include "zutils.h"
@@ -30,6 +31,9 @@ ZDvidTileEnsemble::ZDvidTileEnsemble()
   m_dataFetcher = NULL;
   m_helper = std::make_unique<ZDvidDataSliceHelper>(ZDvidData::ROLE_MULTISCALE_2D);
 //  m_patch = new ZImage(256, 256, QImage::Format_Indexed8);
+  if (NeutubeConfig::GetTileCacheSize() > 0) {
+    setTileCacheSize(NeutubeConfig::GetTileCacheSize());
+  }
 }
 
 ZDvidTileEnsemble::~ZDvidTileEnsemble()
@@ -78,6 +82,8 @@ void ZDvidTileEnsemble::enhanceContrast(bool high)
 void ZDvidTileEnsemble::setContrastProtocal(const ZJsonObject &obj)
 {
   m_contrastProtocal = obj;
+  m_contrastProtocol = ZContrastProtocol();
+  m_contrastProtocol.load(obj);
 }
 
 ZJsonObject ZDvidTileEnsemble::getContrastProtocal() const
@@ -90,6 +96,11 @@ ZDvidPatchDataFetcher* ZDvidTileEnsemble::getDataFetcher() const
   return m_dataFetcher;
 }
 
+void ZDvidTileEnsemble::setTileCacheSize(size_t byteNumber)
+{
+  m_tileCache.setCacheSize(byteNumber);
+}
+
 void ZDvidTileEnsemble::updatePatch(
     const ZImage *patch, const ZIntCuboid &region)
 {
@@ -99,7 +110,7 @@ void ZDvidTileEnsemble::updatePatch(
   }
 
   m_patch = new ZImage(*patch);
-  m_patch->loadHighContrastProtocal(m_contrastProtocal);
+  m_patch->setContrastProtocol(m_contrastProtocol);
   m_patch->enhanceContrast(m_highContrast);
   m_patchRange = region;
 }
@@ -198,17 +209,29 @@ bool ZDvidTileEnsemble::update(
 
   bool updated = false;
 #if defined(_ENABLE_LIBDVIDCPP_)
+  //Tiles decoded before are restored from the tile cache without fetching
   std::vector<std::vector<int> > tile_locs_array;
+  std::vector<ZDvidTile*> fetchTileArray;
   for (std::vector<ZDvidTileInfo::TIndex>::const_iterator iter = tileIndices.begin();
        iter != tileIndices.end(); ++iter) {
     const ZDvidTileInfo::TIndex &index = *iter;
     ZDvidTile *tile = const_cast<ZDvidTileEnsemble*>(this)->getTile(resLevel, index);
     if (tile != NULL) {
+      ZDvidTileCache::ImagePtr image = m_tileCache.get(
+            ZDvidTileCache::Key(resLevel, tile->getIx(), tile->getIy(), z));
+      if (image.get() != NULL) {
+        tile->setContrastProtocol(m_contrastProtocol);
+        tile->loadDvidImage(image, z, m_highContrast);
+        updated = true;
+        continue;
+      }
+
       std::vector<int> loc(3);
       loc[0] = tile->getIx();
       loc[1] = tile->getIy();
       loc[2] = z;
       tile_locs_array.push_back(loc);
+      fetchTileArray.push_back(tile);
     }
   }
 
@@ -270,30 +293,68 @@ bool ZDvidTileEnsemble::update(
 
 //#define DVID_TILE_THREAD_FETCH 1
 
-      std::vector<libdvid::BinaryDataPtr> data;
+      std::vector<libdvid::BinaryDataPtr> data(tile_locs_array.size());
       std::string tileName;
-      try {
 //#if DVID_TILE_THREAD_FETCH
 //        if (tile_locs_array.size() < 5) {
 //          tileName = m_dvidTarget.getLosslessTileName();
 //        } else {
-          tileName = getDvidTarget().getMultiscale2dName();
+      tileName = getDvidTarget().getMultiscale2dName();
 //        }
 
-        if (NeutubeConfig::ParallelTileFetching()) {
-          data = get_tile_array_binary(
+      //Tiles of a locked node are taken from the block cache when possible
+      ZDvidBlockCache *cache = ZDvid::GetBlockCache(getDvidTarget());
+      std::vector<ZDvidBlockCache::Key> cacheKeyArray;
+      std::vector<std::vector<int> > missingLocArray;
+      std::vector<size_t> missingIndexArray;
+      for (size_t i = 0; i < tile_locs_array.size(); ++i) {
+        if (cache != NULL) {
+          const std::vector<int> &loc = tile_locs_array[i];
+          ZDvidBlockCache::Key key;
+          key.server = getDvidTarget().getAddressWithPort();
+          key.uuid = getDvidTarget().getUuid();
+          key.instance = tileName;
+          key.zoom = resLevel;
+          key.x = loc[0];
+          key.y = loc[1];
+          key.z = loc[2];
+
+          std::vector<char> buffer;
+          if (cache->get(key, &buffer)) {
+            data[i] = libdvid::BinaryData::create_binary_data(
+                  buffer.data(), buffer.size());
+            continue;
+          }
+          cacheKeyArray.push_back(key);
+        }
+        missingLocArray.push_back(tile_locs_array[i]);
+        missingIndexArray.push_back(i);
+      }
+
+      try {
+        std::vector<libdvid::BinaryDataPtr> missingData;
+        if (missingLocArray.empty()) {
+          //All from the cache
+        } else if (NeutubeConfig::ParallelTileFetching()) {
+          missingData = get_tile_array_binary(
                 *(getDvidReader().getService()), tileName,
-                libdvid::XY, resLevel, tile_locs_array);
+                libdvid::XY, resLevel, missingLocArray);
         } else {
           //#else
-          data.resize(tile_locs_array.size());
-          //        std::vector<libdvid::BinaryDataPtr> data(tile_locs_array.size());
-          for (size_t i = 0; i < tile_locs_array.size(); ++i) {
-            data[i] = getDvidReader().getService()->get_tile_slice_binary(
-                  tileName, libdvid::XY, resLevel, tile_locs_array[i]);
+          missingData.resize(missingLocArray.size());
+          for (size_t i = 0; i < missingLocArray.size(); ++i) {
+            missingData[i] = getDvidReader().getService()->get_tile_slice_binary(
+                  tileName, libdvid::XY, resLevel, missingLocArray[i]);
           }
         }
 //#endif
+        for (size_t i = 0; i < missingData.size(); ++i) {
+          libdvid::BinaryDataPtr dataPtr = missingData[i];
+          data[missingIndexArray[i]] = dataPtr;
+          if (cache != NULL && dataPtr.get() != NULL && dataPtr->length() > 0) {
+            cache->put(cacheKeyArray[i], dataPtr->get_raw(), dataPtr->length());
+          }
+        }
       } catch (libdvid::DVIDException &e) {
         LWARN() << e.what();
       }
@@ -310,29 +371,20 @@ bool ZDvidTileEnsemble::update(
         LWARN() << "Tile reading hickup.";
       }
 
-      size_t dataIndex = 0;
-
-      QList<ZDvidTile*> tileList;
+      QList<ZDvidTile*> decodeTileList;
       QList<ZDvidTileDecodeTask*> taskList;
-      for (std::vector<ZDvidTileInfo::TIndex>::const_iterator
-           iter = tileIndices.begin();
-           iter != tileIndices.end(); ++iter) {
-        const ZDvidTileInfo::TIndex &index = *iter;
-        ZDvidTile *tile = const_cast<ZDvidTileEnsemble*>(this)->getTile(
-              resLevel, index);
-        if (tile != NULL) {
-          libdvid::BinaryDataPtr dataPtr= data[dataIndex++];
-
+      for (size_t i = 0; i < fetchTileArray.size(); ++i) {
+        ZDvidTile *tile = fetchTileArray[i];
+        libdvid::BinaryDataPtr dataPtr= data[i];
+        if (dataPtr.get() != NULL) {
           ZDvidTileDecodeTask *task = new ZDvidTileDecodeTask(NULL, tile);
           task->setZ(z);
-          if (dataPtr.get() != NULL) {
-            task->setData(dataPtr->get_raw(), dataPtr->length());
-            task->setHighContrast(m_highContrast);
-            taskList.append(task);
-          }
-          tile->setContrastProtocal(m_contrastProtocal);
-          tileList.append(tile);
+          task->setData(dataPtr->get_raw(), dataPtr->length());
+          task->setHighContrast(m_highContrast);
+          taskList.append(task);
+          decodeTileList.append(tile);
         }
+        tile->setContrastProtocol(m_contrastProtocol);
       }
 
       timer.start();
@@ -348,23 +400,31 @@ bool ZDvidTileEnsemble::update(
         delete *iter;
       }
 
+      foreach (ZDvidTile *tile, decodeTileList) {
+        m_tileCache.put(
+              ZDvidTileCache::Key(resLevel, tile->getIx(), tile->getIy(), z),
+              tile->getDecodedImage());
+      }
+
       updated = true;
+    }
 
-      if (m_dataFetcher != NULL && getDvidTarget().isTileLowQuality()) {
-        QRect highresViewPort = getHelper()->getViewPort();
-        if (highresViewPort.width() < 1024 || highresViewPort.height() < 1024) {
-          int z = getHelper()->getZ();
-          QPoint center = highresViewPort.center();
-          int width = 512;
-          int height = 512;
-          int x0 = center.x() - width / 2 - 1;
-          int y0 = center.y() - height / 2 - 1;
-          int x1 = x0 + width;
-          int y1 = y0 + height;
-
-          ZIntCuboid region(x0, y0, z, x1, y1, z);
-          m_dataFetcher->submit(region);
-        }
+    //Tiles restored from the tile cache are low quality as well
+    if (updated && m_dataFetcher != NULL &&
+        getDvidTarget().isTileLowQuality()) {
+      QRect highresViewPort = getHelper()->getViewPort();
+      if (highresViewPort.width() < 1024 || highresViewPort.height() < 1024) {
+        int z = getHelper()->getZ();
+        QPoint center = highresViewPort.center();
+        int width = 512;
+        int height = 512;
+        int x0 = center.x() - width / 2 - 1;
+        int y0 = center.y() - height / 2 - 1;
+        int x1 = x0 + width;
+        int y1 = y0 + height;
+
+        ZIntCuboid region(x0, y0, z, x1, y1, z);
+        m_dataFetcher->submit(region);
       }
     }
 #endif
@@ -525,7 +585,7 @@ void ZDvidTileEnsemble::display(
       m_patch = new ZImage(width, height, QImage::Format_Indexed8);
     }
     if (m_patch->loadFromData(bufferReader.getBuffer(), "png")) {
-      m_patch->loadHighContrastProtocal(m_contrastProtocal);
+      m_patch->setContrastProtocol(m_contrastProtocol);
       m_patch->enhanceContrast(m_highContrast);
       painter.drawImage(x0, y0, *m_patch);
     }
@@ -548,10 +608,13 @@ void ZDvidTileEnsemble::setDvidTarget(const ZDvidTarget &dvidTarget)
   LINFO() << "Tile DVID env:" << dvidTarget.getSourceString();
 
   getHelper()->setDvidTarget(dvidTarget);
+  m_tileCache.clear();
 //  m_dvidTarget = dvidTarget;
 //  getHelper()->getDvidTarget().prepareTile();
   if (getDvidReader().good()) {
     m_tilingInfo = getDvidReader().readTileInfo(dvidTarget.getMultiscale2dName());
+    //Tiles can be cached on disk only after the lock state is known
+    getDvidReader().isNodeLocked();
 
     getHelper()->setMaxZoom(m_tilingInfo.getMaxLevel());
 //    ZJsonObject obj = getDvidReader().readContrastProtocal();
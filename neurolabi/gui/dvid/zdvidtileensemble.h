@@ -12,6 +12,7 @@
 #include "zdvidreader.h"
 #include "zsharedpointer.h"
 #include "zintcuboid.h"
+#include "zdvidtilecache.h"
 
 class ZStackView;
 class ZDvidPatchDataFetcher;
@@ -58,6 +59,16 @@ public:
   ZJsonObject getContrastProtocal() const;
   ZDvidPatchDataFetcher *getDataFetcher() const;
 
+  /*!
+   * \brief Set the memory budget (in bytes) of the decoded tiles.
+   *
+   * The budget is initialized from NeutubeConfig::GetTileCacheSize().
+   */
+  void setTileCacheSize(size_t byteNumber);
+  const ZDvidTileCache& getTileCache() const {
+    return m_tileCache;
+  }
+
 public:
   bool update(
       const std::vector<ZDvidTileInfo::TIndex>& tileIndices, int resLevel, int z);
@@ -90,8 +101,10 @@ private:
   mutable ZIntCuboid m_patchRange;
   bool m_highContrast;
   ZJsonObject m_contrastProtocal;
+  ZContrastProtocol m_contrastProtocol; //Parsed from m_contrastProtocal
 
   ZDvidPatchDataFetcher *m_dataFetcher;
+  ZDvidTileCache m_tileCache;
 
   std::unique_ptr<ZDvidDataSliceHelper> m_helper;
   mutable QMutex m_updateMutex;
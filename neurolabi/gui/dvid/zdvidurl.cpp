@@ -1039,6 +1039,27 @@ std::string ZDvidUrl::getLabels64Url(int sx, int sy, int sz,
                         sx, sy, sz, x0, y0, z0);
 }
 
+std::string ZDvidUrl::getSpecificBlocksUrl(
+    const std::string &dataName, const std::vector<int> &blockCoords,
+    int zoom) const
+{
+  if (dataName.empty() || blockCoords.empty()) {
+    return "";
+  }
+
+  std::ostringstream stream;
+  stream << "specificblocks?blocks=";
+  for (size_t i = 0; i < blockCoords.size(); ++i) {
+    if (i > 0) {
+      stream << ",";
+    }
+    stream << blockCoords[i];
+  }
+  stream << "&scale=" << zoom << "&compression=blocks";
+
+  return GetFullUrl(getDataUrl(dataName), stream.str());
+}
+
 std::string ZDvidUrl::getKeyUrl(const std::string &name, const std::string &key) const
 {
   //new dvid api
@@ -2,6 +2,7 @@
 #define ZDVIDURL_H
 
 #include <string>
+#include <vector>
 
 #include "neutube_def.h"
 #include "dvid/zdvidtarget.h"
@@ -140,6 +141,16 @@ public:
       int sx, int sy, int sz, int x0, int y0, int z0) const;
   std::string getLabels64Url(
       int sx, int sy, int sz, int x0, int y0, int z0, int zoom = 0) const;
+
+  /*!
+   * \brief Url of reading label blocks in the native DVID block encoding
+   *
+   * \a blockCoords is a flat list of block indices (x, y, z, x, y, z, ...).
+   * The returned blocks are gzip-compressed.
+   */
+  std::string getSpecificBlocksUrl(
+      const std::string &dataName, const std::vector<int> &blockCoords,
+      int zoom) const;
   /*
   std::string getLabelSliceUrl(const std::string &name, int dim1, int dim2,
                                int )
@@ -1,5 +1,6 @@
 #include "zdvidwriter.h"
 #include <iostream>
+#include <algorithm>
 #include <QProcess>
 #include <QDebug>
 #include <QFile>
@@ -28,8 +29,10 @@
 #include "dvid/zdvidbufferreader.h"
 #include "zdvidutil.h"
 #include "dvid/zdvidpath.h"
+#include "dvid/zdvidmetrics.h"
 #include "zmesh.h"
 #include "zobject3dscan.h"
+#include "zobject3dscancompact.h"
 
 ZDvidWriter::ZDvidWriter(/*QObject *parent*/)   /*:
 QObject(parent)*/
@@ -676,8 +679,10 @@ void ZDvidWriter::writeBodyInfo(uint64_t bodyId)
 {
   ZDvidReader &reader = m_reader;
   if (m_reader.isReady()) {
-    ZObject3dScan obj;
-    reader.readBody(bodyId, false, &obj);
+    //Only the size and the bound box are needed, so the body is read into
+    //compact storage
+    ZObject3dScanCompact obj;
+    reader.readBodyCompact(bodyId, flyem::EBodyLabelType::BODY, false, &obj);
     if (!obj.isEmpty()) {
       ZFlyEmNeuronBodyInfo bodyInfo;
       bodyInfo.setBodySize(obj.getVoxelNumber());
@@ -868,6 +873,7 @@ std::string ZDvidWriter::request(
   m_statusErrorMessage.clear();
   std::string response;
 #if defined(_ENABLE_LIBDVIDCPP_)
+  ZDvidMetrics::Timer timer;
   try {
     libdvid::BinaryDataPtr libdvidPayload;
     if (payload != NULL && length > 0) {
@@ -912,6 +918,9 @@ std::string ZDvidWriter::request(
     m_statusCode = e.getStatus();
     m_statusErrorMessage = e.what();
   }
+  ZDvidMetrics::GetInstance().recordRequest(
+        url, timer.elapsed(), std::max(0, length), response.size(),
+        m_statusCode == 200);
 #endif
 
 #ifdef _DEBUG_
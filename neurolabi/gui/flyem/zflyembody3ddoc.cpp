@@ -10,6 +10,7 @@
 #include "zjsondef.h"
 #include "dvid/zdvidreader.h"
 #include "dvid/zdvidinfo.h"
+#include "dvid/zdvidmesharchivedecoder.h"
 #include "zswcfactory.h"
 #include "zstackobjectsourcefactory.h"
 #include "z3dgraphfactory.h"
@@ -1734,8 +1735,24 @@ void ZFlyEmBody3dDoc::addBodyMeshFunc(ZFlyEmBodyConfig &config)
 
   notifyBodyUpdate(bodyId, config.getDsLevel());
 
+  // Meshes decoded from an archive are added as soon as they are ready.
+  size_t deliveredCount = 0;
+  MeshBatchCallback batchCallback;
+  if (config.isTar()) {
+    batchCallback = [&](const std::vector<ZMesh*> &batch) {
+      for (ZMesh *mesh : batch) {
+        mesh->setColor(config.getBodyColor());
+        mesh->pushObjectColor();
+        getDataBuffer()->addUpdate(
+              mesh, ZStackDocObjectUpdate::ACTION_ADD_NONUNIQUE);
+      }
+      getDataBuffer()->deliver();
+      deliveredCount += batch.size();
+    };
+  }
+
 //  std::map<uint64_t, ZMesh*> meshes;
-  std::vector<ZMesh *> meshes = makeBodyMeshModels(config);
+  std::vector<ZMesh *> meshes = makeBodyMeshModels(config, batchCallback);
 
 //  bool loaded =
 //      !(getObjectGroup().findSameClass(
@@ -1754,12 +1771,17 @@ void ZFlyEmBody3dDoc::addBodyMeshFunc(ZFlyEmBodyConfig &config)
   }
   */
 
-  for (ZMesh *mesh : meshes) {
-    mesh->setColor(config.getBodyColor());
-    mesh->pushObjectColor();
-  }
+  if (deliveredCount > 0 && deliveredCount == meshes.size()) {
+    config.setDsLevel(0);
+    emit bodyMeshLoaded(meshes.size());
+  } else {
+    for (ZMesh *mesh : meshes) {
+      mesh->setColor(config.getBodyColor());
+      mesh->pushObjectColor();
+    }
 
-  updateMeshFunc(config, meshes);
+    updateMeshFunc(config, meshes);
+  }
 
   if (config.isTar()) {
     QSet<uint64_t> subbodySet;
@@ -1936,6 +1958,29 @@ ZFlyEmBodyAnnotationDialog* ZFlyEmBody3dDoc::getBodyAnnotationDlg()
   return m_annotationDlg;
 }
 
+void ZFlyEmBody3dDoc::addBodyPartFunc(
+    std::shared_ptr<ZObject3dScan> part, uint64_t bodyId, int zoom,
+    flyem::EBodyType bodyType, QColor color)
+{
+  if (m_quitting) {
+    return;
+  }
+
+  ZSwcTree *partTree = ZSwcFactory::CreateSurfaceSwc(*part, 3);
+  if (partTree != NULL) {
+    partTree->setStructrualMode(ZSwcTree::STRUCT_POINT_CLOUD);
+    partTree->setColor(color);
+    partTree->setSource(
+          ZStackObjectSourceFactory::MakeFlyEmBodySource(
+            bodyId, zoom, bodyType));
+    SetObjectClass(partTree, bodyId);
+    partTree->setLabel(bodyId);
+    getDataBuffer()->addUpdate(
+          partTree, ZStackDocObjectUpdate::ACTION_ADD_NONUNIQUE);
+    getDataBuffer()->deliver();
+  }
+}
+
 void ZFlyEmBody3dDoc::addBodyFunc(ZFlyEmBodyConfig &config)
 {
   flyem::EBodyType bodyType = config.getBodyType();
@@ -1963,7 +2008,36 @@ void ZFlyEmBody3dDoc::addBodyFunc(ZFlyEmBodyConfig &config)
       notifyBodyUpdated(bodyId, getMaxDsLevel());
     } else {
       notifyBodyUpdate(bodyId, config.getDsLevel());
-      tree = makeBodyModel(bodyId, config.getDsLevel(), bodyType);
+
+      //Parts of a full-resolution body are shown as they arrive. They are
+      //of the same class as the body, so the final model recycles them.
+      //Their surfaces are made in the global pool instead of the request
+      //engine workers.
+      QList<QFuture<void> > partFutureList;
+      ZDvidBodyStreamLoader::PartCallback callback =
+          [&](const std::shared_ptr<ZObject3dScan> &part, int /*index*/,
+          int /*partNumber*/) {
+        if (!m_quitting) {
+          partFutureList.append(
+                QtConcurrent::run(
+                  this, &ZFlyEmBody3dDoc::addBodyPartFunc, part, bodyId,
+                  config.getDsLevel(), bodyType, config.getBodyColor()));
+        }
+      };
+      tree = makeBodyModel(bodyId, config.getDsLevel(), bodyType, callback);
+      for (QFuture<void> &future : partFutureList) {
+        future.waitForFinished();
+      }
+
+      if (tree == NULL && !partFutureList.isEmpty()) {
+        TStackObjectList objList = getObjectGroup().findSameClass(
+              ZStackObject::TYPE_SWC,
+              ZStackObjectSourceFactory::MakeFlyEmBodySource(bodyId));
+        for (ZStackObject *obj : objList) {
+          getDataBuffer()->addUpdate(obj, ZStackDocObjectUpdate::ACTION_RECYCLE);
+        }
+        getDataBuffer()->deliver();
+      }
       notifyBodyUpdated(bodyId, config.getDsLevel());
     }
 
@@ -2939,6 +3013,14 @@ std::vector<ZSwcTree*> ZFlyEmBody3dDoc::makeDiffBodyModel(
 
 ZSwcTree* ZFlyEmBody3dDoc::makeBodyModel(
     uint64_t bodyId, int zoom, flyem::EBodyType bodyType)
+{
+  return makeBodyModel(
+        bodyId, zoom, bodyType, ZDvidBodyStreamLoader::PartCallback());
+}
+
+ZSwcTree* ZFlyEmBody3dDoc::makeBodyModel(
+    uint64_t bodyId, int zoom, flyem::EBodyType bodyType,
+    const ZDvidBodyStreamLoader::PartCallback &callback)
 {
   ZSwcTree *tree = NULL;
 
@@ -2988,7 +3070,7 @@ ZSwcTree* ZFlyEmBody3dDoc::makeBodyModel(
 
         if (cachedBody == NULL) {
           ZObject3dScan obj;
-          reader.readMultiscaleBody(bodyId, zoom, true, &obj);
+          reader.readMultiscaleBody(bodyId, zoom, true, &obj, callback);
           if (m_quitting) {
             return NULL;
           }
@@ -3340,7 +3422,8 @@ namespace {
 }
 
 std::vector<ZMesh*> ZFlyEmBody3dDoc::makeTarMeshModels(
-    const ZDvidReader &reader, uint64_t bodyId, int t)
+    const ZDvidReader &reader, uint64_t bodyId, int t,
+    const MeshBatchCallback &batchCallback)
 {
   std::vector<ZMesh*> resultVec;
 
@@ -3359,10 +3442,12 @@ std::vector<ZMesh*> ZFlyEmBody3dDoc::makeTarMeshModels(
     bodyId = decode(bodyId);
   }
 
-  if (struct archive *arc = reader.readMeshArchiveStart(bodyId, useOldMeshesTars)) {
+  size_t bytesTotal = 0;
+  if (struct archive *arc =
+      reader.readMeshArchiveStart(bodyId, bytesTotal, useOldMeshesTars)) {
 
-    // When reading the meshes, decompress them in parallel to improve performance.
-    // The following lambda function updates the progress dialog during the decompression.
+    // The meshes are decoded in parallel while the archive is being read, and
+    // the following lambda function updates the progress dialog.
 
     auto progress = [=](size_t i, size_t n) {
       float fraction = float(i) / n;
@@ -3370,19 +3455,40 @@ std::vector<ZMesh*> ZFlyEmBody3dDoc::makeTarMeshModels(
       emit meshArchiveLoadingProgress(progressFraction);
     };
 
-    reader.readMeshArchiveAsync(arc, resultVec, progress);
-    //      QSet<uint64_t> mappedSet;
+    // Normals are prepared by the decoding threads too.
+
     uint64_t decodedBodyId = decode(bodyId);
-    for (ZMesh *mesh : resultVec) {
+    ZDvidMeshArchiveDecoder decoder;
+    decoder.setPostProcess([=](ZMesh *mesh) {
       finalizeMesh(mesh, decodedBodyId, 0, t);
       if (isSupervoxelTar) {
         mesh->addRole(ZStackObjectRole::ROLE_SUPERVOXEL);
       }
-      //        result[mesh->getLabel()] = mesh;
-      //        mappedSet.insert(mesh->getLabel());
+    });
+
+    // Meshes are passed on in batches so that a body with thousands of
+    // supervoxels shows up progressively without an update for every mesh.
+    // All of them are still returned in resultVec.
+
+    const int BATCH_INTERVAL = 200; //ms
+    std::vector<ZMesh*> batch;
+    QElapsedTimer batchTimer;
+    batchTimer.start();
+    decoder.decode(arc, [&](ZMesh *mesh) {
+      resultVec.push_back(mesh);
+      if (batchCallback) {
+        batch.push_back(mesh);
+        if (batchTimer.elapsed() >= BATCH_INTERVAL) {
+          batchCallback(batch);
+          batch.clear();
+          batchTimer.restart();
+        }
+      }
+    }, progress, bytesTotal);
+
+    if (batchCallback && !batch.empty()) {
+      batchCallback(batch);
     }
-//    result[bodyId] = resultVec;
-    //      getBodyManager().registerBody(id, mappedSet);
 
     reader.readMeshArchiveEnd(arc);
 
@@ -3401,13 +3507,13 @@ std::vector<ZMesh*> ZFlyEmBody3dDoc::makeTarMeshModels(
 }
 
 std::vector<ZMesh*> ZFlyEmBody3dDoc::makeTarMeshModels(
-    uint64_t bodyId, int t)
+    uint64_t bodyId, int t, const MeshBatchCallback &batchCallback)
 {
-  return makeTarMeshModels(getWorkDvidReader(), bodyId, t);
+  return makeTarMeshModels(getWorkDvidReader(), bodyId, t, batchCallback);
 }
 
 std::vector<ZMesh*> ZFlyEmBody3dDoc::makeBodyMeshModels(
-    ZFlyEmBodyConfig &config)
+    ZFlyEmBodyConfig &config, const MeshBatchCallback &batchCallback)
 {
   std::vector<ZMesh*> result;
 
@@ -3420,7 +3526,7 @@ std::vector<ZMesh*> ZFlyEmBody3dDoc::makeBodyMeshModels(
   if (result.empty()) {
     int t = m_objectTime.elapsed();
     if (config.isTar()) {
-      result = makeTarMeshModels(config.getBodyId(), t);
+      result = makeTarMeshModels(config.getBodyId(), t, batchCallback);
     } else {
       ZMesh *mesh = NULL;
 
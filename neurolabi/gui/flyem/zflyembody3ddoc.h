@@ -417,14 +417,41 @@ private:
 
 //  ZSwcTree* makeBodyModel(uint64_t bodyId, int zoom);
   ZSwcTree* makeBodyModel(uint64_t bodyId, int zoom, flyem::EBodyType bodyType);
+  /*!
+   * \brief Make a body model with parts passed to \a callback while a
+   * full-resolution body is being read.
+   */
+  ZSwcTree* makeBodyModel(
+      uint64_t bodyId, int zoom, flyem::EBodyType bodyType,
+      const ZDvidBodyStreamLoader::PartCallback &callback);
+  /*!
+   * \brief Add the point cloud of a body part arrived during streaming.
+   *
+   * It runs in the global thread pool, so that the request engine workers
+   * passing the parts are not blocked by making surfaces.
+   */
+  void addBodyPartFunc(
+      std::shared_ptr<ZObject3dScan> part, uint64_t bodyId, int zoom,
+      flyem::EBodyType bodyType, QColor color);
 
   std::vector<ZMesh*> getTarCachedMeshes(uint64_t bodyId);
 
   std::vector<ZMesh*> getCachedMeshes(uint64_t bodyId, int zoom);
-  std::vector<ZMesh *> makeBodyMeshModels(ZFlyEmBodyConfig &config);
-  std::vector<ZMesh*> makeTarMeshModels(uint64_t bodyId, int t);
+  /*!
+   * \brief The function of receiving meshes of an archive as soon as they are
+   * decoded. The meshes are still owned by the returned array.
+   */
+  typedef std::function<void(const std::vector<ZMesh*>&)> MeshBatchCallback;
+
+  std::vector<ZMesh *> makeBodyMeshModels(
+      ZFlyEmBodyConfig &config,
+      const MeshBatchCallback &batchCallback = MeshBatchCallback());
+  std::vector<ZMesh*> makeTarMeshModels(
+      uint64_t bodyId, int t,
+      const MeshBatchCallback &batchCallback = MeshBatchCallback());
   std::vector<ZMesh*> makeTarMeshModels(
-      const ZDvidReader &reader, uint64_t bodyId, int t);
+      const ZDvidReader &reader, uint64_t bodyId, int t,
+      const MeshBatchCallback &batchCallback = MeshBatchCallback());
 
   std::vector<ZSwcTree*> makeDiffBodyModel(
       uint64_t bodyId1, ZDvidReader &diffReader, int zoom,
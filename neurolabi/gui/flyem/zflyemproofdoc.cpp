@@ -24,6 +24,7 @@
 #include "zpuncta.h"
 #include "dvid/zdvidurl.h"
 #include "dvid/zdvidbufferreader.h"
+#include "dvid/zdvidbodyidresolver.h"
 //#include "zflyemproofmvc.h"
 #include "flyem/zflyembookmark.h"
 #include "zstring.h"
@@ -1275,7 +1276,7 @@ void ZFlyEmProofDoc::notifyTodoItemModified(
 void ZFlyEmProofDoc::notifyTodoItemModified(
     const std::vector<ZIntPoint> &ptArray, bool emitingEdit)
 {
-  std::vector<uint64_t> bodyIdArray = m_dvidReader.readBodyIdAt(ptArray);
+  std::vector<uint64_t> bodyIdArray = readBodyIdAt(ptArray);
   std::set<uint64_t> bodyIdSet;
   bodyIdSet.insert(bodyIdArray.begin(), bodyIdArray.end());
   for (std::vector<uint64_t>::const_iterator iter = bodyIdArray.begin();
@@ -3008,6 +3009,24 @@ ZFlyEmBookmark* ZFlyEmProofDoc::findFirstBookmark(const QString &key) const
   return NULL;
 }
 
+std::vector<uint64_t> ZFlyEmProofDoc::readBodyIdAt(
+    const std::vector<ZIntPoint> &ptArray)
+{
+  std::vector<uint64_t> bodyArray;
+  if (!ptArray.empty() && m_dvidReader.isReady()) {
+    ZDvidBodyIdResolver resolver(m_dvidReader.getDvidTarget());
+    const ZDvidLabelSlice *slice = getDvidLabelSlice(neutube::EAxis::Z);
+    if (slice != NULL) {
+      resolver.addLabelSource([slice](const ZIntPoint &pt, uint64_t *label) {
+        return slice->getOriginalLabel(pt.getX(), pt.getY(), pt.getZ(), label);
+      });
+    }
+    bodyArray = resolver.resolve(ptArray);
+  }
+
+  return bodyArray;
+}
+
 void ZFlyEmProofDoc::readBookmarkBodyId(QList<ZFlyEmBookmark *> &bookmarkArray)
 {
   if (!bookmarkArray.isEmpty()) {
@@ -3018,7 +3037,7 @@ void ZFlyEmProofDoc::readBookmarkBodyId(QList<ZFlyEmBookmark *> &bookmarkArray)
       ptArray.push_back(bookmark->getLocation());
     }
 
-    std::vector<uint64_t> idArray = getDvidReader().readBodyIdAt(ptArray);
+    std::vector<uint64_t> idArray = readBodyIdAt(ptArray);
     if (bookmarkArray.size() == (int) idArray.size()) {
       for (int i = 0; i < bookmarkArray.size(); ++i) {
         ZFlyEmBookmark *bookmark = bookmarkArray[i];
@@ -3762,10 +3781,9 @@ ZDvidSparseStack* ZFlyEmProofDoc::getDvidSparseStack(
                 ZIntPoint(x0, y, z);// - dvidInfo.getStartBlockIndex();
             for (int x = x0; x <= x1; ++x) {
               ZStack *stack =
-                  originalStack->getStackGrid()->getStack(blockIndex);
+                  originalStack->getStackGrid()->makeStack(blockIndex);
               if (stack != NULL) {
-                m_splitSource->getStackGrid()->consumeStack(
-                      blockIndex, stack->clone());
+                m_splitSource->getStackGrid()->consumeStack(blockIndex, stack);
               }
               blockIndex.setX(blockIndex.getX() + 1);
             }
@@ -638,6 +638,11 @@ private:
 
   void readBookmarkBodyId(QList<ZFlyEmBookmark*> &bookmarkArray);
 
+  /*!
+   * \brief Read body IDs of points with the loaded label slice as a shortcut.
+   */
+  std::vector<uint64_t> readBodyIdAt(const std::vector<ZIntPoint> &ptArray);
+
   std::string getSynapseName(const ZDvidSynapse &synapse) const;
 
   void updateSequencerBodyMap(
@@ -47,6 +47,7 @@
 #include "neutubeconfig.h"
 #include "flyem/zflyemexternalneurondoc.h"
 #include "zfiletype.h"
+#include "zobject3dscanchunkfile.h"
 #include "z3dpunctafilter.h"
 #include "z3dswcfilter.h"
 #include "dvid/zdvidsynapseensenmble.h"
@@ -3447,7 +3448,12 @@ void ZFlyEmProofMvc::exportSelectedBody()
         }
       }
       obj.canonize();
-      obj.save(fileName.toStdString());
+      if (fileName.endsWith(ZObject3dScanChunkFile::EXTENSION.c_str(),
+                            Qt::CaseInsensitive)) {
+        obj.saveCompressed(fileName.toStdString());
+      } else {
+        obj.save(fileName.toStdString());
+      }
     }
   }
 }
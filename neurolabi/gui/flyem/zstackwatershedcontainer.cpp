@@ -693,7 +693,7 @@ void ZStackWatershedContainer::refineBorder(const ZStackPtr &stack)
   boundaryObject.loadStack(boundaryStack->c_stack());
 
   std::vector<ZObject3dScan> boundaryArray =
-      boundaryObject.getConnectedComponent(ZObject3dScan::ACTION_NONE);
+      boundaryObject.getConnectedComponent(neutube::EStackNeighborhood::D3);
 
 #if 0
   boundaryStack->save(GET_TEST_DATA_DIR + "/test.tif");
@@ -1210,7 +1210,7 @@ ZObject3dScan* ZStackWatershedContainer::processSplitResult(
 
   if (adopting) {
     std::vector<ZObject3dScan> ccArray =
-        currentBody->getConnectedComponent(ZObject3dScan::ACTION_NONE);
+        currentBody->getConnectedComponent(neutube::EStackNeighborhood::D3);
     for (std::vector<ZObject3dScan>::iterator iter = ccArray.begin();
          iter != ccArray.end(); ++iter) {
       ZObject3dScan &subobj = *iter;
@@ -1237,7 +1237,7 @@ void ZStackWatershedContainer::assignComponent(
     ZObject3dScanArray *result)
 {
   std::vector<ZObject3dScan> partArray =
-      remainBody.getConnectedComponent(ZObject3dScan::ACTION_NONE);
+      remainBody.getConnectedComponent(neutube::EStackNeighborhood::D3);
 
   for (std::vector<ZObject3dScan>::iterator iter = partArray.begin();
        iter != partArray.end(); ++iter) {
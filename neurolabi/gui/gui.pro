@@ -561,6 +561,12 @@ HEADERS += mainwindow.h \
     zframefactory.h \
     zactionbutton.h \
     dvid/zdvidbufferreader.h \
+    dvid/zdvidrequestengine.h \
+    dvid/zdvidrequestcoalescer.h \
+    dvid/zdvidbodyidresolver.h \
+    dvid/zdvidsliceprefetcher.h \
+    dvid/zdvidbodystreamloader.h \
+    dvid/zdvidmesharchivedecoder.h \
     zmouseevent.h \
     zmouseeventrecorder.h \
     zmouseeventprocessor.h \
@@ -1259,6 +1265,12 @@ SOURCES += main.cpp \
     zframefactory.cpp \
     zactionbutton.cpp \
     dvid/zdvidbufferreader.cpp \
+    dvid/zdvidrequestengine.cpp \
+    dvid/zdvidrequestcoalescer.cpp \
+    dvid/zdvidbodyidresolver.cpp \
+    dvid/zdvidsliceprefetcher.cpp \
+    dvid/zdvidbodystreamloader.cpp \
+    dvid/zdvidmesharchivedecoder.cpp \
     zmouseevent.cpp \
     zmouseeventrecorder.cpp \
     zmouseeventprocessor.cpp \
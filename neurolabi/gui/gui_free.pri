@@ -12,6 +12,7 @@ HEADERS += $${PWD}/zstack.hxx \
    $${PWD}/zdirectionaltemplate.h \
    $${PWD}/zlocalrect.h \
    $${PWD}/zsinglechannelstack.h \
+   $${PWD}/zstackprojector.h \
    $${PWD}/zbenchtimer.h \
    $${PWD}/zspgrowparser.h \
    $${PWD}/zvoxel.h \
@@ -96,6 +97,8 @@ HEADERS += $${PWD}/zstack.hxx \
    $${PWD}/flyem/zflyemneuron.h \
    $${PWD}/zswctypetrunkanalyzer.h \
    $${PWD}/zobject3dscan.h \
+   $${PWD}/zobject3dscancompact.h \
+   $${PWD}/zobject3dscanchunkfile.h \
    $${PWD}/zswclayershollfeatureanalyzer.h \
    $${PWD}/zswclayertrunkanalyzer.h \
    $${PWD}/zlogmessagereporter.h \
@@ -173,6 +176,14 @@ HEADERS += $${PWD}/zstack.hxx \
    $${PWD}/flyem/zflyem.h \
    $${PWD}/flyem/zflyemdatainfo.h \
    $${PWD}/dvid/zdvidinfo.h \
+   $${PWD}/dvid/zdvidblockcache.h \
+   $${PWD}/dvid/zdvidlabelblock.h \
+   $${PWD}/dvid/zdvidsynapsestore.h \
+   $${PWD}/dvid/zdvidmetrics.h \
+   $${PWD}/dvid/zdvidlabelcolorizer.h \
+   $${PWD}/core/cpufeature.h \
+   $${PWD}/zimagelut.h \
+   $${PWD}/dvid/zdvidtilecache.h \
    $${PWD}/zlinesegment.h \
    $${PWD}/zlinesegmentarray.h \
    $${PWD}/dvid/zdvidtarget.h \
@@ -195,6 +206,7 @@ HEADERS += $${PWD}/zstack.hxx \
    $${PWD}/zintcuboid.h \
    $${PWD}/bigdata/zdvidblockgrid.h \
    $${PWD}/bigdata/zstackblockgrid.h \
+   $${PWD}/bigdata/zcompressedstackblock.h \
    $${PWD}/bigdata/zblockgrid.h \
    $${PWD}/bigdata/zblockgridfactory.h \
    $${PWD}/zsparsestack.h \
@@ -249,6 +261,7 @@ SOURCES += $${PWD}/zstack.cxx \
    $${PWD}/zdirectionaltemplate.cpp \
    $${PWD}/zlocalrect.cpp \
    $${PWD}/zsinglechannelstack.cpp \
+   $${PWD}/zstackprojector.cpp \
    $${PWD}/zspgrowparser.cpp \
    $${PWD}/zvoxel.cpp \
    $${PWD}/zvoxelarray.cpp \
@@ -328,6 +341,8 @@ SOURCES += $${PWD}/zstack.cxx \
    $${PWD}/flyem/zflyemneuron.cpp \
    $${PWD}/zswctypetrunkanalyzer.cpp \
    $${PWD}/zobject3dscan.cpp \
+   $${PWD}/zobject3dscancompact.cpp \
+   $${PWD}/zobject3dscanchunkfile.cpp \
    $${PWD}/zswclayershollfeatureanalyzer.cpp \
    $${PWD}/zswclayertrunkanalyzer.cpp \
    $${PWD}/zstackgraph.cpp \
@@ -397,6 +412,14 @@ SOURCES += $${PWD}/zstack.cxx \
    $${PWD}/flyem/zflyemcoordinateconverter.cpp \
    $${PWD}/flyem/zflyemdatainfo.cpp \
    $${PWD}/dvid/zdvidinfo.cpp \
+   $${PWD}/dvid/zdvidblockcache.cpp \
+   $${PWD}/dvid/zdvidlabelblock.cpp \
+   $${PWD}/dvid/zdvidsynapsestore.cpp \
+   $${PWD}/dvid/zdvidmetrics.cpp \
+   $${PWD}/dvid/zdvidlabelcolorizer.cpp \
+   $${PWD}/core/cpufeature.cpp \
+   $${PWD}/zimagelut.cpp \
+   $${PWD}/dvid/zdvidtilecache.cpp \
    $${PWD}/zlinesegment.cpp \
    $${PWD}/zlinesegmentarray.cpp \
    $${PWD}/dvid/zdvidtarget.cpp \
@@ -417,6 +440,7 @@ SOURCES += $${PWD}/zstack.cxx \
    $${PWD}/zintcuboid.cpp \
    $${PWD}/bigdata/zdvidblockgrid.cpp \
    $${PWD}/bigdata/zstackblockgrid.cpp \
+   $${PWD}/bigdata/zcompressedstackblock.cpp \
    $${PWD}/bigdata/zblockgrid.cpp \
    $${PWD}/bigdata/zblockgridfactory.cpp \
    $${PWD}/zsparsestack.cpp \
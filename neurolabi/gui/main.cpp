@@ -28,6 +28,7 @@
 #include "sandbox/zsandbox.h"
 #include "flyem/zmainwindowcontroller.h"
 #include "flyem/zglobaldvidrepo.h"
+#include "dvid/zdvidmetrics.h"
 
 #if 0
 #ifdef _QT5_
@@ -429,6 +430,14 @@ int main(int argc, char *argv[])
 
   LINFO() << "Config path: " << configPath;
 
+  int metricsInterval = qgetenv("NEUTU_DVID_METRICS_INTERVAL").toInt();
+  if (metricsInterval > 0) {
+    LINFO() << "DVID metrics logged every" << metricsInterval << "seconds";
+    ZDvidMetrics::GetInstance().setLogger([](const std::string &json) {
+      LINFO() << "DVID metrics:" << json.c_str();
+    }, metricsInterval);
+  }
+
   if (guiEnabled) {
     LINFO() << "Start " + GET_SOFTWARE_NAME + " - " + GET_APPLICATION_NAME
             + " " + neutube::GetVersionString();
@@ -90,6 +90,9 @@ void NeutubeConfig::init(const std::string &userName)
   if (m_settings.contains("mesh_split_thre")) {
     m_meshSplitThreshold = m_settings.value("mesh_split_thre").toInt();
   }
+  if (m_settings.contains("tile_cache_size")) {
+    m_tileCacheSize = m_settings.value("tile_cache_size").toULongLong();
+  }
 #endif
 
   updateLogDir();
@@ -479,6 +482,24 @@ std::string NeutubeConfig::getPath(EConfigItem item) const
 #endif
     }
     return m_workDir;
+  case DVID_CACHE:
+  {
+    std::string cacheDir;
+#if defined(_QT_GUI_USED_)
+    cacheDir = QDir(getPath(WORKING_DIR).c_str()).filePath(
+          "dvid_cache").toStdString();
+    QDir cacheDirObj(cacheDir.c_str());
+    if (!cacheDirObj.exists()) {
+      if (!cacheDirObj.mkpath(cacheDir.c_str())) {
+        LERROR() << "Failed to make cache directory: " << cacheDir;
+        cacheDir = "";
+      }
+    }
+#else
+    cacheDir = ZString::fullPath(getPath(WORKING_DIR), "dvid_cache");
+#endif
+    return cacheDir;
+  }
   case LOG_DIR:
     return m_logDir;
   case LOG_DEST_DIR:
@@ -992,6 +1013,29 @@ size_t NeutubeConfig::GetMeshSplitThreshold()
   return getInstance().getMeshSplitThreshold();
 }
 
+void NeutubeConfig::setTileCacheSize(size_t byteNumber)
+{
+  m_tileCacheSize = byteNumber;
+#ifdef _QT_GUI_USED_
+  m_settings.setValue("tile_cache_size", qulonglong(byteNumber));
+#endif
+}
+
+size_t NeutubeConfig::getTileCacheSize() const
+{
+  return m_tileCacheSize;
+}
+
+void NeutubeConfig::SetTileCacheSize(size_t byteNumber)
+{
+  getInstance().setTileCacheSize(byteNumber);
+}
+
+size_t NeutubeConfig::GetTileCacheSize()
+{
+  return getInstance().getTileCacheSize();
+}
+
 int NeutubeConfig::GetVerboseLevel()
 {
   return getInstance().getVerboseLevel();
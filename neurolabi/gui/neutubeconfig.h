@@ -27,7 +27,7 @@ public:
     FLYEM_BODY_CONN_TRAIN_TRUTH, FLYEM_BODY_CONN_EVAL_DATA,
     FLYEM_BODY_CONN_EVAL_TRUTH, SWC_REPOSOTARY, AUTO_SAVE,
     CONFIGURE_FILE, SKELETONIZATION_CONFIG, DOCUMENT, TMP_DATA,
-    WORKING_DIR, LOG_DIR, LOG_DEST_DIR,
+    WORKING_DIR, LOG_DIR, LOG_DEST_DIR, DVID_CACHE,
     LOG_FILE, LOG_APPOUT, LOG_WARN, LOG_ERROR, LOG_TRACE
   };
 
@@ -100,6 +100,17 @@ public:
   static void SetMeshSplitThreshold(size_t thre);
   static size_t GetMeshSplitThreshold();
 
+  /*!
+   * \brief Memory budget (in bytes) of decoded tiles of a tile ensemble.
+   *
+   * 0 means the default size of ZDvidTileCache.
+   */
+  void setTileCacheSize(size_t byteNumber);
+  size_t getTileCacheSize() const;
+
+  static void SetTileCacheSize(size_t byteNumber);
+  static size_t GetTileCacheSize();
+
   static void SetAdvancedMode(bool on);
   static bool IsAdvancedMode();
 
@@ -145,6 +156,7 @@ public:
    *   SKELETONIZATION_CONFIG: configuration for skeletonization parameters
    *   TMP_DATA: folder for saving temporary data
    *   WORKING_DIR: working directory
+   *   DVID_CACHE: folder of the persistent DVID block cache
    *   LOG_DIR: logging directory
    *   LOG_FILE: prefix for logging files
    *   LOG_TRACE: prefix for tracing files
@@ -479,6 +491,7 @@ private:
   int m_verboseLevel;
   bool m_advancedMode = false;
   size_t m_meshSplitThreshold = 5000000;
+  size_t m_tileCacheSize = 0;
 
   ZMessageReporter *m_messageReporter; //Obsolete
 
@@ -5,6 +5,8 @@
 #include "neutubeconfig.h"
 #include "bigdata/zstackblockgrid.h"
 #include "bigdata/zblockgrid.h"
+#include "bigdata/zcompressedstackblock.h"
+#include "zobject3dscan.h"
 #include "zstack.hxx"
 
 #ifdef _USE_GTEST_
@@ -122,6 +124,139 @@ TEST(ZStackBlockGrid, basic)
   grid1.consume(grid2);
 
 
+}
+TEST(ZCompressedStackBlock, Codec)
+{
+  const int width = 8;
+  const int height = 4;
+  const int depth = 2;
+  const size_t voxelNumber = width * height * depth;
+  std::vector<uint8_t> data(voxelNumber);
+  std::vector<uint8_t> decoded(voxelNumber);
+
+  ZCompressedStackBlock block;
+  ASSERT_TRUE(block.isEmpty());
+  ASSERT_FALSE(block.decode(decoded.data()));
+
+  std::fill(data.begin(), data.end(), 7);
+  block.encode(data.data(), width, height, depth);
+  ASSERT_EQ(ZCompressedStackBlock::EEncoding::CONSTANT, block.getEncoding());
+  ASSERT_TRUE(block.isRandomAccessible());
+  ASSERT_EQ(7, block.getValueLocal(3, 2, 1));
+  ASSERT_TRUE(block.decode(decoded.data()));
+  ASSERT_TRUE(data == decoded);
+
+  for (size_t i = 0; i < voxelNumber; ++i) {
+    data[i] = (i % 3) * 50;
+  }
+  block.encode(data.data(), width, height, depth);
+  ASSERT_EQ(ZCompressedStackBlock::EEncoding::PALETTE, block.getEncoding());
+  ASSERT_LT(block.getMemoryUsage(), voxelNumber);
+  ASSERT_EQ(data[(1 * height + 2) * width + 5], block.getValueLocal(5, 2, 1));
+  ASSERT_TRUE(block.decode(decoded.data()));
+  ASSERT_TRUE(data == decoded);
+
+  for (size_t i = 0; i < voxelNumber; ++i) {
+    data[i] = (i % 20) * 3;
+  }
+  block.encode(data.data(), width, height, depth);
+  ASSERT_EQ(ZCompressedStackBlock::EEncoding::DEFLATE, block.getEncoding());
+  ASSERT_FALSE(block.isRandomAccessible());
+  ASSERT_TRUE(block.decode(decoded.data()));
+  ASSERT_TRUE(data == decoded);
+
+  unsigned int seed = 1;
+  for (size_t i = 0; i < voxelNumber; ++i) {
+    seed = seed * 1103515245 + 12345;
+    data[i] = (seed >> 16) & 0xFF;
+  }
+  block.encode(data.data(), width, height, depth);
+  ASSERT_EQ(ZCompressedStackBlock::EEncoding::RAW, block.getEncoding());
+  ASSERT_EQ(data[voxelNumber - 1], block.getValueLocal(7, 3, 1));
+  ASSERT_TRUE(block.decode(decoded.data()));
+  ASSERT_TRUE(data == decoded);
+
+  block.setOffset(ZIntPoint(10, 20, 30));
+  ZStack *stack = block.toStack();
+  ASSERT_EQ(width, stack->width());
+  ASSERT_EQ(10, stack->getOffset().getX());
+  ASSERT_EQ(data[0], stack->getIntValue(10, 20, 30));
+  delete stack;
+}
+
+TEST(ZStackBlockGrid, Compressing)
+{
+  ZStackBlockGrid grid;
+  grid.setCompressing(true);
+  grid.setGridSize(2, 1, 1);
+  grid.setBlockSize(4, 4, 4);
+
+  ZStack *stack = new ZStack(GREY, 4, 4, 4, 1);
+  stack->setOne();
+  grid.consumeStack(ZIntPoint(0, 0, 0), stack);
+
+  stack = new ZStack(GREY, 4, 4, 4, 1);
+  stack->setOffset(4, 0, 0);
+  for (int z = 0; z < 4; ++z) {
+    for (int y = 0; y < 4; ++y) {
+      for (int x = 0; x < 4; ++x) {
+        stack->setIntValue(x + 4, y, z, 0, x + y * 4 + z * 16);
+      }
+    }
+  }
+  grid.consumeStack(ZIntPoint(1, 0, 0), stack);
+
+  ASSERT_TRUE(grid.hasData());
+  ASSERT_TRUE(grid.hasBlock(ZIntPoint(0, 0, 0)));
+  ASSERT_TRUE(grid.hasBlock(ZIntPoint(1, 0, 0)));
+  ASSERT_LT(grid.getMemoryUsage(), size_t(128));
+
+  ASSERT_EQ(1, grid.getValue(2, 3, 1));
+  ASSERT_EQ(1 + 2 * 4 + 3 * 16, grid.getValue(5, 2, 3));
+
+  //Reading a compressed block does not keep it decompressed
+  size_t memoryUsage = grid.getMemoryUsage();
+  ASSERT_TRUE(grid.getStack(ZIntPoint(1, 0, 0)) == NULL);
+  stack = grid.makeStack(ZIntPoint(1, 0, 0));
+  ASSERT_TRUE(stack != NULL);
+  ASSERT_EQ(1 + 2 * 4 + 3 * 16, stack->getIntValue(5, 2, 3));
+  delete stack;
+  ASSERT_EQ(memoryUsage, grid.getMemoryUsage());
+
+  //A row across blocks and out of the grid
+  double row[10] = {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
+  grid.readRow(2, 2, 3, 8, row, 10.0);
+  ASSERT_EQ(11.0, row[0]);
+  ASSERT_EQ(11.0, row[1]);
+  for (int x = 4; x < 8; ++x) {
+    ASSERT_EQ(10.0 + x - 4 + 2 * 4 + 3 * 16, row[x - 2]);
+  }
+  ASSERT_EQ(-1.0, row[6]);
+  ASSERT_EQ(-1.0, row[7]);
+  ASSERT_EQ(-1.0, row[8]);
+  ASSERT_EQ(memoryUsage, grid.getMemoryUsage());
+
+  ZObject3dScan mask;
+  mask.addSegment(1, 2, 2, 6);
+  mask.addSegment(3, 0, 5, 7);
+
+  ZStackBlockGrid::MaskedSegmentIterator iter(&grid, &mask);
+  size_t voxelNumber = 0;
+  while (iter.hasNext()) {
+    const ZStackBlockGrid::MaskedSegmentIterator::Segment &seg = iter.next();
+    ASSERT_TRUE(seg.value != NULL);
+    for (int x = seg.x0; x <= seg.x1; ++x) {
+      ASSERT_EQ(grid.getValue(x, seg.y, seg.z), seg.value[x - seg.x0]);
+      ++voxelNumber;
+    }
+  }
+  ASSERT_EQ(mask.getVoxelNumber(), voxelNumber);
+
+  ZStack *out = grid.toStack();
+  ASSERT_EQ(8, out->width());
+  ASSERT_EQ(1, out->getIntValue(0, 0, 0));
+  ASSERT_EQ(1 + 2 * 4 + 3 * 16, out->getIntValue(5, 2, 3));
+  delete out;
 }
 #endif
 
@@ -1,9 +1,12 @@
 #ifndef ZDVIDANNOTATIONTEST_H
 #define ZDVIDANNOTATIONTEST_H
 
+#include <cstring>
+
 #include "ztestheader.h"
 #include "neutubeconfig.h"
 #include "dvid/zdvidannotation.h"
+#include "dvid/zdvidsynapsestore.h"
 #include "zjsonobject.h"
 #include "zjsonarray.h"
 #include "flyem/zflyemtodoitem.h"
@@ -56,6 +59,43 @@ TEST(ZDvidAnnotation, Json)
 
 }
 
+TEST(ZDvidAnnotation, Store)
+{
+  const char *data =
+      "[{\"Pos\":[1,2,3],\"Kind\":\"PreSyn\",\"Tags\":[\"t1\"],"
+      "\"Prop\":{\"conf\":\"0.5\",\"user\":\"alice\",\"count\":3},"
+      "\"Rels\":[{\"Rel\":\"PreSynTo\",\"To\":[4,5,6]},"
+      "{\"Rel\":\"Unlisted\",\"To\":[7,8,9]}]}]";
+
+  ZDvidSynapseStore store;
+  ASSERT_TRUE(store.decode(data, strlen(data)));
+
+  ZJsonArray jsonArray;
+  jsonArray.decode(data);
+  ZJsonObject json(jsonArray.value(0));
+
+  for (flyem::EDvidAnnotationLoadMode mode :
+       {flyem::EDvidAnnotationLoadMode::NO_PARTNER,
+        flyem::EDvidAnnotationLoadMode::PARTNER_LOCATION,
+        flyem::EDvidAnnotationLoadMode::PARTNER_RELJSON}) {
+    ZDvidAnnotation expected;
+    expected.loadJsonObject(json, mode);
+    ZDvidAnnotation annot;
+    annot.loadStore(store, 0, mode);
+
+    ASSERT_EQ(expected.getPosition(), annot.getPosition());
+    ASSERT_EQ(expected.getKind(), annot.getKind());
+    ASSERT_TRUE(annot.hasTag("t1"));
+    ASSERT_EQ("alice", annot.getUserName());
+    ASSERT_EQ("0.5", annot.getProperty<std::string>("conf"));
+    ASSERT_EQ(expected.getPartners(), annot.getPartners());
+    ASSERT_EQ(expected.getRelationJson().dumpString(0),
+              annot.getRelationJson().dumpString(0));
+    ASSERT_EQ(expected.toJsonObject().dumpString(0).size(),
+              annot.toJsonObject().dumpString(0).size());
+  }
+}
+
 TEST(ZDvidAnnotation, ZFlyEmToDoItem)
 {
   ZFlyEmToDoItem item;
@@ -0,0 +1,136 @@
+#ifndef ZDVIDBLOCKCACHETEST_H
+#define ZDVIDBLOCKCACHETEST_H
+
+#include <QDir>
+#include <QFile>
+
+#include "ztestheader.h"
+#include "dvid/zdvidblockcache.h"
+
+#ifdef _USE_GTEST_
+
+#if !defined(_WIN32)
+
+namespace {
+
+ZDvidBlockCache::Key MakeBlockCacheTestKey(int x)
+{
+  ZDvidBlockCache::Key key;
+  key.server = "emdata:8000";
+  key.uuid = "abcd";
+  key.instance = "grayscale";
+  key.zoom = 1;
+  key.x = x;
+  key.y = 2;
+  key.z = 3;
+
+  return key;
+}
+
+void FillNoise(std::vector<char> *data, unsigned *seed)
+{
+  for (char &c : *data) {
+    *seed = *seed * 1103515245 + 12345;
+    c = char(*seed >> 16);
+  }
+}
+
+}
+
+TEST(ZDvidBlockCache, Basic)
+{
+  QDir dir(QString::fromStdString(GET_TEST_DATA_DIR + "/_dvid_block_cache"));
+  dir.removeRecursively();
+  dir.mkpath(".");
+  std::string dirPath = dir.absolutePath().toStdString();
+
+  ZDvidBlockCache cache;
+  ASSERT_FALSE(cache.put(MakeBlockCacheTestKey(0), "a", 1));
+  ASSERT_FALSE(cache.open(dirPath + "_missing"));
+  ASSERT_TRUE(cache.open(dirPath, 3 * 8192, 8192));
+
+  //The directory is locked by the open cache
+  {
+    ZDvidBlockCache cache2;
+    ASSERT_FALSE(cache2.open(dirPath, 3 * 8192, 8192));
+  }
+
+  std::vector<char> block(4096);
+  for (size_t i = 0; i < block.size(); ++i) {
+    block[i] = i / 512;
+  }
+  unsigned seed = 1;
+  std::vector<char> noise(3000);
+  FillNoise(&noise, &seed);
+
+  ASSERT_TRUE(cache.put(MakeBlockCacheTestKey(0), block.data(), block.size()));
+  ASSERT_TRUE(cache.put(MakeBlockCacheTestKey(1), noise.data(), noise.size()));
+
+  std::vector<char> out;
+  ASSERT_TRUE(cache.get(MakeBlockCacheTestKey(0), &out));
+  ASSERT_EQ(block, out);
+  ASSERT_TRUE(cache.get(MakeBlockCacheTestKey(1), &out));
+  ASSERT_EQ(noise, out);
+  ASSERT_FALSE(cache.get(MakeBlockCacheTestKey(2), &out));
+  ASSERT_LT(cache.getDiskUsage(), 8192u);
+
+  std::vector<char> bigBlock(9000);
+  FillNoise(&bigBlock, &seed);
+  ASSERT_FALSE(cache.put(MakeBlockCacheTestKey(9), bigBlock.data(),
+                         bigBlock.size()));
+
+  //Reopen
+  cache.close();
+  ASSERT_TRUE(cache.open(dirPath, 3 * 8192, 8192));
+  ASSERT_EQ(2u, cache.getBlockNumber());
+  ASSERT_TRUE(cache.get(MakeBlockCacheTestKey(1), &out));
+  ASSERT_EQ(noise, out);
+
+  //Eviction keeps the block in use
+  for (int i = 10; i < 20; ++i) {
+    FillNoise(&noise, &seed);
+    ASSERT_TRUE(cache.put(MakeBlockCacheTestKey(i), noise.data(), noise.size()));
+    ASSERT_TRUE(cache.get(MakeBlockCacheTestKey(0), &out));
+  }
+  ASSERT_EQ(block, out);
+  ASSERT_LE(cache.getSegmentNumber(), 3u);
+  ASSERT_FALSE(cache.contains(MakeBlockCacheTestKey(1)));
+  ASSERT_TRUE(cache.contains(MakeBlockCacheTestKey(19)));
+
+  ASSERT_EQ(-1, cache.getNodeLockState("emdata:8000", "abcd"));
+  cache.setNodeLocked("emdata:8000", "abcd", true);
+  ASSERT_EQ(1, cache.getNodeLockState("emdata:8000", "abcd"));
+
+  size_t blockNumber = cache.getBlockNumber();
+  cache.close();
+  ASSERT_TRUE(cache.open(dirPath, 3 * 8192, 8192));
+  ASSERT_EQ(blockNumber, cache.getBlockNumber());
+  ASSERT_TRUE(cache.get(MakeBlockCacheTestKey(0), &out));
+  ASSERT_EQ(block, out);
+
+  //Segment ids are looked up by value when there are gaps
+  ASSERT_TRUE(cache.put(MakeBlockCacheTestKey(20), block.data(), block.size()));
+  ASSERT_EQ(3u, cache.getSegmentNumber());
+  QStringList segmentFileList =
+      dir.entryList(QStringList() << "segment_*.dat", QDir::Files, QDir::Name);
+  ASSERT_EQ(3, segmentFileList.size());
+  cache.close();
+  QFile::remove(dir.filePath(segmentFileList[1]));
+  ASSERT_TRUE(cache.open(dirPath, 3 * 8192, 8192));
+  ASSERT_EQ(2u, cache.getSegmentNumber());
+  ASSERT_TRUE(cache.get(MakeBlockCacheTestKey(20), &out));
+  ASSERT_EQ(block, out);
+
+  cache.clear();
+  ASSERT_EQ(0u, cache.getBlockNumber());
+  ASSERT_EQ(0u, cache.getSegmentNumber());
+  cache.close();
+
+  dir.removeRecursively();
+}
+
+#endif
+
+#endif
+
+#endif // ZDVIDBLOCKCACHETEST_H
@@ -0,0 +1,60 @@
+#ifndef ZDVIDBODYIDRESOLVERTEST_H
+#define ZDVIDBODYIDRESOLVERTEST_H
+
+#include "ztestheader.h"
+#include "dvid/zdvidbodyidresolver.h"
+
+#ifdef _USE_GTEST_
+
+TEST(ZDvidBodyIdResolver, Local)
+{
+  ZDvidBodyIdResolver resolver((ZDvidTarget()));
+  ASSERT_EQ(ZIntPoint(64, 64, 64), resolver.getBlockSize());
+  resolver.setChunkSize(0);
+  ASSERT_EQ(1, (int) resolver.getChunkSize());
+
+  resolver.setBlockSize(ZIntPoint(8, 8, 8));
+  ASSERT_EQ(ZIntPoint(8, 8, 8), resolver.getBlockSize());
+
+  int sourceCount = 0;
+  resolver.addLabelSource([&](const ZIntPoint &pt, uint64_t *label) {
+    ++sourceCount;
+    if (pt.getZ() == 1000) {
+      *label = pt.getX();
+      return true;
+    }
+    return false;
+  });
+  resolver.addLabelSource([](const ZIntPoint &pt, uint64_t *label) {
+    *label = (pt.getX() + 8) % 8 + 100;
+    return true;
+  });
+
+  std::vector<ZIntPoint> ptArray;
+  ptArray.push_back(ZIntPoint(5, 0, 1000));
+  ptArray.push_back(ZIntPoint(-8, 0, 16));
+  ptArray.push_back(ZIntPoint(-1, 7, 23));
+  ptArray.push_back(ZIntPoint(3, 0, 1000));
+  ptArray.push_back(ZIntPoint(-5, 2, 20));
+
+  std::vector<uint64_t> bodyArray = resolver.resolve(ptArray);
+  ASSERT_EQ(ptArray.size(), bodyArray.size());
+  ASSERT_EQ(5, (int) bodyArray[0]);
+  ASSERT_EQ(100, (int) bodyArray[1]);
+  ASSERT_EQ(107, (int) bodyArray[2]);
+  ASSERT_EQ(3, (int) bodyArray[3]);
+  ASSERT_EQ(103, (int) bodyArray[4]);
+
+  ASSERT_EQ(200, resolver.getStatusCode());
+  ASSERT_EQ(5, (int) resolver.getLocalCount());
+  ASSERT_EQ(0, (int) resolver.getRequestCount());
+  //Sources are tried in the order they are added
+  ASSERT_EQ(5, sourceCount);
+
+  ASSERT_TRUE(resolver.resolve(std::vector<ZIntPoint>()).empty());
+  ASSERT_EQ(0, (int) resolver.getLocalCount());
+}
+
+#endif
+
+#endif // ZDVIDBODYIDRESOLVERTEST_H
@@ -0,0 +1,155 @@
+#ifndef ZDVIDBODYSTREAMLOADERTEST_H
+#define ZDVIDBODYSTREAMLOADERTEST_H
+
+#include <map>
+
+#include "ztestheader.h"
+#include "zobject3dscan.h"
+#include "dvid/zdvidbodystreamloader.h"
+#include "dvid/zdvidreader.h"
+#include "dvid/zdvidinfo.h"
+
+#ifdef _USE_GTEST_
+
+TEST(ZDvidBodyStreamLoader, Partition)
+{
+  ASSERT_TRUE(ZDvidBodyStreamLoader::MakePartition(10, 9, 32, 64, 4).empty());
+  ASSERT_TRUE(ZDvidBodyStreamLoader::MakePartition(0, 9, 0, 64, 4).empty());
+
+  std::vector<std::pair<int, int>> partition =
+      ZDvidBodyStreamLoader::MakePartition(40, 300, 32, 100, 10);
+  ASSERT_EQ(3, (int) partition.size());
+  ASSERT_EQ(std::make_pair(32, 159), partition[0]);
+  ASSERT_EQ(std::make_pair(160, 287), partition[1]);
+  ASSERT_EQ(std::make_pair(288, 300), partition[2]);
+
+  //Too many parts
+  partition = ZDvidBodyStreamLoader::MakePartition(0, 1023, 32, 32, 4);
+  ASSERT_EQ(4, (int) partition.size());
+  ASSERT_EQ(std::make_pair(0, 255), partition[0]);
+  ASSERT_EQ(std::make_pair(768, 1023), partition[3]);
+
+  partition = ZDvidBodyStreamLoader::MakePartition(-40, 10, 32, 1, 0);
+  ASSERT_EQ(3, (int) partition.size());
+  ASSERT_EQ(std::make_pair(-64, -33), partition[0]);
+  ASSERT_EQ(std::make_pair(-32, -1), partition[1]);
+  ASSERT_EQ(std::make_pair(0, 10), partition[2]);
+}
+
+TEST(ZDvidBodyStreamLoader, CoarsePartition)
+{
+  ZDvidReader reader;
+  ZDvidBodyStreamLoader loader(reader);
+  loader.setPartDepth(64);
+  loader.setMinBlockNumber(4);
+
+  ZDvidInfo dvidInfo;
+  dvidInfo.setBlockSize(32, 32, 32);
+
+  ZObject3dScan coarseBody;
+  ASSERT_TRUE(loader.makePartition(coarseBody, dvidInfo, 0).empty());
+
+  //Too small to be partitioned
+  coarseBody.addSegment(1, 0, 0, 1);
+  coarseBody.addSegment(3, 0, 0, 0);
+  ASSERT_TRUE(loader.makePartition(coarseBody, dvidInfo, 0).empty());
+
+  coarseBody.addSegment(4, 0, 0, 0);
+  std::vector<std::pair<int, int>> partition =
+      loader.makePartition(coarseBody, dvidInfo, 0);
+  ASSERT_EQ(2, (int) partition.size());
+  ASSERT_EQ(std::make_pair(32, 95), partition[0]);
+  ASSERT_EQ(std::make_pair(96, 159), partition[1]);
+
+  //Aligned to blocks at zoom 1
+  partition = loader.makePartition(coarseBody, dvidInfo, 1);
+  ASSERT_EQ(3, (int) partition.size());
+  ASSERT_EQ(std::make_pair(0, 63), partition[0]);
+  ASSERT_EQ(std::make_pair(128, 159), partition[2]);
+
+  loader.setMinBlockNumber(0);
+  coarseBody.clear();
+  coarseBody.addSegment(0, 0, 0, 0);
+  partition = loader.makePartition(coarseBody, dvidInfo, 0);
+  ASSERT_EQ(1, (int) partition.size());
+  ASSERT_EQ(std::make_pair(0, 31), partition[0]);
+}
+
+TEST(ZDvidBodyStreamLoader, LoadParts)
+{
+  ZObject3dScan body;
+  for (int z = 0; z < 30; ++z) {
+    body.addSegment(z, z % 3, z, z + 5);
+  }
+
+  std::vector<std::string> urlArray;
+  std::map<QString, QByteArray> payloadMap;
+  for (int z = 0; z < 30; z += 10) {
+    std::string url = "http://localhost:8000/part" + std::to_string(z);
+    urlArray.push_back(url);
+    payloadMap[url.c_str()] = body.getSlice(z, z + 9).toDvidPayload();
+  }
+
+  ZDvidRequestEngine engine(2, 2);
+  engine.setHandler([&](const ZDvidRequestEngine::Request &request) {
+    ZDvidRequestEngine::Result result;
+    result.buffer = payloadMap.at(request.url);
+    result.status = neutube::EReadStatus::OK;
+    result.statusCode = 200;
+    return result;
+  });
+
+  ZDvidReader reader;
+  ZDvidBodyStreamLoader loader(reader);
+  loader.setRequestEngine(&engine);
+
+  std::vector<bool> received(urlArray.size(), false);
+  size_t voxelNumber = 0;
+  std::vector<std::shared_ptr<ZObject3dScan>> keptPartArray;
+  ZObject3dScan result;
+  loader.loadParts(
+        1, urlArray, false, true, &result,
+        [&](const std::shared_ptr<ZObject3dScan> &part, int index,
+        int partNumber) {
+    ASSERT_EQ(3, partNumber);
+    received[index] = true;
+    voxelNumber += part->getVoxelNumber();
+    ASSERT_EQ(index * 10, part->getMinZ());
+    ASSERT_EQ(1, (int) part->getLabel());
+    keptPartArray.push_back(part);
+  });
+
+  ASSERT_EQ(200, loader.getStatusCode());
+  ASSERT_EQ(std::vector<bool>(3, true), received);
+  ASSERT_EQ(body.getVoxelNumber(), voxelNumber);
+  ASSERT_TRUE(body.equalsLiterally(result));
+  ASSERT_EQ(1, (int) result.getLabel());
+
+  //Parts kept by the receiver are not copied or cleared by the loader
+  ASSERT_EQ(3, (int) keptPartArray.size());
+  for (const std::shared_ptr<ZObject3dScan> &part : keptPartArray) {
+    ASSERT_EQ(1, (int) part.use_count());
+    ASSERT_EQ(60, (int) part->getVoxelNumber());
+  }
+
+  //A failed part leaves the result empty
+  engine.setHandler([&](const ZDvidRequestEngine::Request &request) {
+    ZDvidRequestEngine::Result result;
+    if (request.url.endsWith("part10")) {
+      result.status = neutube::EReadStatus::FAILED;
+      result.statusCode = 500;
+    } else {
+      result.buffer = payloadMap.at(request.url);
+      result.status = neutube::EReadStatus::OK;
+      result.statusCode = 200;
+    }
+    return result;
+  });
+  loader.loadParts(1, urlArray, false, true, &result);
+  ASSERT_EQ(500, loader.getStatusCode());
+  ASSERT_TRUE(result.isEmpty());
+}
+
+#endif
+
+#endif // ZDVIDBODYSTREAMLOADERTEST_H
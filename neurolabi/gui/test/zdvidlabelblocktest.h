@@ -0,0 +1,226 @@
+#ifndef ZDVIDLABELBLOCKTEST_H
+#define ZDVIDLABELBLOCKTEST_H
+
+#include <algorithm>
+#include <cstring>
+#include <zlib.h>
+
+#include "ztestheader.h"
+#include "dvid/zdvidlabelblock.h"
+#include "zobject3dscan.h"
+#include "zintcuboid.h"
+
+#ifdef _USE_GTEST_
+
+namespace {
+
+std::vector<uint64_t> MakeLabelBlockTestData(
+    int width, int height, int depth, int labelNumber)
+{
+  std::vector<uint64_t> data(size_t(width) * height * depth);
+  size_t index = 0;
+  for (int z = 0; z < depth; ++z) {
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        data[index++] =
+            (x / 5 + y / 7 * 3 + z / 3 * 11) % labelNumber + 1000000000000ull;
+      }
+    }
+  }
+
+  return data;
+}
+
+std::vector<char> GzipLabelBlockTestData(const std::vector<char> &data)
+{
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8,
+               Z_DEFAULT_STRATEGY);
+  std::vector<char> out(deflateBound(&stream, data.size()) + 32);
+  stream.next_in = (Bytef*) data.data();
+  stream.avail_in = data.size();
+  stream.next_out = (Bytef*) out.data();
+  stream.avail_out = out.size();
+  deflate(&stream, Z_FINISH);
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  return out;
+}
+
+}
+
+TEST(ZDvidLabelBlock, Encode)
+{
+  ZDvidLabelBlock block;
+  ASSERT_TRUE(block.isEmpty());
+  uint64_t value = 1;
+  ASSERT_FALSE(block.encode(&value, 1, 1, 1));
+
+  int width = 24;
+  int height = 16;
+  int depth = 32;
+  for (int labelNumber : {1, 2, 17}) {
+    std::vector<uint64_t> data =
+        MakeLabelBlockTestData(width, height, depth, labelNumber);
+    ASSERT_TRUE(block.encode(data.data(), width, height, depth));
+    ASSERT_EQ(width, block.getWidth());
+    ASSERT_EQ(height, block.getHeight());
+    ASSERT_EQ(depth, block.getDepth());
+    ASSERT_LT(block.getMemoryUsage(), data.size() * sizeof(uint64_t) / 8);
+
+    std::vector<uint64_t> decoded(data.size());
+    block.decode(decoded.data());
+    ASSERT_EQ(data, decoded);
+
+    block.setOffset(ZIntPoint(100, 200, 300));
+    ASSERT_EQ(ZIntCuboid(100, 200, 300, 123, 215, 331), block.getBoundBox());
+    for (size_t i = 0; i < data.size(); i += 7) {
+      int x = i % width;
+      int y = (i / width) % height;
+      int z = i / width / height;
+      ASSERT_EQ(data[i], block.getValueLocal(x, y, z));
+      ASSERT_EQ(data[i], block.getValue(x + 100, y + 200, z + 300));
+    }
+    ASSERT_EQ(0u, block.getValue(0, 0, 0));
+
+    std::vector<char> byteArray = block.toByteArray();
+    ZDvidLabelBlock block2;
+    ASSERT_TRUE(block2.load(byteArray.data(), byteArray.size()));
+    ASSERT_EQ(byteArray, block2.toByteArray());
+    if (labelNumber > 1) {
+      ASSERT_FALSE(block2.load(byteArray.data(), byteArray.size() - 1));
+      ASSERT_TRUE(block2.isEmpty());
+    }
+  }
+
+  //All voxels are different
+  std::vector<uint64_t> data(size_t(width) * height * depth);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = i;
+  }
+  ASSERT_TRUE(block.encode(data.data(), width, height, depth));
+  std::vector<uint64_t> decoded(data.size());
+  block.decode(decoded.data());
+  ASSERT_EQ(data, decoded);
+}
+
+TEST(ZDvidLabelBlock, Extract)
+{
+  int width = 24;
+  int height = 16;
+  int depth = 32;
+  std::vector<uint64_t> data = MakeLabelBlockTestData(width, height, depth, 5);
+  data[100] = 7;
+
+  ZDvidLabelBlock block;
+  block.encode(data.data(), width, height, depth);
+  block.setOffset(ZIntPoint(8, 16, 24));
+
+  auto getValue = [&](int x, int y, int z) {
+    return data[(size_t(z) * height + y) * width + x];
+  };
+
+  std::vector<uint64_t> slice(width * height);
+  ASSERT_TRUE(block.extractSlice(neutube::EAxis::Z, 13, slice.data()));
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      ASSERT_EQ(getValue(x, y, 13), slice[y * width + x]);
+    }
+  }
+
+  slice.resize(width * depth);
+  ASSERT_TRUE(block.extractSlice(neutube::EAxis::Y, 9, slice.data()));
+  for (int z = 0; z < depth; ++z) {
+    for (int x = 0; x < width; ++x) {
+      ASSERT_EQ(getValue(x, 9, z), slice[z * width + x]);
+    }
+  }
+
+  slice.resize(height * depth);
+  ASSERT_TRUE(block.extractSlice(neutube::EAxis::X, 23, slice.data()));
+  for (int z = 0; z < depth; ++z) {
+    for (int y = 0; y < height; ++y) {
+      ASSERT_EQ(getValue(23, y, z), slice[z * height + y]);
+    }
+  }
+  ASSERT_FALSE(block.extractSlice(neutube::EAxis::X, 24, slice.data()));
+
+  ASSERT_TRUE(block.hasLabel(7));
+  ASSERT_FALSE(block.hasLabel(8));
+  ASSERT_EQ(6u, block.getLabelSet().size());
+
+  for (uint64_t label : {uint64_t(7), data[0], data[500]}) {
+    ZObject3dScan obj;
+    size_t voxelNumber = block.appendObject(label, &obj);
+    ASSERT_EQ(size_t(std::count(data.begin(), data.end(), label)),
+              voxelNumber);
+    ASSERT_EQ(voxelNumber, obj.getVoxelNumber());
+    for (int z = 0; z < depth; ++z) {
+      for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+          ASSERT_EQ(getValue(x, y, z) == label,
+                    obj.contains(x + 8, y + 16, z + 24));
+        }
+      }
+    }
+  }
+
+  ZObject3dScan obj;
+  ASSERT_EQ(0u, block.appendObject(8, &obj));
+  ASSERT_TRUE(obj.isEmpty());
+
+  ZIntCuboid range(10, 20, 30, 27, 25, 40);
+  for (uint64_t label : {data[0], data[500]}) {
+    obj.clear();
+    size_t voxelNumber = block.appendObject(label, range, &obj, false);
+    obj.canonize();
+    ASSERT_EQ(voxelNumber, obj.getVoxelNumber());
+    size_t count = 0;
+    for (int z = 0; z < depth; ++z) {
+      for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+          bool expected = getValue(x, y, z) == label &&
+              range.contains(x + 8, y + 16, z + 24);
+          if (expected) {
+            ++count;
+          }
+          ASSERT_EQ(expected, obj.contains(x + 8, y + 16, z + 24));
+        }
+      }
+    }
+    ASSERT_EQ(count, voxelNumber);
+  }
+
+  obj.clear();
+  ASSERT_EQ(0u, block.appendObject(
+              data[0], ZIntCuboid(0, 0, 0, 7, 100, 100), &obj));
+  ASSERT_TRUE(obj.isEmpty());
+}
+
+TEST(ZDvidLabelBlock, LoadCompressed)
+{
+  int width = 24;
+  int height = 16;
+  int depth = 32;
+  std::vector<uint64_t> data = MakeLabelBlockTestData(width, height, depth, 5);
+
+  ZDvidLabelBlock block;
+  block.encode(data.data(), width, height, depth);
+  std::vector<char> byteArray = block.toByteArray();
+  std::vector<char> compressed = GzipLabelBlockTestData(byteArray);
+
+  ZDvidLabelBlock block2;
+  ASSERT_TRUE(block2.loadCompressed(compressed.data(), compressed.size()));
+  ASSERT_EQ(byteArray, block2.toByteArray());
+
+  ASSERT_FALSE(block2.loadCompressed(compressed.data(), compressed.size() / 2));
+  ASSERT_TRUE(block2.isEmpty());
+  ASSERT_FALSE(block2.loadCompressed(byteArray.data(), byteArray.size()));
+  ASSERT_TRUE(block2.isEmpty());
+}
+
+#endif
+
+#endif // ZDVIDLABELBLOCKTEST_H
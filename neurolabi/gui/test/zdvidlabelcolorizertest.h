@@ -0,0 +1,69 @@
+#ifndef ZDVIDLABELCOLORIZERTEST_H
+#define ZDVIDLABELCOLORIZERTEST_H
+
+#include <vector>
+
+#include "ztestheader.h"
+#include "dvid/zdvidlabelcolorizer.h"
+
+#ifdef _USE_GTEST_
+
+TEST(ZDvidLabelColorizer, Paint)
+{
+  ZDvidLabelColorizer colorizer;
+  ASSERT_TRUE(colorizer.isEmpty());
+
+  const int width = 1000;
+  const int height = 300;
+  std::vector<uint64_t> label(width * height);
+  for (size_t i = 0; i < label.size(); ++i) {
+    label[i] = (i / 7) % 50 + 1000000000000ull;
+  }
+
+  for (int threadNumber = 1; threadNumber <= 4; threadNumber *= 2) {
+    colorizer.setThreadNumber(threadNumber);
+    colorizer.setLabelField(label.data(), width, height);
+    ASSERT_FALSE(colorizer.isEmpty());
+    ASSERT_EQ(50, (int) colorizer.getLabelArray().size());
+
+    int resolveCount = 0;
+    colorizer.updateColor([&](uint64_t v) {
+      ++resolveCount;
+      return uint32_t(v % 1000);
+    });
+    ASSERT_EQ(50, resolveCount);
+
+    const size_t stride = width + 3;
+    std::vector<uint32_t> image(stride * height, 0xFFFFFFFF);
+    colorizer.paint(image.data(), stride);
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        ASSERT_EQ(uint32_t(label[y * width + x] % 1000), image[y * stride + x]);
+      }
+      ASSERT_EQ(0xFFFFFFFF, image[y * stride + width]);
+    }
+
+    std::vector<uint32_t> transposed(width * height);
+    colorizer.paintTranspose(transposed.data(), height);
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        ASSERT_EQ(uint32_t(label[y * width + x] % 1000),
+                  transposed[x * height + y]);
+      }
+    }
+  }
+
+  //Recolored without indexing again
+  colorizer.updateColor([](uint64_t v) { return uint32_t(v % 2); });
+  std::vector<uint32_t> image(width * height);
+  colorizer.paint(image.data(), width);
+  ASSERT_EQ(uint32_t(label[width * 10 + 20] % 2), image[width * 10 + 20]);
+
+  colorizer.clear();
+  ASSERT_TRUE(colorizer.isEmpty());
+  ASSERT_TRUE(colorizer.getLabelArray().empty());
+}
+
+#endif
+
+#endif // ZDVIDLABELCOLORIZERTEST_H
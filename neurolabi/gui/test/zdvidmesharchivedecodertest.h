@@ -0,0 +1,105 @@
+#ifndef ZDVIDMESHARCHIVEDECODERTEST_H
+#define ZDVIDMESHARCHIVEDECODERTEST_H
+
+#include <set>
+#include <atomic>
+
+#include <QThreadPool>
+
+#include "ztestheader.h"
+#include "dvid/zdvidmesharchivedecoder.h"
+#include "zmesh.h"
+
+#ifdef _USE_GTEST_
+
+namespace {
+
+ZDvidMeshArchiveDecoder::EntryReader MakeMeshArchiveTestReader(
+    int entryNumber, int *readCount)
+{
+  return [=](ZDvidMeshArchiveDecoder::Entry &entry) {
+    if (*readCount >= entryNumber) {
+      return false;
+    }
+    ++(*readCount);
+    entry.name = std::to_string(*readCount) + ".drc";
+    entry.data.assign(10, char(*readCount % 2)); //Odd entries are valid
+    return true;
+  };
+}
+
+ZMesh* DecodeMeshArchiveTestEntry(const ZDvidMeshArchiveDecoder::Entry &entry)
+{
+  if (entry.data[0] == 1) {
+    return new ZMesh;
+  }
+
+  return NULL;
+}
+
+}
+
+TEST(ZDvidMeshArchiveDecoder, Decode)
+{
+  ASSERT_EQ(123, (int) ZDvidMeshArchiveDecoder::GetMeshId("123.drc"));
+  ASSERT_EQ(0, (int) ZDvidMeshArchiveDecoder::GetMeshId("mesh"));
+
+  ZDvidMeshArchiveDecoder decoder;
+  decoder.setThreadNumber(4);
+  decoder.setWindowSize(3);
+  decoder.setDecodeFunction(DecodeMeshArchiveTestEntry);
+  std::atomic<int> processCount(0);
+  decoder.setPostProcess([&](ZMesh*) { ++processCount; });
+
+  int readCount = 0;
+  int maxPending = 0;
+  std::set<uint64_t> idSet;
+  size_t lastDone = 0;
+  size_t lastTotal = 0;
+  size_t count = decoder.decode(
+        MakeMeshArchiveTestReader(100, &readCount), [&](ZMesh *mesh) {
+    idSet.insert(mesh->getLabel());
+    delete mesh;
+  }, [&](size_t done, size_t total) {
+    //Entries read but not delivered stay within the window
+    maxPending = std::max(maxPending, readCount - int(done / 10));
+    lastDone = done;
+    lastTotal = total;
+  });
+
+  ASSERT_EQ(50, (int) count);
+  ASSERT_EQ(50, (int) idSet.size());
+  ASSERT_EQ(50, processCount.load());
+  ASSERT_EQ(1, (int) *idSet.begin());
+  ASSERT_EQ(99, (int) *idSet.rbegin());
+  ASSERT_EQ(1000, (int) lastDone);
+  ASSERT_EQ(1000, (int) lastTotal);
+  ASSERT_LE(maxPending, 3);
+
+  //Canceled in the middle
+  readCount = 0;
+  count = decoder.decode(
+        MakeMeshArchiveTestReader(100, &readCount), [&](ZMesh *mesh) {
+    delete mesh;
+    decoder.cancel();
+  });
+  ASSERT_EQ(1, (int) count);
+  ASSERT_TRUE(decoder.isCanceled());
+  ASSERT_LT(readCount, 100);
+
+  //Decoded in the calling thread without a free thread in the pool
+  QThreadPool *pool = QThreadPool::globalInstance();
+  int maxThreadCount = pool->maxThreadCount();
+  pool->setMaxThreadCount(0);
+  readCount = 0;
+  count = decoder.decode(
+        MakeMeshArchiveTestReader(20, &readCount), [&](ZMesh *mesh) {
+    delete mesh;
+  });
+  pool->setMaxThreadCount(maxThreadCount);
+  ASSERT_EQ(10, (int) count);
+}
+
+#endif
+
+#endif // ZDVIDMESHARCHIVEDECODERTEST_H
@@ -0,0 +1,85 @@
+#ifndef ZDVIDMETRICSTEST_H
+#define ZDVIDMETRICSTEST_H
+
+#include "ztestheader.h"
+#include "dvid/zdvidmetrics.h"
+
+#ifdef _USE_GTEST_
+
+TEST(ZDvidMetrics, Endpoint)
+{
+  ASSERT_EQ(ZDvidMetrics::EEndpoint::SPARSEVOL, ZDvidMetrics::GetEndpoint(
+              "http://emdata:8000/api/node/a1b2/segmentation/sparsevol/1"));
+  ASSERT_EQ(ZDvidMetrics::EEndpoint::SPARSEVOL, ZDvidMetrics::GetEndpoint(
+              "/api/node/a1b2/segmentation/sparsevol-coarse/1?format=blocks"));
+  ASSERT_EQ(ZDvidMetrics::EEndpoint::TILE, ZDvidMetrics::GetEndpoint(
+              "http://emdata:8000/api/node/a1b2/tiles/tile/xy/0/1_2_3"));
+  ASSERT_EQ(ZDvidMetrics::EEndpoint::BLOCKS, ZDvidMetrics::GetEndpoint(
+              "/api/node/a1b2/grayscale/specificblocks?blocks=1,2,3"));
+  ASSERT_EQ(ZDvidMetrics::EEndpoint::LABELS, ZDvidMetrics::GetEndpoint(
+              "/api/node/a1b2/segmentation/label/1_2_3"));
+  ASSERT_EQ(ZDvidMetrics::EEndpoint::LABELS, ZDvidMetrics::GetEndpoint(
+              "/api/node/a1b2/segmentation/labels"));
+  ASSERT_EQ(ZDvidMetrics::EEndpoint::VOXELS, ZDvidMetrics::GetEndpoint(
+              "/api/node/a1b2/grayscale/raw/0_1/512_512/0_0_100"));
+  ASSERT_EQ(ZDvidMetrics::EEndpoint::KEYVALUE, ZDvidMetrics::GetEndpoint(
+              "/api/node/a1b2/bookmarks/key/100"));
+  ASSERT_EQ(ZDvidMetrics::EEndpoint::ANNOTATION, ZDvidMetrics::GetEndpoint(
+              "/api/node/a1b2/synapses/elements/10_10_10/0_0_0"));
+  ASSERT_EQ(ZDvidMetrics::EEndpoint::ANNOTATION, ZDvidMetrics::GetEndpoint(
+              "/api/node/a1b2/synapses/label/1?relationships=true"));
+  ASSERT_EQ(ZDvidMetrics::EEndpoint::OTHER, ZDvidMetrics::GetEndpoint(
+              "/api/node/a1b2/info"));
+  ASSERT_EQ(ZDvidMetrics::EEndpoint::OTHER, ZDvidMetrics::GetEndpoint(
+              "/api/server/info"));
+}
+
+TEST(ZDvidMetrics, Record)
+{
+  ZDvidMetrics metrics;
+
+  metrics.recordRequest(
+        "/api/node/a1b2/tiles/tile/xy/0/1_2_3", 0.5, 0, 100, true);
+  metrics.recordRequest(ZDvidMetrics::EEndpoint::TILE, 15.0, 10, 200, true);
+  metrics.recordRequest(ZDvidMetrics::EEndpoint::TILE, 10000.0, 0, 0, false);
+  metrics.recordDecode(ZDvidMetrics::EEndpoint::TILE, 2.5);
+
+  ZDvidMetrics::Stat stat = metrics.getStat(ZDvidMetrics::EEndpoint::TILE);
+  ASSERT_EQ(3, (int) stat.requestCount);
+  ASSERT_EQ(1, (int) stat.failureCount);
+  ASSERT_EQ(10, (int) stat.sentByteCount);
+  ASSERT_EQ(300, (int) stat.receivedByteCount);
+  ASSERT_DOUBLE_EQ(10015.5, stat.latency);
+  ASSERT_DOUBLE_EQ(10015.5 / 3, stat.getMeanLatency());
+  ASSERT_EQ(1, (int) stat.decodeCount);
+  ASSERT_DOUBLE_EQ(2.5, stat.decodeTime);
+
+  ASSERT_EQ(ZDvidMetrics::GetHistogramBound().size() + 1,
+            stat.histogram.size());
+  ASSERT_EQ(1, (int) stat.histogram.front()); //<= 1ms
+  ASSERT_EQ(1, (int) stat.histogram[4]); //(10ms, 20ms]
+  ASSERT_EQ(1, (int) stat.histogram.back()); //Overflow
+
+  stat = metrics.getStat(ZDvidMetrics::EEndpoint::SPARSEVOL);
+  ASSERT_EQ(0, (int) stat.requestCount);
+
+  metrics.setEnabled(false);
+  metrics.recordRequest(ZDvidMetrics::EEndpoint::TILE, 1.0, 0, 0, true);
+  ASSERT_EQ(3, (int) metrics.getStat(
+              ZDvidMetrics::EEndpoint::TILE).requestCount);
+  metrics.setEnabled(true);
+
+  int logCount = 0;
+  metrics.setLogger([&](const std::string&) { ++logCount; }, 0);
+  metrics.recordRequest(ZDvidMetrics::EEndpoint::TILE, 1.0, 0, 0, true);
+  ASSERT_EQ(0, logCount);
+
+  metrics.reset();
+  stat = metrics.getStat(ZDvidMetrics::EEndpoint::TILE);
+  ASSERT_EQ(0, (int) stat.requestCount);
+  ASSERT_EQ(0, (int) stat.histogram.back());
+}
+
+#endif
+
+#endif // ZDVIDMETRICSTEST_H
@@ -0,0 +1,108 @@
+#ifndef ZDVIDREQUESTCOALESCERTEST_H
+#define ZDVIDREQUESTCOALESCERTEST_H
+
+#include <thread>
+#include <atomic>
+
+#include "ztestheader.h"
+#include "dvid/zdvidrequestcoalescer.h"
+
+#ifdef _USE_GTEST_
+
+TEST(ZDvidRequestCoalescer, Key)
+{
+  ASSERT_EQ(QString("http://emdata1:8000/api/node/1234/grayscale/info"),
+            ZDvidRequestCoalescer::NormalizeUrl(
+              "HTTP://EMDATA1:8000/api/node/1234/grayscale/info"));
+  ASSERT_EQ(ZDvidRequestCoalescer::NormalizeUrl(
+              "http://EMDATA1:8000/api//node/1234/grayscale/info/"),
+            ZDvidRequestCoalescer::NormalizeUrl(
+              "http://emdata1:8000/api/node/1234/grayscale/info"));
+  ASSERT_EQ(ZDvidRequestCoalescer::NormalizeUrl(
+              "http://emdata1:8000/api/node/1234/bodies/sparsevol/1?minz=1&maxz=2"),
+            ZDvidRequestCoalescer::NormalizeUrl(
+              "http://emdata1:8000/api/node/1234/bodies/sparsevol/1?maxz=2&minz=1"));
+  ASSERT_NE(ZDvidRequestCoalescer::NormalizeUrl(
+              "http://emdata1:8000/api/node/1234/Grayscale/info"),
+            ZDvidRequestCoalescer::NormalizeUrl(
+              "http://emdata1:8000/api/node/1234/grayscale/info"));
+
+  QString url = "http://emdata1:8000/api/node/1234/labels";
+  ASSERT_EQ(ZDvidRequestCoalescer::MakeKey(url, "[1,2]"),
+            ZDvidRequestCoalescer::MakeKey(url, "[1,2]"));
+  ASSERT_NE(ZDvidRequestCoalescer::MakeKey(url, "[1,2]"),
+            ZDvidRequestCoalescer::MakeKey(url, "[1,3]"));
+  ASSERT_NE(ZDvidRequestCoalescer::MakeKey(url),
+            ZDvidRequestCoalescer::MakeKey(url, QByteArray(), "POST"));
+}
+
+TEST(ZDvidRequestCoalescer, Fetch)
+{
+  ZDvidRequestCoalescer coalescer;
+  std::atomic<int> fetchCount(0);
+  std::atomic<bool> blocking(true);
+
+  auto fetcher = [&]() {
+    ++fetchCount;
+    while (blocking) {
+      std::this_thread::yield();
+    }
+    ZDvidRequestCoalescer::Result result;
+    result.buffer = "test";
+    result.status = neutube::EReadStatus::OK;
+    result.statusCode = 200;
+    return result;
+  };
+
+  ZDvidRequestCoalescer::Result result1;
+  ZDvidRequestCoalescer::Result result2;
+  std::thread thread1([&]() { result1 = coalescer.fetch("key", fetcher); });
+  while (fetchCount == 0) {
+    std::this_thread::yield();
+  }
+  std::thread thread2([&]() { result2 = coalescer.fetch("key", fetcher); });
+  while (coalescer.getCoalescedCount() == 0) {
+    std::this_thread::yield();
+  }
+  blocking = false;
+  thread1.join();
+  thread2.join();
+
+  ASSERT_EQ(1, fetchCount);
+  ASSERT_EQ(1u, coalescer.getFetchCount());
+  ASSERT_EQ(QByteArray("test"), result1.buffer);
+  ASSERT_EQ(QByteArray("test"), result2.buffer);
+  ASSERT_EQ(200, result2.statusCode);
+
+  //Not cached without a lifetime
+  coalescer.fetch("key", fetcher);
+  ASSERT_EQ(2, fetchCount);
+
+  coalescer.fetch("key", fetcher, 60000);
+  ASSERT_EQ(3, fetchCount);
+  result1 = coalescer.fetch("key", fetcher, 60000);
+  ASSERT_EQ(3, fetchCount);
+  ASSERT_EQ(1u, coalescer.getCacheHitCount());
+  ASSERT_EQ(QByteArray("test"), result1.buffer);
+
+  coalescer.clearCache();
+  coalescer.fetch("key", fetcher, 60000);
+  ASSERT_EQ(4, fetchCount);
+
+  //Failed responses are not cached
+  auto failedFetcher = [&]() {
+    ++fetchCount;
+    ZDvidRequestCoalescer::Result result;
+    result.status = neutube::EReadStatus::FAILED;
+    result.statusCode = 404;
+    return result;
+  };
+  coalescer.fetch("key2", failedFetcher, 60000);
+  result1 = coalescer.fetch("key2", failedFetcher, 60000);
+  ASSERT_EQ(6, fetchCount);
+  ASSERT_EQ(404, result1.statusCode);
+}
+
+#endif
+
+#endif // ZDVIDREQUESTCOALESCERTEST_H
@@ -0,0 +1,96 @@
+#ifndef ZDVIDREQUESTENGINETEST_H
+#define ZDVIDREQUESTENGINETEST_H
+
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "ztestheader.h"
+#include "dvid/zdvidrequestengine.h"
+
+#ifdef _USE_GTEST_
+
+TEST(ZDvidRequestEngine, Schedule)
+{
+  ZDvidRequestEngine engine(1, 1);
+  ASSERT_EQ(1, engine.getMaxInFlight());
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool blocking = true;
+  std::vector<QString> urlArray;
+
+  engine.setHandler([&](const ZDvidRequestEngine::Request &request) {
+    if (request.url.endsWith("first")) {
+      std::unique_lock<std::mutex> lock(mutex);
+      condition.wait(lock, [&]() { return !blocking; });
+    }
+    urlArray.push_back(request.url);
+
+    ZDvidRequestEngine::Result result;
+    result.buffer = request.url.toLatin1();
+    result.status = neutube::EReadStatus::OK;
+    result.statusCode = 200;
+    return result;
+  });
+
+  ZDvidRequestEngine::Handle first =
+      engine.submit("http://localhost:8000/first");
+  while (engine.getInFlightNumber() == 0) {
+    std::this_thread::yield();
+  }
+
+  std::atomic<int> callbackCount(0);
+  ZDvidRequestEngine::Callback callback =
+      [&](const ZDvidRequestEngine::Result &) { ++callbackCount; };
+  ZDvidRequestEngine::Handle low =
+      engine.submit("http://localhost:8000/low", 0, callback);
+  ZDvidRequestEngine::Handle high =
+      engine.submit("http://localhost:8000/high", 5, callback);
+  ZDvidRequestEngine::Handle canceled =
+      engine.submit("http://localhost:8000/canceled", 9, callback);
+  ASSERT_EQ(3, (int) engine.getPendingNumber());
+
+  ASSERT_TRUE(canceled.cancel());
+  ASSERT_TRUE(canceled.isDone());
+  ASSERT_FALSE(canceled.cancel());
+  ASSERT_EQ(neutube::EReadStatus::CANCELED, canceled.getResult().status);
+  ASSERT_EQ(2, (int) engine.getPendingNumber());
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    blocking = false;
+  }
+  condition.notify_all();
+
+  low.wait();
+  high.wait();
+  ASSERT_EQ(2, callbackCount.load());
+  ASSERT_EQ("http://localhost:8000/high",
+            QString(high.getResult().buffer).toStdString());
+  ASSERT_EQ(200, first.getResult().statusCode);
+
+  ASSERT_EQ(3, (int) urlArray.size());
+  ASSERT_TRUE(urlArray[1].endsWith("high"));
+  ASSERT_TRUE(urlArray[2].endsWith("low"));
+
+  ZDvidRequestEngine::Request jobRequest;
+  jobRequest.url = "http://localhost:8000/job";
+  jobRequest.job = []() {
+    ZDvidRequestEngine::Result result;
+    result.buffer = "job";
+    result.statusCode = 200;
+    return result;
+  };
+  ASSERT_EQ("job", QString(engine.submit(jobRequest).getResult().buffer).
+            toStdString());
+  ASSERT_EQ(3, (int) urlArray.size());
+
+  ZDvidRequestEngine::Handle handle;
+  ASSERT_FALSE(handle.isValid());
+  ASSERT_TRUE(handle.isDone());
+}
+
+#endif
+
+#endif // ZDVIDREQUESTENGINETEST_H
@@ -33,6 +33,16 @@ TEST(ZDvidRoi, Basic)
   ASSERT_TRUE(roi.contains(7, 5, 3));
   ASSERT_FALSE(roi.contains(8, 5, 3));
 
+  std::vector<ZIntPoint> ptArray;
+  ptArray.push_back(ZIntPoint(8, 5, 3));
+  ptArray.push_back(ZIntPoint(6, 4, 2));
+  ptArray.push_back(ZIntPoint(7, 5, 3));
+  std::vector<bool> result = roi.containsBatch(ptArray);
+  ASSERT_EQ(3, (int) result.size());
+  ASSERT_FALSE(result[0]);
+  ASSERT_TRUE(result[1]);
+  ASSERT_TRUE(result[2]);
+
 
 #if 0
   ZDvidRoi roi;
@@ -0,0 +1,179 @@
+#ifndef ZDVIDSLICEPREFETCHERTEST_H
+#define ZDVIDSLICEPREFETCHERTEST_H
+
+#include <mutex>
+#include <condition_variable>
+
+#include "ztestheader.h"
+#include "dvid/zdvidsliceprefetcher.h"
+#include "zarray.h"
+
+#ifdef _USE_GTEST_
+
+namespace {
+
+ZDvidSlicePrefetcher::SliceData MakeSlicePrefetcherTestData(int z)
+{
+  int dims[3] = {4, 4, 1};
+  ZDvidSlicePrefetcher::SliceData data;
+  data.array.reset(new ZArray(mylib::UINT64_TYPE, 3, dims));
+  data.array->setValue<uint64_t>(0, z);
+
+  return data;
+}
+
+ZDvidSlicePrefetcher::SliceKey MakeSlicePrefetcherTestKey(int z)
+{
+  ZDvidSlicePrefetcher::SliceKey key;
+  key.source = "test";
+  key.width = 4;
+  key.height = 4;
+  key.z = z;
+
+  return key;
+}
+
+}
+
+TEST(ZDvidSlicePrefetcher, Count)
+{
+  ASSERT_EQ(2, ZDvidSlicePrefetcher::GetPrefetchCount(0.0, 8));
+  ASSERT_EQ(6, ZDvidSlicePrefetcher::GetPrefetchCount(5.5, 8));
+  ASSERT_EQ(8, ZDvidSlicePrefetcher::GetPrefetchCount(100.0, 8));
+  ASSERT_EQ(1, ZDvidSlicePrefetcher::GetPrefetchCount(100.0, 1));
+  ASSERT_EQ(0, ZDvidSlicePrefetcher::GetPrefetchCount(100.0, 0));
+}
+
+TEST(ZDvidSlicePrefetcher, Cache)
+{
+  ZDvidSlicePrefetcher prefetcher;
+  size_t byteNumber = MakeSlicePrefetcherTestData(0).getByteNumber();
+  prefetcher.setCacheSize(byteNumber * 2);
+
+  prefetcher.put(MakeSlicePrefetcherTestKey(1), MakeSlicePrefetcherTestData(1));
+  prefetcher.put(MakeSlicePrefetcherTestKey(2), MakeSlicePrefetcherTestData(2));
+  ASSERT_EQ(byteNumber * 2, prefetcher.getCacheUsage());
+
+  //Touch 1 so that 2 is evicted first
+  ZDvidSlicePrefetcher::SliceData data =
+      prefetcher.get(MakeSlicePrefetcherTestKey(1));
+  ASSERT_EQ(1, (int) data.array->getUint64Value(0));
+
+  prefetcher.put(MakeSlicePrefetcherTestKey(3), MakeSlicePrefetcherTestData(3));
+  ASSERT_TRUE(prefetcher.contains(MakeSlicePrefetcherTestKey(1)));
+  ASSERT_FALSE(prefetcher.contains(MakeSlicePrefetcherTestKey(2)));
+  ASSERT_TRUE(prefetcher.contains(MakeSlicePrefetcherTestKey(3)));
+  ASSERT_EQ(byteNumber * 2, prefetcher.getCacheUsage());
+
+  ZDvidSlicePrefetcher::SliceKey key = MakeSlicePrefetcherTestKey(3);
+  key.zoom = 1;
+  ASSERT_FALSE(prefetcher.contains(key));
+  ASSERT_TRUE(prefetcher.get(key).isEmpty());
+
+  prefetcher.invalidate("test");
+  ASSERT_FALSE(prefetcher.contains(MakeSlicePrefetcherTestKey(1)));
+  ASSERT_EQ(0, (int) prefetcher.getCacheUsage());
+}
+
+TEST(ZDvidSlicePrefetcher, Prefetch)
+{
+  ZDvidSlicePrefetcher prefetcher;
+  prefetcher.setPrefetchCount(3);
+
+  ZDvidSlicePrefetcher::Loader loader =
+      [](const ZDvidSlicePrefetcher::SliceKey &key) {
+    return MakeSlicePrefetcherTestData(key.z);
+  };
+
+  //No direction yet
+  prefetcher.notifyView(MakeSlicePrefetcherTestKey(10), loader);
+  ASSERT_TRUE(prefetcher.waitForIdle(5000));
+  ASSERT_EQ(0, (int) prefetcher.getCacheUsage());
+
+  prefetcher.notifyView(MakeSlicePrefetcherTestKey(12), loader);
+  ASSERT_TRUE(prefetcher.waitForIdle(5000));
+  for (int z : {14, 16, 18}) {
+    ZDvidSlicePrefetcher::SliceData data =
+        prefetcher.get(MakeSlicePrefetcherTestKey(z));
+    ASSERT_FALSE(data.isEmpty());
+    ASSERT_EQ(z, (int) data.array->getUint64Value(0));
+  }
+  ASSERT_FALSE(prefetcher.contains(MakeSlicePrefetcherTestKey(13)));
+  ASSERT_FALSE(prefetcher.contains(MakeSlicePrefetcherTestKey(20)));
+
+  //Reversed direction
+  prefetcher.notifyView(MakeSlicePrefetcherTestKey(11), loader);
+  ASSERT_TRUE(prefetcher.waitForIdle(5000));
+  ASSERT_TRUE(prefetcher.contains(MakeSlicePrefetcherTestKey(10)));
+  ASSERT_TRUE(prefetcher.contains(MakeSlicePrefetcherTestKey(9)));
+  ASSERT_TRUE(prefetcher.contains(MakeSlicePrefetcherTestKey(8)));
+
+  //A new viewport restarts tracking
+  ZDvidSlicePrefetcher::SliceKey key = MakeSlicePrefetcherTestKey(7);
+  key.x0 = 100;
+  prefetcher.notifyView(key, loader);
+  ASSERT_TRUE(prefetcher.waitForIdle(5000));
+  key.z = 6;
+  ASSERT_FALSE(prefetcher.contains(key));
+
+  prefetcher.setEnabled(false);
+  key.z = 8;
+  prefetcher.notifyView(key, loader);
+  ASSERT_EQ(0, (int) prefetcher.getPendingNumber());
+}
+
+TEST(ZDvidSlicePrefetcher, Cancel)
+{
+  ZDvidRequestEngine engine(4, 4);
+  ZDvidSlicePrefetcher prefetcher;
+  prefetcher.setRequestEngine(&engine);
+  prefetcher.setPrefetchCount(3);
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool blocking = true;
+  bool started = false;
+  int loadingNumber = 0;
+  int maxLoadingNumber = 0;
+
+  ZDvidSlicePrefetcher::Loader loader =
+      [&](const ZDvidSlicePrefetcher::SliceKey &key) {
+    std::unique_lock<std::mutex> lock(mutex);
+    maxLoadingNumber = std::max(maxLoadingNumber, ++loadingNumber);
+    if (key.z == 14) {
+      started = true;
+      condition.notify_all();
+      condition.wait(lock, [&]() { return !blocking; });
+    }
+    --loadingNumber;
+    return MakeSlicePrefetcherTestData(key.z);
+  };
+
+  prefetcher.notifyView(MakeSlicePrefetcherTestKey(10), loader);
+  prefetcher.notifyView(MakeSlicePrefetcherTestKey(12), loader);
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [&]() { return started; });
+  }
+  ASSERT_EQ(3, (int) prefetcher.getPendingNumber());
+
+  //Reversing drops all slices ahead, including the one being loaded
+  prefetcher.notifyView(MakeSlicePrefetcherTestKey(11), loader);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    blocking = false;
+  }
+  condition.notify_all();
+
+  ASSERT_TRUE(prefetcher.waitForIdle(5000));
+  ASSERT_FALSE(prefetcher.contains(MakeSlicePrefetcherTestKey(14)));
+  for (int z : {10, 9, 8}) {
+    ASSERT_TRUE(prefetcher.contains(MakeSlicePrefetcherTestKey(z)));
+  }
+  //Slices of the same source are loaded one at a time
+  ASSERT_EQ(1, maxLoadingNumber);
+}
+
+#endif
+
+#endif // ZDVIDSLICEPREFETCHERTEST_H
@@ -0,0 +1,105 @@
+#ifndef ZDVIDSYNAPSESTORETEST_H
+#define ZDVIDSYNAPSESTORETEST_H
+
+#include <cstring>
+
+#include "ztestheader.h"
+#include "dvid/zdvidsynapsestore.h"
+
+#ifdef _USE_GTEST_
+
+TEST(ZDvidSynapseStore, Decode)
+{
+  ZDvidSynapseStore store;
+  ASSERT_TRUE(store.decode("", 0));
+  ASSERT_TRUE(store.decode("null", 4));
+  ASSERT_TRUE(store.decode(" [ ] ", 5));
+  ASSERT_TRUE(store.isEmpty());
+
+  const char *data =
+      "[{\"Pos\":[1,2,3],\"Kind\":\"PreSyn\",\"Tags\":[\"t1\",\"t\\u00e92\"],"
+      "\"Prop\":{\"conf\":\"0.5\",\"user\":\"alice\",\"annotation\":\"a\\\"b\"},"
+      "\"Rels\":[{\"Rel\":\"PreSynTo\",\"To\":[4,5,6]},"
+      "{\"Rel\":\"PreSynTo\",\"To\":[7,8,9]}]},"
+      "{\"Kind\":\"PostSyn\",\"Prop\":{\"user\":\"bob\"}},"
+      "{\"Pos\":[4,5,6],\"Kind\":\"PostSyn\",\"Tags\":null,"
+      "\"Prop\":{\"confidence\":0.25,\"conf\":\"0.75\",\"user\":\"alice\"},"
+      "\"Rels\":[{\"Rel\":\"PostSynTo\",\"To\":[1,2,3]}],"
+      "\"Extra\":{\"a\":[1,{\"b\":true}],\"c\":false}}]";
+  ASSERT_TRUE(store.decode(data, strlen(data)));
+  ASSERT_EQ(2, (int) store.size());
+
+  ASSERT_EQ(ZIntPoint(1, 2, 3), store.getPosition(0));
+  ASSERT_EQ(ZDvidSynapseStore::EKind::KIND_PRE_SYN, store.getKind(0));
+  ASSERT_DOUBLE_EQ(0.5, store.getConfidence(0));
+  ASSERT_EQ("alice", store.getUser(0));
+  ASSERT_EQ(2, (int) store.getTagNumber(0));
+  ASSERT_EQ("t1", store.getTag(0, 0));
+  ASSERT_EQ("t\xc3\xa9" "2", store.getTag(0, 1));
+  ASSERT_TRUE(store.hasTag(0, "t1"));
+  ASSERT_FALSE(store.hasTag(1, "t1"));
+
+  ASSERT_EQ(ZDvidSynapseStore::EKind::KIND_POST_SYN, store.getKind(1));
+  ASSERT_DOUBLE_EQ(0.25, store.getConfidence(1));
+  ASSERT_EQ(0, (int) store.getTagNumber(1));
+  //"", "t1", "t\xc3\xa92", "conf", "0.5", "user", "alice", "annotation",
+  //"a\"b", "PreSynTo", "confidence", "0.25", "0.75", "PostSynTo"
+  ASSERT_EQ(14, (int) store.getStringNumber());
+
+  ASSERT_EQ(3, (int) store.getPropertyNumber(0));
+  const ZDvidSynapseStore::Property &prop = store.getProperty(0, 2);
+  ASSERT_EQ("annotation", store.getString(prop.key));
+  ASSERT_EQ("a\"b", store.getString(prop.value));
+  ASSERT_FALSE(prop.isNumber);
+  ASSERT_EQ(3, (int) store.getPropertyNumber(1));
+  ASSERT_EQ("confidence", store.getString(store.getProperty(1, 0).key));
+  ASSERT_EQ("0.25", store.getString(store.getProperty(1, 0).value));
+  ASSERT_TRUE(store.getProperty(1, 0).isNumber);
+
+  ASSERT_EQ(1, store.findIndex(ZIntPoint(4, 5, 6)));
+  ASSERT_EQ(ZDvidSynapseStore::NO_INDEX, store.findIndex(ZIntPoint(7, 8, 9)));
+  ASSERT_EQ(1, (int) store.countKind(ZDvidSynapseStore::EKind::KIND_PRE_SYN));
+
+  const std::vector<ZDvidSynapseStore::Relation> &relationArray =
+      store.getRelationArray();
+  ASSERT_EQ(3, (int) relationArray.size());
+  ASSERT_EQ(0, (int) relationArray[0].from);
+  ASSERT_EQ(1, relationArray[0].to);
+  ASSERT_EQ(ZDvidSynapseStore::ERelation::RELATION_PRESYN_TO,
+            relationArray[0].type);
+  ASSERT_EQ(ZDvidSynapseStore::NO_INDEX, relationArray[1].to);
+  ASSERT_EQ(ZIntPoint(7, 8, 9), relationArray[1].toPos);
+  ASSERT_EQ(0, relationArray[2].to);
+
+  std::vector<size_t> relationIndex = store.getRelationIndex(0);
+  ASSERT_EQ(2, (int) relationIndex.size());
+  ASSERT_EQ(1, (int) relationIndex[1]);
+  ASSERT_EQ(2, (int) store.getRelationIndex(1)[0]);
+  ASSERT_EQ("PostSynTo", store.getRelationName(2));
+
+  //Appending resolves the partners of existing elements
+  const char *data2 = "[{\"Pos\":[7,8,9],\"Kind\":\"PostSyn\"}]";
+  ASSERT_TRUE(store.decode(data2, strlen(data2)));
+  ASSERT_EQ(3, (int) store.size());
+  ASSERT_EQ(2, store.getRelationArray()[1].to);
+  ASSERT_DOUBLE_EQ(1.0, store.getConfidence(2));
+  ASSERT_TRUE(store.getUser(2).empty());
+  ASSERT_EQ(0, (int) store.getPropertyNumber(2));
+
+  //Invalid data leaves the store unchanged
+  const char *badData = "[{\"Pos\":[10,11,12],\"Tags\":[\"new\"]},{\"Pos\":";
+  ASSERT_FALSE(store.decode(badData, strlen(badData)));
+  ASSERT_EQ(3, (int) store.size());
+  ASSERT_EQ(14, (int) store.getStringNumber());
+  ASSERT_EQ(ZDvidSynapseStore::NO_INDEX, store.findIndex(ZIntPoint(10, 11, 12)));
+  ASSERT_FALSE(store.decode("[1]x", 4));
+  ASSERT_FALSE(store.decode("{}", 2));
+
+  store.clear();
+  ASSERT_TRUE(store.isEmpty());
+  ASSERT_TRUE(store.getRelationArray().empty());
+}
+
+#endif
+
+#endif // ZDVIDSYNAPSESTORETEST_H
@@ -0,0 +1,68 @@
+#ifndef ZDVIDTILECACHETEST_H
+#define ZDVIDTILECACHETEST_H
+
+#include "ztestheader.h"
+#include "dvid/zdvidtilecache.h"
+
+#ifdef _USE_GTEST_
+
+TEST(ZDvidTileCache, Basic)
+{
+  auto makeImage = [](int width, int height, uint8_t value) {
+    std::shared_ptr<ZDvidTileCache::Image> image =
+        std::make_shared<ZDvidTileCache::Image>();
+    image->width = width;
+    image->height = height;
+    image->data.resize(width * height, value);
+    return ZDvidTileCache::ImagePtr(image);
+  };
+
+  ZDvidTileCache cache;
+  ASSERT_EQ(ZDvidTileCache::DEFAULT_CACHE_SIZE, cache.getCacheSize());
+  cache.setCacheSize(300);
+
+  ZDvidTileCache::Key key1(0, 1, 2, 3);
+  ZDvidTileCache::Key key2(1, 1, 2, 3);
+  ZDvidTileCache::Key key3(0, 1, 2, 4);
+
+  ASSERT_TRUE(cache.get(key1).get() == NULL);
+  cache.put(key1, ZDvidTileCache::ImagePtr());
+  ASSERT_EQ(0, (int) cache.size());
+
+  cache.put(key1, makeImage(10, 10, 1));
+  cache.put(key2, makeImage(10, 10, 2));
+  ASSERT_EQ(2, (int) cache.size());
+  ASSERT_EQ(200, (int) cache.getCacheUsage());
+  ASSERT_EQ(1, cache.get(key1)->data[0]);
+  ASSERT_EQ(2, cache.get(key2)->data[0]);
+
+  //key1 becomes the most recently used one
+  cache.get(key1);
+  cache.put(key3, makeImage(10, 15, 3));
+  ASSERT_TRUE(cache.contains(key1));
+  ASSERT_FALSE(cache.contains(key2));
+  ASSERT_TRUE(cache.contains(key3));
+  ASSERT_EQ(250, (int) cache.getCacheUsage());
+
+  //Replaced
+  cache.put(key1, makeImage(5, 10, 4));
+  ASSERT_EQ(4, cache.get(key1)->data[0]);
+  ASSERT_EQ(200, (int) cache.getCacheUsage());
+
+  //Too large to be cached
+  cache.put(key2, makeImage(20, 20, 5));
+  ASSERT_FALSE(cache.contains(key2));
+
+  cache.setCacheSize(100);
+  ASSERT_TRUE(cache.contains(key1));
+  ASSERT_FALSE(cache.contains(key3));
+  ASSERT_EQ(50, (int) cache.getCacheUsage());
+
+  cache.clear();
+  ASSERT_EQ(0, (int) cache.size());
+  ASSERT_EQ(0, (int) cache.getCacheUsage());
+}
+
+#endif
+
+#endif // ZDVIDTILECACHETEST_H
@@ -0,0 +1,61 @@
+#ifndef ZIMAGELUTTEST_H
+#define ZIMAGELUTTEST_H
+
+#include <vector>
+
+#include "ztestheader.h"
+#include "zimagelut.h"
+
+#ifdef _USE_GTEST_
+
+TEST(ZImageLut, Linear)
+{
+  ZImageLut::TTable table;
+  ZImageLut::MakeLinear(table, 256, 2.0, -10.0);
+  ASSERT_EQ(256, (int) table.size());
+  ASSERT_EQ(0xFF000000, table[0]);
+  ASSERT_EQ(0xFF000000, table[5]);
+  ASSERT_EQ(0xFF141414, table[15]);
+  ASSERT_EQ(0xFFFFFFFF, table[200]);
+
+  ZImageLut::MakeLinear(table, 65536, 0.5, 0.0, 1.0, 0.5, 0.0, 300);
+  ASSERT_EQ(65536, (int) table.size());
+  ASSERT_EQ(0xFF643200, table[200]);
+  ASSERT_EQ(0xFFFF0000, table[301]);
+
+  std::shared_ptr<const ZImageLut::TTable> shared =
+      ZImageLut::GetLinear(256, 2.0, -10.0);
+  ASSERT_EQ(shared, ZImageLut::GetLinear(256, 2.0, -10.0));
+  ASSERT_NE(shared, ZImageLut::GetLinear(256, 2.0, -11.0));
+  ASSERT_EQ(0xFF141414, (*shared)[15]);
+}
+
+TEST(ZImageLut, Apply)
+{
+  std::vector<uint8_t> data8(37);
+  std::vector<uint16_t> data16(37);
+  for (size_t i = 0; i < data8.size(); ++i) {
+    data8[i] = uint8_t(i * 7);
+    data16[i] = uint16_t(i * 1777);
+  }
+
+  std::vector<uint32_t> out(data8.size());
+  std::shared_ptr<const ZImageLut::TTable> table8 =
+      ZImageLut::GetLinear(256, 1.5, 3.0);
+  ZImageLut::Apply(data8.data(), data8.size(), table8->data(), out.data());
+  for (size_t i = 0; i < data8.size(); ++i) {
+    ASSERT_EQ((*table8)[data8[i]], out[i]);
+  }
+
+  std::shared_ptr<const ZImageLut::TTable> table16 =
+      ZImageLut::GetLinear(65536, 255.0 / 65535, 0.0);
+  ZImageLut::Apply(data16.data(), data16.size(), table16->data(), out.data());
+  for (size_t i = 0; i < data16.size(); ++i) {
+    ASSERT_EQ((*table16)[data16[i]], out[i]);
+  }
+  ASSERT_EQ(0xFF000000, out[0]);
+}
+
+#endif
+
+#endif // ZIMAGELUTTEST_H
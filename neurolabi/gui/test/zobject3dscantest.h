@@ -1,8 +1,14 @@
 #ifndef ZOBJECT3DSCANTEST_H
 #define ZOBJECT3DSCANTEST_H
 
+#include <fstream>
+#include <thread>
+
 #include "ztestheader.h"
 #include "zobject3dscan.h"
+#include "zobject3dscancompact.h"
+#include "zobject3dscanchunkfile.h"
+#include "zfiletype.h"
 #include "neutubeconfig.h"
 #include "zgraph.h"
 #include "tz_iarray.h"
@@ -1708,11 +1714,237 @@ TEST(ZObject3dScan, contains)
   ASSERT_TRUE(obj.contains(2, 1, 2));
   ASSERT_TRUE(obj.contains(1, 2, 2));
   ASSERT_FALSE(obj.contains(2, 2, 2));
+  ASSERT_TRUE(obj.isDeprecated(ZObject3dScan::COMPONENT_STRIPE_INDEX_HASH));
+
+  obj.clear();
+  obj.addSegment(0, 1, 0, 1);
+  obj.addSegment(0, 3, 0, 1);
+  obj.addSegment(2, 0, 0, 1);
+  ASSERT_EQ(0, (int) obj.lowerBoundStripe(-1, 5));
+  ASSERT_EQ(0, (int) obj.lowerBoundStripe(0, 1));
+  ASSERT_EQ(1, (int) obj.lowerBoundStripe(0, 2));
+  ASSERT_EQ(2, (int) obj.lowerBoundStripe(1, 0));
+  ASSERT_EQ(3, (int) obj.lowerBoundStripe(2, 1));
 
 //  obj.addSegment(0, 0, 3, 4);
 //  obj.addSegment(0, 0, 6, 9);
 }
 
+TEST(ZObject3dScan, containsBatch)
+{
+  ZObject3dScan obj;
+  ASSERT_TRUE(obj.containsBatch(std::vector<ZIntPoint>()).empty());
+
+  std::vector<ZIntPoint> ptArray;
+  ptArray.push_back(ZIntPoint(0, 0, 0));
+  ASSERT_EQ(std::vector<bool>(1, false), obj.containsBatch(ptArray));
+
+  for (unsigned int seed = 1; seed <= 5; ++seed) {
+    srand(seed);
+    obj.clear();
+    for (int i = 0; i < 200; ++i) {
+      int z = rand() % 10 - 5;
+      int y = rand() % 10 - 5;
+      int x0 = rand() % 30 - 10;
+      obj.addSegment(z, y, x0, x0 + rand() % 5, false);
+    }
+
+    ptArray.clear();
+    for (int i = 0; i < 500; ++i) {
+      ptArray.push_back(
+            ZIntPoint(rand() % 40 - 15, rand() % 14 - 7, rand() % 14 - 7));
+    }
+
+    std::vector<bool> result = obj.containsBatch(ptArray);
+    ASSERT_EQ(ptArray.size(), result.size());
+    for (size_t i = 0; i < ptArray.size(); ++i) {
+      ASSERT_EQ(obj.contains(ptArray[i]), result[i]);
+    }
+  }
+
+  obj.clear();
+  obj.addSegment(0, 0, 0, 1);
+  ptArray.clear();
+  ptArray.push_back(ZIntPoint(1, 0, 0));
+  ptArray.push_back(ZIntPoint(2, 0, 0));
+  ptArray.push_back(ZIntPoint(1, 0, 0));
+  std::vector<bool> result = obj.containsBatch(ptArray);
+  ASSERT_TRUE(result[0]);
+  ASSERT_FALSE(result[1]);
+  ASSERT_TRUE(result[2]);
+
+  //The index is invalidated by modification
+  ASSERT_FALSE(obj.contains(5, 1, 0));
+  obj.addSegment(0, 1, 5, 6);
+  ASSERT_TRUE(obj.contains(5, 1, 0));
+  obj.translate(1, 0, 0);
+  ASSERT_FALSE(obj.contains(5, 1, 0));
+  ASSERT_TRUE(obj.contains(7, 1, 0));
+
+  obj.setSliceAxis(neutube::EAxis::X);
+  ptArray.clear();
+  ptArray.push_back(ZIntPoint(0, 0, 7));
+  ptArray.push_back(ZIntPoint(0, 0, 1));
+  result = obj.containsBatch(ptArray);
+  ASSERT_EQ(obj.contains(ptArray[0]), result[0]);
+  ASSERT_EQ(obj.contains(ptArray[1]), result[1]);
+}
+
+namespace {
+
+void CheckObjectSummary(const ZObject3dScan &obj)
+{
+  size_t voxelNumber = 0;
+  double xSum = 0.0;
+  double ySum = 0.0;
+  double zSum = 0.0;
+  std::unordered_map<int, size_t> slicewiseVoxelNumber;
+  ZIntCuboid box;
+  for (size_t i = 0; i < obj.getStripeNumber(); ++i) {
+    const ZObject3dStripe &stripe = obj.getStripe(i);
+    for (int j = 0; j < stripe.getSegmentNumber(); ++j) {
+      int x0 = stripe.getSegmentStart(j);
+      int x1 = stripe.getSegmentEnd(j);
+      for (int x = x0; x <= x1; ++x) {
+        ++voxelNumber;
+        xSum += x;
+        ySum += stripe.getY();
+        zSum += stripe.getZ();
+        ++slicewiseVoxelNumber[stripe.getZ()];
+        if (box.isEmpty()) {
+          box.set(x, stripe.getY(), stripe.getZ(),
+                  x, stripe.getY(), stripe.getZ());
+        } else {
+          box.join(x, stripe.getY(), stripe.getZ());
+        }
+      }
+    }
+  }
+
+  ASSERT_EQ(voxelNumber, obj.getVoxelNumber());
+  ASSERT_EQ(box, obj.getBoundBox());
+  for (const auto &entry : slicewiseVoxelNumber) {
+    ASSERT_EQ(entry.second, obj.getVoxelNumber(entry.first));
+  }
+  size_t sliceVoxelNumber = 0;
+  for (const auto &entry : obj.getSlicewiseVoxelNumber()) {
+    sliceVoxelNumber += entry.second;
+  }
+  ASSERT_EQ(voxelNumber, sliceVoxelNumber);
+
+  if (voxelNumber > 0) {
+    ZPoint center = obj.getCentroid();
+    ASSERT_NEAR(xSum / voxelNumber, center.x(), 1e-6);
+    ASSERT_NEAR(ySum / voxelNumber, center.y(), 1e-6);
+    ASSERT_NEAR(zSum / voxelNumber, center.z(), 1e-6);
+  }
+}
+
+}
+
+TEST(ZObject3dScan, Summary)
+{
+  ZObject3dScan obj;
+  CheckObjectSummary(obj);
+  ASSERT_TRUE(obj.getBoundBox().isEmpty());
+
+  obj.addSegment(0, 0, 1, 3);
+  CheckObjectSummary(obj);
+  obj.addSegment(0, 0, 2, 5); //merged into the last segment
+  CheckObjectSummary(obj);
+  obj.addSegment(0, 0, 0, 0, false); //out of order
+  CheckObjectSummary(obj);
+  obj.addSegment(0, 0, 9, 7); //reversed and canonized
+  CheckObjectSummary(obj);
+  obj.addSegment(-1, 2, 3, 4);
+  CheckObjectSummary(obj);
+
+  for (unsigned int seed = 1; seed <= 5; ++seed) {
+    srand(seed);
+    for (int i = 0; i < 100; ++i) {
+      int z = rand() % 10 - 5;
+      int y = rand() % 10 - 5;
+      int x0 = rand() % 30 - 10;
+      obj.addSegment(z, y, x0, x0 + rand() % 5, rand() % 2 == 0);
+      if (i % 10 == 0) {
+        CheckObjectSummary(obj);
+      }
+    }
+    CheckObjectSummary(obj);
+
+    obj.canonize();
+    CheckObjectSummary(obj);
+
+    obj.translate(3, -2, 5);
+    CheckObjectSummary(obj);
+
+    ZObject3dScan obj2;
+    obj2.addSegment(20, 1, 1, 10);
+    obj2.addSegment(20, 2, 1, 10);
+    obj.concat(obj2);
+    CheckObjectSummary(obj);
+
+    obj.addSegmentFast(30, 40);
+    CheckObjectSummary(obj);
+
+    obj.getStripe(0).addSegment(50, 60);
+    CheckObjectSummary(obj);
+
+    ZObject3dScan obj3 = obj;
+    CheckObjectSummary(obj3);
+
+    obj.blockEvent(true);
+    obj.addSegment(0, 0, 100, 101);
+    CheckObjectSummary(obj);
+    obj.blockEvent(false);
+    CheckObjectSummary(obj);
+
+    obj.downsampleMax(1, 1, 1);
+    CheckObjectSummary(obj);
+  }
+
+  obj.setSliceAxis(neutube::EAxis::X);
+  ZIntCuboid box = obj.getBoundBox();
+  obj.setSliceAxis(neutube::EAxis::Z);
+  ZIntCuboid expectedBox = obj.getBoundBox();
+  expectedBox.shiftSliceAxis(neutube::EAxis::X);
+  ASSERT_EQ(expectedBox, box);
+
+  //Spans of (x, y, z, length), imported in parallel
+  std::vector<char> buffer(12 + 16 * 4, 0);
+  buffer[1] = 3;
+  uint32_t spanNumber = 4;
+  memcpy(buffer.data() + 8, &spanNumber, 4);
+  int32_t spanArray[] = {0, 0, 0, 4, 5, 1, 0, 5, 2, 3, 1, 1, -3, 3, 7, 2};
+  memcpy(buffer.data() + 12, spanArray, sizeof(spanArray));
+  for (int threadNumber = 1; threadNumber <= 3; ++threadNumber) {
+    ZObject3dScan obj2;
+    ASSERT_TRUE(obj2.importDvidObjectBuffer(
+                  buffer.data(), buffer.size(), threadNumber));
+    CheckObjectSummary(obj2);
+    ASSERT_EQ(12, (int) obj2.getVoxelNumber());
+  }
+
+  //Concurrent const queries on a deprecated summary
+  obj.deprecate(ZObject3dScan::COMPONENT_SUMMARY);
+  const ZObject3dScan &constObj = obj;
+  std::vector<size_t> voxelNumberArray(4, 0);
+  std::vector<std::thread> threadArray;
+  for (size_t i = 0; i < voxelNumberArray.size(); ++i) {
+    threadArray.emplace_back([&, i]() {
+      constObj.getBoundBox();
+      voxelNumberArray[i] = constObj.getVoxelNumber();
+    });
+  }
+  for (std::thread &thread : threadArray) {
+    thread.join();
+  }
+  for (size_t voxelNumber : voxelNumberArray) {
+    ASSERT_EQ(obj.getVoxelNumber(), voxelNumber);
+  }
+  CheckObjectSummary(obj);
+}
+
 TEST(ZObject3dScan, component)
 {
   ZObject3dScan obj;
@@ -2237,6 +2469,393 @@ TEST(ZObject3dScan, subtract)
 //  subtracted.print();
 }
 
+TEST(ZObject3dScan, RunConnectedComponent)
+{
+  {
+    ZObject3dScan obj;
+    obj.addSegment(0, 0, 1, 2);
+    obj.addSegment(0, 1, 3, 4);
+    ASSERT_EQ(2, (int) obj.getConnectedComponent(
+                neutube::EStackNeighborhood::D1).size());
+    ASSERT_EQ(1, (int) obj.getConnectedComponent(
+                neutube::EStackNeighborhood::D2).size());
+
+    obj.clear();
+    obj.addSegment(0, 0, 1, 2);
+    obj.addSegment(1, 1, 2, 4);
+    ASSERT_EQ(2, (int) obj.getConnectedComponent(
+                neutube::EStackNeighborhood::D1).size());
+    ASSERT_EQ(1, (int) obj.getConnectedComponent(
+                neutube::EStackNeighborhood::D2).size());
+
+    obj.clear();
+    obj.addSegment(0, 0, 1, 2);
+    obj.addSegment(1, 1, 3, 4);
+    ASSERT_EQ(2, (int) obj.getConnectedComponent(
+                neutube::EStackNeighborhood::D2).size());
+    ASSERT_EQ(1, (int) obj.getConnectedComponent(
+                neutube::EStackNeighborhood::D3).size());
+  }
+
+  //Compare with flood filling on random objects
+  const int width = 12;
+  const int height = 10;
+  const int depth = 9;
+
+  for (unsigned int seed = 1; seed <= 5; ++seed) {
+    srand(seed);
+    std::vector<int> mask(width * height * depth, 0);
+    ZObject3dScan obj;
+    for (int i = 0; i < 120; ++i) {
+      int z = rand() % depth;
+      int y = rand() % height;
+      int x0 = rand() % width;
+      int x1 = std::min(width - 1, x0 + rand() % 3);
+      obj.addSegment(z, y, x0, x1, false);
+      for (int x = x0; x <= x1; ++x) {
+        mask[(z * height + y) * width + x] = 1;
+      }
+    }
+
+    for (neutube::EStackNeighborhood nbr : {
+         neutube::EStackNeighborhood::D1, neutube::EStackNeighborhood::D2,
+         neutube::EStackNeighborhood::D3}) {
+      int maxDist = 1;
+      if (nbr == neutube::EStackNeighborhood::D2) {
+        maxDist = 2;
+      } else if (nbr == neutube::EStackNeighborhood::D3) {
+        maxDist = 3;
+      }
+
+      //Label voxels by flood filling
+      std::vector<int> label(mask.size(), 0);
+      std::vector<size_t> expectedSize;
+      for (size_t i = 0; i < mask.size(); ++i) {
+        if (mask[i] && label[i] == 0) {
+          expectedSize.push_back(0);
+          int currentLabel = expectedSize.size();
+          std::vector<size_t> queue(1, i);
+          label[i] = currentLabel;
+          while (!queue.empty()) {
+            size_t v = queue.back();
+            queue.pop_back();
+            ++expectedSize.back();
+            int x = v % width;
+            int y = (v / width) % height;
+            int z = v / width / height;
+            for (int dz = -1; dz <= 1; ++dz) {
+              for (int dy = -1; dy <= 1; ++dy) {
+                for (int dx = -1; dx <= 1; ++dx) {
+                  int dist = std::abs(dx) + std::abs(dy) + std::abs(dz);
+                  int nx = x + dx;
+                  int ny = y + dy;
+                  int nz = z + dz;
+                  if (dist > 0 && dist <= maxDist && nx >= 0 && nx < width &&
+                      ny >= 0 && ny < height && nz >= 0 && nz < depth) {
+                    size_t u = (nz * height + ny) * width + nx;
+                    if (mask[u] && label[u] == 0) {
+                      label[u] = currentLabel;
+                      queue.push_back(u);
+                    }
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+
+      for (int threadNumber = 1; threadNumber <= 4; ++threadNumber) {
+        std::vector<size_t> sizeArray;
+        std::vector<ZObject3dScan> objArray =
+            obj.getConnectedComponent(nbr, &sizeArray, threadNumber);
+        ASSERT_EQ(expectedSize.size(), objArray.size());
+        ASSERT_EQ(expectedSize.size(), sizeArray.size());
+
+        size_t voxelNumber = 0;
+        for (size_t i = 0; i < objArray.size(); ++i) {
+          const ZObject3dScan &subobj = objArray[i];
+          ASSERT_TRUE(subobj.isCanonized());
+          ASSERT_EQ(sizeArray[i], subobj.getVoxelNumber());
+          voxelNumber += sizeArray[i];
+
+          //All voxels of a component have the same flood-filling label
+          const ZObject3dStripe &stripe = subobj.getStripe(0);
+          int firstLabel = label[(stripe.getZ() * height + stripe.getY()) *
+              width + stripe.getSegmentStart(0)];
+          ASSERT_EQ(expectedSize[firstLabel - 1], sizeArray[i]);
+          for (size_t k = 0; k < subobj.getStripeNumber(); ++k) {
+            const ZObject3dStripe &s = subobj.getStripe(k);
+            for (int j = 0; j < s.getSegmentNumber(); ++j) {
+              for (int x = s.getSegmentStart(j); x <= s.getSegmentEnd(j);
+                   ++x) {
+                ASSERT_EQ(firstLabel,
+                          label[(s.getZ() * height + s.getY()) * width + x]);
+              }
+            }
+          }
+        }
+        ASSERT_EQ(obj.getVoxelNumber(), voxelNumber);
+      }
+    }
+  }
+}
+
+TEST(ZObject3dScan, Pyramid)
+{
+  for (unsigned int seed = 1; seed <= 5; ++seed) {
+    srand(seed);
+    ZObject3dScan obj;
+    for (int i = 0; i < 300; ++i) {
+      int z = rand() % 40 - 10;
+      int y = rand() % 40 - 10;
+      int x0 = rand() % 60 - 20;
+      obj.addSegment(z, y, x0, x0 + rand() % 10, false);
+    }
+
+    for (int scale = 0; scale <= 5; ++scale) {
+      ZObject3dScan expected = obj;
+      int intv = (1 << scale) - 1;
+      expected.downsampleMax(intv, intv, intv);
+
+      ZObject3dScan level = obj;
+      level.downsampleToPyramidLevel(scale);
+      ASSERT_TRUE(level.isCanonized());
+      ASSERT_TRUE(expected.equalsLiterally(level));
+    }
+  }
+
+  ZObject3dScan obj;
+  obj.addSegment(0, 0, 0, 3);
+  obj.addSegment(0, 2, 0, 3);
+  obj.translate(2, 0, 0);
+  obj.downsampleToPyramidLevel(1);
+  ASSERT_EQ(4, (int) obj.getVoxelNumber());
+  ASSERT_EQ(1, obj.getBoundBox().getFirstCorner().getX());
+  ASSERT_EQ(ZIntPoint(1, 1, 1), obj.getDsIntv());
+}
+
+TEST(ZObject3dScan, ChunkFile)
+{
+  std::string filePath =
+      GET_TEST_DATA_DIR + "/_test_chunk" + ZObject3dScanChunkFile::EXTENSION;
+  ASSERT_EQ(ZFileType::FILE_OBJECT_SCAN, ZFileType::FileType(filePath));
+
+  ZObject3dScan obj;
+  ASSERT_TRUE(obj.saveCompressed(filePath));
+  ZObject3dScanChunkFile file;
+  ASSERT_TRUE(file.open(filePath));
+  ASSERT_EQ(0, (int) file.getChunkNumber());
+  ASSERT_TRUE(file.getSlice(0).isEmpty());
+
+  for (unsigned int seed = 1; seed <= 3; ++seed) {
+    srand(seed);
+    obj.clear();
+    for (int i = 0; i < 500; ++i) {
+      int z = rand() % 20 - 5;
+      int y = rand() % 200 - 100;
+      int x0 = rand() % 100000 - 50000;
+      obj.addSegment(z, y, x0, x0 + rand() % 100, false);
+    }
+
+    ZObject3dScan canonized = obj;
+    canonized.canonize();
+
+    for (int deflating = 0; deflating <= 1; ++deflating) {
+      ASSERT_TRUE(ZObject3dScanChunkFile::Write(obj, filePath, deflating));
+      ASSERT_TRUE(ZObject3dScanChunkFile::IsChunkFile(filePath));
+
+      ASSERT_TRUE(file.open(filePath));
+      ASSERT_EQ(canonized.getStripeNumber(), file.getStripeNumber());
+      ASSERT_EQ(canonized.getMinZ(), file.getMinZ());
+      ASSERT_EQ(canonized.getMaxZ(), file.getMaxZ());
+
+      ZObject3dScan loaded;
+      ASSERT_TRUE(file.read(&loaded) != NULL);
+      ASSERT_TRUE(loaded.isCanonized());
+      ASSERT_TRUE(canonized.equalsLiterally(loaded));
+
+      for (int z = -6; z <= 15; ++z) {
+        ASSERT_EQ(canonized.hasSlice(z), file.hasSlice(z));
+        ASSERT_TRUE(canonized.getSlice(z).equalsLiterally(file.getSlice(z)));
+      }
+      ASSERT_TRUE(canonized.getSlice(2, 7).equalsLiterally(
+                    file.getSlice(2, 7)));
+
+      loaded.clear();
+      ASSERT_TRUE(loaded.load(filePath));
+      ASSERT_TRUE(canonized.equalsLiterally(loaded));
+    }
+  }
+
+  //Corrupted raw size of the first chunk
+  ASSERT_TRUE(ZObject3dScanChunkFile::Write(obj, filePath, true));
+  {
+    std::fstream stream(filePath, std::ios::in | std::ios::out |
+                        std::ios::binary);
+    uint64_t rawSize = uint64_t(1) << 40;
+    stream.seekp(16 + 24);
+    stream.write((const char*) &rawSize, sizeof(rawSize));
+  }
+  ASSERT_TRUE(file.open(filePath));
+  ASSERT_TRUE(file.read(NULL) == NULL);
+
+  //Legacy format still works
+  obj.save(filePath);
+  ASSERT_FALSE(ZObject3dScanChunkFile::IsChunkFile(filePath));
+  ZObject3dScan loaded;
+  ASSERT_TRUE(loaded.load(filePath));
+  ASSERT_TRUE(obj.equalsLiterally(loaded));
+}
+
+TEST(ZObject3dScan, extractAllObjectParallel)
+{
+  const int width = 37;
+  const int height = 23;
+  const int depth = 11;
+  std::vector<uint64_t> array(width * height * depth);
+  srand(1);
+  for (size_t i = 0; i < array.size(); ++i) {
+    //Runs of random labels, including large ones
+    if (i == 0 || rand() % 4 == 0) {
+      array[i] = (rand() % 10 == 0) ? 0 : (uint64_t(rand() % 30) << 40);
+    } else {
+      array[i] = array[i - 1];
+    }
+  }
+
+  std::map<uint64_t, ZObject3dScan*> *expected =
+      ZObject3dScan::extractAllObject(
+        array.data(), width, height, depth, 1, 2, 3, 1, NULL);
+
+  for (int threadNumber = 0; threadNumber <= 5; ++threadNumber) {
+    for (int foreground = 0; foreground <= 1; ++foreground) {
+      std::map<uint64_t, ZObject3dScan*> *bodySet =
+          ZObject3dScan::extractAllObjectParallel(
+            array.data(), width, height, depth, 1, 2, 3, foreground,
+            threadNumber);
+      ASSERT_EQ(expected->size() - foreground * expected->count(0),
+                bodySet->size());
+      for (auto &body : *bodySet) {
+        ZObject3dScan *obj = body.second;
+        ASSERT_EQ(body.first, obj->getLabel());
+        ASSERT_TRUE(obj->isCanonized());
+        ASSERT_TRUE(obj->isCanonizedActually());
+        ZObject3dScan expectedObj = *(*expected)[body.first];
+        expectedObj.canonize();
+        ASSERT_TRUE(expectedObj.equalsLiterally(*obj));
+        delete obj;
+      }
+      delete bodySet;
+    }
+  }
+
+  for (auto &body : *expected) {
+    delete body.second;
+  }
+  delete expected;
+
+  //2D array
+  uint8_t array2[6] = {1, 1, 2, 0, 2, 2};
+  std::map<uint64_t, ZObject3dScan*> *bodySet =
+      ZObject3dScan::extractAllObjectParallel(array2, 3, 2, 1, 0, 0, 0, true, 2);
+  ASSERT_EQ(2, (int) bodySet->size());
+  ASSERT_EQ(2, (int) (*bodySet)[1]->getVoxelNumber());
+  ASSERT_EQ(3, (int) (*bodySet)[2]->getVoxelNumber());
+  ASSERT_EQ(2, (int) (*bodySet)[2]->getStripeNumber());
+  for (auto &body : *bodySet) {
+    delete body.second;
+  }
+  delete bodySet;
+}
+
+TEST(ZObject3dScan, SetOperation)
+{
+  //Compare with dense masks on random objects
+  const int width = 16;
+  const int height = 8;
+  const int depth = 12;
+  const size_t volume = width * height * depth;
+
+  auto makeObject = [&](unsigned int seed, std::vector<bool> &mask) {
+    mask.assign(volume, false);
+    srand(seed);
+    ZObject3dScan obj;
+    for (int i = 0; i < 150; ++i) {
+      int z = rand() % depth;
+      int y = rand() % height;
+      int x0 = rand() % width;
+      int x1 = std::min(width - 1, x0 + rand() % 5);
+      obj.addSegment(z, y, x0, x1, false);
+      for (int x = x0; x <= x1; ++x) {
+        mask[(z * height + y) * width + x] = true;
+      }
+    }
+    return obj;
+  };
+
+  auto makeMask = [&](const ZObject3dScan &obj) {
+    std::vector<bool> mask(volume, false);
+    for (size_t i = 0; i < obj.getStripeNumber(); ++i) {
+      const ZObject3dStripe &stripe = obj.getStripe(i);
+      for (int j = 0; j < stripe.getSegmentNumber(); ++j) {
+        for (int x = stripe.getSegmentStart(j); x <= stripe.getSegmentEnd(j);
+             ++x) {
+          mask[(stripe.getZ() * height + stripe.getY()) * width + x] = true;
+        }
+      }
+    }
+    return mask;
+  };
+
+  for (unsigned int seed = 1; seed <= 5; ++seed) {
+    std::vector<bool> mask1;
+    std::vector<bool> mask2;
+    ZObject3dScan obj1 = makeObject(seed, mask1);
+    ZObject3dScan obj2 = makeObject(seed + 100, mask2);
+
+    std::vector<bool> unionMask(volume);
+    std::vector<bool> diffMask(volume);
+    std::vector<bool> commonMask(volume);
+    for (size_t i = 0; i < volume; ++i) {
+      unionMask[i] = mask1[i] || mask2[i];
+      diffMask[i] = mask1[i] && !mask2[i];
+      commonMask[i] = mask1[i] && mask2[i];
+    }
+
+    for (int threadNumber = 0; threadNumber <= 5; ++threadNumber) {
+      ZObject3dScan obj = obj1;
+      obj.unify(obj2, threadNumber);
+      ASSERT_TRUE(obj.isCanonized());
+      ASSERT_TRUE(obj.isCanonizedActually());
+      ASSERT_TRUE(unionMask == makeMask(obj));
+
+      obj = obj1.intersect(obj2, threadNumber);
+      ASSERT_TRUE(obj.isCanonizedActually());
+      ASSERT_TRUE(commonMask == makeMask(obj));
+    }
+
+    ZObject3dScan obj = obj1 - obj2;
+    ASSERT_TRUE(obj.isCanonizedActually());
+    ASSERT_TRUE(diffMask == makeMask(obj));
+
+    obj = obj1;
+    ZObject3dScan subtracted = obj.subtract(obj2);
+    ASSERT_TRUE(diffMask == makeMask(obj));
+    ASSERT_TRUE(commonMask == makeMask(subtracted));
+
+    //Concatenating in order keeps canonization
+    ZObject3dScan part1 = obj1.getSlice(0, depth / 2);
+    ZObject3dScan part2 = obj1.getSlice(depth / 2 + 1, depth - 1);
+    ASSERT_TRUE(part1.isCanonized());
+    part1.concat(part2);
+    ASSERT_TRUE(part1.isCanonized());
+    ASSERT_TRUE(part1.equalsLiterally(obj1));
+    part2.concat(obj1);
+    ASSERT_FALSE(part2.isCanonized());
+  }
+}
+
 TEST(ZObject3dScan, Mainpulate)
 {
   ZObject3dScan obj;
@@ -2361,6 +2980,148 @@ TEST(ZObject3dScan, remove)
 
 }
 
+TEST(ZObject3dScan, importDvidObjectBuffer)
+{
+  auto makePayload = [](const std::vector<int32_t> &spanArray) {
+    std::vector<char> buffer(12 + spanArray.size() * 4, 0);
+    buffer[1] = 3;
+    uint32_t spanNumber = spanArray.size() / 4;
+    memcpy(buffer.data() + 8, &spanNumber, 4);
+    memcpy(buffer.data() + 12, spanArray.data(), spanArray.size() * 4);
+    return buffer;
+  };
+
+  //x, y, z, length
+  std::vector<int32_t> spanArray = {
+    0, 0, 0, 4,  4, 0, 0, 2,  8, 0, 0, 1,  1, 1, 0, 3,
+    2, 0, 1, 2,  5, 3, 1, 4,  0, 0, 2, 1,  3, 2, 2, 1,
+    6, 2, 2, 2,  0, 5, 3, 10
+  };
+
+  ZObject3dScan expected;
+  for (size_t i = 0; i < spanArray.size(); i += 4) {
+    expected.addSegment(spanArray[i + 2], spanArray[i + 1], spanArray[i],
+        spanArray[i] + spanArray[i + 3] - 1, false);
+  }
+  expected.canonize();
+
+  std::vector<char> buffer = makePayload(spanArray);
+
+  ZObject3dScan obj;
+  ASSERT_TRUE(obj.importDvidObjectBuffer(buffer.data(), buffer.size()));
+  ASSERT_TRUE(obj.isCanonized());
+  ASSERT_TRUE(obj.isCanonizedActually());
+  ASSERT_TRUE(obj.equalsLiterally(expected));
+  ASSERT_EQ(0, obj.getStripe(0).getSegmentStart(0));
+  ASSERT_EQ(5, obj.getStripe(0).getSegmentEnd(0));
+
+  for (int threadNumber = 2; threadNumber <= 12; ++threadNumber) {
+    ZObject3dScan obj2;
+    ASSERT_TRUE(obj2.importDvidObjectBuffer(
+                  buffer.data(), buffer.size(), threadNumber));
+    ASSERT_TRUE(obj2.isCanonized());
+    ASSERT_TRUE(obj2.equalsLiterally(expected));
+  }
+
+  //Out of order
+  std::vector<int32_t> spanArray2 = {
+    0, 0, 2, 1,  5, 3, 1, 4,  0, 0, 0, 4,  8, 0, 0, 1,  4, 0, 0, 2
+  };
+  buffer = makePayload(spanArray2);
+  expected.clear();
+  for (size_t i = 0; i < spanArray2.size(); i += 4) {
+    expected.addSegment(spanArray2[i + 2], spanArray2[i + 1], spanArray2[i],
+        spanArray2[i] + spanArray2[i + 3] - 1, false);
+  }
+  expected.canonize();
+
+  for (int threadNumber = 1; threadNumber <= 3; ++threadNumber) {
+    ZObject3dScan obj2;
+    ASSERT_TRUE(obj2.importDvidObjectBuffer(
+                  buffer.data(), buffer.size(), threadNumber));
+    ASSERT_FALSE(obj2.isCanonized());
+    obj2.canonize();
+    ASSERT_TRUE(obj2.equalsLiterally(expected));
+  }
+}
+
+TEST(ZObject3dScanCompact, Basic)
+{
+  ZObject3dScanCompact obj;
+  ASSERT_TRUE(obj.isEmpty());
+  ASSERT_TRUE(obj.isCanonized());
+
+  obj.addSegment(0, 0, 1, 3);
+  obj.addSegment(0, 0, 5, 6);
+  obj.addSegment(0, 1, 2, 2);
+  ASSERT_EQ(2, (int) obj.getStripeNumber());
+  ASSERT_EQ(3, (int) obj.getSegmentNumber());
+  ASSERT_EQ(6, (int) obj.getVoxelNumber());
+  ASSERT_EQ(2, (int) obj.getSegmentNumber(0));
+  ASSERT_EQ(5, obj.getSegmentStart(0, 1));
+  ASSERT_EQ(6, obj.getSegmentEnd(0, 1));
+
+  ZIntCuboid box = obj.getBoundBox();
+  ASSERT_EQ(1, box.getFirstCorner().getX());
+  ASSERT_EQ(6, box.getLastCorner().getX());
+  ASSERT_EQ(1, box.getLastCorner().getY());
+  ASSERT_EQ(0, obj.getZ(1));
+  ASSERT_EQ(1, obj.getY(1));
+  ASSERT_EQ(2, obj.getSegmentStart(1, 0));
+}
+
+TEST(ZObject3dScanCompact, Canonize)
+{
+  ZObject3dScan obj;
+  obj.addSegment(1, 2, 3, 5, false);
+  obj.addSegment(0, 1, 0, 2, false);
+  obj.addSegment(1, 2, 6, 8, false);
+  obj.addSegment(0, 1, 1, 4, false);
+  obj.addSegment(0, 0, 7, 9, false);
+  obj.addSegment(1, 2, 10, 11, false);
+
+  ZObject3dScanCompact compact;
+  compact.load(obj);
+  ASSERT_EQ(obj.getVoxelNumber(), compact.getVoxelNumber());
+
+  obj.canonize();
+  compact.canonize();
+  ASSERT_TRUE(compact.isCanonized());
+  ASSERT_TRUE(compact.toObject3dScan().equalsLiterally(obj));
+
+  ZObject3dScanCompact compact2;
+  compact2.load(obj);
+  ASSERT_TRUE(compact2.equalsLiterally(compact));
+
+  ZObject3dScan obj2;
+  compact.toObject3dScan(&obj2);
+  ASSERT_TRUE(obj2.isCanonized());
+  ASSERT_TRUE(obj2.equalsLiterally(obj));
+}
+
+TEST(ZObject3dScanCompact, DvidBuffer)
+{
+  ZObject3dScan obj;
+  obj.addSegment(0, 0, 0, 3);
+  obj.addSegment(0, 1, 5, 9);
+  obj.addSegment(1, 3, 2, 2);
+
+  std::vector<char> buffer(12 + 16 * 3, 0);
+  buffer[1] = 3;
+  uint32_t spanNumber = 3;
+  memcpy(buffer.data() + 8, &spanNumber, 4);
+  int32_t spanArray[] = {0, 0, 0, 4, 5, 1, 0, 5, 2, 3, 1, 1};
+  memcpy(buffer.data() + 12, spanArray, sizeof(spanArray));
+
+  ZObject3dScanCompact compact;
+  ASSERT_TRUE(compact.importDvidObjectBuffer(buffer.data(), buffer.size()));
+  ASSERT_TRUE(compact.isCanonized());
+  ASSERT_TRUE(compact.toObject3dScan().equalsLiterally(obj));
+
+  ASSERT_FALSE(compact.importDvidObjectBuffer(buffer.data(), 20));
+  ASSERT_TRUE(compact.isEmpty());
+}
+
 #endif
 
 #endif // ZOBJECT3DSCANTEST_H
@@ -0,0 +1,104 @@
+#ifndef ZSTACKPROJECTORTEST_H
+#define ZSTACKPROJECTORTEST_H
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+#include "ztestheader.h"
+#include "zstackprojector.h"
+
+#ifdef _USE_GTEST_
+
+namespace {
+
+template<typename T>
+T ProjectVoxels(ZStackProjector::EMode mode, const std::vector<T> &voxels)
+{
+  switch (mode) {
+  case ZStackProjector::EMode::MAX:
+    return *std::max_element(voxels.begin(), voxels.end());
+  case ZStackProjector::EMode::MIN:
+    return *std::min_element(voxels.begin(), voxels.end());
+  case ZStackProjector::EMode::MEAN:
+  {
+    double sum = 0.0;
+    for (T v : voxels) {
+      sum += v;
+    }
+    if (std::is_integral<T>::value) {
+      return T(sum / voxels.size() + 0.5);
+    }
+    return T(sum / voxels.size());
+  }
+  }
+
+  return T(0);
+}
+
+template<typename T>
+void TestStackProjection(int width, int height, int depth, int threadNumber)
+{
+  std::vector<T> data(size_t(width) * height * depth);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = T((i * 7919 + i / 13) % 251);
+  }
+
+  auto voxel = [&](int x, int y, int z) {
+    return data[(size_t(z) * height + y) * width + x];
+  };
+
+  for (ZStackProjector::EMode mode : {ZStackProjector::EMode::MAX,
+       ZStackProjector::EMode::MIN, ZStackProjector::EMode::MEAN}) {
+    for (ZStackProjector::EAxis axis : {ZStackProjector::EAxis::X,
+         ZStackProjector::EAxis::Y, ZStackProjector::EAxis::Z}) {
+      int projWidth = 0;
+      int projHeight = 0;
+      ZStackProjector::GetProjectionSize(
+            width, height, depth, axis, &projWidth, &projHeight);
+      std::vector<T> proj(size_t(projWidth) * projHeight);
+      ZStackProjector::Project(data.data(), width, height, depth, mode, axis,
+                               proj.data(), threadNumber);
+
+      for (int j = 0; j < projHeight; ++j) {
+        for (int i = 0; i < projWidth; ++i) {
+          std::vector<T> voxels;
+          switch (axis) {
+          case ZStackProjector::EAxis::X:
+            for (int x = 0; x < width; ++x) {
+              voxels.push_back(voxel(x, i, j));
+            }
+            break;
+          case ZStackProjector::EAxis::Y:
+            for (int y = 0; y < height; ++y) {
+              voxels.push_back(voxel(i, y, j));
+            }
+            break;
+          case ZStackProjector::EAxis::Z:
+            for (int z = 0; z < depth; ++z) {
+              voxels.push_back(voxel(i, j, z));
+            }
+            break;
+          }
+          ASSERT_EQ(ProjectVoxels(mode, voxels), proj[j * projWidth + i]);
+        }
+      }
+    }
+  }
+}
+
+}
+
+TEST(ZStackProjector, Project)
+{
+  TestStackProjection<uint8_t>(101, 83, 7, 1);
+  TestStackProjection<uint8_t>(101, 83, 7, 3);
+  TestStackProjection<uint16_t>(127, 70, 5, 4);
+  TestStackProjection<uint16_t>(1, 1, 1, 0);
+  TestStackProjection<float>(33, 10, 6, 2);
+  TestStackProjection<double>(5, 9, 20, 0);
+}
+
+#endif
+
+#endif // ZSTACKPROJECTORTEST_H
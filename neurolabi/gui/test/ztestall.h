@@ -62,6 +62,20 @@
 #include "test/zstackobjectgrouptest.h"
 #include "test/zgradientmagnitudemoduletest.h"
 #include "test/zdvidresultservicetest.h"
+#include "test/zdvidrequestenginetest.h"
+#include "test/zdvidrequestcoalescertest.h"
+#include "test/zdvidblockcachetest.h"
+#include "test/zdvidlabelblocktest.h"
+#include "test/zdvidbodyidresolvertest.h"
+#include "test/zdvidsliceprefetchertest.h"
+#include "test/zdvidbodystreamloadertest.h"
+#include "test/zdvidsynapsestoretest.h"
+#include "test/zdvidmesharchivedecodertest.h"
+#include "test/zdvidmetricstest.h"
+#include "test/zdvidlabelcolorizertest.h"
+#include "test/zimageluttest.h"
+#include "test/zdvidtilecachetest.h"
+#include "test/zstackprojectortest.h"
 #include "test/zstackobjectinfotest.h"
 #include "test/zglobaltest.h"
 #include "test/zmouseeventprocessortest.h"
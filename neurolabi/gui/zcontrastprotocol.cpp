@@ -5,15 +5,24 @@
 #include "zjsonparser.h"
 #include "zjsonobject.h"
 
-ZContrastProtocol::ZContrastProtocol()
+namespace {
+//const double DEFAULT_NONLINEAR_OFFSET = -1.0;
+//const double DEFAULT_NONLINEAR_SCALE = 2.197;
+const double DEFAULT_NONLINEAR_OFFSET = -0.5;
+const double DEFAULT_NONLINEAR_SCALE = 4.197;
+}
+
+ZContrastProtocol::ZContrastProtocol() :
+  ZContrastProtocol(DEFAULT_NONLINEAR_OFFSET, DEFAULT_NONLINEAR_SCALE,
+                    NONLINEAR_SIGMOID)
 {
-  setDefaultNonLinear();
 }
 
 ZContrastProtocol::ZContrastProtocol(
     double offset, double scale, ENonlinearMode nonlinear) :
   m_offset(offset), m_scale(scale), m_nonlinearMode(nonlinear)
 {
+  updateGreyMap();
 }
 
 double ZContrastProtocol::getOffset() const
@@ -45,16 +54,19 @@ ZJsonObject ZContrastProtocol::toJsonObject() const
 void ZContrastProtocol::setNonlinear(ENonlinearMode mode)
 {
   m_nonlinearMode = mode;
+  updateGreyMap();
 }
 
 void ZContrastProtocol::setOffset(double offset)
 {
   m_offset = offset;
+  updateGreyMap();
 }
 
 void ZContrastProtocol::setScale(double scale)
 {
   m_scale = scale;
+  updateGreyMap();
 }
 
 void ZContrastProtocol::load(const ZJsonObject &obj)
@@ -80,17 +92,24 @@ void ZContrastProtocol::load(const ZJsonObject &obj)
   if (obj.hasKey("scale")) {
     m_scale = ZJsonParser::numberValue(obj["scale"]);
   }
+
+  updateGreyMap();
 }
 
-uint8_t ZContrastProtocol::mapGrey(uint8_t v)
+void ZContrastProtocol::updateGreyMap()
 {
-  if (hasNoEffect()) {
-    return v;
+  for (int i = 0; i < 256; ++i) {
+    if (hasNoEffect()) {
+      m_greyMap[i] = i;
+    } else {
+      m_greyMap[i] = iround(mapFloat(i / 255.0) * 255.0);
+    }
   }
+}
 
-  double nv = mapFloat(v / 255.0);
-
-  return iround(nv * 255.0);
+uint8_t ZContrastProtocol::mapGrey(uint8_t v) const
+{
+  return m_greyMap[v];
 }
 
 /*
@@ -117,7 +136,7 @@ int ZContrastProtocol::mapInt(int v)
  *
  * Nonlinear mapping: 1/(1+exp(-(x+x0)*s)), 0->0, 1->1.
  */
-double ZContrastProtocol::mapFloat(double v)
+double ZContrastProtocol::mapFloat(double v) const
 {
   if (hasNoEffect()) {
     return v;
@@ -153,9 +172,8 @@ double ZContrastProtocol::mapFloat(double v)
 
 void ZContrastProtocol::setDefaultNonLinear()
 {
-//  setOffset(-1.0);
-//  setScale(2.197);
-  setOffset(-0.5);
-  setScale(4.197);
-  setNonlinear(NONLINEAR_SIGMOID);
+  m_offset = DEFAULT_NONLINEAR_OFFSET;
+  m_scale = DEFAULT_NONLINEAR_SCALE;
+  m_nonlinearMode = NONLINEAR_SIGMOID;
+  updateGreyMap();
 }
@@ -27,9 +27,22 @@ public:
   bool isNonlinear() const;
 
 
-  uint8_t mapGrey(uint8_t v);
+  /*!
+   * \brief Map an 8-bit grey value.
+   *
+   * The mapping is looked up from a table, which is updated whenever the
+   * protocol changes.
+   */
+  uint8_t mapGrey(uint8_t v) const;
 //  int mapInt(int v);
-  double mapFloat(double v);
+  double mapFloat(double v) const;
+
+  /*!
+   * \brief Get the table of mapping all 256 grey values.
+   */
+  const uint8_t* getGreyMap() const {
+    return m_greyMap;
+  }
 
   /*!
    * \brief Set protocal from a json object
@@ -49,11 +62,14 @@ public:
 
   void setDefaultNonLinear();
 
+private:
+  void updateGreyMap();
 
 private:
   double m_offset;
   double m_scale;
   ENonlinearMode m_nonlinearMode;
+  uint8_t m_greyMap[256];
 };
 
 
@@ -2,6 +2,7 @@
 
 #include <QUrl>
 #include <cmath>
+#include <mutex>
 
 #include "neutubeconfig.h"
 #include "zjsonvalue.h"
@@ -12,6 +13,7 @@
 #include "zintcuboid.h"
 #include "dvid/zdvidurl.h"
 #include "dvid/zdvidreader.h"
+#include "dvid/zdvidblockcache.h"
 
 #if defined(_ENABLE_LIBDVIDCPP_)
 
@@ -321,6 +323,30 @@ ZIntCuboid ZDvid::GetZoomBox(const ZIntCuboid &box, int zoom)
   return zoomBox;
 }
 
+ZDvidBlockCache* ZDvid::GetBlockCache(const ZDvidTarget &target)
+{
+  static std::once_flag openFlag;
+  std::call_once(openFlag, []() {
+    std::string cacheDir =
+        NeutubeConfig::getInstance().getPath(NeutubeConfig::DVID_CACHE);
+    if (!cacheDir.empty()) {
+      if (!ZDvidBlockCache::GetInstance().open(cacheDir)) {
+        LWARN() << "Failed to open the DVID block cache at" << cacheDir
+                << "; it may be in use by another process. "
+                   "Blocks will not be cached.";
+      }
+    }
+  });
+
+  ZDvidBlockCache &cache = ZDvidBlockCache::GetInstance();
+  if (cache.isOpen() &&
+      cache.getNodeLockState(target.getAddressWithPort(), target.getUuid()) > 0) {
+    return &cache;
+  }
+
+  return NULL;
+}
+
 bool ZDvid::IsDataValid(const std::string &data, const ZDvidTarget &target,
                         const ZJsonObject &infoJson, const ZDvidVersionDag &dag)
 {
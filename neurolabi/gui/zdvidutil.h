@@ -12,6 +12,7 @@ class ZDvidVersionDag;
 class ZDvidInfo;
 class ZIntCuboid;
 class ZDvidReader;
+class ZDvidBlockCache;
 
 #define DVID_UUID_COMMON_LENGTH 4
 
@@ -98,6 +99,15 @@ bool IsValidDvidUrl(const std::string &url);
  */
 bool IsUuidMatched(const std::string &uuid1, const std::string &uuid2);
 
+/*!
+ * \brief Get the persistent block cache for a DVID node.
+ *
+ * The cache is opened in the DVID_CACHE folder on the first call. It returns
+ * NULL if the cache is not available or the node of \a target is not known
+ * to be locked (see ZDvidReader::isNodeLocked()).
+ */
+ZDvidBlockCache* GetBlockCache(const ZDvidTarget &target);
+
 bool IsDataValid(const std::string &data, const ZDvidTarget &target,
                  const ZJsonObject &infoJson, const ZDvidVersionDag &dag);
 
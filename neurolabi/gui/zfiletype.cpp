@@ -2,6 +2,7 @@
 
 //#include <QString>
 #include "zstring.h"
+#include "zobject3dscanchunkfile.h"
 
 #ifdef _QT_GUI_USED_
 #include "zmesh.h"
@@ -68,7 +69,9 @@ ZFileType::EFileType ZFileType::FileType(const std::string &filePath)
     return FILE_TXT;
   } else if (str.endsWith(".nsp", ZString::CASE_INSENSITIVE)) {
     return FILE_MYERS_NSP;
-  } else if (str.endsWith(".sobj", ZString::CASE_INSENSITIVE)) {
+  } else if (str.endsWith(".sobj", ZString::CASE_INSENSITIVE) ||
+             str.endsWith(ZObject3dScanChunkFile::EXTENSION,
+                          ZString::CASE_INSENSITIVE)) {
     return FILE_OBJECT_SCAN;
   } else if (str.endsWith(".soba", ZString::CASE_INSENSITIVE)) {
     return FILE_OBJECT_SCAN_ARRAY;
@@ -1243,55 +1243,28 @@ void ZImage::enhanceContrast(bool highContrast)
 
     if (this->depth() == 32) {
       if (highContrast) {
+        //Each color channel is boosted by 20%
+        static const std::vector<uchar> boostTable = []() {
+          std::vector<uchar> table(256);
+          for (int i = 0; i < 256; ++i) {
+            table[i] = (i <= 213) ? uchar(i + i / 5) : uchar(255);
+          }
+          return table;
+        }();
+
         for (int j = 0; j < height(); j++) {
           uchar *line = scanLine(j);
           for (int i = 0; i < width(); i++) {
-            if (line[0] <= 213) {
-              line[0] += line[0] / 5;
-            } else {
-              line[0] = 255;
-            }
-            if (line[1] <= 213) {
-              line[1] += line[1] / 5;
-            } else {
-              line[1] = 255;
-            }
-            if (line[2] <= 213) {
-              line[2] += line[2] / 5;
-            } else {
-              line[2] = 255;
-            }
-
+            line[0] = boostTable[line[0]];
+            line[1] = boostTable[line[1]];
+            line[2] = boostTable[line[2]];
             line += 4;
           }
         }
       }
     } else if (this->depth() == 8) {
       if (highContrast) {
-        uchar colorTable[256];
-//        double s = m_grayScale;
-        for (int i = 0; i < 256; ++i) {
-          int v = m_contrastProtocol.mapGrey(i);
-#if 0
-          double v = (i + m_grayOffset) * s;
-
-          if (m_nonlinear) {
-            if (v < 0.0) {
-              v = 0.0;
-            } else {
-              v = sqrt(v / 255.0) * i;
-            }
-          }
-
-          if (v < 0.0) {
-            v = 0.0;
-          } else if (v > 255.0) {
-            v = 255.0;
-          }
-#endif
-          colorTable[i] = iround(v);
-        }
-
+        const uint8_t *colorTable = m_contrastProtocol.getGreyMap();
         for (int j = 0; j < height(); j++) {
           uchar *line = scanLine(j);
           for (int i = 0; i < width(); i++) {
@@ -1530,6 +1503,11 @@ void ZImage::setDataBlock(const ZImage::DataSource<uint8_t> &source, int startLi
   }
 
   const uint8_t* data = source.data + startLine * width();
+  if (setDataByLut(data, startLine, endLine, source.scale, source.offset,
+                   source.color, threshold)) {
+    return;
+  }
+
   float scale = source.scale;
   float offset = source.offset;
   glm::vec3 color = glm::vec3(source.color.b, source.color.g, source.color.r);
@@ -1631,6 +1609,22 @@ void ZImage::setDataBlock(const ZImage::DataSource<uint8_t> &source, int startLi
   }
 }
 
+bool ZImage::setDataByLut(
+    const uint8_t *data, int startLine, int endLine, double scale,
+    double offset, const glm::vec3 &color, int threshold)
+{
+  return setDataByLut(data, startLine, endLine, 256, scale, offset, color,
+                      threshold);
+}
+
+bool ZImage::setDataByLut(
+    const uint16_t *data, int startLine, int endLine, double scale,
+    double offset, const glm::vec3 &color, int threshold)
+{
+  return setDataByLut(data, startLine, endLine, 65536, scale, offset, color,
+                      threshold);
+}
+
 void ZImage::setDataIndexed8(
     const std::vector<ZImage::DataSource<uint8_t> > &sources,
     uint8_t alpha, bool useMultithread)
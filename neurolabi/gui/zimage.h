@@ -11,6 +11,7 @@
 #include "zsttransform.h"
 #include "neutube.h"
 #include "zcontrastprotocol.h"
+#include "zimagelut.h"
 
 class ZStack;
 class ZObject3dScan;
@@ -208,6 +209,28 @@ public:
 private:
   template<class T>
   void setBinaryDataIndexed8(const T *data, T bg);
+
+  /*!
+   * \brief Set rows [\a startLine, \a endLine) of an ARGB32 image through a
+   * lookup table.
+   *
+   * \a data starts from the first pixel of \a startLine. It returns false
+   * without doing anything if the pixel type or the image format is not
+   * supported.
+   */
+  template<class T>
+  bool setDataByLut(const T *data, int startLine, int endLine, double scale,
+                    double offset, const glm::vec3 &color, int threshold);
+  bool setDataByLut(const uint8_t *data, int startLine, int endLine,
+                    double scale, double offset, const glm::vec3 &color,
+                    int threshold);
+  bool setDataByLut(const uint16_t *data, int startLine, int endLine,
+                    double scale, double offset, const glm::vec3 &color,
+                    int threshold);
+  template<class T>
+  bool setDataByLut(const T *data, int startLine, int endLine,
+                    size_t valueNumber, double scale, double offset,
+                    const glm::vec3 &color, int threshold);
   static bool hasSameColor(uchar *pt1, uchar *pt2);
   static void MakeValueMap(double scale, double offset, uint8 *valueMap);
   void setDataIndexed8(const uint8_t *data);
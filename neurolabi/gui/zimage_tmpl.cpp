@@ -134,6 +134,10 @@ void ZImage::setData(const T *data, double scale, double offset,
         return;
     }
 
+    if (setDataByLut(data, 0, height(), scale, offset, glm::vec3(1.f),
+                     threshold)) {
+        return;
+    }
 
     if (threshold < 0) {
         int i, j;
@@ -509,6 +513,11 @@ void ZImage::setData(const ZImage::DataSource<T> &source, int threshold, bool us
     return;
   }
 
+  if (setDataByLut(source.data, 0, height(), source.scale, source.offset,
+                   source.color, threshold)) {
+    return;
+  }
+
   const T* data = source.data;
   float scale = source.scale;
   float offset = source.offset;
@@ -669,6 +678,11 @@ void ZImage::setDataBlock(const ZImage::DataSource<T> &source, int startLine,
     }
 
   const T* data = source.data + startLine * width();
+  if (setDataByLut(data, startLine, endLine, source.scale, source.offset,
+                   source.color, threshold)) {
+    return;
+  }
+
   float scale = source.scale;
   float offset = source.offset;
   glm::vec3 color = glm::vec3(source.color.b, source.color.g, source.color.r);
@@ -808,3 +822,30 @@ void ZImage::setDataBlockMS(const std::vector<ZImage::DataSource<T> > &sources,
   }
 }
 
+template<class T>
+bool ZImage::setDataByLut(
+    const T *, int, int, double, double, const glm::vec3 &, int)
+{
+  return false;
+}
+
+template<class T>
+bool ZImage::setDataByLut(
+    const T *data, int startLine, int endLine, size_t valueNumber,
+    double scale, double offset, const glm::vec3 &color, int threshold)
+{
+  if (!isArgb32()) {
+    return false;
+  }
+
+  std::shared_ptr<const ZImageLut::TTable> table = ZImageLut::GetLinear(
+        valueNumber, scale, offset, color.r, color.g, color.b, threshold);
+
+  int w = width();
+  for (int j = startLine; j < endLine; ++j) {
+    ZImageLut::Apply(data, w, table->data(), (uint32_t*) scanLine(j));
+    data += w;
+  }
+
+  return true;
+}
@@ -0,0 +1,150 @@
+#include "zimagelut.h"
+
+#include <mutex>
+#include <list>
+#include <tuple>
+#include <algorithm>
+
+#include "core/cpufeature.h"
+
+#if defined(NT_AVX2_DISPATCH)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const size_t MAX_CACHED_TABLE_NUMBER = 8;
+
+uint32_t MapChannel(double channel, double value)
+{
+  double v = channel * value;
+  if (v <= 0.0) {
+    return 0;
+  } else if (v >= 255.0) {
+    return 255;
+  }
+
+  return uint32_t(v);
+}
+
+#if defined(NT_AVX2_DISPATCH)
+//Returns the number of values converted, which is a multiple of 8
+NT_AVX2_TARGET size_t ApplyAvx2(
+    const uint8_t *data, size_t n, const uint32_t *table, uint32_t *out)
+{
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i index = _mm256_cvtepu8_epi32(
+          _mm_loadl_epi64((const __m128i*) (data + i)));
+    _mm256_storeu_si256(
+          (__m256i*) (out + i),
+          _mm256_i32gather_epi32((const int*) table, index, 4));
+  }
+
+  return i;
+}
+
+NT_AVX2_TARGET size_t ApplyAvx2(
+    const uint16_t *data, size_t n, const uint32_t *table, uint32_t *out)
+{
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i index = _mm256_cvtepu16_epi32(
+          _mm_loadu_si128((const __m128i*) (data + i)));
+    _mm256_storeu_si256(
+          (__m256i*) (out + i),
+          _mm256_i32gather_epi32((const int*) table, index, 4));
+  }
+
+  return i;
+}
+#endif
+
+struct TableKey {
+  size_t valueNumber;
+  double scale;
+  double offset;
+  double red;
+  double green;
+  double blue;
+  int threshold;
+
+  bool operator== (const TableKey &key) const {
+    return std::tie(valueNumber, scale, offset, red, green, blue, threshold) ==
+        std::tie(key.valueNumber, key.scale, key.offset, key.red, key.green,
+                 key.blue, key.threshold);
+  }
+};
+
+}
+
+void ZImageLut::MakeLinear(
+    TTable &table, size_t valueNumber, double scale, double offset,
+    double red, double green, double blue, int threshold)
+{
+  table.resize(valueNumber);
+  for (size_t i = 0; i < valueNumber; ++i) {
+    if (threshold >= 0 && i > size_t(threshold)) {
+      table[i] = 0xFFFF0000;
+    } else {
+      double value = scale * i + offset;
+      table[i] = 0xFF000000 | (MapChannel(red, value) << 16) |
+          (MapChannel(green, value) << 8) | MapChannel(blue, value);
+    }
+  }
+}
+
+std::shared_ptr<const ZImageLut::TTable> ZImageLut::GetLinear(
+    size_t valueNumber, double scale, double offset,
+    double red, double green, double blue, int threshold)
+{
+  static std::mutex mutex;
+  static std::list<std::pair<TableKey, std::shared_ptr<const TTable>>> cache;
+
+  TableKey key{valueNumber, scale, offset, red, green, blue, threshold};
+
+  std::lock_guard<std::mutex> guard(mutex);
+  for (auto iter = cache.begin(); iter != cache.end(); ++iter) {
+    if (iter->first == key) {
+      cache.splice(cache.begin(), cache, iter);
+      return cache.front().second;
+    }
+  }
+
+  std::shared_ptr<TTable> table = std::make_shared<TTable>();
+  MakeLinear(*table, valueNumber, scale, offset, red, green, blue, threshold);
+  cache.emplace_front(key, table);
+  if (cache.size() > MAX_CACHED_TABLE_NUMBER) {
+    cache.pop_back();
+  }
+
+  return table;
+}
+
+void ZImageLut::Apply(
+    const uint8_t *data, size_t n, const uint32_t *table, uint32_t *out)
+{
+  size_t i = 0;
+#if defined(NT_AVX2_DISPATCH)
+  if (neutube::HasAvx2()) {
+    i = ApplyAvx2(data, n, table, out);
+  }
+#endif
+  for (; i < n; ++i) {
+    out[i] = table[data[i]];
+  }
+}
+
+void ZImageLut::Apply(
+    const uint16_t *data, size_t n, const uint32_t *table, uint32_t *out)
+{
+  size_t i = 0;
+#if defined(NT_AVX2_DISPATCH)
+  if (neutube::HasAvx2()) {
+    i = ApplyAvx2(data, n, table, out);
+  }
+#endif
+  for (; i < n; ++i) {
+    out[i] = table[data[i]];
+  }
+}
@@ -0,0 +1,56 @@
+#ifndef ZIMAGELUT_H
+#define ZIMAGELUT_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+/*!
+ * \brief The class of lookup tables from intensities to ARGB32 colors
+ *
+ * A table has an entry for every value of an 8-bit (256 entries) or 16-bit
+ * (65536 entries) image, so that the intensity transform is computed once for
+ * each value instead of once for each pixel. Apply() converts a row of pixels
+ * by gathering from the table.
+ */
+class ZImageLut
+{
+public:
+  typedef std::vector<uint32_t> TTable;
+
+  /*!
+   * \brief Make a table of linear mapping.
+   *
+   * Each channel of the color of a value v is
+   * clamp(channel * (scale * v + offset), 0, 255). The color is opaque red for
+   * values above \a threshold if \a threshold >= 0.
+   */
+  static void MakeLinear(
+      TTable &table, size_t valueNumber, double scale, double offset,
+      double red = 1.0, double green = 1.0, double blue = 1.0,
+      int threshold = -1);
+
+  /*!
+   * \brief Get a linear table shared by calls with the same parameters.
+   *
+   * The most recently used tables are kept, so that images drawn with the same
+   * intensity transform do not build their tables again.
+   */
+  static std::shared_ptr<const TTable> GetLinear(
+      size_t valueNumber, double scale, double offset,
+      double red = 1.0, double green = 1.0, double blue = 1.0,
+      int threshold = -1);
+
+  /*!
+   * \brief Write the colors of \a n values into \a out.
+   *
+   * \a table must have an entry for each possible value of \a data.
+   */
+  static void Apply(
+      const uint8_t *data, size_t n, const uint32_t *table, uint32_t *out);
+  static void Apply(
+      const uint16_t *data, size_t n, const uint32_t *table, uint32_t *out);
+};
+
+#endif // ZIMAGELUT_H
@@ -12,6 +12,34 @@
 #include "ilastik/laplacian_smoothing.h"
 #include "zobject3dscanarray.h"
 #include "data3d/zstackobjecthelper.h"
+#include "geometry/zgeometry.h"
+
+namespace {
+
+/*
+ * Get the object downsampled by <dsIntv>. The result is computed in <buffer>
+ * so that <obj> is left unchanged. Power-of-two intervals use the streaming
+ * pyramid downsampling.
+ */
+const ZObject3dScan& GetDsObject(
+    const ZObject3dScan &obj, int dsIntv, ZObject3dScan &buffer)
+{
+  if (dsIntv <= 0) {
+    return obj;
+  }
+
+  buffer = obj;
+  int scale = dsIntv + 1;
+  if ((scale & (scale - 1)) == 0) {
+    buffer.downsampleToPyramidLevel(zgeom::GetZoomLevel(scale));
+  } else {
+    buffer.downsampleMax(dsIntv, dsIntv, dsIntv);
+  }
+
+  return buffer;
+}
+
+}
 
 ZMeshFactory::ZMeshFactory()
 {
@@ -149,16 +177,13 @@ ZMesh* ZMeshFactory::MakeMesh(
     return NULL;
   }
 
-  ZObject3dScan dsObj = obj;
-
   if (dsIntv == 0) {
-    ZIntCuboid box = dsObj.getBoundBox();
+    ZIntCuboid box = obj.getBoundBox();
     dsIntv = misc::getIsoDsIntvFor3DVolume(box, neutube::ONEGIGA / 2, true);
   }
 
-  if (dsIntv > 0) {
-    dsObj.downsampleMax(dsIntv, dsIntv, dsIntv);
-  }
+  ZObject3dScan buffer;
+  const ZObject3dScan &dsObj = GetDsObject(obj, dsIntv, buffer);
 
   ZStack *stack = dsObj.toStackObjectWithMargin(1, 1);
   ZMesh *mesh = ZMarchingCube::March(*stack, smooth, offsetAdjust, NULL);
@@ -181,16 +206,13 @@ ZMesh* ZMeshFactory::MakeFaceMesh(const ZObject3dScan &obj, int dsIntv)
 
   ZMesh *mesh = new ZMesh;
 
-  ZObject3dScan dsObj = obj;
-
   if (dsIntv == 0) {
-    ZIntCuboid box = dsObj.getBoundBox();
+    ZIntCuboid box = obj.getBoundBox();
     dsIntv = misc::getIsoDsIntvFor3DVolume(box, neutube::ONEGIGA / 2, true);
   }
 
-  if (dsIntv > 0) {
-    dsObj.downsampleMax(dsIntv, dsIntv, dsIntv);
-  }
+  ZObject3dScan buffer;
+  const ZObject3dScan &dsObj = GetDsObject(obj, dsIntv, buffer);
 
   //For each voxel, create a graph
   int startCoord[3];
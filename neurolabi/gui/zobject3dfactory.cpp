@@ -246,10 +246,16 @@ ZObject3dScanArray* ZObject3dFactory::MakeObject3dScanArray(
   ZObject3dScanArray *objArray = NULL;
 
   if (stack.hasData()) {
-    std::map<uint64_t, ZObject3dScan*> *bodySet =
-        ZObject3dScan::extractAllObject(
-          stack.array8(), stack.width(), stack.height(), stack.depth(), 0, yStep,
-          NULL);
+    std::map<uint64_t, ZObject3dScan*> *bodySet = NULL;
+    if (yStep == 1) {
+      bodySet = ZObject3dScan::extractAllObjectParallel(
+            stack.array8(), stack.width(), stack.height(), stack.depth(),
+            0, 0, 0, true);
+    } else {
+      bodySet = ZObject3dScan::extractAllObject(
+            stack.array8(), stack.width(), stack.height(), stack.depth(), 0,
+            yStep, NULL);
+    }
     objArray = new ZObject3dScanArray;
     for (std::map<uint64_t, ZObject3dScan*>::const_iterator iter = bodySet->begin();
          iter != bodySet->end(); ++iter) {
@@ -299,9 +305,9 @@ std::map<uint64_t, ZObject3dScan*>* ZObject3dFactory::ExtractAllForegroundObject
     ZStack &stack, bool upsampling)
 {
   std::map<uint64_t, ZObject3dScan*> *bodySet =
-      ZObject3dScan::extractAllForegroundObject(
+      ZObject3dScan::extractAllObjectParallel(
         stack.array8(), stack.width(), stack.height(), stack.depth(),
-        neutube::EAxis::Z);
+        0, 0, 0, true);
   if (bodySet != NULL) {
     for (auto &bodyIter : *bodySet) {
       ZObject3dScan *body = bodyIter.second;
@@ -422,10 +428,16 @@ std::vector<ZObject3dScan*> ZObject3dFactory::MakeObject3dScanPointerArray(
       mask = MakeBoundaryStack(stack);
     }
 
-    std::map<uint64_t, ZObject3dScan*> *bodySet =
-        ZObject3dScan::extractAllObject(
-          mask->array8(), mask->width(), mask->height(), mask->depth(),
-          0, yStep, NULL);
+    std::map<uint64_t, ZObject3dScan*> *bodySet = NULL;
+    if (yStep == 1) {
+      bodySet = ZObject3dScan::extractAllObjectParallel(
+            mask->array8(), mask->width(), mask->height(), mask->depth(),
+            0, 0, 0, true);
+    } else {
+      bodySet = ZObject3dScan::extractAllObject(
+            mask->array8(), mask->width(), mask->height(), mask->depth(),
+            0, yStep, NULL);
+    }
     for (std::map<uint64_t, ZObject3dScan*>::const_iterator iter = bodySet->begin();
          iter != bodySet->end(); ++iter) {
       ZObject3dScan *obj = iter->second;
@@ -456,7 +468,11 @@ ZObject3dScanArray* ZObject3dFactory::MakeObject3dScanArray(
   std::map<uint64_t, ZObject3dScan*> *bodySet = NULL;
 
   if (array.valueType() == mylib::UINT64_TYPE) {
-    if (foreground) {
+    if (yStep == 1) {
+      bodySet = ZObject3dScan::extractAllObjectParallel(
+            array.getDataPointer<uint64_t>(), array.dim(0), array.dim(1),
+            array.dim(2), 0, 0, 0, foreground);
+    } else if (foreground) {
       bodySet = ZObject3dScan::extractAllForegroundObject(
         array.getDataPointer<uint64_t>(), array.dim(0), array.dim(1),
             array.dim(2), 0, 0, 0, yStep, NULL);
@@ -508,7 +524,11 @@ ZObject3dScanArray* ZObject3dFactory::MakeObject3dScanArray(
 
   switch (stack.kind()) {
   case GREY:
-    if (foreground) {
+    if (axis == neutube::EAxis::Z) {
+      bodySet = ZObject3dScan::extractAllObjectParallel(
+            stack.array8(), stack.width(), stack.height(), stack.depth(),
+            0, 0, 0, foreground);
+    } else if (foreground) {
       bodySet = ZObject3dScan::extractAllForegroundObject(
             stack.array8(), stack.width(), stack.height(), stack.depth(), axis);
     } else {
@@ -517,7 +537,11 @@ ZObject3dScanArray* ZObject3dFactory::MakeObject3dScanArray(
     }
     break;
   case GREY16:
-    if (foreground) {
+    if (axis == neutube::EAxis::Z) {
+      bodySet = ZObject3dScan::extractAllObjectParallel(
+            stack.array16(), stack.width(), stack.height(), stack.depth(),
+            0, 0, 0, foreground);
+    } else if (foreground) {
       bodySet = ZObject3dScan::extractAllForegroundObject(
             stack.array16(), stack.width(), stack.height(), stack.depth(), axis);
     } else {
@@ -576,7 +600,11 @@ ZObject3dScanArray* ZObject3dFactory::MakeObject3dScanArray(
   std::map<uint64_t, ZObject3dScan*> *bodySet = NULL;
 
   if (array.valueType() == mylib::UINT64_TYPE) {
-    if (foreground) {
+    if (axis == neutube::EAxis::Z) {
+      bodySet = ZObject3dScan::extractAllObjectParallel(
+            array.getDataPointer<uint64_t>(), array.dim(0), array.dim(1),
+            array.dim(2), 0, 0, 0, foreground);
+    } else if (foreground) {
       bodySet = ZObject3dScan::extractAllForegroundObject(
             array.getDataPointer<uint64_t>(), array.dim(0), array.dim(1),
             array.dim(2), axis);
@@ -7,6 +7,8 @@
 #include <sstream>
 #include <cmath>
 #include <cstring>
+#include <thread>
+#include <functional>
 #if _QT_GUI_USED_
 
 #endif
@@ -42,6 +44,7 @@
 #include "zstackwriter.h"
 #include "zobject3dfactory.h"
 #include "core/memorystream.h"
+#include "zobject3dscanchunkfile.h"
 
 ///////////////////////////////////////////////////
 
@@ -53,6 +56,7 @@ const ZObject3dScan::TEvent ZObject3dScan::EVENT_OBJECT_UNCANONIZED =
     0x4 | ZObject3dScan::EVENT_OBJECT_VIEW_CHANGED;
 const ZObject3dScan::TEvent ZObject3dScan::EVENT_OBJECT_CANONIZED =
     0x8 | ZObject3dScan::EVENT_OBJECT_VIEW_CHANGED;
+const ZObject3dScan::TEvent ZObject3dScan::EVENT_OBJECT_SUMMARY_UPDATED = 0x10;
 
 const int ZObject3dScan::MAX_SPAN_HINT = 2000000;
 
@@ -105,6 +109,10 @@ ZObject3dScan& ZObject3dScan::operator=(const ZObject3dScan& obj)
   m_blockingEvent = false;
   m_sliceAxis = obj.m_sliceAxis;
   m_dsIntv = obj.m_dsIntv;
+  if (obj.m_summary.isValid) {
+    m_summary = obj.m_summary;
+    m_slicewiseVoxelNumber = obj.m_slicewiseVoxelNumber;
+  }
 //  uint64_t m_label;
 
 //  this->m_zProjection = NULL;
@@ -125,6 +133,10 @@ ZObject3dScan& ZObject3dScan::operator=(const ZObject3dScan&& obj)
   m_blockingEvent = false;
   m_sliceAxis = obj.m_sliceAxis;
   m_dsIntv = obj.m_dsIntv;
+  if (obj.m_summary.isValid) {
+    m_summary = obj.m_summary;
+    m_slicewiseVoxelNumber = obj.m_slicewiseVoxelNumber;
+  }
 //  uint64_t m_label;
 
 //  this->m_zProjection = NULL;
@@ -182,12 +194,15 @@ bool ZObject3dScan::isDeprecated(EComponent comp) const
   switch (comp) {
   case COMPONENT_STRIPE_INDEX_MAP:
     return m_stripeMap.empty();
+  case COMPONENT_STRIPE_INDEX_HASH:
+    return m_stripeIndexHash.empty();
   case COMPONENT_INDEX_SEGMENT_MAP:
     return m_indexSegmentMap.empty();
   case COMPONENT_ACCUMULATED_STRIPE_NUMBER:
     return m_accNumberArray.empty();
   case COMPONENT_SLICEWISE_VOXEL_NUMBER:
-    return m_slicewiseVoxelNumber.empty();
+  case COMPONENT_SUMMARY:
+    return !m_summary.isValid;
   case COMPONENT_Z_PROJECTION:
     return m_zProjection == NULL;
   default:
@@ -205,6 +220,9 @@ void ZObject3dScan::deprecate(EComponent comp)
   case COMPONENT_STRIPE_INDEX_MAP:
     m_stripeMap.clear();
     break;
+  case COMPONENT_STRIPE_INDEX_HASH:
+    m_stripeIndexHash.clear();
+    break;
   case COMPONENT_INDEX_SEGMENT_MAP:
     m_indexSegmentMap.clear();
     break;
@@ -212,7 +230,12 @@ void ZObject3dScan::deprecate(EComponent comp)
     m_accNumberArray.clear();
     break;
   case COMPONENT_SLICEWISE_VOXEL_NUMBER:
-    m_slicewiseVoxelNumber.clear();
+  case COMPONENT_SUMMARY:
+    //Checked first because it is called for every segment added
+    if (m_summary.isValid) {
+      m_summary = Summary();
+      m_slicewiseVoxelNumber.clear();
+    }
     break;
   case COMPONENT_Z_PROJECTION:
     delete m_zProjection;
@@ -221,8 +244,9 @@ void ZObject3dScan::deprecate(EComponent comp)
   case COMPONENT_ALL:
     deprecate(COMPONENT_STRIPE_INDEX_MAP);
     deprecate(COMPONENT_INDEX_SEGMENT_MAP);
+    deprecate(COMPONENT_STRIPE_INDEX_HASH);
     deprecate(COMPONENT_ACCUMULATED_STRIPE_NUMBER);
-    deprecate(COMPONENT_SLICEWISE_VOXEL_NUMBER);
+    deprecate(COMPONENT_SUMMARY);
     deprecate(COMPONENT_Z_PROJECTION);
     break;
   }
@@ -248,12 +272,9 @@ size_t ZObject3dScan::getStripeNumber() const
 
 size_t ZObject3dScan::getVoxelNumber() const
 {
-  size_t voxelNumber = 0;
-  for (size_t i = 0; i < getStripeNumber(); ++i) {
-    voxelNumber += m_stripeArray[i].getVoxelNumber();
-  }
+  updateSummary();
 
-  return voxelNumber;
+  return m_summary.voxelNumber;
 }
 
 bool ZObject3dScan::hasVoxel() const
@@ -269,33 +290,141 @@ bool ZObject3dScan::hasVoxel() const
 
 size_t ZObject3dScan::getVoxelNumber(int z) const
 {
-  size_t voxelNumber = 0;
-  size_t stripeNumber = getStripeNumber();
-  for (size_t i = 0; i < stripeNumber; ++i) {
-    if (m_stripeArray[i].getZ() == z) {
-      voxelNumber += m_stripeArray[i].getVoxelNumber();
-    }
+  updateSummary();
+
+  auto iter = m_slicewiseVoxelNumber.find(z);
+  if (iter != m_slicewiseVoxelNumber.end()) {
+    return iter->second;
   }
 
-  return voxelNumber;
+  return 0;
 }
 
 const std::unordered_map<int, size_t> &ZObject3dScan::getSlicewiseVoxelNumber() const
 {
-  if (isDeprecated(COMPONENT_SLICEWISE_VOXEL_NUMBER)) {
-    //std::vector<size_t> voxelNumber;
-    size_t stripeNumber = getStripeNumber();
-    for (size_t i = 0; i < stripeNumber; ++i) {
-      int z = m_stripeArray[i].getZ();
-      if (m_slicewiseVoxelNumber.count(z) == 0) {
-        m_slicewiseVoxelNumber[z] = m_stripeArray[i].getVoxelNumber();
-      } else {
-        m_slicewiseVoxelNumber[z] += m_stripeArray[i].getVoxelNumber();
+  updateSummary();
+
+  return m_slicewiseVoxelNumber;
+}
+
+void ZObject3dScan::Summary::joinBoundBox(int x0, int x1, int y, int z)
+{
+  if (hasBoundBox) {
+    minX = std::min(minX, x0);
+    maxX = std::max(maxX, x1);
+    minY = std::min(minY, y);
+    maxY = std::max(maxY, y);
+    minZ = std::min(minZ, z);
+    maxZ = std::max(maxZ, z);
+  } else {
+    minX = x0;
+    maxX = x1;
+    minY = maxY = y;
+    minZ = maxZ = z;
+    hasBoundBox = true;
+  }
+}
+
+void ZObject3dScan::Summary::merge(const Summary &summary)
+{
+  if (summary.hasBoundBox) {
+    joinBoundBox(summary.minX, summary.maxX, summary.minY, summary.minZ);
+    joinBoundBox(summary.minX, summary.maxX, summary.maxY, summary.maxZ);
+  }
+  voxelNumber += summary.voxelNumber;
+  xSum += summary.xSum;
+  ySum += summary.ySum;
+  zSum += summary.zSum;
+}
+
+void ZObject3dScan::ComputeSummary(
+    const std::vector<ZObject3dStripe> &stripeArray, Summary *summary,
+    std::unordered_map<int, size_t> *slicewiseVoxelNumber)
+{
+  *summary = Summary();
+  slicewiseVoxelNumber->clear();
+
+  //Stripes are usually grouped by z, so the slice count is accumulated
+  //locally and flushed when z changes.
+  bool hasSlice = false;
+  int currentZ = 0;
+  size_t sliceVoxelNumber = 0;
+  for (const ZObject3dStripe &stripe : stripeArray) {
+    int segmentNumber = stripe.getSegmentNumber();
+    if (segmentNumber > 0) {
+      int z = stripe.getZ();
+      if (hasSlice && z != currentZ) {
+        (*slicewiseVoxelNumber)[currentZ] += sliceVoxelNumber;
+        sliceVoxelNumber = 0;
       }
+      currentZ = z;
+      hasSlice = true;
+
+      size_t voxelNumber = 0;
+      double xSum = 0.0;
+      for (int i = 0; i < segmentNumber; ++i) {
+        int x0 = stripe.getSegmentStart(i);
+        int x1 = stripe.getSegmentEnd(i);
+        size_t length = x1 - x0 + 1;
+        voxelNumber += length;
+        xSum += 0.5 * ((double) x0 + x1) * length;
+      }
+      summary->joinBoundBox(stripe.getMinX(), stripe.getMaxX(),
+                            stripe.getY(), z);
+      summary->voxelNumber += voxelNumber;
+      summary->xSum += xSum;
+      summary->ySum += (double) stripe.getY() * voxelNumber;
+      summary->zSum += (double) z * voxelNumber;
+      sliceVoxelNumber += voxelNumber;
     }
   }
 
-  return m_slicewiseVoxelNumber;
+  if (hasSlice) {
+    (*slicewiseVoxelNumber)[currentZ] += sliceVoxelNumber;
+  }
+
+  summary->isValid = true;
+}
+
+void ZObject3dScan::updateSummary() const
+{
+  std::lock_guard<std::mutex> guard(m_summaryMutex);
+  if (isDeprecated(COMPONENT_SUMMARY)) {
+    ComputeSummary(m_stripeArray, &m_summary, &m_slicewiseVoxelNumber);
+  }
+}
+
+void ZObject3dScan::addSummarySegment(
+    int z, int y, int x0, int x1, int sign) const
+{
+  size_t length = x1 - x0 + 1;
+  double xSum = 0.5 * ((double) x0 + x1) * length;
+  if (sign > 0) {
+    m_summary.voxelNumber += length;
+    m_slicewiseVoxelNumber[z] += length;
+  } else {
+    m_summary.voxelNumber -= length;
+    m_slicewiseVoxelNumber[z] -= length;
+    xSum = -xSum;
+  }
+  m_summary.xSum += xSum;
+  m_summary.ySum += (double) sign * y * length;
+  m_summary.zSum += (double) sign * z * length;
+}
+
+void ZObject3dScan::addSummaryStripe(
+    const ZObject3dStripe &stripe, int sign) const
+{
+  int segmentNumber = stripe.getSegmentNumber();
+  for (int i = 0; i < segmentNumber; ++i) {
+    addSummarySegment(stripe.getZ(), stripe.getY(),
+                      stripe.getSegmentStart(i), stripe.getSegmentEnd(i),
+                      sign);
+  }
+  if (sign > 0 && segmentNumber > 0) {
+    m_summary.joinBoundBox(
+          stripe.getMinX(), stripe.getMaxX(), stripe.getY(), stripe.getZ());
+  }
 }
 
 std::unordered_map<int, size_t> &ZObject3dScan::getSlicewiseVoxelNumber()
@@ -311,6 +440,8 @@ const ZObject3dStripe &ZObject3dScan::getStripe(size_t index) const
 
 ZObject3dStripe &ZObject3dScan::getStripe(size_t index)
 {
+  deprecate(COMPONENT_SUMMARY);
+
   return m_stripeArray[index];
 }
 
@@ -350,6 +481,7 @@ void ZObject3dScan::addStripeFast(int z, int y)
 
 void ZObject3dScan::addStripeFast(const ZObject3dStripe &stripe)
 {
+  deprecate(COMPONENT_SUMMARY);
   m_stripeArray.push_back(stripe);
 }
 
@@ -382,16 +514,25 @@ void ZObject3dScan::addStripe(
 
   if (lastStripeMergable) {
     ZObject3dStripe &lastStripe = m_stripeArray.back();
+    if (m_summary.isValid) {
+      addSummaryStripe(lastStripe, -1);
+    }
     for (int i = 0; i < stripe.getSegmentNumber(); ++i) {
       lastStripe.addSegment(
             stripe.getSegmentStart(i), stripe.getSegmentEnd(i), canonizing);
     }
+    if (m_summary.isValid) {
+      addSummaryStripe(lastStripe, 1);
+    }
   } else {
     m_stripeArray.push_back(stripe);
+    if (m_summary.isValid) {
+      addSummaryStripe(stripe, 1);
+    }
   }
 
   if (!m_blockingEvent) {
-    event |= EVENT_OBJECT_MODEL_CHANGED;
+    event |= EVENT_OBJECT_MODEL_CHANGED | EVENT_OBJECT_SUMMARY_UPDATED;
     processEvent(event);
   }
 
@@ -407,10 +548,40 @@ void ZObject3dScan::addSegment(int x1, int x2, bool canonizing)
   if (!isEmpty()) {
     TEvent event = EVENT_NULL;
 
-    m_stripeArray.back().addSegment(x1, x2, canonizing);
+    ZObject3dStripe &stripe = m_stripeArray.back();
+
+    if (m_summary.isValid) {
+      if (x1 > x2) {
+        std::swap(x1, x2);
+      }
+
+      //Same cases as ZObject3dStripe::addSegment(). Only the new voxels are
+      //added to the summary unless the stripe needs canonization, which may
+      //merge overlapping segments.
+      std::vector<int> &segmentArray = stripe.getSegmentArray();
+      bool merging = !segmentArray.empty() &&
+          x1 <= segmentArray.back() + 1 &&
+          x1 >= segmentArray[segmentArray.size() - 2];
+      bool stripeCanonized = segmentArray.empty() ||
+          (stripe.isCanonized() && (merging || x1 > segmentArray.back() + 1));
+      if (canonizing && !stripeCanonized) {
+        deprecate(COMPONENT_SUMMARY);
+      } else if (merging) {
+        if (x2 > segmentArray.back()) {
+          addSummarySegment(stripe.getZ(), stripe.getY(),
+                            segmentArray.back() + 1, x2, 1);
+          m_summary.joinBoundBox(x1, x2, stripe.getY(), stripe.getZ());
+        }
+      } else {
+        addSummarySegment(stripe.getZ(), stripe.getY(), x1, x2, 1);
+        m_summary.joinBoundBox(x1, x2, stripe.getY(), stripe.getZ());
+      }
+    }
+
+    stripe.addSegment(x1, x2, canonizing);
 
     if (!m_blockingEvent) {
-      event |= EVENT_OBJECT_MODEL_CHANGED;
+      event |= EVENT_OBJECT_MODEL_CHANGED | EVENT_OBJECT_SUMMARY_UPDATED;
 
       if (!m_stripeArray.back().isCanonized()) {
         //m_isCanonized = false;
@@ -431,6 +602,7 @@ void ZObject3dScan::addSegment(int x1, int x2, bool canonizing)
 void ZObject3dScan::addSegmentFast(int x1, int x2)
 {
   if (!isEmpty()) {
+    deprecate(COMPONENT_SUMMARY);
     ZObject3dStripe &stripe = m_stripeArray.back();
     stripe.getSegmentArray().push_back(x1);
     stripe.getSegmentArray().push_back(x2);
@@ -673,6 +845,12 @@ bool ZObject3dScan::load(const std::string &filePath)
     }
   } else if (ZFileType::FileType(filePath) == ZFileType::FILE_DVID_OBJECT) {
     succ = importDvidObject(filePath);
+  } else if (ZFileType::FileType(filePath) == ZFileType::FILE_OBJECT_SCAN &&
+             ZObject3dScanChunkFile::IsChunkFile(filePath)) {
+    ZObject3dScanChunkFile file;
+    if (file.open(filePath)) {
+      succ = (file.read(this) != NULL);
+    }
   } else if (ZFileType::FileType(filePath) == ZFileType::FILE_OBJECT_SCAN) {
     FILE *fp = fopen(filePath.c_str(), "rb");
     if (fp != NULL) {
@@ -851,6 +1029,11 @@ bool ZObject3dScan::save(const std::string &filePath) const
   return succ;
 }
 
+bool ZObject3dScan::saveCompressed(const std::string &filePath) const
+{
+  return ZObject3dScanChunkFile::Write(*this, filePath);
+}
+
 size_t ZObject3dScan::countForegroundOverlap(Stack *stack, const int *offset)
 {
   size_t count = 0;
@@ -935,6 +1118,181 @@ void ZObject3dScan::drawStack(
 }
 
 
+namespace {
+
+inline bool IsStripeLess(const ZObject3dStripe &s1, const ZObject3dStripe &s2)
+{
+  return (s1.getZ() < s2.getZ()) ||
+      (s1.getZ() == s2.getZ() && s1.getY() < s2.getY());
+}
+
+/* Run task(0), ..., task(n - 1) with one thread for each. */
+void RunParallel(int n, const std::function<void(int)> &task)
+{
+  std::vector<std::thread> threadArray;
+  for (int i = 1; i < n; ++i) {
+    threadArray.emplace_back(task, i);
+  }
+  if (n > 0) {
+    task(0);
+  }
+  for (std::thread &thread : threadArray) {
+    thread.join();
+  }
+}
+
+enum class ESetOperation {
+  UNION, SUBTRACTION, INTERSECTION
+};
+
+/* Minimal number of stripes processed by one thread. */
+const size_t PARALLEL_MIN_THREAD_STRIPE = 50000;
+
+/*
+ * Merge-join two canonized stripe ranges. The result is canonized and appended
+ * to <result>.
+ */
+void MergeStripe(
+    const ZObject3dStripe *stripeArray1, size_t n1,
+    const ZObject3dStripe *stripeArray2, size_t n2,
+    ESetOperation op, std::vector<ZObject3dStripe> &result)
+{
+  size_t index1 = 0;
+  size_t index2 = 0;
+
+  while (index1 < n1 && index2 < n2) {
+    const ZObject3dStripe &s1 = stripeArray1[index1];
+    const ZObject3dStripe &s2 = stripeArray2[index2];
+
+    if (IsStripeLess(s1, s2)) {
+      if (op != ESetOperation::INTERSECTION) {
+        result.push_back(s1);
+      }
+      ++index1;
+    } else if (IsStripeLess(s2, s1)) {
+      if (op == ESetOperation::UNION) {
+        result.push_back(s2);
+      }
+      ++index2;
+    } else {
+      switch (op) {
+      case ESetOperation::UNION:
+        result.push_back(s1);
+        result.back().unify(s2);
+        break;
+      case ESetOperation::SUBTRACTION:
+      {
+        ZObject3dStripe diff = s1 - s2;
+        if (!diff.isEmpty()) {
+          result.push_back(diff);
+        }
+      }
+        break;
+      case ESetOperation::INTERSECTION:
+      {
+        ZObject3dStripe common = s1.intersect(s2);
+        if (!common.isEmpty()) {
+          result.push_back(common);
+        }
+      }
+        break;
+      }
+      ++index1;
+      ++index2;
+    }
+  }
+
+  if (op != ESetOperation::INTERSECTION) {
+    result.insert(result.end(), stripeArray1 + index1, stripeArray1 + n1);
+  }
+
+  if (op == ESetOperation::UNION) {
+    result.insert(result.end(), stripeArray2 + index2, stripeArray2 + n2);
+  }
+}
+
+/*
+ * Apply a set operation on two canonized stripe arrays. Large inputs are
+ * split into z slabs, which are merged in parallel and then joined in order.
+ * The cost is O(n1 + n2) besides the binary search for slab boundaries.
+ */
+std::vector<ZObject3dStripe> ApplySetOperation(
+    const std::vector<ZObject3dStripe> &stripeArray1,
+    const std::vector<ZObject3dStripe> &stripeArray2,
+    ESetOperation op, int threadNumber)
+{
+  size_t n1 = stripeArray1.size();
+  size_t n2 = stripeArray2.size();
+
+  if (threadNumber <= 0) {
+    threadNumber = std::min(
+          (size_t) std::max(1U, std::thread::hardware_concurrency()),
+          std::max(size_t(1), (n1 + n2) / PARALLEL_MIN_THREAD_STRIPE));
+  }
+
+  std::vector<ZObject3dStripe> result;
+
+  if (threadNumber <= 1 || n1 == 0 || n2 == 0) {
+    result.reserve(op == ESetOperation::UNION ? n1 + n2 : n1);
+    MergeStripe(stripeArray1.data(), n1, stripeArray2.data(), n2, op, result);
+    return result;
+  }
+
+  //Slab pivots are taken from the larger array
+  const std::vector<ZObject3dStripe> &refArray =
+      (n1 >= n2) ? stripeArray1 : stripeArray2;
+  std::vector<int> pivotArray;
+  for (int i = 1; i < threadNumber; ++i) {
+    int z = refArray[refArray.size() * i / threadNumber].getZ();
+    if (pivotArray.empty() || z > pivotArray.back()) {
+      pivotArray.push_back(z);
+    }
+  }
+
+  auto getBoundary = [&](const std::vector<ZObject3dStripe> &stripeArray,
+      size_t slab) -> size_t {
+    if (slab == 0) {
+      return 0;
+    } else if (slab > pivotArray.size()) {
+      return stripeArray.size();
+    }
+
+    return std::lower_bound(
+          stripeArray.begin(), stripeArray.end(), pivotArray[slab - 1],
+          [](const ZObject3dStripe &stripe, int z) {
+      return stripe.getZ() < z; }) - stripeArray.begin();
+  };
+
+  size_t slabNumber = pivotArray.size() + 1;
+  std::vector<std::vector<ZObject3dStripe> > slabResult(slabNumber);
+  auto merge = [&](int slab) {
+    size_t begin1 = getBoundary(stripeArray1, slab);
+    size_t end1 = getBoundary(stripeArray1, slab + 1);
+    size_t begin2 = getBoundary(stripeArray2, slab);
+    size_t end2 = getBoundary(stripeArray2, slab + 1);
+    MergeStripe(stripeArray1.data() + begin1, end1 - begin1,
+                stripeArray2.data() + begin2, end2 - begin2, op,
+                slabResult[slab]);
+  };
+
+  RunParallel(slabNumber, merge);
+
+  size_t stripeNumber = 0;
+  for (const std::vector<ZObject3dStripe> &slab : slabResult) {
+    stripeNumber += slab.size();
+  }
+  result.reserve(stripeNumber);
+  for (std::vector<ZObject3dStripe> &slab : slabResult) {
+    result.insert(result.end(), std::make_move_iterator(slab.begin()),
+                  std::make_move_iterator(slab.end()));
+    std::vector<ZObject3dStripe>().swap(slab);
+  }
+
+  return result;
+}
+
+}
+
 static int ZObject3dStripeCompare(const void *e1, const void *e2)
 {
   ZObject3dStripe *v1 = (ZObject3dStripe*) e1;
@@ -1061,6 +1419,9 @@ void ZObject3dScan::canonize()
   std::cout << "Uncanonized: " << ncount << std::endl;
 #endif
     sortedCanonize();
+
+    //Most queries on a canonized object need the summary
+    updateSummary();
   }
 }
 
@@ -1069,29 +1430,53 @@ void ZObject3dScan::canonizeConst() const
   const_cast<ZObject3dScan&>(*this).canonize();
 }
 
-void ZObject3dScan::unify(const ZObject3dScan &obj)
+void ZObject3dScan::unify(const ZObject3dScan &obj, int threadNumber)
 {
-  bool processed = false;
-  if (isCanonized() && obj.isCanonized()) {
-    if (obj.getMinZ() > getMaxZ()) {
-      concat(obj);
-      setCanonized(true);
-      processed = true;
-    }
+  canonize();
+  obj.canonizeConst();
+
+  if (obj.isEmpty()) {
+    return;
   }
 
-  if (processed == false) {
+  if (isEmpty() || IsStripeLess(m_stripeArray.back(), obj.m_stripeArray.front())) {
     concat(obj);
-    canonize();
+  } else {
+    m_stripeArray = ApplySetOperation(
+          m_stripeArray, obj.m_stripeArray, ESetOperation::UNION, threadNumber);
+    processEvent(EVENT_OBJECT_MODEL_CHANGED | EVENT_OBJECT_CANONIZED);
   }
 }
 
 void ZObject3dScan::concat(const ZObject3dScan &obj)
 {
+  if (obj.isEmpty()) {
+    return;
+  }
+
+  //The result remains canonized if obj is appended in order
+  bool canonized = isCanonized() && obj.isCanonized() &&
+      (isEmpty() ||
+       IsStripeLess(m_stripeArray.back(), obj.m_stripeArray.front()));
+
   m_stripeArray.insert(m_stripeArray.end(), obj.m_stripeArray.begin(),
                        obj.m_stripeArray.end());
 
-  processEvent(EVENT_OBJECT_MODEL_CHANGED | EVENT_OBJECT_UNCANONIZED);
+  if (m_summary.isValid) {
+    obj.updateSummary();
+    m_summary.merge(obj.m_summary);
+    for (const auto &entry : obj.m_slicewiseVoxelNumber) {
+      m_slicewiseVoxelNumber[entry.first] += entry.second;
+    }
+  }
+
+  if (canonized) {
+    processEvent(EVENT_OBJECT_MODEL_CHANGED | EVENT_OBJECT_CANONIZED |
+                 EVENT_OBJECT_SUMMARY_UPDATED);
+  } else {
+    processEvent(EVENT_OBJECT_MODEL_CHANGED | EVENT_OBJECT_UNCANONIZED |
+                 EVENT_OBJECT_SUMMARY_UPDATED);
+  }
   //deprecate(ALL_COMPONENT);
 }
 
@@ -1254,6 +1639,125 @@ void ZObject3dScan::downsampleMax(int xintv, int yintv, int zintv)
   //deprecate(ALL_COMPONENT);
 }
 
+namespace {
+
+/*
+ * Max downsampling of canonized stripes by 2 along each axis. Input slices and
+ * rows that fall into the same output row are consecutive, so the output is
+ * produced in canonical order in a single pass without sorting.
+ */
+void DownsampleMaxByTwo(
+    const std::vector<ZObject3dStripe> &src, std::vector<ZObject3dStripe> &dst)
+{
+  dst.clear();
+  dst.reserve(src.size() / 2 + 1);
+
+  std::vector<size_t> cursor;
+  std::vector<size_t> sliceEnd;
+  std::vector<const std::vector<int>*> rowSegment;
+  std::vector<size_t> segIndex;
+
+  size_t sliceBegin = 0;
+  while (sliceBegin < src.size()) {
+    //Collect the input slices of the current output slice
+    int z = src[sliceBegin].getZ() / 2;
+    cursor.clear();
+    sliceEnd.clear();
+    size_t i = sliceBegin;
+    while (i < src.size() && src[i].getZ() / 2 == z) {
+      size_t j = i;
+      while (j < src.size() && src[j].getZ() == src[i].getZ()) {
+        ++j;
+      }
+      cursor.push_back(i);
+      sliceEnd.push_back(j);
+      i = j;
+    }
+    sliceBegin = i;
+
+    while (true) {
+      bool hasRow = false;
+      int y = 0;
+      for (size_t k = 0; k < cursor.size(); ++k) {
+        if (cursor[k] < sliceEnd[k]) {
+          int currentY = src[cursor[k]].getY() / 2;
+          if (!hasRow || currentY < y) {
+            y = currentY;
+            hasRow = true;
+          }
+        }
+      }
+
+      if (!hasRow) {
+        break;
+      }
+
+      rowSegment.clear();
+      for (size_t k = 0; k < cursor.size(); ++k) {
+        while (cursor[k] < sliceEnd[k] && src[cursor[k]].getY() / 2 == y) {
+          rowSegment.push_back(&(src[cursor[k]].getSegmentArray()));
+          ++cursor[k];
+        }
+      }
+
+      //Merge the downsampled segments of all stripes in the row
+      dst.resize(dst.size() + 1);
+      ZObject3dStripe &stripe = dst.back();
+      stripe.setZ(z);
+      stripe.setY(y);
+      std::vector<int> &segArray = stripe.getSegmentArray();
+      segIndex.assign(rowSegment.size(), 0);
+      while (true) {
+        int current = -1;
+        int x0 = 0;
+        for (size_t k = 0; k < rowSegment.size(); ++k) {
+          if (segIndex[k] < rowSegment[k]->size()) {
+            int x = (*rowSegment[k])[segIndex[k]] / 2;
+            if (current < 0 || x < x0) {
+              current = k;
+              x0 = x;
+            }
+          }
+        }
+
+        if (current < 0) {
+          break;
+        }
+
+        int x1 = (*rowSegment[current])[segIndex[current] + 1] / 2;
+        segIndex[current] += 2;
+        if (!segArray.empty() && segArray.back() + 1 >= x0) {
+          if (segArray.back() < x1) {
+            segArray.back() = x1;
+          }
+        } else {
+          segArray.push_back(x0);
+          segArray.push_back(x1);
+        }
+      }
+    }
+  }
+}
+
+}
+
+void ZObject3dScan::downsampleToPyramidLevel(int scale)
+{
+  if (scale <= 0) {
+    return;
+  }
+
+  canonize();
+  deprecate(COMPONENT_ALL);
+
+  std::vector<ZObject3dStripe> stripeArray;
+  for (int s = 0; s < scale; ++s) {
+    DownsampleMaxByTwo(m_stripeArray, stripeArray);
+    m_stripeArray.swap(stripeArray);
+    pushDsIntv(1, 1, 1);
+  }
+}
+
 void ZObject3dScan::upSample(const ZIntPoint &dsIntv)
 {
   upSample(dsIntv.getX(), dsIntv.getY(), dsIntv.getZ());
@@ -1675,27 +2179,10 @@ ZIntCuboid ZObject3dScan::getBoundBox() const
 {
   ZIntCuboid boundBox;
 
-  bool isFirst = true;
-  for (std::vector<ZObject3dStripe>::const_iterator iter = m_stripeArray.begin();
-       iter != m_stripeArray.end(); ++iter) {
-    if (!iter->isEmpty()) {
-      if (isFirst) {
-        boundBox.set(iter->getMinX(), iter->getY(), iter->getZ(),
-                     iter->getMaxX(), iter->getY(), iter->getZ());
-        isFirst = false;
-      } else {
-        boundBox.joinY(iter->getY());
-        boundBox.joinZ(iter->getZ());
-        boundBox.joinX(iter->getMinX());
-        boundBox.joinX(iter->getMaxX());
-      }
-#ifdef _DEBUG_2
-      std::cout << iter->getMinX() << " " << iter->getMaxX() << " "
-                << iter->getY() << " " << iter->getZ() << std::endl;
-      std::cout << boundBox.getFirstCorner().toString() << " "
-                << boundBox.getLastCorner().toString() << std::endl;
-#endif
-    }
+  updateSummary();
+  if (m_summary.hasBoundBox) {
+    boundBox.set(m_summary.minX, m_summary.minY, m_summary.minZ,
+                 m_summary.maxX, m_summary.maxY, m_summary.maxZ);
   }
 
   boundBox.shiftSliceAxis(m_sliceAxis);
@@ -1748,6 +2235,35 @@ const std::map<std::pair<int, int>, size_t> &ZObject3dScan::getStripeMap() const
   return m_stripeMap;
 }
 
+uint64_t ZObject3dScan::GetStripeIndexKey(int z, int y)
+{
+  return (uint64_t(uint32_t(z)) << 32) | uint64_t(uint32_t(y));
+}
+
+size_t ZObject3dScan::lowerBoundStripe(int z, int y) const
+{
+  return std::lower_bound(
+        m_stripeArray.begin(), m_stripeArray.end(), std::make_pair(z, y),
+        [](const ZObject3dStripe &stripe, const std::pair<int, int> &zy) {
+    return stripe.getZ() < zy.first ||
+        (stripe.getZ() == zy.first && stripe.getY() < zy.second);
+  }) - m_stripeArray.begin();
+}
+
+const std::unordered_map<uint64_t, size_t>&
+ZObject3dScan::getStripeIndexHash() const
+{
+  if (isDeprecated(COMPONENT_STRIPE_INDEX_HASH)) {
+    m_stripeIndexHash.reserve(getStripeNumber());
+    for (size_t i = 0; i < getStripeNumber(); ++i) {
+      const ZObject3dStripe &stripe = m_stripeArray[i];
+      m_stripeIndexHash[GetStripeIndexKey(stripe.getZ(), stripe.getY())] = i;
+    }
+  }
+
+  return m_stripeIndexHash;
+}
+
 ZGraph* ZObject3dScan::buildConnectionGraph()
 {
   if (isEmpty()) {
@@ -1867,20 +2383,7 @@ std::vector<size_t> ZObject3dScan::getConnectedObjectSize()
   }
 #else
   if (!isEmpty()) {
-    std::vector<ZObject3dScan> objArray = getConnectedComponent(ACTION_NONE);
-
-    sizeArray.resize(objArray.size());
-    for (size_t i = 0; i < objArray.size(); ++i) {
-      sizeArray[i] = objArray[i].getVoxelNumber();
-#if _DEBUG_2
-      std::cout << "Sub object:" << std::endl;
-      objArray[i].print();
-#endif
-    }
-
-#ifdef _DEBUG_
-    objArray[0].save(GET_TEST_DATA_DIR + "/test.sobj");
-#endif
+    getConnectedComponent(neutube::EStackNeighborhood::D3, &sizeArray);
   }
 #endif
 
@@ -1963,43 +2466,288 @@ std::vector<ZObject3dScan> ZObject3dScan::getConnectedComponent(
         break;
       }
 
-//      subobj.sort();
-//      subobj.setCanonized(true);
-//      TZ_ASSERT(subobj.isCanonizedActually(), "Inconsisten data assumption");
-//      subobj.canonize();
+//      subobj.sort();
+//      subobj.setCanonized(true);
+//      TZ_ASSERT(subobj.isCanonizedActually(), "Inconsisten data assumption");
+//      subobj.canonize();
+
+      subobj.setLabel(getLabel());
+      objArray.push_back(subobj);
+    }
+
+#if 1
+    std::cout << objArray.size() << " components extracted." << std::endl;
+#endif
+
+    delete graph;
+
+#if 1
+    std::cout << "Checking remains ..." << std::endl;
+#endif
+    for (size_t i = 0; i < isAdded.size(); ++i) {
+      if (!isAdded[i]) {
+        ZObject3dScan subobj;
+        int z, y, x1, x2;
+        getSegment(i, &z, &y, &x1, &x2);
+        subobj.addSegment(z, y, x1, x2);
+        objArray.push_back(subobj);
+      }
+    }
+
+#if 1
+    std::cout << objArray.size() << " components extracted." << std::endl;
+#endif
+  }
+
+  for (std::vector<ZObject3dScan>::iterator iter = objArray.begin();
+       iter != objArray.end(); ++iter) {
+    ZObject3dScan &obj = *iter;
+    obj.copyAttributeFrom(*this);
+  }
+
+  return objArray;
+}
+
+namespace {
+
+/* Union-find on run indices. The root of a set is its smallest index. */
+class RunUnionFind {
+public:
+  explicit RunUnionFind(size_t n) : m_parent(n) {
+    for (size_t i = 0; i < n; ++i) {
+      m_parent[i] = i;
+    }
+  }
+
+  size_t find(size_t i) {
+    while (m_parent[i] != i) {
+      m_parent[i] = m_parent[m_parent[i]];
+      i = m_parent[i];
+    }
+    return i;
+  }
+
+  void merge(size_t i, size_t j) {
+    i = find(i);
+    j = find(j);
+    if (i < j) {
+      m_parent[j] = i;
+    } else if (j < i) {
+      m_parent[i] = j;
+    }
+  }
+
+private:
+  std::vector<size_t> m_parent;
+};
+
+/*
+ * Maximal x gap allowed between runs of two stripes that are <diffYZ> apart in
+ * the YZ plane. A negative value means the stripes are never connected.
+ */
+int GetRunConnectionGap(int diffYZ, neutube::EStackNeighborhood nbr)
+{
+  switch (nbr) {
+  case neutube::EStackNeighborhood::D1:
+    return (diffYZ == 1) ? 0 : -1;
+  case neutube::EStackNeighborhood::D2:
+    return (diffYZ == 1) ? 1 : 0;
+  case neutube::EStackNeighborhood::D3:
+    return 1;
+  }
+
+  return -1;
+}
+
+/* Link connected runs of two canonized stripes. */
+void LinkRun(const ZObject3dStripe &s1, size_t offset1,
+             const ZObject3dStripe &s2, size_t offset2,
+             int gap, RunUnionFind &uf)
+{
+  const std::vector<int> &segArray1 = s1.getSegmentArray();
+  const std::vector<int> &segArray2 = s2.getSegmentArray();
+
+  size_t index1 = 0;
+  size_t index2 = 0;
+  while (index1 < segArray1.size() && index2 < segArray2.size()) {
+    if (segArray1[index1 + 1] + gap < segArray2[index2]) {
+      index1 += 2;
+    } else if (segArray2[index2 + 1] + gap < segArray1[index1]) {
+      index2 += 2;
+    } else {
+      uf.merge(offset1 + index1 / 2, offset2 + index2 / 2);
+      if (segArray1[index1 + 1] < segArray2[index2 + 1]) {
+        index1 += 2;
+      } else {
+        index2 += 2;
+      }
+    }
+  }
+}
+
+/*
+ * Link runs of slice [begin1, end1) to runs of the next slice [begin2, end2).
+ * <segmentOffset> is the index of the first run of each stripe.
+ */
+void LinkSlice(const std::vector<ZObject3dStripe> &stripeArray,
+               const std::vector<size_t> &segmentOffset,
+               size_t begin1, size_t end1, size_t begin2, size_t end2,
+               neutube::EStackNeighborhood nbr, RunUnionFind &uf)
+{
+  size_t cursor = begin2;
+  for (size_t i = begin1; i < end1; ++i) {
+    const ZObject3dStripe &stripe = stripeArray[i];
+    while (cursor < end2 && stripeArray[cursor].getY() < stripe.getY() - 1) {
+      ++cursor;
+    }
+    for (size_t j = cursor;
+         j < end2 && stripeArray[j].getY() <= stripe.getY() + 1; ++j) {
+      int gap = GetRunConnectionGap(
+            1 + std::abs(stripeArray[j].getY() - stripe.getY()), nbr);
+      if (gap >= 0) {
+        LinkRun(stripe, segmentOffset[i], stripeArray[j], segmentOffset[j],
+                gap, uf);
+      }
+    }
+  }
+}
+
+/* Link runs within a slice [begin, end). */
+void LinkInSlice(const std::vector<ZObject3dStripe> &stripeArray,
+                 const std::vector<size_t> &segmentOffset,
+                 size_t begin, size_t end,
+                 neutube::EStackNeighborhood nbr, RunUnionFind &uf)
+{
+  int gap = GetRunConnectionGap(1, nbr);
+  for (size_t i = begin; i + 1 < end; ++i) {
+    if (stripeArray[i].getY() + 1 == stripeArray[i + 1].getY()) {
+      LinkRun(stripeArray[i], segmentOffset[i],
+              stripeArray[i + 1], segmentOffset[i + 1], gap, uf);
+    }
+  }
+}
+
+}
+
+std::vector<ZObject3dScan> ZObject3dScan::getConnectedComponent(
+    neutube::EStackNeighborhood nbr, std::vector<size_t> *sizeArray,
+    int threadNumber)
+{
+  std::vector<ZObject3dScan> objArray;
+  if (sizeArray != NULL) {
+    sizeArray->clear();
+  }
+
+  if (isEmpty()) {
+    return objArray;
+  }
+
+  canonize();
 
-      subobj.setLabel(getLabel());
-      objArray.push_back(subobj);
+  size_t stripeNumber = m_stripeArray.size();
+  std::vector<size_t> segmentOffset(stripeNumber + 1, 0);
+  std::vector<size_t> sliceStart;
+  for (size_t i = 0; i < stripeNumber; ++i) {
+    segmentOffset[i + 1] = segmentOffset[i] + m_stripeArray[i].getSize();
+    if (i == 0 || m_stripeArray[i].getZ() != m_stripeArray[i - 1].getZ()) {
+      sliceStart.push_back(i);
     }
+  }
+  size_t sliceNumber = sliceStart.size();
+  sliceStart.push_back(stripeNumber);
 
-#if 1
-    std::cout << objArray.size() << " components extracted." << std::endl;
-#endif
+  RunUnionFind uf(segmentOffset.back());
 
-    delete graph;
+  //Link slice s to slice s + 1 if they are adjacent in Z
+  auto linkSlice = [&](size_t slice) {
+    if (m_stripeArray[sliceStart[slice]].getZ() + 1 ==
+        m_stripeArray[sliceStart[slice + 1]].getZ()) {
+      LinkSlice(m_stripeArray, segmentOffset,
+                sliceStart[slice], sliceStart[slice + 1],
+                sliceStart[slice + 1], sliceStart[slice + 2], nbr, uf);
+    }
+  };
 
-#if 1
-    std::cout << "Checking remains ..." << std::endl;
-#endif
-    for (size_t i = 0; i < isAdded.size(); ++i) {
-      if (!isAdded[i]) {
-        ZObject3dScan subobj;
-        int z, y, x1, x2;
-        getSegment(i, &z, &y, &x1, &x2);
-        subobj.addSegment(z, y, x1, x2);
-        objArray.push_back(subobj);
+  if (threadNumber <= 0) {
+    threadNumber = std::min(
+          (size_t) std::max(1U, std::thread::hardware_concurrency()),
+          std::max(size_t(1), stripeNumber / PARALLEL_MIN_THREAD_STRIPE));
+  }
+  threadNumber = std::min((size_t) threadNumber, sliceNumber);
+
+  //Each slab is a range of slices. Runs in different slabs do not share any
+  //set until the slabs are merged, so the slabs can be labeled in parallel.
+  std::vector<size_t> slabStart(threadNumber + 1, sliceNumber);
+  for (int i = 0; i < threadNumber; ++i) {
+    slabStart[i] = std::upper_bound(
+          sliceStart.begin(), sliceStart.begin() + sliceNumber,
+          stripeNumber * i / threadNumber) - sliceStart.begin() - 1;
+  }
+  for (int i = 1; i <= threadNumber; ++i) {
+    slabStart[i] = std::max(slabStart[i], slabStart[i - 1]);
+  }
+
+  RunParallel(threadNumber, [&](int slab) {
+    for (size_t slice = slabStart[slab]; slice < slabStart[slab + 1]; ++slice) {
+      LinkInSlice(m_stripeArray, segmentOffset, sliceStart[slice],
+                  sliceStart[slice + 1], nbr, uf);
+      if (slice + 1 < slabStart[slab + 1]) {
+        linkSlice(slice);
       }
     }
+  });
+
+  //Merge labels at slab boundaries
+  for (int i = 1; i < threadNumber; ++i) {
+    if (slabStart[i] > 0 && slabStart[i] < sliceNumber) {
+      linkSlice(slabStart[i] - 1);
+    }
+  }
 
-#if 1
-    std::cout << objArray.size() << " components extracted." << std::endl;
-#endif
+  //Components are numbered in the order of their first run
+  std::vector<size_t> componentIndex(segmentOffset.back());
+  size_t componentNumber = 0;
+  for (size_t i = 0; i < componentIndex.size(); ++i) {
+    size_t root = uf.find(i);
+    if (root == i) {
+      componentIndex[i] = componentNumber++;
+    } else {
+      componentIndex[i] = componentIndex[root];
+    }
   }
 
-  for (std::vector<ZObject3dScan>::iterator iter = objArray.begin();
-       iter != objArray.end(); ++iter) {
-    ZObject3dScan &obj = *iter;
+  objArray.resize(componentNumber);
+  if (sizeArray != NULL) {
+    sizeArray->assign(componentNumber, 0);
+  }
+
+  for (size_t i = 0; i < stripeNumber; ++i) {
+    const ZObject3dStripe &stripe = m_stripeArray[i];
+    for (int j = 0; j < stripe.getSegmentNumber(); ++j) {
+      size_t index = componentIndex[segmentOffset[i] + j];
+      std::vector<ZObject3dStripe> &targetArray =
+          objArray[index].m_stripeArray;
+      if (targetArray.empty() || targetArray.back().getZ() != stripe.getZ() ||
+          targetArray.back().getY() != stripe.getY()) {
+        ZObject3dStripe newStripe;
+        newStripe.setZ(stripe.getZ());
+        newStripe.setY(stripe.getY());
+        targetArray.push_back(newStripe);
+      }
+      int x0 = stripe.getSegmentStart(j);
+      int x1 = stripe.getSegmentEnd(j);
+      targetArray.back().getSegmentArray().push_back(x0);
+      targetArray.back().getSegmentArray().push_back(x1);
+      if (sizeArray != NULL) {
+        (*sizeArray)[index] += x1 - x0 + 1;
+      }
+    }
+  }
+
+  for (ZObject3dScan &obj : objArray) {
     obj.copyAttributeFrom(*this);
+    obj.setLabel(getLabel());
+    obj.setCanonized(true);
   }
 
   return objArray;
@@ -2020,7 +2768,30 @@ void ZObject3dScan::translate(int dx, int dy, int dz)
     m_stripeArray[i].translate(dx, dy, dz);
   }
 
-  processEvent(EVENT_OBJECT_MODEL_CHANGED);
+  if (m_summary.isValid) {
+    if (m_summary.hasBoundBox) {
+      m_summary.minX += dx;
+      m_summary.maxX += dx;
+      m_summary.minY += dy;
+      m_summary.maxY += dy;
+      m_summary.minZ += dz;
+      m_summary.maxZ += dz;
+    }
+    double voxelNumber = m_summary.voxelNumber;
+    m_summary.xSum += dx * voxelNumber;
+    m_summary.ySum += dy * voxelNumber;
+    m_summary.zSum += dz * voxelNumber;
+    if (dz != 0) {
+      std::unordered_map<int, size_t> slicewiseVoxelNumber;
+      slicewiseVoxelNumber.reserve(m_slicewiseVoxelNumber.size());
+      for (const auto &entry : m_slicewiseVoxelNumber) {
+        slicewiseVoxelNumber[entry.first + dz] = entry.second;
+      }
+      m_slicewiseVoxelNumber.swap(slicewiseVoxelNumber);
+    }
+  }
+
+  processEvent(EVENT_OBJECT_MODEL_CHANGED | EVENT_OBJECT_SUMMARY_UPDATED);
 }
 
 void ZObject3dScan::translate(const ZIntPoint &dp)
@@ -2829,21 +3600,11 @@ ZIntPoint ZObject3dScan::getHitPoint() const
 ZPoint ZObject3dScan::getCentroid() const
 {
   ZPoint center(0, 0, 0);
-  int count = 0;
-  for (size_t i = 0; i < getStripeNumber(); ++i) {
-    int nseg = m_stripeArray[i].getSegmentNumber();
-    for (int j = 0; j < nseg; ++j) {
-      int x1 = m_stripeArray[i].getSegmentStart(j);
-      int x2 = m_stripeArray[i].getSegmentEnd(j);
-      int len = x2 - x1 + 1;
-      count += len;
-      center.translate((x1 + x2) * len /2, m_stripeArray[i].getY() * len,
-                       m_stripeArray[i].getZ() * len);
-    }
-  }
 
-  if (count > 0) {
-    center /= count;
+  updateSummary();
+  if (m_summary.voxelNumber > 0) {
+    center.set(m_summary.xSum, m_summary.ySum, m_summary.zSum);
+    center /= m_summary.voxelNumber;
   }
 
   center.shiftSliceAxis(m_sliceAxis);
@@ -3496,6 +4257,71 @@ bool ZObject3dScan::importDvidObject(const std::string &filePath)
   return true;
 }
 
+namespace {
+
+const size_t DVID_SPARSEVOL_HEADER_SIZE = 12;
+const size_t DVID_SPARSEVOL_SPAN_SIZE = 16;
+
+/* Minimal number of spans decoded by one thread. */
+const size_t DVID_SPARSEVOL_MIN_THREAD_SPAN = 100000;
+
+inline void ReadDvidSpan(const char *spanArray, size_t index, tz_int32 *span)
+{
+  memcpy(span, spanArray + index * DVID_SPARSEVOL_SPAN_SIZE,
+         DVID_SPARSEVOL_SPAN_SIZE);
+}
+
+inline int GetDvidSpanZ(const char *spanArray, size_t index)
+{
+  tz_int32 z = 0;
+  memcpy(&z, spanArray + index * DVID_SPARSEVOL_SPAN_SIZE + 8, sizeof(z));
+  return z;
+}
+
+/*
+ * Decode spans [spanBegin, spanEnd) into stripes. Consecutive spans on the same
+ * (z, y) line go to the same stripe and overlapping or touching segments are
+ * merged on the fly. <sorted> is set to false if the spans are not in
+ * canonical order. It returns false if any span has an invalid run length.
+ */
+bool DecodeDvidSpan(
+    const char *spanArray, size_t spanBegin, size_t spanEnd,
+    std::vector<ZObject3dStripe> &stripeArray, bool &sorted)
+{
+  sorted = true;
+  stripeArray.reserve(stripeArray.size() + spanEnd - spanBegin);
+
+  ZObject3dStripe *stripe = NULL;
+  for (size_t index = spanBegin; index < spanEnd; ++index) {
+    tz_int32 span[4];
+    ReadDvidSpan(spanArray, index, span);
+    if (span[3] <= 0) {
+      return false;
+    }
+
+    if (stripe == NULL || stripe->getZ() != span[2] ||
+        stripe->getY() != span[1]) {
+      ZObject3dStripe newStripe;
+      newStripe.setZ(span[2]);
+      newStripe.setY(span[1]);
+      if (stripe != NULL && !IsStripeLess(*stripe, newStripe)) {
+        sorted = false;
+      }
+      stripeArray.push_back(newStripe);
+      stripe = &(stripeArray.back());
+    }
+
+    stripe->addSegment(span[0], span[0] + span[3] - 1, false);
+    if (!stripe->isCanonized()) {
+      sorted = false;
+    }
+  }
+
+  return true;
+}
+
+}
+
 #define READ_BYTE_BUFFER(target, type) \
   if (byteNumber < sizeof(type)) { \
     RECORD_ERROR_UNCOND("Buffer ended prematurely."); \
@@ -3508,6 +4334,10 @@ bool ZObject3dScan::importDvidObject(const std::string &filePath)
 bool ZObject3dScan::importDvidObjectBuffer(
     const char *byteArray, size_t byteNumber)
 {
+  if (getSliceAxis() == neutube::EAxis::Z) {
+    return importDvidObjectBuffer(byteArray, byteNumber, 0);
+  }
+
   clear();
 
   if (byteArray == NULL || byteNumber <= 12) {
@@ -3559,8 +4389,6 @@ bool ZObject3dScan::importDvidObjectBuffer(
       return false;
     }
 
-//    addStripeFast(coord[2], coord[1]);
-//    addSegmentFast(coord[0], coord[0] + runLength - 1);
     zgeom::shiftSliceAxis(coord[0], coord[1], coord[2], getSliceAxis());
 
     if (getSliceAxis() == neutube::EAxis::X) {
@@ -3575,6 +4403,145 @@ bool ZObject3dScan::importDvidObjectBuffer(
   return true;
 }
 
+bool ZObject3dScan::importDvidObjectBuffer(
+    const char *byteArray, size_t byteNumber, int threadNumber)
+{
+  clear();
+
+  if (byteArray == NULL || byteNumber <= DVID_SPARSEVOL_HEADER_SIZE) {
+    RECORD_ERROR_UNCOND("Invalid byte buffer");
+    return false;
+  }
+
+  tz_uint8 numberOfDimensions = *(const tz_uint8*)(byteArray + 1);
+  if (numberOfDimensions != 3) {
+    RECORD_ERROR_UNCOND("Current version only supports 3D");
+    return false;
+  }
+
+  tz_uint8 dimOfRun = *(const tz_uint8*)(byteArray + 2);
+  if (dimOfRun != 0) {
+    RECORD_ERROR_UNCOND("Unspported run dimension");
+    return false;
+  }
+
+  tz_uint32 numberOfSpans = 0;
+  memcpy(&numberOfSpans, byteArray + 8, sizeof(numberOfSpans));
+
+  //Spans that are fully contained in the buffer
+  size_t spanNumber = std::min(
+        (size_t) numberOfSpans,
+        (byteNumber - DVID_SPARSEVOL_HEADER_SIZE) / DVID_SPARSEVOL_SPAN_SIZE);
+  const char *spanArray = byteArray + DVID_SPARSEVOL_HEADER_SIZE;
+
+  if (threadNumber <= 0) {
+    threadNumber = std::min(
+          (size_t) std::max(1U, std::thread::hardware_concurrency()),
+          std::max(size_t(1), spanNumber / DVID_SPARSEVOL_MIN_THREAD_SPAN));
+  }
+  threadNumber = std::min((size_t) threadNumber, std::max(size_t(1), spanNumber));
+
+  //Chunk boundaries are moved forward to z changes so that no stripe is split
+  std::vector<size_t> boundary(threadNumber + 1, spanNumber);
+  boundary[0] = 0;
+  for (int i = 1; i < threadNumber; ++i) {
+    size_t index = std::max(boundary[i - 1], spanNumber * i / threadNumber);
+    if (index > 0) {
+      int z = GetDvidSpanZ(spanArray, index - 1);
+      while (index < spanNumber && GetDvidSpanZ(spanArray, index) == z) {
+        ++index;
+      }
+    }
+    boundary[i] = index;
+  }
+
+  bool succ = true;
+  bool sorted = true;
+
+  if (threadNumber == 1) {
+    succ = DecodeDvidSpan(spanArray, 0, spanNumber, m_stripeArray, sorted);
+    if (succ) {
+      ComputeSummary(m_stripeArray, &m_summary, &m_slicewiseVoxelNumber);
+    }
+  } else {
+    std::vector<std::vector<ZObject3dStripe> > chunkArray(threadNumber);
+    std::vector<char> chunkSucc(threadNumber, 1);
+    std::vector<char> chunkSorted(threadNumber, 1);
+    std::vector<Summary> chunkSummary(threadNumber);
+    std::vector<std::unordered_map<int, size_t> > chunkSlicewiseVoxelNumber(
+          threadNumber);
+
+    auto decode = [&](int i) {
+      bool chunkIsSorted = true;
+      chunkSucc[i] = DecodeDvidSpan(
+            spanArray, boundary[i], boundary[i + 1], chunkArray[i],
+            chunkIsSorted);
+      chunkSorted[i] = chunkIsSorted;
+      if (chunkSucc[i]) {
+        ComputeSummary(chunkArray[i], &chunkSummary[i],
+                       &chunkSlicewiseVoxelNumber[i]);
+      }
+    };
+
+    RunParallel(threadNumber, decode);
+
+    size_t stripeNumber = 0;
+    for (int i = 0; i < threadNumber; ++i) {
+      succ = succ && chunkSucc[i];
+      sorted = sorted && chunkSorted[i];
+      stripeNumber += chunkArray[i].size();
+    }
+
+    if (succ) {
+      m_stripeArray.reserve(stripeNumber);
+      for (std::vector<ZObject3dStripe> &chunk : chunkArray) {
+        if (!chunk.empty()) {
+          if (sorted && !m_stripeArray.empty() &&
+              !IsStripeLess(m_stripeArray.back(), chunk.front())) {
+            sorted = false;
+          }
+          m_stripeArray.insert(m_stripeArray.end(),
+                               std::make_move_iterator(chunk.begin()),
+                               std::make_move_iterator(chunk.end()));
+        }
+        std::vector<ZObject3dStripe>().swap(chunk);
+      }
+
+      //Chunks are split at z changes, so their slices rarely overlap
+      m_summary = Summary();
+      m_slicewiseVoxelNumber.clear();
+      for (int i = 0; i < threadNumber; ++i) {
+        m_summary.merge(chunkSummary[i]);
+        for (const auto &entry : chunkSlicewiseVoxelNumber[i]) {
+          m_slicewiseVoxelNumber[entry.first] += entry.second;
+        }
+      }
+      m_summary.isValid = true;
+    }
+  }
+
+  if (!succ) {
+    clear();
+    RECORD_ERROR_UNCOND("Invalid run length");
+    return false;
+  }
+
+  if (sorted) {
+    processEvent(EVENT_OBJECT_MODEL_CHANGED | EVENT_OBJECT_CANONIZED |
+                 EVENT_OBJECT_SUMMARY_UPDATED);
+  } else {
+    processEvent(EVENT_OBJECT_MODEL_CHANGED | EVENT_OBJECT_UNCANONIZED |
+                 EVENT_OBJECT_SUMMARY_UPDATED);
+  }
+
+  if (spanNumber < numberOfSpans) {
+    RECORD_ERROR_UNCOND("Buffer ended prematurely.");
+    return false;
+  }
+
+  return true;
+}
+
 bool ZObject3dScan::importDvidBlockBuffer(
     const char *byteArray, size_t byteNumber, bool canonizing)
 {
@@ -4002,93 +4969,23 @@ int ZObject3dScan::subtractForegroundSlice8(ZStack *stack)
 
 ZObject3dScan ZObject3dScan::subtract(const ZObject3dScan &obj)
 {
-  int minZ = getMinZ();
-  int maxZ = getMaxZ();
-
-  ZObject3dScan subtracted;
-  ZObject3dScan remained;
-
-  for (int z = minZ; z <= maxZ; ++z) {
-    ZObject3dScan slice = getSlice(z);
-    ZObject3dScan slice2 = obj.getSlice(z);
-    if (slice2.isEmpty()) {
-      remained.concat(slice);
-    } else {
-      ZObject3dScan diff = slice - slice2;
-      if (diff.isEmpty()) {
-        subtracted.concat(slice);
-      } else {
-        remained.concat(diff);
-        subtracted.concat(slice - diff);
-      }
-#if 0
-      ZStack *plane = slice.toStackObject();
-      slice2.addForegroundSlice8(plane); //1: remained; 2: subtracted
-
-      std::vector<ZObject3dScan*> objArray = extractAllObject(*plane);
-      for (std::vector<ZObject3dScan*>::const_iterator iter = objArray.begin();
-           iter != objArray.end(); ++iter) {
-        ZObject3dScan *obj = *iter;
-        if (obj->getLabel() == 1) {
-          remained.concat(*obj);
-        } else if (obj->getLabel() == 2) {
-          subtracted.concat(*obj);
-        }
-        delete obj;
-      }
-      delete plane;
-#endif
-    }
-  }
-
-  remained.canonize();
-  subtracted.canonize();
-
-  remained.copyAttributeFrom(*this);
-  subtracted.copyAttributeFrom(*this);
-
-  this->copyDataFrom(remained);
+  ZObject3dScan subtracted = intersect(obj);
   subtracted.setLabel(getLabel());
 
+  subtractSliently(obj);
+
   return subtracted;
 }
 
 ZObject3dScan operator - (
     const ZObject3dScan &obj1, const ZObject3dScan &obj2)
 {
-  const_cast<ZObject3dScan&>(obj1).canonize();
-  const_cast<ZObject3dScan&>(obj2).canonize();
-
-  size_t index1 = 0;
-  size_t index2 = 0;
-
+  obj1.canonizeConst();
+  obj2.canonizeConst();
 
   ZObject3dScan remained;
-
-  while (index1 < obj1.m_stripeArray.size() &&
-         index2 < obj2.m_stripeArray.size()) {
-    const ZObject3dStripe &s1 = obj1.m_stripeArray[index1];
-    const ZObject3dStripe &s2 = obj2.m_stripeArray[index2];
-
-    if (s1.getY() == s2.getY() && s1.getZ() == s2.getZ()) {
-      ZObject3dStripe diff = s1 - s2;
-      if (!diff.isEmpty()) {
-        remained.m_stripeArray.push_back(diff);
-      }
-      ++index1;
-      ++index2;
-    } else if (s1.getZ() < s2.getZ() ||
-               (s1.getZ() == s2.getZ() && s1.getY() < s2.getY())) {
-      remained.m_stripeArray.push_back(obj1.m_stripeArray[index1]);
-      ++index1;
-    } else {
-      ++index2;
-    }
-  }
-
-  for (; index1 < obj1.m_stripeArray.size(); ++index1) {
-    remained.m_stripeArray.push_back(obj1.m_stripeArray[index1]);
-  }
+  remained.m_stripeArray = ApplySetOperation(
+        obj1.m_stripeArray, obj2.m_stripeArray, ESetOperation::SUBTRACTION, 0);
 
   remained.copyAttributeFrom(obj1);
 
@@ -4099,7 +4996,10 @@ ZObject3dScan operator - (
 
 void ZObject3dScan::subtractSliently(const ZObject3dScan &obj)
 {
-  this->copyDataFrom(*this - obj);
+  ZObject3dScan remained = *this - obj;
+  deprecate(COMPONENT_ALL);
+  m_stripeArray.swap(remained.m_stripeArray);
+  setCanonized(true);
 #if 0
   int originalMinZ = getMinZ();
   int originalMaxZ = getMaxZ();
@@ -4157,9 +5057,20 @@ void ZObject3dScan::subtractSliently(const ZObject3dScan &obj)
 #endif
 }
 
-ZObject3dScan ZObject3dScan::intersect(const ZObject3dScan &obj) const
+ZObject3dScan ZObject3dScan::intersect(
+    const ZObject3dScan &obj, int threadNumber) const
 {
-  return *this - (*this - obj);
+  canonizeConst();
+  obj.canonizeConst();
+
+  ZObject3dScan result;
+  result.m_stripeArray = ApplySetOperation(
+        m_stripeArray, obj.m_stripeArray, ESetOperation::INTERSECTION,
+        threadNumber);
+  result.copyAttributeFrom(*this);
+  result.setCanonized(true);
+
+  return result;
 
 #if 0
   int minZ = std::max(getMinZ(), obj.getMinZ());
@@ -4501,46 +5412,111 @@ bool ZObject3dScan::contains(int x, int y, int z)
 
   canonize();
 
-  //Binary search
-  size_t lowIndex = 0;
-  size_t highIndex = getStripeNumber() - 1;
-
-  while (highIndex >= lowIndex) {
-    size_t medIndex = (lowIndex + highIndex) / 2;
-    ZObject3dStripe &stripe = m_stripeArray[medIndex];
+  size_t index = lowerBoundStripe(z, y);
+  if (index < getStripeNumber()) {
+    const ZObject3dStripe &stripe = m_stripeArray[index];
     if (stripe.getZ() == z && stripe.getY() == y) {
       return stripe.containsX(x);
-    } else {
-      //On the left side
-      if (stripe.getZ() > z || (stripe.getZ() == z && stripe.getY() > y)) {
-        if (medIndex == 0) {
-          if (highIndex == 1) {
-            return m_stripeArray[highIndex].contains(x, y, z);
-          }
-          return false;
-        } else {
-          highIndex = medIndex - 1;
-        }
-      } else { //On the right side
-        lowIndex = medIndex + 1;
-      }
     }
   }
 
   return false;
 }
 
+std::vector<bool> ZObject3dScan::containsBatch(
+    const std::vector<ZIntPoint> &ptArray)
+{
+  std::vector<bool> result(ptArray.size(), false);
+
+  if (isEmpty() || ptArray.empty()) {
+    return result;
+  }
+
+  canonize();
+
+  std::vector<ZIntPoint> shiftedArray = ptArray;
+  for (ZIntPoint &pt : shiftedArray) {
+    pt.shiftSliceAxis(m_sliceAxis);
+  }
+
+  std::vector<size_t> order(ptArray.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&](size_t i1, size_t i2) {
+    const ZIntPoint &pt1 = shiftedArray[i1];
+    const ZIntPoint &pt2 = shiftedArray[i2];
+    if (pt1.getZ() != pt2.getZ()) {
+      return pt1.getZ() < pt2.getZ();
+    }
+    if (pt1.getY() != pt2.getY()) {
+      return pt1.getY() < pt2.getY();
+    }
+    return pt1.getX() < pt2.getX();
+  });
+
+  //Both the stripes and the queries are sorted, so the stripe cursor and the
+  //segment cursor only move forward.
+  size_t stripeIndex = 0;
+  size_t segIndex = 0;
+  const size_t stripeNumber = getStripeNumber();
+  for (size_t index : order) {
+    const ZIntPoint &pt = shiftedArray[index];
+    while (stripeIndex < stripeNumber) {
+      const ZObject3dStripe &stripe = m_stripeArray[stripeIndex];
+      if (stripe.getZ() < pt.getZ() ||
+          (stripe.getZ() == pt.getZ() && stripe.getY() < pt.getY())) {
+        ++stripeIndex;
+        segIndex = 0;
+      } else {
+        break;
+      }
+    }
+
+    if (stripeIndex == stripeNumber) {
+      break;
+    }
+
+    const ZObject3dStripe &stripe = m_stripeArray[stripeIndex];
+    if (stripe.getZ() == pt.getZ() && stripe.getY() == pt.getY()) {
+      const int segNumber = stripe.getSegmentNumber();
+      while ((int) segIndex < segNumber &&
+             stripe.getSegmentEnd(segIndex) < pt.getX()) {
+        ++segIndex;
+      }
+      if ((int) segIndex < segNumber &&
+          stripe.getSegmentStart(segIndex) <= pt.getX()) {
+        result[index] = true;
+      }
+    }
+  }
+
+  return result;
+}
+
 void ZObject3dScan::blockEvent(bool blocking)
 {
+  //Caches may have missed events while blocking
+  if (m_blockingEvent && !blocking) {
+    m_blockingEvent = false;
+    deprecate(COMPONENT_ALL);
+  }
+
   m_blockingEvent = blocking;
 }
 
 void ZObject3dScan::processEvent(TEvent event)
 {
+  //The summary is cheap to deprecate and must not be stale even when events
+  //are blocked.
+  if ((event & (EVENT_OBJECT_MODEL_CHANGED | EVENT_OBJECT_CANONIZED) &
+       ~EVENT_OBJECT_VIEW_CHANGED) && !(event & EVENT_OBJECT_SUMMARY_UPDATED)) {
+    deprecate(COMPONENT_SUMMARY);
+  }
+
   if (!m_blockingEvent) {
     if (event & EVENT_OBJECT_MODEL_CHANGED & ~EVENT_OBJECT_VIEW_CHANGED) {
       deprecate(COMPONENT_ACCUMULATED_STRIPE_NUMBER);
-      deprecate(COMPONENT_SLICEWISE_VOXEL_NUMBER);
     }
 
     if (event & EVENT_OBJECT_UNCANONIZED & ~EVENT_OBJECT_VIEW_CHANGED) {
@@ -4554,6 +5530,7 @@ void ZObject3dScan::processEvent(TEvent event)
     if (event & EVENT_OBJECT_VIEW_CHANGED) {
       deprecate(COMPONENT_STRIPE_INDEX_MAP);
       deprecate(COMPONENT_INDEX_SEGMENT_MAP);
+      deprecate(COMPONENT_STRIPE_INDEX_HASH);
     }
   }
 }
@@ -4701,16 +5678,30 @@ std::vector<ZObject3dScan*> ZObject3dScan::extractAllObject(
 
   switch (stack.kind()) {
   case GREY:
-    objMap = extractAllForegroundObject(
-          stack.array8(), stack.width(), stack.height(), stack.depth(),
-          stack.getOffset().getX(), stack.getOffset().getY(),
-          stack.getOffset().getZ(), yStep, NULL);
+    if (yStep == 1) {
+      objMap = extractAllObjectParallel(
+            stack.array8(), stack.width(), stack.height(), stack.depth(),
+            stack.getOffset().getX(), stack.getOffset().getY(),
+            stack.getOffset().getZ(), true);
+    } else {
+      objMap = extractAllForegroundObject(
+            stack.array8(), stack.width(), stack.height(), stack.depth(),
+            stack.getOffset().getX(), stack.getOffset().getY(),
+            stack.getOffset().getZ(), yStep, NULL);
+    }
     break;
   case GREY16:
-    objMap = extractAllForegroundObject(
-          stack.array16(), stack.width(), stack.height(), stack.depth(),
-          stack.getOffset().getX(), stack.getOffset().getY(),
-          stack.getOffset().getZ(), yStep, NULL);
+    if (yStep == 1) {
+      objMap = extractAllObjectParallel(
+            stack.array16(), stack.width(), stack.height(), stack.depth(),
+            stack.getOffset().getX(), stack.getOffset().getY(),
+            stack.getOffset().getZ(), true);
+    } else {
+      objMap = extractAllForegroundObject(
+            stack.array16(), stack.width(), stack.height(), stack.depth(),
+            stack.getOffset().getX(), stack.getOffset().getY(),
+            stack.getOffset().getZ(), yStep, NULL);
+    }
     break;
   default:
     break;
@@ -5030,6 +6021,8 @@ int ZObject3dScan::Appender::Hash(int z, int y)
 void ZObject3dScan::Appender::addSegment(int z, int y, int x0, int x1)
 {
   if (m_obj) {
+    //The current stripe is modified without notifying the object
+    m_obj->deprecate(COMPONENT_SUMMARY);
     if (m_currentStripe) {
       if (m_currentStripe->getZ() != z || m_currentStripe->getY() != y) {
         m_currentStripe = nullptr;
@@ -5066,6 +6059,8 @@ void ZObject3dScan::Appender::addSegment(int z, int y, int x0, int x1)
 void ZObject3dScan::Appender::addSegment(int x0, int x1)
 {
   if (m_obj) {
+    //The current stripe is modified without notifying the object
+    m_obj->deprecate(COMPONENT_SUMMARY);
     if (m_currentStripe) {
       m_currentStripe->addSegment(x0, x1, false);
     } else {
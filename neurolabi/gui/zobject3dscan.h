@@ -8,6 +8,7 @@
 #include <unordered_map>
 #include <utility>
 #include <fstream>
+#include <mutex>
 
 #ifdef _QT_GUI_USED_
 #include <QByteArray>
@@ -79,6 +80,9 @@ public:
    *
    * \return The number of voxels of the current representation, not necessarily
    * the object itself.
+   *
+   * The voxel number, bound box, centroid and slicewise voxel number are
+   * computed together and cached until the object changes.
    */
   size_t getVoxelNumber() const;
 
@@ -117,8 +121,10 @@ public:
 
   enum EComponent {
     COMPONENT_STRIPE_INDEX_MAP, COMPONENT_INDEX_SEGMENT_MAP,
+    COMPONENT_STRIPE_INDEX_HASH,
     COMPONENT_ACCUMULATED_STRIPE_NUMBER,
     COMPONENT_SLICEWISE_VOXEL_NUMBER,
+    COMPONENT_SUMMARY,
     COMPONENT_Z_PROJECTION,
     COMPONENT_ALL
   };
@@ -146,6 +152,19 @@ public:
   bool load(const char *filePath);
   bool load(const std::string &filePath);
 
+  /*!
+   * \brief Save the object in the chunked RLE format.
+   *
+   * The file is much smaller than the one written by save() and supports
+   * reading a range of slices without loading the whole object (see
+   * ZObject3dScanChunkFile). It is meant for files with the extension
+   * ZObject3dScanChunkFile::EXTENSION; .sobj files should be written by
+   * save() to stay in the legacy format. load() recognizes both formats.
+   *
+   * \return true iff the object is saved successfully
+   */
+  bool saveCompressed(const std::string &filePath) const;
+
   bool hit(double x, double y, double z);
   bool hit(double x, double y, neutube::EAxis axis);
   //ZIntPoint getHitPoint() const;
@@ -190,9 +209,25 @@ public:
 
   /*!
    * \brief Import object from a byte array
+   *
+   * For objects sliced along Z, stripes are built directly from the spans,
+   * which DVID sends in ZYX order, and the object is marked as canonized when
+   * the spans are in canonical order. In that case a following canonize() call
+   * does nothing. Large payloads are decoded in parallel.
    */
   bool importDvidObjectBuffer(const char *byteArray, size_t byteNumber);
 
+  /*!
+   * \brief Import object from a byte array with a given number of threads
+   *
+   * The spans are split at z boundaries into at most \a threadNumber chunks,
+   * which are decoded independently and then joined. The number of threads is
+   * decided by the hardware and the payload size if \a threadNumber <= 0. The
+   * slice axis of the object is ignored.
+   */
+  bool importDvidObjectBuffer(
+      const char *byteArray, size_t byteNumber, int threadNumber);
+
   bool importDvidBlockBuffer(
       const char *byteArray, size_t byteNumber, bool canonizing);
 
@@ -277,25 +312,47 @@ public:
   /*!
    * \brief Unify two objects
    *
-   * Unify \a obj to the current object and keep the result canonized.
+   * Unify \a obj to the current object and keep the result canonized. Both
+   * objects are merged as sorted stripe lists, which takes linear time after
+   * canonization. Large objects are processed in parallel z slabs with at most
+   * \a threadNumber threads, which is decided automatically if it is 0.
    */
-  void unify(const ZObject3dScan &obj);
+  void unify(const ZObject3dScan &obj, int threadNumber = 0);
 
   /*!
    * \brief Concatenate two objects
    *
    * The current object will be changed to the combination of its old content
-   * and \a obj. The result will not be canonized.
+   * and \a obj. The result will not be canonized unless both objects are
+   * canonized and \a obj starts after the last stripe of the current object.
    */
   void concat(const ZObject3dScan &obj);
 
+  /*!
+   * \brief Subtract an object
+   *
+   * The current object becomes the part that is not in \a obj.
+   *
+   * \return The part that is removed.
+   */
   ZObject3dScan subtract(const ZObject3dScan &obj);
   void subtractSliently(const ZObject3dScan &obj);
 
+  /*!
+   * \brief Subtraction in linear time
+   *
+   * Both objects are canonized first. The result is canonized.
+   */
   friend ZObject3dScan operator - (
       const ZObject3dScan &obj1, const ZObject3dScan &obj2);
 
-  ZObject3dScan intersect(const ZObject3dScan &obj) const;
+  /*!
+   * \brief Intersection of two objects
+   *
+   * The result is canonized. See unify() for \a threadNumber.
+   */
+  ZObject3dScan intersect(
+      const ZObject3dScan &obj, int threadNumber = 0) const;
 
   /*!
    * \brief Extract voxels within a cuboid
@@ -347,6 +404,15 @@ public:
   void upSample(int xIntv, int yIntv, int zIntv);
   void upSample(const ZIntPoint &dsIntv);
 
+  /*!
+   * \brief Downsample the object to a pyramid scale in place
+   *
+   * The result has the same voxels as downsampleMax((1 << \a scale) - 1).
+   * Each scale is computed from the previous one in a single streaming pass
+   * without sorting, which is faster than the general downsampling.
+   */
+  void downsampleToPyramidLevel(int scale);
+
   Stack* toStack(int *offset = NULL, int v = 1) const;
   Stack* toStackWithMargin(int *offset, int v, int margin) const;
 
@@ -392,6 +458,24 @@ public:
       int yStep,
       std::map<uint64_t, ZObject3dScan*> *bodySet);
 
+  /*!
+   * \brief Extract all objects from a label array in parallel
+   *
+   * The rows of the array are split into contiguous slabs, which are scanned
+   * on separate threads into thread-local hash maps. The per-label stripes are
+   * then concatenated in slab order, so each object is canonized without
+   * sorting. (\a x0, \a y0, \a z0) is the coordinate of the first voxel of
+   * the array. Label 0 is skipped if \a foreground is true. The number of
+   * threads is decided by the hardware and the array size if
+   * \a threadNumber <= 0.
+   *
+   * \return A map from labels to newly created objects. The caller is
+   *         responsible for freeing the map and the objects.
+   */
+  template<class T>
+  static std::map<uint64_t, ZObject3dScan*>* extractAllObjectParallel(
+      const T *array, int width, int height, int depth, int x0, int y0, int z0,
+      bool foreground, int threadNumber = 0);
 
   //Foreground only
   static std::vector<ZObject3dScan*> extractAllObject(const ZStack &stack,
@@ -403,9 +487,49 @@ public:
 
   const std::map<std::pair<int, int>, size_t> &getStripeMap() const;
 
+  /*!
+   * \brief Find the first stripe at or after (\a z, \a y) in the ZY order.
+   *
+   * It is a binary search over the stripes, so the object must be canonized.
+   *
+   * \return The stripe index, or getStripeNumber() if every stripe is before
+   *         (\a z, \a y).
+   */
+  size_t lowerBoundStripe(int z, int y) const;
+
+  /*!
+   * \brief Get the hashed (z, y)->stripe index map.
+   *
+   * The map is an opt-in index for callers that do many random stripe lookups
+   * on a large object and can afford its memory. It is built on the first
+   * call and invalidated by any change of the object. It is only meaningful
+   * when the object is canonized, in which case each key corresponds to
+   * exactly one stripe. Use GetStripeIndexKey() to make a key. Other queries,
+   * such as contains(), use lowerBoundStripe() instead.
+   */
+  const std::unordered_map<uint64_t, size_t>& getStripeIndexHash() const;
+  static uint64_t GetStripeIndexKey(int z, int y);
+
   std::vector<size_t> getConnectedObjectSize();
   std::vector<ZObject3dScan> getConnectedComponent(EAction ppAction);
 
+  /*!
+   * \brief Extract connected components by union-find on runs
+   *
+   * Runs in adjacent rows and slices are linked directly without building a
+   * connection graph. \a nbr specifies 6- (D1), 18- (D2) or 26-connectivity
+   * (D3). Slabs of slices are labeled in parallel with at most
+   * \a threadNumber threads (decided automatically if it is 0) and then merged
+   * at slab boundaries.
+   *
+   * \param sizeArray Stores the voxel number of each component if it is not
+   *        NULL.
+   * \return Canonized components in the order of their first runs.
+   */
+  std::vector<ZObject3dScan> getConnectedComponent(
+      neutube::EStackNeighborhood nbr, std::vector<size_t> *sizeArray = NULL,
+      int threadNumber = 0);
+
   /*!
    * \brief Check if an object is canonized.
    *
@@ -488,6 +612,18 @@ public:
   bool contains(int x, int y, int z);
   bool contains(const ZIntPoint &pt);
 
+  /*!
+   * \brief Test if the object contains a list of voxels
+   *
+   * The queries are sorted in the stripe order and answered in a single sweep
+   * through the stripes, which is much faster than calling contains() for each
+   * point when there are many queries.
+   *
+   * \return An array with the same size as \a ptArray. The i-th element is
+   *         true iff the i-th point is a part of the object.
+   */
+  std::vector<bool> containsBatch(const std::vector<ZIntPoint> &ptArray);
+
   ZIntPoint getDsIntv() const {
     return m_dsIntv;
   }
@@ -819,6 +955,7 @@ public:
   };
 
   std::vector<ZObject3dStripe>& getStripeArray() {
+    deprecate(COMPONENT_SUMMARY);
     return m_stripeArray;
   }
 
@@ -845,6 +982,51 @@ private:
 
   bool isAdjacentTo_Old(const ZObject3dScan &obj) const;
 
+  /*!
+   * \brief Statistics of the current representation
+   *
+   * The bound box and moments are in the internal (slice-axis) coordinates.
+   * The slicewise voxel number is kept in m_slicewiseVoxelNumber, which is
+   * valid iff the summary is valid.
+   */
+  struct Summary {
+    bool isValid = false;
+    size_t voxelNumber = 0;
+    bool hasBoundBox = false;
+    int minX = 0;
+    int minY = 0;
+    int minZ = 0;
+    int maxX = -1;
+    int maxY = -1;
+    int maxZ = -1;
+    double xSum = 0.0;
+    double ySum = 0.0;
+    double zSum = 0.0;
+
+    void joinBoundBox(int x0, int x1, int y, int z);
+    void merge(const Summary &summary);
+  };
+
+  /*!
+   * \brief Compute the summary if it is deprecated.
+   *
+   * It is guarded by m_summaryMutex so that const queries can be made from
+   * multiple threads.
+   */
+  void updateSummary() const;
+
+  /*!
+   * \brief Add the voxels of [\a x0, \a x1] to the summary.
+   *
+   * The bound box is not updated. \a sign is -1 for removing the voxels.
+   */
+  void addSummarySegment(int z, int y, int x0, int x1, int sign) const;
+  void addSummaryStripe(const ZObject3dStripe &stripe, int sign) const;
+
+  static void ComputeSummary(
+      const std::vector<ZObject3dStripe> &stripeArray, Summary *summary,
+      std::unordered_map<int, size_t> *slicewiseVoxelNumber);
+
 protected:
   std::vector<ZObject3dStripe> m_stripeArray;
   bool m_isCanonized;
@@ -856,7 +1038,10 @@ protected:
   //ZIntPoint m_hitPoint;
   mutable std::vector<size_t> m_accNumberArray;
   mutable std::unordered_map<int, size_t> m_slicewiseVoxelNumber;
+  mutable Summary m_summary;
+  mutable std::mutex m_summaryMutex;
   mutable std::map<std::pair<int, int>, size_t> m_stripeMap;
+  mutable std::unordered_map<uint64_t, size_t> m_stripeIndexHash;
   mutable std::map<size_t, std::pair<size_t, size_t> > m_indexSegmentMap;
   mutable ZObject3dScan *m_zProjection;
 
@@ -867,6 +1052,8 @@ protected:
   const static TEvent EVENT_OBJECT_CANONIZED;
   const static TEvent EVENT_OBJECT_VIEW_CHANGED;
   const static TEvent EVENT_NULL;
+  //Combined with EVENT_OBJECT_MODEL_CHANGED when the summary has been updated
+  const static TEvent EVENT_OBJECT_SUMMARY_UPDATED;
 #endif
 };
 
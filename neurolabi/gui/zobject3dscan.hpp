@@ -1,6 +1,11 @@
 #ifndef ZOBJECT3DSCAN_HPP
 #define ZOBJECT3DSCAN_HPP
 
+#include <thread>
+#include <unordered_map>
+#include <algorithm>
+#include <iterator>
+
 #include "zobject3dscan.h"
 
 template<class T>
@@ -416,6 +421,112 @@ std::map<uint64_t, ZObject3dScan *> *ZObject3dScan::extractAllForegroundObject(
   return bodySet;
 }
 
+template<class T>
+std::map<uint64_t, ZObject3dScan *> *ZObject3dScan::extractAllObjectParallel(
+    const T *array, int width, int height, int depth, int x0, int y0, int z0,
+    bool foreground, int threadNumber)
+{
+  std::map<uint64_t, ZObject3dScan*> *bodySet =
+      new std::map<uint64_t, ZObject3dScan*>;
+
+  if (array == NULL || width <= 0 || height <= 0 || depth <= 0) {
+    return bodySet;
+  }
+
+  const size_t rowNumber = size_t(height) * depth;
+  if (threadNumber <= 0) {
+    const size_t minThreadVoxel = 1000000;
+    threadNumber = std::min<size_t>(
+          std::max(1u, std::thread::hardware_concurrency()),
+          std::max<size_t>(1, rowNumber * width / minThreadVoxel));
+  }
+  threadNumber = std::min<size_t>(threadNumber, rowNumber);
+
+  typedef std::unordered_map<uint64_t, ZObject3dScan*> TLocalBodySet;
+  std::vector<TLocalBodySet> localBodySetArray(threadNumber);
+
+  auto scanSlab = [&](int index) {
+    TLocalBodySet &localBodySet = localBodySetArray[index];
+    const size_t rowStart = rowNumber * index / threadNumber;
+    const size_t rowEnd = rowNumber * (index + 1) / threadNumber;
+
+    ZObject3dScan *obj = NULL;
+    uint64_t currentLabel = 0;
+    for (size_t row = rowStart; row < rowEnd; ++row) {
+      const T *rowArray = array + row * width;
+      const int y = int(row % height) + y0;
+      const int z = int(row / height) + z0;
+      int x = 0;
+      while (x < width) {
+        const T v = rowArray[x];
+        int length = 1;
+        while (x + length < width && rowArray[x + length] == v) {
+          ++length;
+        }
+
+        if (v > 0 || !foreground) {
+          //Neighboring rows usually start with the same label
+          if (obj == NULL || currentLabel != uint64_t(v)) {
+            currentLabel = v;
+            auto iter = localBodySet.find(currentLabel);
+            if (iter == localBodySet.end()) {
+              obj = new ZObject3dScan;
+              localBodySet[currentLabel] = obj;
+            } else {
+              obj = iter->second;
+            }
+          }
+
+          if (obj->isEmpty() || obj->m_stripeArray.back().getY() != y ||
+              obj->m_stripeArray.back().getZ() != z) {
+            obj->addStripeFast(z, y);
+          }
+          obj->addSegmentFast(x + x0, x + x0 + length - 1);
+        }
+
+        x += length;
+      }
+    }
+  };
+
+  if (threadNumber == 1) {
+    scanSlab(0);
+  } else {
+    std::vector<std::thread> threadArray;
+    for (int i = 1; i < threadNumber; ++i) {
+      threadArray.emplace_back(scanSlab, i);
+    }
+    scanSlab(0);
+    for (std::thread &t : threadArray) {
+      t.join();
+    }
+  }
+
+  //Slabs are merged in order to keep the stripes sorted
+  for (TLocalBodySet &localBodySet : localBodySetArray) {
+    for (auto &body : localBodySet) {
+      auto iter = bodySet->find(body.first);
+      if (iter == bodySet->end()) {
+        body.second->setLabel(body.first);
+        bodySet->insert(std::map<uint64_t, ZObject3dScan*>::value_type(
+                          body.first, body.second));
+      } else {
+        std::vector<ZObject3dStripe> &target = iter->second->m_stripeArray;
+        std::vector<ZObject3dStripe> &source = body.second->m_stripeArray;
+        target.insert(target.end(), std::make_move_iterator(source.begin()),
+                      std::make_move_iterator(source.end()));
+        delete body.second;
+      }
+    }
+  }
+
+  for (auto &body : *bodySet) {
+    body.second->setCanonized(true);
+  }
+
+  return bodySet;
+}
+
 
 template<class InputIterator>
 Stack* ZObject3dScan::makeStack(InputIterator startObject,
@@ -0,0 +1,472 @@
+#include "zobject3dscanchunkfile.h"
+
+#include <cstring>
+#include <algorithm>
+#include <zlib.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "zobject3dscan.h"
+#include "zerror.h"
+
+const int ZObject3dScanChunkFile::VERSION_TAG = -3;
+const std::string ZObject3dScanChunkFile::EXTENSION = ".csobj";
+
+namespace {
+
+const uint32_t CHUNK_FLAG_DEFLATE = 0x1;
+const size_t CHUNK_HEADER_SIZE = 16;
+const size_t CHUNK_INDEX_SIZE = 32;
+
+//zlib never expands data by more than about 1032 times
+const uint64_t MAX_DEFLATE_RATIO = 1032;
+
+template <typename T>
+void AppendValue(std::vector<char> &buffer, T value)
+{
+  size_t pos = buffer.size();
+  buffer.resize(pos + sizeof(T));
+  memcpy(buffer.data() + pos, &value, sizeof(T));
+}
+
+template <typename T>
+T ReadValue(const char *data)
+{
+  T value;
+  memcpy(&value, data, sizeof(T));
+
+  return value;
+}
+
+void AppendVarint(std::vector<char> &buffer, uint64_t v)
+{
+  while (v >= 0x80) {
+    buffer.push_back(char((v & 0x7F) | 0x80));
+    v >>= 7;
+  }
+  buffer.push_back(char(v));
+}
+
+void AppendSignedVarint(std::vector<char> &buffer, int64_t v)
+{
+  AppendVarint(buffer, (uint64_t(v) << 1) ^ uint64_t(v >> 63));
+}
+
+bool ReadVarint(const char *&data, const char *end, uint64_t *v)
+{
+  *v = 0;
+  for (int shift = 0; shift < 64 && data < end; shift += 7) {
+    uint8_t byte = uint8_t(*(data++));
+    *v |= uint64_t(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool ReadSignedVarint(const char *&data, const char *end, int64_t *v)
+{
+  uint64_t u = 0;
+  if (!ReadVarint(data, end, &u)) {
+    return false;
+  }
+  *v = int64_t(u >> 1) ^ -int64_t(u & 1);
+
+  return true;
+}
+
+}
+
+ZObject3dScanChunkFile::ZObject3dScanChunkFile()
+{
+}
+
+ZObject3dScanChunkFile::~ZObject3dScanChunkFile()
+{
+  close();
+}
+
+bool ZObject3dScanChunkFile::Write(
+    const ZObject3dScan &obj, const std::string &filePath, bool deflating)
+{
+  ZObject3dScan canonizedObj;
+  const ZObject3dScan *source = &obj;
+  if (!obj.isCanonized()) {
+    canonizedObj = obj;
+    canonizedObj.canonize();
+    source = &canonizedObj;
+  }
+
+  std::vector<ChunkIndex> index;
+  std::vector<std::vector<char> > chunkArray;
+
+  const size_t stripeNumber = source->getStripeNumber();
+  size_t stripeIndex = 0;
+  while (stripeIndex < stripeNumber) {
+    ChunkIndex chunk;
+    chunk.z = source->getStripe(stripeIndex).getZ();
+
+    std::vector<char> data;
+    int64_t prevY = 0;
+    for (; stripeIndex < stripeNumber &&
+         source->getStripe(stripeIndex).getZ() == chunk.z; ++stripeIndex) {
+      const ZObject3dStripe &stripe = source->getStripe(stripeIndex);
+      AppendSignedVarint(data, stripe.getY() - prevY);
+      prevY = stripe.getY();
+
+      const int segmentNumber = stripe.getSegmentNumber();
+      AppendVarint(data, segmentNumber);
+      int64_t prevX = 0;
+      for (int i = 0; i < segmentNumber; ++i) {
+        int x0 = stripe.getSegmentStart(i);
+        int x1 = stripe.getSegmentEnd(i);
+        AppendSignedVarint(data, x0 - prevX);
+        AppendVarint(data, uint64_t(x1 - x0));
+        prevX = x1;
+      }
+      ++chunk.stripeNumber;
+    }
+
+    chunk.rawSize = data.size();
+    if (deflating && !data.empty()) {
+      uLongf compressedSize = compressBound(data.size());
+      std::vector<char> compressed(compressedSize);
+      if (compress2((Bytef*) compressed.data(), &compressedSize,
+                    (const Bytef*) data.data(), data.size(),
+                    Z_DEFAULT_COMPRESSION) == Z_OK &&
+          compressedSize < data.size()) {
+        compressed.resize(compressedSize);
+        data.swap(compressed);
+      }
+    }
+    chunk.storedSize = data.size();
+
+    index.push_back(chunk);
+    chunkArray.push_back(std::move(data));
+  }
+
+  std::vector<char> header;
+  header.reserve(CHUNK_HEADER_SIZE + CHUNK_INDEX_SIZE * index.size());
+  AppendValue<int32_t>(header, VERSION_TAG);
+  AppendValue<uint32_t>(header, deflating ? CHUNK_FLAG_DEFLATE : 0);
+  AppendValue<uint64_t>(header, index.size());
+
+  uint64_t offset = CHUNK_HEADER_SIZE + CHUNK_INDEX_SIZE * index.size();
+  for (ChunkIndex &chunk : index) {
+    chunk.offset = offset;
+    offset += chunk.storedSize;
+    AppendValue<int32_t>(header, chunk.z);
+    AppendValue<uint32_t>(header, chunk.stripeNumber);
+    AppendValue<uint64_t>(header, chunk.offset);
+    AppendValue<uint64_t>(header, chunk.storedSize);
+    AppendValue<uint64_t>(header, chunk.rawSize);
+  }
+
+  std::ofstream stream(filePath.c_str(), std::ios_base::binary);
+  if (!stream.good()) {
+    RECORD_WARNING_UNCOND("Cannot open file " + filePath);
+    return false;
+  }
+
+  stream.write(header.data(), header.size());
+  for (const std::vector<char> &data : chunkArray) {
+    stream.write(data.data(), data.size());
+  }
+
+  return stream.good();
+}
+
+bool ZObject3dScanChunkFile::IsChunkFile(const std::string &filePath)
+{
+  std::ifstream stream(filePath.c_str(), std::ios_base::binary);
+  int32_t tag = 0;
+  stream.read((char*)(&tag), sizeof(tag));
+
+  return stream.good() && tag == VERSION_TAG;
+}
+
+bool ZObject3dScanChunkFile::open(const std::string &filePath)
+{
+  close();
+
+#ifndef _WIN32
+  int fd = ::open(filePath.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+      void *data = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED) {
+        m_mappedData = (const char*) data;
+        m_fileSize = fileStat.st_size;
+      }
+    }
+    ::close(fd);
+  }
+#endif
+
+  if (m_mappedData == nullptr) {
+    m_stream.open(filePath.c_str(), std::ios_base::binary);
+    if (m_stream.good()) {
+      m_stream.seekg(0, std::ios_base::end);
+      m_fileSize = m_stream.tellg();
+    }
+  }
+
+  if (m_mappedData != nullptr || m_stream.is_open()) {
+    m_isOpen = readIndex();
+  }
+
+  if (!m_isOpen) {
+    close();
+    RECORD_WARNING_UNCOND("Invalid chunked RLE file " + filePath);
+  }
+
+  return m_isOpen;
+}
+
+void ZObject3dScanChunkFile::close()
+{
+#ifndef _WIN32
+  if (m_mappedData != nullptr) {
+    munmap((void*) m_mappedData, m_fileSize);
+  }
+#endif
+  m_mappedData = nullptr;
+
+  if (m_stream.is_open()) {
+    m_stream.close();
+  }
+  m_stream.clear();
+
+  m_fileSize = 0;
+  m_index.clear();
+  m_isOpen = false;
+}
+
+bool ZObject3dScanChunkFile::readData(
+    uint64_t offset, uint64_t size, std::vector<char> *buffer,
+    const char **data) const
+{
+  if (offset + size > m_fileSize) {
+    return false;
+  }
+
+  if (m_mappedData != nullptr) {
+    *data = m_mappedData + offset;
+  } else {
+    buffer->resize(size);
+    m_stream.clear();
+    m_stream.seekg(offset);
+    m_stream.read(buffer->data(), size);
+    if (!m_stream.good()) {
+      return false;
+    }
+    *data = buffer->data();
+  }
+
+  return true;
+}
+
+bool ZObject3dScanChunkFile::readIndex()
+{
+  std::vector<char> buffer;
+  const char *data = NULL;
+  if (!readData(0, CHUNK_HEADER_SIZE, &buffer, &data)) {
+    return false;
+  }
+
+  if (ReadValue<int32_t>(data) != VERSION_TAG) {
+    return false;
+  }
+
+  uint64_t chunkNumber = ReadValue<uint64_t>(data + 8);
+  if (chunkNumber > (m_fileSize - CHUNK_HEADER_SIZE) / CHUNK_INDEX_SIZE) {
+    return false;
+  }
+
+  if (!readData(CHUNK_HEADER_SIZE, CHUNK_INDEX_SIZE * chunkNumber,
+                &buffer, &data)) {
+    return false;
+  }
+
+  m_index.resize(chunkNumber);
+  for (size_t i = 0; i < m_index.size(); ++i) {
+    ChunkIndex &chunk = m_index[i];
+    const char *entry = data + CHUNK_INDEX_SIZE * i;
+    chunk.z = ReadValue<int32_t>(entry);
+    chunk.stripeNumber = ReadValue<uint32_t>(entry + 4);
+    chunk.offset = ReadValue<uint64_t>(entry + 8);
+    chunk.storedSize = ReadValue<uint64_t>(entry + 16);
+    chunk.rawSize = ReadValue<uint64_t>(entry + 24);
+
+    if (chunk.offset > m_fileSize || chunk.storedSize > m_fileSize - chunk.offset) {
+      return false;
+    }
+
+    if (i > 0 && chunk.z <= m_index[i - 1].z) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+size_t ZObject3dScanChunkFile::getStripeNumber() const
+{
+  size_t stripeNumber = 0;
+  for (const ChunkIndex &chunk : m_index) {
+    stripeNumber += chunk.stripeNumber;
+  }
+
+  return stripeNumber;
+}
+
+int ZObject3dScanChunkFile::getMinZ() const
+{
+  if (m_index.empty()) {
+    return 0;
+  }
+
+  return m_index.front().z;
+}
+
+int ZObject3dScanChunkFile::getMaxZ() const
+{
+  if (m_index.empty()) {
+    return -1;
+  }
+
+  return m_index.back().z;
+}
+
+bool ZObject3dScanChunkFile::hasSlice(int z) const
+{
+  auto iter = std::lower_bound(
+        m_index.begin(), m_index.end(), z,
+        [](const ChunkIndex &chunk, int z) { return chunk.z < z; });
+
+  return iter != m_index.end() && iter->z == z;
+}
+
+bool ZObject3dScanChunkFile::decodeChunk(
+    const ChunkIndex &chunk, ZObject3dScan *result) const
+{
+  std::vector<char> buffer;
+  const char *data = NULL;
+  if (!readData(chunk.offset, chunk.storedSize, &buffer, &data)) {
+    return false;
+  }
+
+  //Each stripe takes at least two bytes: its y and number of segments
+  if (chunk.rawSize < uint64_t(chunk.stripeNumber) * 2) {
+    return false;
+  }
+
+  std::vector<char> rawData;
+  if (chunk.storedSize != chunk.rawSize) {
+    //Reject corrupted sizes before allocating the buffer
+    if (chunk.rawSize > chunk.storedSize * MAX_DEFLATE_RATIO + 64) {
+      return false;
+    }
+    rawData.resize(chunk.rawSize);
+    uLongf rawSize = chunk.rawSize;
+    if (uncompress((Bytef*) rawData.data(), &rawSize,
+                   (const Bytef*) data, chunk.storedSize) != Z_OK ||
+        rawSize != chunk.rawSize) {
+      return false;
+    }
+    data = rawData.data();
+  }
+
+  const char *end = data + chunk.rawSize;
+  int64_t y = 0;
+  for (uint32_t i = 0; i < chunk.stripeNumber; ++i) {
+    int64_t dy = 0;
+    uint64_t segmentNumber = 0;
+    if (!ReadSignedVarint(data, end, &dy) ||
+        !ReadVarint(data, end, &segmentNumber)) {
+      return false;
+    }
+    y += dy;
+    result->addStripeFast(chunk.z, y);
+
+    int64_t x = 0;
+    for (uint64_t j = 0; j < segmentNumber; ++j) {
+      int64_t dx = 0;
+      uint64_t length = 0;
+      if (!ReadSignedVarint(data, end, &dx) ||
+          !ReadVarint(data, end, &length)) {
+        return false;
+      }
+      int64_t x0 = x + dx;
+      x = x0 + length;
+      result->addSegmentFast(x0, x);
+    }
+  }
+
+  return data == end;
+}
+
+ZObject3dScan* ZObject3dScanChunkFile::readSlice(
+    int minZ, int maxZ, ZObject3dScan *result) const
+{
+  if (!isOpen()) {
+    return NULL;
+  }
+
+  bool isNewResult = false;
+  if (result == NULL) {
+    result = new ZObject3dScan;
+    isNewResult = true;
+  } else {
+    result->clear();
+  }
+
+  auto iter = std::lower_bound(
+        m_index.begin(), m_index.end(), minZ,
+        [](const ChunkIndex &chunk, int z) { return chunk.z < z; });
+  for (; iter != m_index.end() && iter->z <= maxZ; ++iter) {
+    if (!decodeChunk(*iter, result)) {
+      RECORD_WARNING_UNCOND("Corrupted chunk in RLE file");
+      if (isNewResult) {
+        delete result;
+      } else {
+        result->clear();
+      }
+      return NULL;
+    }
+  }
+
+  result->setCanonized(true);
+
+  return result;
+}
+
+ZObject3dScan* ZObject3dScanChunkFile::read(ZObject3dScan *result) const
+{
+  if (m_index.empty()) {
+    return readSlice(0, -1, result);
+  }
+
+  return readSlice(getMinZ(), getMaxZ(), result);
+}
+
+ZObject3dScan ZObject3dScanChunkFile::getSlice(int z) const
+{
+  return getSlice(z, z);
+}
+
+ZObject3dScan ZObject3dScanChunkFile::getSlice(int minZ, int maxZ) const
+{
+  ZObject3dScan obj;
+  readSlice(minZ, maxZ, &obj);
+
+  return obj;
+}
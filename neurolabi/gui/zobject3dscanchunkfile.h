@@ -0,0 +1,133 @@
+#ifndef ZOBJECT3DSCANCHUNKFILE_H
+#define ZOBJECT3DSCANCHUNKFILE_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+
+class ZObject3dScan;
+
+/*!
+ * \brief The class of chunked RLE file
+ *
+ * A chunked RLE file stores a canonized ZObject3dScan object slice by slice.
+ * Each slice (chunk) is encoded independently: the y of each stripe is
+ * delta-encoded from the previous stripe, the segments are delta-encoded from
+ * the end of the previous segment, and all numbers are written as varints.
+ * A chunk can be further deflated with zlib.
+ *
+ * The file starts with a header and a z-offset index, so that a range of
+ * slices can be read without touching the rest of the file:
+ *
+ *   int32   Version tag (VERSION_TAG), which is negative so that a legacy
+ *           .sobj reader sees an invalid stripe number
+ *   uint32  Flags (bit 0: chunks are deflated when it helps)
+ *   uint64  Number of chunks
+ *   Index, one entry per chunk in increasing z:
+ *     int32   z
+ *     uint32  Number of stripes
+ *     uint64  Offset of the chunk from the beginning of the file
+ *     uint64  Stored size of the chunk
+ *     uint64  Raw size of the chunk. The chunk is deflated iff it is
+ *             different from the stored size.
+ *   Chunk data
+ *
+ * All fields are in the native byte order, same as the legacy .sobj format.
+ * The file is memory mapped when possible.
+ *
+ * Chunked files use their own extension (EXTENSION) so that .sobj files stay
+ * readable by tools that only know the legacy format.
+ */
+class ZObject3dScanChunkFile
+{
+public:
+  ZObject3dScanChunkFile();
+  ~ZObject3dScanChunkFile();
+
+  const static int VERSION_TAG;
+  const static std::string EXTENSION;
+
+  /*!
+   * \brief Write an object into a chunked RLE file.
+   *
+   * \a obj does not have to be canonized, but the file always stores the
+   * canonized object.
+   *
+   * \return true iff the file is written successfully.
+   */
+  static bool Write(const ZObject3dScan &obj, const std::string &filePath,
+                    bool deflating = true);
+
+  /*!
+   * \brief Test if a file is a chunked RLE file by checking its version tag.
+   */
+  static bool IsChunkFile(const std::string &filePath);
+
+  /*!
+   * \brief Open a chunked RLE file.
+   *
+   * Only the header and the index are read.
+   *
+   * \return true iff the file is opened successfully.
+   */
+  bool open(const std::string &filePath);
+  void close();
+
+  inline bool isOpen() const { return m_isOpen; }
+
+  size_t getChunkNumber() const { return m_index.size(); }
+  size_t getStripeNumber() const;
+
+  /*!
+   * \brief Get the z range of the object.
+   *
+   * The range is [0, -1] if the file is not open or the object is empty.
+   */
+  int getMinZ() const;
+  int getMaxZ() const;
+
+  bool hasSlice(int z) const;
+
+  /*!
+   * \brief Read slices in [\a minZ, \a maxZ]
+   *
+   * Only the chunks in the range are decoded. A new object is created if
+   * \a result is NULL.
+   *
+   * \return The canonized object in the range, or NULL if the file is not
+   *         readable.
+   */
+  ZObject3dScan* readSlice(int minZ, int maxZ, ZObject3dScan *result) const;
+
+  /*!
+   * \brief Read the whole object.
+   */
+  ZObject3dScan* read(ZObject3dScan *result) const;
+
+  ZObject3dScan getSlice(int z) const;
+  ZObject3dScan getSlice(int minZ, int maxZ) const;
+
+private:
+  struct ChunkIndex {
+    int z = 0;
+    uint32_t stripeNumber = 0;
+    uint64_t offset = 0;
+    uint64_t storedSize = 0;
+    uint64_t rawSize = 0;
+  };
+
+  bool readIndex();
+  bool readData(uint64_t offset, uint64_t size, std::vector<char> *buffer,
+                const char **data) const;
+  bool decodeChunk(const ChunkIndex &chunk, ZObject3dScan *result) const;
+
+private:
+  std::vector<ChunkIndex> m_index;
+  bool m_isOpen = false;
+  uint64_t m_fileSize = 0;
+  const char *m_mappedData = nullptr;
+  mutable std::ifstream m_stream; //used when the file cannot be mapped
+};
+
+#endif // ZOBJECT3DSCANCHUNKFILE_H
@@ -0,0 +1,370 @@
+#include "zobject3dscancompact.h"
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+#include "zobject3dscan.h"
+#include "zintcuboid.h"
+#include "zerror.h"
+#include "tz_stdint.h"
+
+ZObject3dScanCompact::ZObject3dScanCompact()
+{
+  m_segmentOffset.push_back(0);
+}
+
+void ZObject3dScanCompact::clear()
+{
+  m_z.clear();
+  m_y.clear();
+  m_segmentOffset.resize(1);
+  m_segmentOffset[0] = 0;
+  m_x.clear();
+  m_isCanonized = true;
+}
+
+void ZObject3dScanCompact::reserve(size_t stripeNumber, size_t segmentNumber)
+{
+  m_z.reserve(stripeNumber);
+  m_y.reserve(stripeNumber);
+  m_segmentOffset.reserve(stripeNumber + 1);
+  m_x.reserve(segmentNumber * 2);
+}
+
+void ZObject3dScanCompact::shrinkToFit()
+{
+  m_z.shrink_to_fit();
+  m_y.shrink_to_fit();
+  m_segmentOffset.shrink_to_fit();
+  m_x.shrink_to_fit();
+}
+
+size_t ZObject3dScanCompact::getVoxelNumber() const
+{
+  size_t voxelNumber = 0;
+  for (size_t i = 0; i < m_x.size(); i += 2) {
+    voxelNumber += m_x[i + 1] - m_x[i] + 1;
+  }
+
+  return voxelNumber;
+}
+
+void ZObject3dScanCompact::addStripe(int z, int y)
+{
+  if (!m_z.empty()) {
+    if (m_z.back() == z && m_y.back() == y) {
+      return;
+    }
+
+    if (z < m_z.back() || (z == m_z.back() && y < m_y.back())) {
+      m_isCanonized = false;
+    }
+  }
+
+  m_z.push_back(z);
+  m_y.push_back(y);
+  m_segmentOffset.push_back(m_segmentOffset.back());
+}
+
+void ZObject3dScanCompact::addSegment(int x0, int x1)
+{
+  if (!isEmpty()) {
+    if (x0 > x1) {
+      std::swap(x0, x1);
+    }
+
+    if (getSegmentNumber(getStripeNumber() - 1) > 0) {
+      int lastX = m_x.back();
+      if (x0 <= lastX + 1) {
+        if (x0 >= m_x[m_x.size() - 2]) {
+          m_x.back() = std::max(lastX, x1);
+          return;
+        }
+        m_isCanonized = false;
+      }
+    }
+
+    m_x.push_back(x0);
+    m_x.push_back(x1);
+    ++m_segmentOffset.back();
+  }
+}
+
+void ZObject3dScanCompact::addSegment(int z, int y, int x0, int x1)
+{
+  addStripe(z, y);
+  addSegment(x0, x1);
+}
+
+bool ZObject3dScanCompact::isStripeSorted() const
+{
+  for (size_t i = 1; i < m_z.size(); ++i) {
+    if (m_z[i] < m_z[i - 1] || (m_z[i] == m_z[i - 1] && m_y[i] < m_y[i - 1])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void ZObject3dScanCompact::sortStripe()
+{
+  std::vector<size_t> order(m_z.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [this](size_t i1, size_t i2) {
+    return m_z[i1] < m_z[i2] || (m_z[i1] == m_z[i2] && m_y[i1] < m_y[i2]);
+  });
+
+  std::vector<int> z(m_z.size());
+  std::vector<int> y(m_y.size());
+  std::vector<size_t> segmentOffset(m_segmentOffset.size());
+  std::vector<int> x(m_x.size());
+
+  segmentOffset[0] = 0;
+  for (size_t i = 0; i < order.size(); ++i) {
+    size_t index = order[i];
+    z[i] = m_z[index];
+    y[i] = m_y[index];
+    const int *first = getSegmentArray(index);
+    const int *last = first + getSegmentNumber(index) * 2;
+    std::copy(first, last, x.begin() + segmentOffset[i] * 2);
+    segmentOffset[i + 1] = segmentOffset[i] + getSegmentNumber(index);
+  }
+
+  m_z.swap(z);
+  m_y.swap(y);
+  m_segmentOffset.swap(segmentOffset);
+  m_x.swap(x);
+}
+
+void ZObject3dScanCompact::canonizeSortedStripe()
+{
+  //All writing positions are not ahead of reading positions, so the
+  //canonization can be done in place.
+  size_t stripeLength = 0;
+  size_t xLength = 0;
+
+  std::vector<std::pair<int, int> > segBuffer;
+
+  size_t stripeNumber = getStripeNumber();
+  size_t segStart = m_segmentOffset[0];
+  size_t i = 0;
+  while (i < stripeNumber) {
+    //Stripes with the same (z, y) form a group
+    size_t groupEnd = i + 1;
+    while (groupEnd < stripeNumber && m_z[groupEnd] == m_z[i] &&
+           m_y[groupEnd] == m_y[i]) {
+      ++groupEnd;
+    }
+
+    size_t segEnd = m_segmentOffset[groupEnd];
+    int *first = m_x.data() + segStart * 2;
+    int *last = m_x.data() + segEnd * 2;
+
+    bool sorted = true;
+    for (int *seg = first + 2; seg < last; seg += 2) {
+      if (*seg < *(seg - 2)) {
+        sorted = false;
+        break;
+      }
+    }
+
+    if (!sorted) {
+      segBuffer.clear();
+      for (int *seg = first; seg < last; seg += 2) {
+        segBuffer.emplace_back(seg[0], seg[1]);
+      }
+      std::sort(segBuffer.begin(), segBuffer.end());
+      int *seg = first;
+      for (const auto &s : segBuffer) {
+        *(seg++) = s.first;
+        *(seg++) = s.second;
+      }
+    }
+
+    size_t groupXStart = xLength;
+    for (int *seg = first; seg < last; seg += 2) {
+      if (xLength > groupXStart && seg[0] <= m_x[xLength - 1] + 1) {
+        m_x[xLength - 1] = std::max(m_x[xLength - 1], seg[1]);
+      } else {
+        m_x[xLength++] = seg[0];
+        m_x[xLength++] = seg[1];
+      }
+    }
+
+    if (xLength > groupXStart) { //Empty stripes are removed
+      m_z[stripeLength] = m_z[i];
+      m_y[stripeLength] = m_y[i];
+      m_segmentOffset[stripeLength + 1] = xLength / 2;
+      ++stripeLength;
+    }
+
+    segStart = segEnd;
+    i = groupEnd;
+  }
+
+  m_z.resize(stripeLength);
+  m_y.resize(stripeLength);
+  m_segmentOffset.resize(stripeLength + 1);
+  m_x.resize(xLength);
+}
+
+void ZObject3dScanCompact::canonize()
+{
+  if (!isCanonized()) {
+    if (!isStripeSorted()) {
+      sortStripe();
+    }
+    canonizeSortedStripe();
+    m_isCanonized = true;
+  }
+}
+
+ZIntCuboid ZObject3dScanCompact::getBoundBox() const
+{
+  ZIntCuboid boundBox;
+
+  bool isFirst = true;
+  for (size_t i = 0; i < getStripeNumber(); ++i) {
+    size_t segNumber = getSegmentNumber(i);
+    if (segNumber > 0) {
+      const int *seg = getSegmentArray(i);
+      int minX = seg[0];
+      int maxX = seg[1];
+      for (size_t j = 1; j < segNumber; ++j) {
+        minX = std::min(minX, seg[j * 2]);
+        maxX = std::max(maxX, seg[j * 2 + 1]);
+      }
+      if (isFirst) {
+        boundBox.set(minX, m_y[i], m_z[i], maxX, m_y[i], m_z[i]);
+        isFirst = false;
+      } else {
+        boundBox.joinY(m_y[i]);
+        boundBox.joinZ(m_z[i]);
+        boundBox.joinX(minX);
+        boundBox.joinX(maxX);
+      }
+    }
+  }
+
+  return boundBox;
+}
+
+size_t ZObject3dScanCompact::getMemoryUsage() const
+{
+  return m_z.capacity() * sizeof(int) + m_y.capacity() * sizeof(int) +
+      m_segmentOffset.capacity() * sizeof(size_t) +
+      m_x.capacity() * sizeof(int);
+}
+
+void ZObject3dScanCompact::load(const ZObject3dScan &obj)
+{
+  clear();
+
+  size_t stripeNumber = obj.getStripeNumber();
+  size_t segmentNumber = 0;
+  for (size_t i = 0; i < stripeNumber; ++i) {
+    segmentNumber += obj.getStripe(i).getSize();
+  }
+  reserve(stripeNumber, segmentNumber);
+
+  for (size_t i = 0; i < stripeNumber; ++i) {
+    const ZObject3dStripe &stripe = obj.getStripe(i);
+    if (!stripe.isEmpty()) {
+      m_z.push_back(stripe.getZ());
+      m_y.push_back(stripe.getY());
+      const std::vector<int> &segArray = stripe.getSegmentArray();
+      m_x.insert(m_x.end(), segArray.begin(), segArray.end());
+      m_segmentOffset.push_back(m_x.size() / 2);
+    }
+  }
+
+  m_isCanonized = obj.isCanonized();
+}
+
+ZObject3dScan* ZObject3dScanCompact::toObject3dScan(ZObject3dScan *result) const
+{
+  if (result == NULL) {
+    result = new ZObject3dScan;
+  } else {
+    result->clear();
+  }
+
+  std::vector<ZObject3dStripe> &stripeArray = result->getStripeArray();
+  stripeArray.resize(getStripeNumber());
+  for (size_t i = 0; i < getStripeNumber(); ++i) {
+    ZObject3dStripe &stripe = stripeArray[i];
+    stripe.setZ(m_z[i]);
+    stripe.setY(m_y[i]);
+    const int *seg = getSegmentArray(i);
+    stripe.getSegmentArray().assign(seg, seg + getSegmentNumber(i) * 2);
+    stripe.setCanonized(isCanonized());
+  }
+  result->setCanonized(isCanonized());
+
+  return result;
+}
+
+ZObject3dScan ZObject3dScanCompact::toObject3dScan() const
+{
+  ZObject3dScan obj;
+  toObject3dScan(&obj);
+
+  return obj;
+}
+
+bool ZObject3dScanCompact::equalsLiterally(
+    const ZObject3dScanCompact &obj) const
+{
+  return m_z == obj.m_z && m_y == obj.m_y &&
+      m_segmentOffset == obj.m_segmentOffset && m_x == obj.m_x;
+}
+
+bool ZObject3dScanCompact::importDvidObjectBuffer(
+    const char *byteArray, size_t byteNumber)
+{
+  clear();
+
+  const size_t headerSize = 12;
+  const size_t spanSize = 16;
+
+  if (byteArray == NULL || byteNumber < headerSize) {
+    RECORD_ERROR_UNCOND("Invalid byte buffer");
+    return false;
+  }
+
+  tz_uint8 numberOfDimensions = *(const tz_uint8*)(byteArray + 1);
+  if (numberOfDimensions != 3) {
+    RECORD_ERROR_UNCOND("Current version only supports 3D");
+    return false;
+  }
+
+  tz_uint8 dimOfRun = *(const tz_uint8*)(byteArray + 2);
+  if (dimOfRun != 0) {
+    RECORD_ERROR_UNCOND("Unspported run dimension");
+    return false;
+  }
+
+  tz_uint32 numberOfSpans = *(const tz_uint32*)(byteArray + 8);
+  if (byteNumber < headerSize + spanSize * (size_t) numberOfSpans) {
+    RECORD_ERROR_UNCOND("Buffer ended prematurely.");
+    return false;
+  }
+
+  reserve(numberOfSpans, numberOfSpans);
+
+  const char *spanArray = byteArray + headerSize;
+  for (tz_uint32 span = 0; span < numberOfSpans; ++span) {
+    const tz_int32 *coord = (const tz_int32*)(spanArray + span * spanSize);
+    tz_int32 runLength = coord[3];
+    if (runLength <= 0) {
+      RECORD_ERROR_UNCOND("Invalid run length");
+      clear();
+      return false;
+    }
+    addSegment(coord[2], coord[1], coord[0], coord[0] + runLength - 1);
+  }
+
+  return true;
+}
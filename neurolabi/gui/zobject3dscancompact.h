@@ -0,0 +1,157 @@
+#ifndef ZOBJECT3DSCANCOMPACT_H
+#define ZOBJECT3DSCANCOMPACT_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+class ZObject3dScan;
+class ZIntCuboid;
+
+/*!
+ * \brief The class of compact RLE storage
+ *
+ * ZObject3dScanCompact stores the same RLE representation as ZObject3dScan,
+ * but in a structure-of-arrays layout: one array for z, one for y, one for the
+ * segment offset of each stripe and a flat array of (x0, x1) pairs shared by
+ * all stripes. No per-stripe allocation is made, so a body with millions of
+ * stripes only needs a few contiguous buffers and all passes over the runs are
+ * linear scans.
+ *
+ * The segments of the i-th stripe are stored in the x array at
+ * [2 * m_segmentOffset[i], 2 * m_segmentOffset[i + 1]).
+ *
+ * It is not a replacement of ZObject3dScan. It is meant for reading a large
+ * body only to get its statistics, such as the voxel number and bound box
+ * (see ZDvidReader::readBodyCompact()). Use toObject3dScan() when other
+ * operations are needed.
+ */
+class ZObject3dScanCompact
+{
+public:
+  ZObject3dScanCompact();
+
+  void clear();
+
+  /*!
+   * \brief Reserve space for stripes and segments.
+   */
+  void reserve(size_t stripeNumber, size_t segmentNumber);
+
+  /*!
+   * \brief Release unused capacity of the buffers.
+   */
+  void shrinkToFit();
+
+  inline bool isEmpty() const { return m_z.empty(); }
+  inline size_t getStripeNumber() const { return m_z.size(); }
+  inline size_t getSegmentNumber() const { return m_x.size() / 2; }
+  size_t getVoxelNumber() const;
+
+  inline int getZ(size_t stripeIndex) const { return m_z[stripeIndex]; }
+  inline int getY(size_t stripeIndex) const { return m_y[stripeIndex]; }
+
+  /*!
+   * \brief Get the number of segments in a stripe.
+   */
+  inline size_t getSegmentNumber(size_t stripeIndex) const {
+    return m_segmentOffset[stripeIndex + 1] - m_segmentOffset[stripeIndex];
+  }
+
+  /*!
+   * \brief Get the segment array of a stripe.
+   *
+   * The array has 2 * getSegmentNumber(\a stripeIndex) elements arranged as
+   * x0, x1, x0, x1, ...
+   */
+  inline const int* getSegmentArray(size_t stripeIndex) const {
+    return m_x.data() + 2 * m_segmentOffset[stripeIndex];
+  }
+
+  inline int getSegmentStart(size_t stripeIndex, size_t segIndex) const {
+    return getSegmentArray(stripeIndex)[segIndex * 2];
+  }
+
+  inline int getSegmentEnd(size_t stripeIndex, size_t segIndex) const {
+    return getSegmentArray(stripeIndex)[segIndex * 2 + 1];
+  }
+
+  /*!
+   * \brief Add a stripe to the end.
+   *
+   * A new stripe is added only when (\a z, \a y) is different from the last
+   * stripe.
+   */
+  void addStripe(int z, int y);
+
+  /*!
+   * \brief Add a segment to the last stripe.
+   *
+   * Nothing will be done if there is no stripe.
+   */
+  void addSegment(int x0, int x1);
+  void addSegment(int z, int y, int x0, int x1);
+
+  inline bool isCanonized() const { return isEmpty() || m_isCanonized; }
+  inline void setCanonized(bool canonized) { m_isCanonized = canonized; }
+
+  /*!
+   * \brief Canonize the object.
+   *
+   * The result has the same definition of canonization as ZObject3dScan. The
+   * stripes are only sorted when they are not in ZY order already, so that
+   * canonizing an object built in order is a single linear pass.
+   */
+  void canonize();
+
+  ZIntCuboid getBoundBox() const;
+
+  /*!
+   * \brief Get the number of bytes used by the buffers.
+   */
+  size_t getMemoryUsage() const;
+
+  /*!
+   * \brief Load data from an RLE object.
+   *
+   * Empty stripes in \a obj are skipped.
+   */
+  void load(const ZObject3dScan &obj);
+
+  /*!
+   * \brief Convert to a ZObject3dScan object.
+   *
+   * The stripes are added to \a result, which is cleared first. A new object
+   * is created if \a result is NULL.
+   */
+  ZObject3dScan* toObject3dScan(ZObject3dScan *result) const;
+  ZObject3dScan toObject3dScan() const;
+
+  /*!
+   * \brief Import a DVID sparsevol payload.
+   *
+   * See ZObject3dScan::importDvidObject() for the format. The buffers are
+   * reserved from the span count in the header, so no reallocation happens
+   * during the import. The result is not canonized unless the spans are
+   * already in canonical order.
+   *
+   * \return true iff the payload is parsed successfully.
+   */
+  bool importDvidObjectBuffer(const char *byteArray, size_t byteNumber);
+
+  bool equalsLiterally(const ZObject3dScanCompact &obj) const;
+
+private:
+  bool isStripeSorted() const;
+  void sortStripe();
+  void canonizeSortedStripe();
+
+private:
+  std::vector<int> m_z;
+  std::vector<int> m_y;
+  std::vector<size_t> m_segmentOffset;
+  std::vector<int> m_x;
+  bool m_isCanonized = true;
+};
+
+#endif // ZOBJECT3DSCANCOMPACT_H
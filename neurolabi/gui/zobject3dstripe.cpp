@@ -1,6 +1,7 @@
 #include "zobject3dstripe.h"
 
 #include <cstring>
+#include <algorithm>
 
 #include "tz_error.h"
 #include "zerror.h"
@@ -721,6 +722,41 @@ bool ZObject3dStripe::unify(const ZObject3dStripe &stripe, bool canonizing)
     return true;
   } else {
     if (getY() == stripe.getY() && getZ() == stripe.getZ()) {
+      if (canonizing && isCanonized() && stripe.isCanonized()) {
+        //Linear merge of two sorted segment lists
+        std::vector<int> newSegmentArray;
+        newSegmentArray.reserve(
+              m_segmentArray.size() + stripe.m_segmentArray.size());
+        size_t index1 = 0;
+        size_t index2 = 0;
+        while (index1 < m_segmentArray.size() ||
+               index2 < stripe.m_segmentArray.size()) {
+          const int *seg = NULL;
+          if (index2 >= stripe.m_segmentArray.size() ||
+              (index1 < m_segmentArray.size() &&
+               m_segmentArray[index1] <= stripe.m_segmentArray[index2])) {
+            seg = &(m_segmentArray[index1]);
+            index1 += 2;
+          } else {
+            seg = &(stripe.m_segmentArray[index2]);
+            index2 += 2;
+          }
+
+          if (!newSegmentArray.empty() &&
+              newSegmentArray.back() + 1 >= seg[0]) {
+            if (newSegmentArray.back() < seg[1]) {
+              newSegmentArray.back() = seg[1];
+            }
+          } else {
+            newSegmentArray.push_back(seg[0]);
+            newSegmentArray.push_back(seg[1]);
+          }
+        }
+        m_segmentArray.swap(newSegmentArray);
+
+        return true;
+      }
+
       if (isCanonized() && stripe.isCanonized()) {
         if (!isEmpty() && !stripe.isEmpty()) {
           if (m_segmentArray.back() + 1 >= stripe.m_segmentArray.front()) {
@@ -745,6 +781,40 @@ bool ZObject3dStripe::unify(const ZObject3dStripe &stripe, bool canonizing)
   return false;
 }
 
+ZObject3dStripe ZObject3dStripe::intersect(const ZObject3dStripe &stripe) const
+{
+  ZObject3dStripe result;
+  result.setY(getY());
+  result.setZ(getZ());
+
+  if (getY() == stripe.getY() && getZ() == stripe.getZ()) {
+    const_cast<ZObject3dStripe&>(*this).canonize();
+    const_cast<ZObject3dStripe&>(stripe).canonize();
+
+    const std::vector<int> &segArray1 = m_segmentArray;
+    const std::vector<int> &segArray2 = stripe.m_segmentArray;
+
+    size_t index1 = 0;
+    size_t index2 = 0;
+    while (index1 < segArray1.size() && index2 < segArray2.size()) {
+      int x0 = std::max(segArray1[index1], segArray2[index2]);
+      int x1 = std::min(segArray1[index1 + 1], segArray2[index2 + 1]);
+      if (x0 <= x1) {
+        result.m_segmentArray.push_back(x0);
+        result.m_segmentArray.push_back(x1);
+      }
+
+      if (segArray1[index1 + 1] < segArray2[index2 + 1]) {
+        index1 += 2;
+      } else {
+        index2 += 2;
+      }
+    }
+  }
+
+  return result;
+}
+
 bool ZObject3dStripe::equalsLiterally(const ZObject3dStripe &stripe) const
 {
   if (getZ() != stripe.getZ()) {
@@ -81,6 +81,14 @@ public:
    */
   bool unify(const ZObject3dStripe &stripe, bool canonizing = true);
 
+  /*!
+   * \brief Intersect two stripes
+   *
+   * \return A canonized stripe that has the same y and z as the current
+   *         stripe. It is empty if the two stripes are on different lines.
+   */
+  ZObject3dStripe intersect(const ZObject3dStripe &stripe) const;
+
   void print(int indent = 0) const;
 
   void downsample(int xintv);
@@ -162,6 +162,25 @@ void ZPixmap::clean(const QRect &rect)
   */
 }
 
+void ZPixmap::shift(int dx, int dy, QRegion *exposed)
+{
+  QRegion exposedRegion;
+  scroll(dx, dy, rect(), &exposedRegion);
+
+  if (!exposedRegion.isEmpty()) {
+    QPainter painter;
+    painter.begin(this);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.setClipRegion(exposedRegion);
+    painter.fillRect(rect(), QColor(0, 0, 0, 0));
+    painter.end();
+  }
+
+  if (exposed != NULL) {
+    *exposed = exposedRegion;
+  }
+}
+
 QRectF ZPixmap::getActiveArea(neutube::ECoordinateSystem coord) const
 {
   switch (coord) {
@@ -4,6 +4,7 @@
 #include <QPixmap>
 #include <QRect>
 #include <QBitmap>
+#include <QRegion>
 #include <QFutureWatcher>
 
 #include "zsttransform.h"
@@ -31,6 +32,14 @@ public:
   void cleanUp();
   void clean(const QRect &rect);
 
+  /*!
+   * \brief Shift the content of the pixmap by (\a dx, \a dy) pixels.
+   *
+   * The area exposed by the shift is cleaned and stored in \a exposed if it
+   * is not NULL. The pixmap must not be painted by any painter at the moment.
+   */
+  void shift(int dx, int dy, QRegion *exposed);
+
 
   inline bool isVisible() const {
     return m_isVisible;
@@ -13,6 +13,7 @@
 #include "tz_stack_attribute.h"
 #include "tz_stack_watershed.h"
 #include "tz_math.h"
+#include "zstackprojector.h"
 
 ZSingleChannelStack::ZSingleChannelStack()
 {
@@ -64,9 +65,11 @@ bool ZSingleChannelStack::isDeprecated(EComponent component) const
   case STACK:
     return m_stack == NULL;
   case STACK_MAX_PROJ:
-    return m_maxProj == NULL;
+    return isProjDeprecated(MAX_PROJ);
   case STACK_MIN_PROJ:
-    return m_minProj == NULL;
+    return isProjDeprecated(MIN_PROJ);
+  case STACK_MEAN_PROJ:
+    return isProjDeprecated(MEAN_PROJ);
   case STACK_STAT:
     return m_stat == NULL;
   }
@@ -74,18 +77,40 @@ bool ZSingleChannelStack::isDeprecated(EComponent component) const
   return false;
 }
 
+bool ZSingleChannelStack::isProjDeprecated(Proj_Mode mode) const
+{
+  for (int axis = 0; axis < 3; ++axis) {
+    if (m_proj[mode][axis] != NULL) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void ZSingleChannelStack::deprecateProj(Proj_Mode mode)
+{
+  for (int axis = 0; axis < 3; ++axis) {
+    delete m_proj[mode][axis];
+    m_proj[mode][axis] = NULL;
+  }
+}
+
 void ZSingleChannelStack::deprecateDependent(EComponent component)
 {
   switch (component) {
   case STACK:
     deprecate(STACK_MAX_PROJ);
     deprecate(STACK_MIN_PROJ);
+    deprecate(STACK_MEAN_PROJ);
     deprecate(STACK_STAT);
     break;
   case STACK_MAX_PROJ:
     break;
   case STACK_MIN_PROJ:
     break;
+  case STACK_MEAN_PROJ:
+    break;
   case STACK_STAT:
     break;
   }
@@ -104,12 +129,13 @@ void ZSingleChannelStack::deprecate(EComponent component)
     m_delloc = NULL;
     break;
   case STACK_MAX_PROJ:
-    delete m_maxProj;
-    m_maxProj = NULL;
+    deprecateProj(MAX_PROJ);
     break;
   case STACK_MIN_PROJ:
-    delete m_minProj;
-    m_minProj = NULL;
+    deprecateProj(MIN_PROJ);
+    break;
+  case STACK_MEAN_PROJ:
+    deprecateProj(MEAN_PROJ);
     break;
   case STACK_STAT:
     delete m_stat;
@@ -166,40 +192,19 @@ ZStack_Stat* ZSingleChannelStack::getStat() const
   return m_stat;
 }
 
-ZStack_Projection* ZSingleChannelStack::getMaxProj()
+ZStack_Projection* ZSingleChannelStack::getMaxProj(Stack_Axis axis)
 {
-  if (m_stack == NULL) {
-    return NULL;
-  }
-
-  if (isVirtual()) {
-    return NULL;
-  }
-
-  if (isDeprecated(STACK_MAX_PROJ)) {
-    m_maxProj = new ZStack_Projection;
-    m_maxProj->update(m_stack, ZSingleChannelStack::MAX_PROJ);
-  }
-
-  return m_maxProj;
+  return getProj(MAX_PROJ, axis);
 }
 
-ZStack_Projection* ZSingleChannelStack::getMinProj()
+ZStack_Projection* ZSingleChannelStack::getMinProj(Stack_Axis axis)
 {
-  if (m_stack == NULL) {
-    return NULL;
-  }
-
-  if (isVirtual()) {
-    return NULL;
-  }
-
-  if (isDeprecated(STACK_MIN_PROJ)) {
-    m_minProj = new ZStack_Projection;
-    m_minProj->update(m_stack, ZSingleChannelStack::MIN_PROJ);
-  }
+  return getProj(MIN_PROJ, axis);
+}
 
-  return m_minProj;
+ZStack_Projection* ZSingleChannelStack::getMeanProj(Stack_Axis axis)
+{
+  return getProj(MEAN_PROJ, axis);
 }
 
 double ZSingleChannelStack::min() const
@@ -367,29 +372,35 @@ void ZSingleChannelStack::setData(Stack *stack,
   m_delloc = delloc;
 }
 
-ZStack_Projection* ZSingleChannelStack::getProj(Proj_Mode mode)
+ZStack_Projection* ZSingleChannelStack::getProj(
+    Proj_Mode mode, Stack_Axis axis)
 {
-  switch (mode) {
-  case MAX_PROJ:
-    return getMaxProj();
-  case MIN_PROJ:
-    return getMinProj();
+  if (m_stack == NULL) {
+    return NULL;
+  }
+
+  if (isVirtual()) {
+    return NULL;
   }
 
-  return NULL;
+  ZStack_Projection *&proj = m_proj[mode][axis];
+  if (proj == NULL) {
+    proj = new ZStack_Projection;
+    proj->update(m_stack, mode, axis);
+  }
+
+  return proj;
 }
 
 void *ZSingleChannelStack::projection(
     ZSingleChannelStack::Proj_Mode mode, ZSingleChannelStack::Stack_Axis axis)
 {
-  UNUSED_PARAMETER(mode);
-  UNUSED_PARAMETER(axis);
-
-  if (isVirtual()) {
+  ZStack_Projection *proj = getProj(mode, axis);
+  if (proj == NULL) {
     return NULL;
   }
 
-  return getProj(mode)->data();
+  return proj->data();
 }
 
 void ZSingleChannelStack::bcAdjustHint(double *scale, double *offset)
@@ -531,8 +542,11 @@ void ZSingleChannelStack::init()
   m_stack = NULL;
   m_delloc = NULL;
   m_data.array = NULL;
-  m_maxProj = NULL;
-  m_minProj = NULL;
+  for (int mode = 0; mode < 3; ++mode) {
+    for (int axis = 0; axis < 3; ++axis) {
+      m_proj[mode][axis] = NULL;
+    }
+  }
   m_stat = NULL;
   //m_isOwner = true;
 }
@@ -542,22 +556,93 @@ void ZSingleChannelStack::copyData(const Stack *stack)
   Copy_Stack_Array(m_stack, stack);
 }
 
-void ZStack_Projection::update(Stack *stack, ZSingleChannelStack::Proj_Mode mode)
+void ZStack_Projection::update(
+    Stack *stack, ZSingleChannelStack::Proj_Mode mode,
+    ZSingleChannelStack::Stack_Axis axis)
 {
   if (m_proj != NULL) {
     Kill_Image(m_proj);
     m_proj = NULL;
   }
 
-  if (stack->array != NULL) {
-    switch (mode) {
-    case ZSingleChannelStack::MAX_PROJ:
-      m_proj = Proj_Stack_Zmax(stack);
-      break;
-    case ZSingleChannelStack::MIN_PROJ:
-      m_proj = Proj_Stack_Zmin(stack);
-      break;
+  if (stack->array == NULL) {
+    return;
+  }
+
+  ZStackProjector::EMode projMode = ZStackProjector::EMode::MAX;
+  switch (mode) {
+  case ZSingleChannelStack::MAX_PROJ:
+    projMode = ZStackProjector::EMode::MAX;
+    break;
+  case ZSingleChannelStack::MIN_PROJ:
+    projMode = ZStackProjector::EMode::MIN;
+    break;
+  case ZSingleChannelStack::MEAN_PROJ:
+    projMode = ZStackProjector::EMode::MEAN;
+    break;
+  }
+
+  ZStackProjector::EAxis projAxis = ZStackProjector::EAxis::Z;
+  switch (axis) {
+  case ZSingleChannelStack::X_AXIS:
+    projAxis = ZStackProjector::EAxis::X;
+    break;
+  case ZSingleChannelStack::Y_AXIS:
+    projAxis = ZStackProjector::EAxis::Y;
+    break;
+  case ZSingleChannelStack::Z_AXIS:
+    projAxis = ZStackProjector::EAxis::Z;
+    break;
+  }
+
+  int width = 0;
+  int height = 0;
+  ZStackProjector::GetProjectionSize(
+        stack->width, stack->height, stack->depth, projAxis, &width, &height);
+
+  Image_Array sta;
+  sta.array = stack->array;
+  Image_Array ima;
+
+  switch (stack->kind) {
+  case GREY:
+    m_proj = Make_Image(stack->kind, width, height);
+    ima.array = m_proj->array;
+    ZStackProjector::Project(sta.array8, stack->width, stack->height,
+                             stack->depth, projMode, projAxis, ima.array8);
+    break;
+  case GREY16:
+    m_proj = Make_Image(stack->kind, width, height);
+    ima.array = m_proj->array;
+    ZStackProjector::Project(sta.array16, stack->width, stack->height,
+                             stack->depth, projMode, projAxis, ima.array16);
+    break;
+  case FLOAT32:
+    m_proj = Make_Image(stack->kind, width, height);
+    ima.array = m_proj->array;
+    ZStackProjector::Project(sta.array32, stack->width, stack->height,
+                             stack->depth, projMode, projAxis, ima.array32);
+    break;
+  case FLOAT64:
+    m_proj = Make_Image(stack->kind, width, height);
+    ima.array = m_proj->array;
+    ZStackProjector::Project(sta.array64, stack->width, stack->height,
+                             stack->depth, projMode, projAxis, ima.array64);
+    break;
+  default: //Color stacks are only projected along z
+    if (axis == ZSingleChannelStack::Z_AXIS) {
+      switch (mode) {
+      case ZSingleChannelStack::MAX_PROJ:
+        m_proj = Proj_Stack_Zmax(stack);
+        break;
+      case ZSingleChannelStack::MIN_PROJ:
+        m_proj = Proj_Stack_Zmin(stack);
+        break;
+      default:
+        break;
+      }
     }
+    break;
   }
 }
 /*
@@ -20,7 +20,8 @@ public:
 public:
   enum Proj_Mode {
     MAX_PROJ,
-    MIN_PROJ
+    MIN_PROJ,
+    MEAN_PROJ
   };
 
   enum Stack_Axis {
@@ -38,7 +39,7 @@ public:
   inline Stack* data() const { return m_stack; }
 
   enum EComponent {
-    STACK, STACK_MAX_PROJ, STACK_MIN_PROJ, STACK_STAT
+    STACK, STACK_MAX_PROJ, STACK_MIN_PROJ, STACK_MEAN_PROJ, STACK_STAT
   };
 
   void deprecateDependent(EComponent component);
@@ -69,9 +70,16 @@ public:
   }
 
   ZStack_Stat* getStat() const;
-  ZStack_Projection* getMaxProj();
-  ZStack_Projection* getMinProj();
-  ZStack_Projection* getProj(Proj_Mode mode);
+  ZStack_Projection* getMaxProj(Stack_Axis axis = Z_AXIS);
+  ZStack_Projection* getMinProj(Stack_Axis axis = Z_AXIS);
+  ZStack_Projection* getMeanProj(Stack_Axis axis = Z_AXIS);
+
+  /*!
+   * \brief Get the projection along an axis.
+   *
+   * The projection is computed only once until the stack is deprecated.
+   */
+  ZStack_Projection* getProj(Proj_Mode mode, Stack_Axis axis = Z_AXIS);
 
   void setValue(int x, int y, int z, double v);
   void setValue(size_t index, double value);
@@ -118,14 +126,15 @@ public: /* processing routines */
 private:
   void init();
   void copyData(const Stack *stack);
+  bool isProjDeprecated(Proj_Mode mode) const;
+  void deprecateProj(Proj_Mode mode);
 
 private:
   Stack *m_stack;
   C_Stack::Stack_Deallocator *m_delloc;
   //bool m_isOwner;
   //int m_stamp;
-  ZStack_Projection* m_maxProj;
-  ZStack_Projection *m_minProj;
+  ZStack_Projection* m_proj[3][3]; //Indexed by [Proj_Mode][Stack_Axis]
   mutable ZStack_Stat *m_stat;
   Image_Array m_data;
 };
@@ -136,9 +145,12 @@ public:
   m_proj(NULL) { }
   ~ZStack_Projection() {if (m_proj != NULL) { Kill_Image(m_proj); }}
 
-  void update(Stack *stack, ZSingleChannelStack::Proj_Mode mode);
+  void update(Stack *stack, ZSingleChannelStack::Proj_Mode mode,
+              ZSingleChannelStack::Stack_Axis axis = ZSingleChannelStack::Z_AXIS);
   //void update(Stack *stack, int stamp);
-  inline void* data() { return (void*)m_proj->array; }
+  inline void* data() {
+    return m_proj == NULL ? NULL : (void*)m_proj->array;
+  }
 
 private:
   Stack *m_parent;
@@ -105,6 +105,7 @@ void ZSparseObject::append(const ZObject3dScan &obj)
   for (size_t i = 0; i < obj.getStripeNumber(); ++i) {
     m_stripeArray.push_back(obj.getStripe(i));
   }
+  deprecate(COMPONENT_ALL);
 }
 
 int ZSparseObject::getVoxelValue(int x, int y, int z) const
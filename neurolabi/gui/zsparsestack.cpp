@@ -91,28 +91,9 @@ void ZSparseStack::setBaseValue(int baseValue)
 
 void ZSparseStack::getLineValue(int x,int y,int z,int cnt,double* buffer) const
 {
-  double *dst=buffer;
-  double base_value=m_baseValue;
-  memset(dst,0,sizeof(double)*cnt);
-  int num=0;
+  memset(buffer,0,sizeof(double)*cnt);
   if(getStackGrid()){
-    int width = getStackGrid()->getBlockSize().getX();
-
-    while(num<cnt){
-      ZStackBlockGrid::Location location = getStackGrid()->getLocation(x+num, y, z);
-      int ofx=location.getLocalPosition().getX();
-      ZStack *stack = getStackGrid()->getStack(location.getBlockIndex());
-      if(stack!=NULL){
-        int ofy=location.getLocalPosition().getY();
-        int ofz=location.getLocalPosition().getZ();
-        for(int j=0;j<width-ofx && num <cnt;++j,++num){
-          *(dst+num)=(double)stack->getIntValueLocal(ofx+j,ofy,ofz)+base_value;
-        }
-      }
-      else{
-        num+=width-ofx;
-      }
-    }
+    getStackGrid()->readRow(x, y, z, cnt, buffer, m_baseValue);
   }
 }
 
@@ -130,7 +111,7 @@ void ZSparseStack::assignStackValue(
     ZStack *stack, const ZObject3dScan &obj, const ZStackBlockGrid &stackGrid,
     const int baseValue)
 {
-  if (stackGrid.isEmpty() || stackGrid.getStackArray().empty()) {
+  if (stackGrid.isEmpty() || !stackGrid.hasData()) {
     for (size_t i = 0; i < obj.getStripeNumber(); ++i) {
       const ZObject3dStripe &stripe = obj.getStripe(i);
       int y = stripe.getY();
@@ -145,18 +126,16 @@ void ZSparseStack::assignStackValue(
       }
     }
   } else {
-    for (size_t i = 0; i < obj.getStripeNumber(); ++i) {
-      const ZObject3dStripe &stripe = obj.getStripe(i);
-      int y = stripe.getY();
-      int z = stripe.getZ();
-      for (int j = 0; j < stripe.getSegmentNumber(); ++j) {
-        int x0 = stripe.getSegmentStart(j);
-        int x1 = stripe.getSegmentEnd(j);
-
-        for (int x = x0; x <= x1; ++x) {
-          int v = stackGrid.getValue(x, y, z) + baseValue;
-          stack->setIntValue(x, y, z, 0, v);
+    //Only the blocks touched by the mask are decoded, each once
+    ZStackBlockGrid::MaskedSegmentIterator iter(&stackGrid, &obj);
+    while (iter.hasNext()) {
+      const ZStackBlockGrid::MaskedSegmentIterator::Segment &seg = iter.next();
+      for (int x = seg.x0; x <= seg.x1; ++x) {
+        int v = baseValue;
+        if (seg.value != NULL) {
+          v += seg.value[x - seg.x0];
         }
+        stack->setIntValue(x, seg.y, seg.z, 0, v);
       }
     }
   }
@@ -167,7 +146,7 @@ void ZSparseStack::assignStackValue(
     const ZStackBlockGrid &stackGrid,
     const int baseValue)
 {
-  if (stackGrid.isEmpty() || stackGrid.getStackArray().empty()) {
+  if (stackGrid.isEmpty() || !stackGrid.hasData()) {
     for (size_t i = 0; i < obj.getStripeNumber(); ++i) {
       const ZObject3dStripe &stripe = obj.getStripe(i);
       int y = stripe.getY();
@@ -182,18 +161,16 @@ void ZSparseStack::assignStackValue(
       }
     }
   } else {
-    for (size_t i = 0; i < obj.getStripeNumber(); ++i) {
-      const ZObject3dStripe &stripe = obj.getStripe(i);
-      int y = stripe.getY();
-      int z = stripe.getZ();
-      for (int j = 0; j < stripe.getSegmentNumber(); ++j) {
-        int x0 = stripe.getSegmentStart(j);
-        int x1 = stripe.getSegmentEnd(j);
-
-        for (int x = x0; x <= x1; ++x) {
-          int v = stackGrid.getValue(x, y, z) + baseValue;
-          stack->setIntValue(x, y, z, 0, v);
+    //Only the blocks touched by the mask are decoded, each once
+    ZStackBlockGrid::MaskedSegmentIterator iter(&stackGrid, &obj);
+    while (iter.hasNext()) {
+      const ZStackBlockGrid::MaskedSegmentIterator::Segment &seg = iter.next();
+      for (int x = seg.x0; x <= seg.x1; ++x) {
+        int v = baseValue;
+        if (seg.value != NULL) {
+          v += seg.value[x - seg.x0];
         }
+        stack->setIntValue(x, seg.y, seg.z, 0, v);
       }
     }
 
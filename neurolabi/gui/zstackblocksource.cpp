@@ -101,6 +101,7 @@ void ZStackBlockSource::cacheStack(int i, int j, int k, int zoom, ZStack *stack)
     if (!grid) {
       m_cache[zoom] = std::make_unique<ZStackBlockGrid>();
       m_cache[zoom]->configure(m_gridConfig, zoom);
+      m_cache[zoom]->setCompressing(true);
     }
     grid->consumeStack(ZIntPoint(i, j, k), stack);
   }
@@ -115,7 +116,7 @@ bool ZStackBlockSource::isCached(int i, int j, int k, int zoom)
   std::unique_ptr<ZStackBlockGrid> &grid = m_cache[zoom];
 
   if (grid) {
-    return (grid->getStack(ZIntPoint(i, j, k)) != nullptr);
+    return grid->hasBlock(ZIntPoint(i, j, k));
   }
 
   return false;
@@ -240,18 +241,21 @@ void ZStackBlockSource::cacheStack(
   }
 }
 
-ZStack* ZStackBlockSource::getStack(int i, int j, int k, int zoom)
+ZStack* ZStackBlockSource::makeStack(int i, int j, int k, int zoom)
 {
   ZStack *stack = nullptr;
 
   ZStackBlockGrid *grid = getBlockGrid(zoom);
   if (grid) {
-    stack = grid->getStack(ZIntPoint(i, j, k));
+    stack = grid->makeStack(ZIntPoint(i, j, k));
   }
 
-  if (stack == nullptr) {
+  if (stack == nullptr && m_factory) {
     stack = m_factory->make(ZIntPoint(i, j, k), zoom);
-    cacheStack(i, j, k, zoom, stack);
+    if (stack) {
+      //The cache may compress its copy
+      cacheStack(i, j, k, zoom, stack->clone());
+    }
   }
 
   return stack;
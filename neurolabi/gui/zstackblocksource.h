@@ -18,7 +18,14 @@ public:
   ZStackBlockSource();
   ~ZStackBlockSource();
 
-  ZStack* getStack(int i, int j, int k, int zoom);
+  /*!
+   * \brief Make the stack of a block.
+   *
+   * The block is read from the cache or made by the block factory, in which
+   * case it is also cached. The caller is responsible for deleting the
+   * returned pointer.
+   */
+  ZStack* makeStack(int i, int j, int k, int zoom);
 
   void setBlockFactory(std::unique_ptr<ZStackBlockFactory> &&factory);
   void setBlockFactory(ZStackBlockFactory *factory);
@@ -5882,6 +5882,11 @@ void ZStackDoc::notifySparseObjectModified()
 void ZStackDoc::notifyStackModified(bool rangeChanged)
 {
   LDEBUG() << "Stack modified";
+  //Cached projections and statistics of the old data are no longer valid
+  if (getStack() != NULL) {
+    getStack()->deprecate(ZStack::SINGLE_CHANNEL_VIEW);
+  }
+
   if (rangeChanged) {
     emit stackRangeChanged();
   }
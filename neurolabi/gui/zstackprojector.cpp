@@ -0,0 +1,360 @@
+#include "zstackprojector.h"
+
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <functional>
+#include <algorithm>
+
+#include "core/cpufeature.h"
+
+#if defined(NT_AVX2_DISPATCH)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+//Volumes smaller than this are projected in the calling thread by default
+const size_t MIN_PARALLEL_VOXEL_NUMBER = 1 << 22;
+
+//Pixels of the z projection reduced together to keep them in cache
+const size_t Z_BLOCK_SIZE = 8192;
+
+template<typename T>
+struct SumType {
+  typedef double type;
+};
+
+template<>
+struct SumType<uint8_t> {
+  typedef uint32_t type;
+};
+
+template<>
+struct SumType<uint16_t> {
+  typedef uint64_t type;
+};
+
+template<typename T, typename S>
+T Average(S sum, size_t n)
+{
+  return T((sum + n / 2) / n);
+}
+
+template<>
+float Average<float, double>(double sum, size_t n)
+{
+  return float(sum / n);
+}
+
+template<>
+double Average<double, double>(double sum, size_t n)
+{
+  return sum / n;
+}
+
+template<typename T>
+void MaxRow(T *acc, const T *row, size_t n)
+{
+  for (size_t i = 0; i < n; ++i) {
+    if (row[i] > acc[i]) {
+      acc[i] = row[i];
+    }
+  }
+}
+
+template<typename T>
+void MinRow(T *acc, const T *row, size_t n)
+{
+  for (size_t i = 0; i < n; ++i) {
+    if (row[i] < acc[i]) {
+      acc[i] = row[i];
+    }
+  }
+}
+
+#if defined(NT_AVX2_DISPATCH)
+//Each function returns the number of elements reduced, leaving the tail to
+//the scalar loop.
+NT_AVX2_TARGET size_t MaxRowAvx2(uint8_t *acc, const uint8_t *row, size_t n)
+{
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i*) (acc + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*) (row + i));
+    _mm256_storeu_si256((__m256i*) (acc + i), _mm256_max_epu8(a, b));
+  }
+
+  return i;
+}
+
+NT_AVX2_TARGET size_t MinRowAvx2(uint8_t *acc, const uint8_t *row, size_t n)
+{
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i*) (acc + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*) (row + i));
+    _mm256_storeu_si256((__m256i*) (acc + i), _mm256_min_epu8(a, b));
+  }
+
+  return i;
+}
+
+NT_AVX2_TARGET size_t MaxRowAvx2(
+    uint16_t *acc, const uint16_t *row, size_t n)
+{
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i a = _mm256_loadu_si256((const __m256i*) (acc + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*) (row + i));
+    _mm256_storeu_si256((__m256i*) (acc + i), _mm256_max_epu16(a, b));
+  }
+
+  return i;
+}
+
+NT_AVX2_TARGET size_t MinRowAvx2(
+    uint16_t *acc, const uint16_t *row, size_t n)
+{
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i a = _mm256_loadu_si256((const __m256i*) (acc + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*) (row + i));
+    _mm256_storeu_si256((__m256i*) (acc + i), _mm256_min_epu16(a, b));
+  }
+
+  return i;
+}
+
+template<typename T>
+void MaxRowDispatch(T *acc, const T *row, size_t n)
+{
+  size_t i = 0;
+  if (neutube::HasAvx2()) {
+    i = MaxRowAvx2(acc, row, n);
+  }
+  MaxRow<T>(acc + i, row + i, n - i);
+}
+
+template<typename T>
+void MinRowDispatch(T *acc, const T *row, size_t n)
+{
+  size_t i = 0;
+  if (neutube::HasAvx2()) {
+    i = MinRowAvx2(acc, row, n);
+  }
+  MinRow<T>(acc + i, row + i, n - i);
+}
+
+void MaxRow(uint8_t *acc, const uint8_t *row, size_t n)
+{
+  MaxRowDispatch(acc, row, n);
+}
+
+void MinRow(uint8_t *acc, const uint8_t *row, size_t n)
+{
+  MinRowDispatch(acc, row, n);
+}
+
+void MaxRow(uint16_t *acc, const uint16_t *row, size_t n)
+{
+  MaxRowDispatch(acc, row, n);
+}
+
+void MinRow(uint16_t *acc, const uint16_t *row, size_t n)
+{
+  MinRowDispatch(acc, row, n);
+}
+#endif
+
+template<typename T, typename S>
+void AddRow(S *acc, const T *row, size_t n)
+{
+  for (size_t i = 0; i < n; ++i) {
+    acc[i] += row[i];
+  }
+}
+
+template<typename T>
+void ReduceRow(ZStackProjector::EMode mode, T *acc, const T *row, size_t n)
+{
+  if (mode == ZStackProjector::EMode::MAX) {
+    MaxRow(acc, row, n);
+  } else {
+    MinRow(acc, row, n);
+  }
+}
+
+template<typename T>
+T ReduceValue(ZStackProjector::EMode mode, const T *row, size_t n)
+{
+  switch (mode) {
+  case ZStackProjector::EMode::MAX:
+    return *std::max_element(row, row + n);
+  case ZStackProjector::EMode::MIN:
+    return *std::min_element(row, row + n);
+  case ZStackProjector::EMode::MEAN:
+  {
+    typename SumType<T>::type sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+      sum += row[i];
+    }
+    return Average<T>(sum, n);
+  }
+  }
+
+  return T(0);
+}
+
+/*!
+ * Reduce \a n rows of \a rowLength elements, which are \a stride elements
+ * apart, into \a out.
+ */
+template<typename T>
+void ReduceRows(
+    ZStackProjector::EMode mode, const T *data, size_t rowLength, size_t n,
+    size_t stride, T *out)
+{
+  if (mode == ZStackProjector::EMode::MEAN) {
+    std::vector<typename SumType<T>::type> sum(rowLength, 0);
+    for (size_t i = 0; i < n; ++i) {
+      AddRow(sum.data(), data + i * stride, rowLength);
+    }
+    for (size_t i = 0; i < rowLength; ++i) {
+      out[i] = Average<T>(sum[i], n);
+    }
+  } else {
+    memcpy(out, data, rowLength * sizeof(T));
+    for (size_t i = 1; i < n; ++i) {
+      ReduceRow(mode, out, data + i * stride, rowLength);
+    }
+  }
+}
+
+/*!
+ * Split [0, n) into parts and run \a f on each part in parallel.
+ */
+void RunParallel(
+    size_t n, int threadNumber, size_t voxelNumber,
+    const std::function<void(size_t, size_t)> &f)
+{
+  if (n == 0) {
+    return;
+  }
+
+  size_t partNumber = 1;
+  if (threadNumber > 0) {
+    partNumber = threadNumber;
+  } else if (voxelNumber >= MIN_PARALLEL_VOXEL_NUMBER) {
+    partNumber = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  size_t partSize = (n + partNumber - 1) / partNumber;
+  std::vector<std::thread> threadArray;
+  for (size_t start = partSize; start < n; start += partSize) {
+    threadArray.emplace_back(f, start, std::min(n, start + partSize));
+  }
+  f(0, std::min(n, partSize));
+  for (std::thread &thread : threadArray) {
+    thread.join();
+  }
+}
+
+template<typename T>
+void Project(
+    const T *data, int width, int height, int depth,
+    ZStackProjector::EMode mode, ZStackProjector::EAxis axis, T *out,
+    int threadNumber)
+{
+  if (data == NULL || out == NULL || width <= 0 || height <= 0 || depth <= 0) {
+    return;
+  }
+
+  size_t area = size_t(width) * height;
+  size_t voxelNumber = area * depth;
+
+  switch (axis) {
+  case ZStackProjector::EAxis::Z:
+    //The plane is split into bands, each of which is reduced along z block
+    //by block
+    RunParallel(
+          (area + Z_BLOCK_SIZE - 1) / Z_BLOCK_SIZE, threadNumber, voxelNumber,
+          [&](size_t startBlock, size_t endBlock) {
+      for (size_t block = startBlock; block < endBlock; ++block) {
+        size_t start = block * Z_BLOCK_SIZE;
+        size_t n = std::min(area, start + Z_BLOCK_SIZE) - start;
+        ReduceRows(mode, data + start, n, depth, area, out + start);
+      }
+    });
+    break;
+  case ZStackProjector::EAxis::Y:
+    RunParallel(depth, threadNumber, voxelNumber,
+                [&](size_t startZ, size_t endZ) {
+      for (size_t z = startZ; z < endZ; ++z) {
+        ReduceRows(mode, data + z * area, width, height, width, out + z * width);
+      }
+    });
+    break;
+  case ZStackProjector::EAxis::X:
+    RunParallel(depth, threadNumber, voxelNumber,
+                [&](size_t startZ, size_t endZ) {
+      for (size_t z = startZ; z < endZ; ++z) {
+        const T *slice = data + z * area;
+        for (int y = 0; y < height; ++y) {
+          out[z * height + y] = ReduceValue(mode, slice + y * width, width);
+        }
+      }
+    });
+    break;
+  }
+}
+
+}
+
+void ZStackProjector::GetProjectionSize(
+    int width, int height, int depth, EAxis axis,
+    int *projWidth, int *projHeight)
+{
+  switch (axis) {
+  case EAxis::X:
+    *projWidth = height;
+    *projHeight = depth;
+    break;
+  case EAxis::Y:
+    *projWidth = width;
+    *projHeight = depth;
+    break;
+  case EAxis::Z:
+    *projWidth = width;
+    *projHeight = height;
+    break;
+  }
+}
+
+void ZStackProjector::Project(
+    const uint8_t *data, int width, int height, int depth,
+    EMode mode, EAxis axis, uint8_t *out, int threadNumber)
+{
+  ::Project(data, width, height, depth, mode, axis, out, threadNumber);
+}
+
+void ZStackProjector::Project(
+    const uint16_t *data, int width, int height, int depth,
+    EMode mode, EAxis axis, uint16_t *out, int threadNumber)
+{
+  ::Project(data, width, height, depth, mode, axis, out, threadNumber);
+}
+
+void ZStackProjector::Project(
+    const float *data, int width, int height, int depth,
+    EMode mode, EAxis axis, float *out, int threadNumber)
+{
+  ::Project(data, width, height, depth, mode, axis, out, threadNumber);
+}
+
+void ZStackProjector::Project(
+    const double *data, int width, int height, int depth,
+    EMode mode, EAxis axis, double *out, int threadNumber)
+{
+  ::Project(data, width, height, depth, mode, axis, out, threadNumber);
+}
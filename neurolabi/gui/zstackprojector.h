@@ -0,0 +1,57 @@
+#ifndef ZSTACKPROJECTOR_H
+#define ZSTACKPROJECTOR_H
+
+#include <cstdint>
+#include <cstddef>
+
+/*!
+ * \brief The class of computing intensity projections of a single-channel
+ * stack
+ *
+ * The stack array is in the x-y-z order. The projection along z is a
+ * width x height image; the projection along y is width x depth; the
+ * projection along x is height x depth.
+ *
+ * The volume is split into parts that are reduced in parallel threads, with
+ * contiguous rows reduced by AVX2 instructions when the CPU supports them.
+ */
+class ZStackProjector
+{
+public:
+  enum class EMode {
+    MAX, MIN, MEAN
+  };
+
+  enum class EAxis {
+    X, Y, Z
+  };
+
+  /*!
+   * \brief Get the size of the projection image.
+   */
+  static void GetProjectionSize(
+      int width, int height, int depth, EAxis axis,
+      int *projWidth, int *projHeight);
+
+  /*!
+   * \brief Project \a data into \a out.
+   *
+   * \a out must have enough space for the projection image. The mean is
+   * rounded to the nearest integer for integer types. The number of hardware
+   * threads is used if \a threadNumber <= 0.
+   */
+  static void Project(
+      const uint8_t *data, int width, int height, int depth,
+      EMode mode, EAxis axis, uint8_t *out, int threadNumber = 0);
+  static void Project(
+      const uint16_t *data, int width, int height, int depth,
+      EMode mode, EAxis axis, uint16_t *out, int threadNumber = 0);
+  static void Project(
+      const float *data, int width, int height, int depth,
+      EMode mode, EAxis axis, float *out, int threadNumber = 0);
+  static void Project(
+      const double *data, int width, int height, int depth,
+      EMode mode, EAxis axis, double *out, int threadNumber = 0);
+};
+
+#endif // ZSTACKPROJECTOR_H
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <cmath>
 #include <QElapsedTimer>
 #include <QMdiArea>
 #include <QImageWriter>
@@ -46,6 +47,32 @@
 
 using namespace std;
 
+namespace {
+
+//Margin (in canvas pixels) for objects drawn slightly beyond their bound boxes
+const int PAN_EXPOSED_MARGIN = 16;
+
+bool IntersectsArea(const ZStackObject *obj, const std::vector<QRectF> &area)
+{
+  ZIntCuboid box;
+  obj->boundBox(&box);
+  if (box.isEmpty()) { //Unknown extent
+    return true;
+  }
+
+  QRectF rect(box.getFirstCorner().getX(), box.getFirstCorner().getY(),
+              box.getWidth(), box.getHeight());
+  for (const QRectF &r : area) {
+    if (rect.intersects(r)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+}
+
 ZStackView::ZStackView(ZStackFrame *parent) : QWidget(parent)
 {
   init();
@@ -1117,10 +1144,16 @@ void ZStackView::redraw(EUpdateOption option)
         box.getFirstCorner().getY(),
         box.getWidth(), box.getHeight());
 
-  paintStackBuffer();
+  //The stack and mask canvases cover the whole slice, which is not changed by
+  //panning
+  if (!m_panningIncrementally || m_image == NULL) {
+    paintStackBuffer();
+  }
   qint64 stackPaintTime = timer.elapsed();
   ZOUT(LTRACE(), 5) << "paint stack per frame: " << stackPaintTime;
-  paintMaskBuffer();
+  if (!m_panningIncrementally || m_imageMask == NULL) {
+    paintMaskBuffer();
+  }
   paintTileCanvasBuffer();
   qint64 tilePaintTime = timer.elapsed();
   ZOUT(LTRACE(), 5) << "paint tile per frame: " << tilePaintTime;
@@ -1683,7 +1716,9 @@ void ZStackView::updateObjectCanvas()
   std::cout << "Updating object canvas." << std::endl;
 #endif
 
-  m_objectCanvas = updateProjCanvas(m_objectCanvas, &m_objectCanvasPainter);
+  m_objectCanvas = updateProjCanvas(
+        m_objectCanvas, &m_objectCanvasPainter,
+        ZStackObject::TARGET_OBJECT_CANVAS);
   m_imageWidget->setObjectCanvas(m_objectCanvas);
 
 #if 0
@@ -1744,7 +1779,8 @@ ZPixmap *ZStackView::updateViewPortCanvas(ZPixmap *canvas)
 }
 
 #if 1
-ZPixmap *ZStackView::updateProjCanvas(ZPixmap *canvas, ZPainter *painter)
+ZPixmap *ZStackView::updateProjCanvas(
+    ZPixmap *canvas, ZPainter *painter, ZStackObject::ETarget target)
 {
   QRectF projRect = getProjRegion();
   QSize newCanvasSize = projRect.size().toSize();
@@ -1781,6 +1817,8 @@ ZPixmap *ZStackView::updateProjCanvas(ZPixmap *canvas, ZPainter *painter)
     canvas = new ZPixmap(newCanvasSize);
   }
 
+  ZStTransform oldTransform = canvas->getTransform();
+
   if (usingProjSize) {
     canvas->getProjTransform().setScale(1.0, 1.0);
     canvas->getProjTransform().setOffset(projRect.left(), projRect.top());
@@ -1792,11 +1830,17 @@ ZPixmap *ZStackView::updateProjCanvas(ZPixmap *canvas, ZPainter *painter)
   }
 
   canvas->setTransform(transform);
+
+  bool shifted = false;
+  if (m_panningIncrementally && target != ZStackObject::TARGET_NULL) {
+    shifted = shiftProjCanvas(canvas, painter, oldTransform, target);
+  }
+
   if (painter != NULL) {
     painter->updateTransform(canvas);
   }
 
-  if (canvas->isVisible()){
+  if (!shifted && canvas->isVisible()){
     canvas->cleanUp();
   }
 
@@ -1804,6 +1848,70 @@ ZPixmap *ZStackView::updateProjCanvas(ZPixmap *canvas, ZPainter *painter)
 }
 #endif
 
+bool ZStackView::shiftProjCanvas(
+    ZPixmap *canvas, ZPainter *painter, const ZStTransform &oldTransform,
+    ZStackObject::ETarget target)
+{
+  const ZStTransform &transform = canvas->getTransform();
+  double dx = transform.getTx() - oldTransform.getTx();
+  double dy = transform.getTy() - oldTransform.getTy();
+  int shiftX = iround(dx);
+  int shiftY = iround(dy);
+
+  //The content can only be reused when it is moved by whole pixels
+  if (canvas->isVisible() &&
+      std::fabs(transform.getSx() - oldTransform.getSx()) < 1e-6 &&
+      std::fabs(transform.getSy() - oldTransform.getSy()) < 1e-6 &&
+      std::fabs(dx - shiftX) < 1e-3 && std::fabs(dy - shiftY) < 1e-3 &&
+      std::abs(shiftX) < canvas->width() &&
+      std::abs(shiftY) < canvas->height()) {
+    QRegion &region = m_panExposedRegion[target];
+    if (shiftX != 0 || shiftY != 0) {
+      if (painter != NULL) {
+        painter->end();
+      }
+      QRegion exposed;
+      canvas->shift(shiftX, shiftY, &exposed);
+      region.translate(shiftX, shiftY);
+      region = (region | exposed) & canvas->rect();
+    }
+    return true;
+  }
+
+  m_panExposedRegion.remove(target);
+
+  return false;
+}
+
+void ZStackView::beginIncrementalPan()
+{
+  m_panExposedRegion.clear();
+  m_panningIncrementally = (getSliceAxis() != neutube::EAxis::ARB);
+}
+
+void ZStackView::endIncrementalPan()
+{
+  //Shifted canvases that are not painted are cleaned as in a full redraw
+  for (QMap<ZStackObject::ETarget, QRegion>::const_iterator
+       iter = m_panExposedRegion.begin(); iter != m_panExposedRegion.end();
+       ++iter) {
+    if (!iter.value().isEmpty()) {
+      ZPixmap *canvas = getCanvas(iter.key());
+      if (canvas != NULL) {
+        if (iter.key() == ZStackObject::TARGET_OBJECT_CANVAS) {
+          m_objectCanvasPainter.end();
+        } else if (iter.key() == ZStackObject::TARGET_TILE_CANVAS) {
+          m_tileCanvasPainter.end();
+        }
+        canvas->cleanUp();
+      }
+    }
+  }
+
+  m_panExposedRegion.clear();
+  m_panningIncrementally = false;
+}
+
 #if 0
 ZPixmap *ZStackView::updateProjCanvas(ZPixmap *canvas)
 {
@@ -1877,7 +1985,8 @@ void ZStackView::updateTileCanvas()
 #endif
 
 //  m_tileCanvasPainter.end();
-  m_tileCanvas = updateProjCanvas(m_tileCanvas, &m_tileCanvasPainter);
+  m_tileCanvas = updateProjCanvas(
+        m_tileCanvas, &m_tileCanvasPainter, ZStackObject::TARGET_TILE_CANVAS);
   m_imageWidget->setTileCanvas(m_tileCanvas);
 }
 
@@ -2076,6 +2185,32 @@ void ZStackView::paintObjectBuffer(
 
   painter.setPainted(false);
 
+  //After an incremental pan, only the exposed area is painted
+  bool paintingExposed = m_panExposedRegion.contains(target);
+  std::vector<QRectF> exposedArea;
+  if (paintingExposed) {
+    QRegion exposedRegion = m_panExposedRegion.value(target);
+    m_panExposedRegion[target] = QRegion();
+    if (exposedRegion.isEmpty()) {
+      return;
+    }
+
+    ZStTransform inverseTransform =
+        painter.getCanvasTransform().getInverseTransform();
+    foreach (const QRect &rect, exposedRegion.rects()) {
+      exposedArea.push_back(inverseTransform.transform(QRectF(
+          rect.adjusted(-PAN_EXPOSED_MARGIN, -PAN_EXPOSED_MARGIN,
+                        PAN_EXPOSED_MARGIN, PAN_EXPOSED_MARGIN))));
+    }
+
+    painter.save();
+    QTransform transform = painter.getTransform();
+    painter.setTransform(QTransform());
+    painter.getPainter()->setClipRegion(exposedRegion);
+    painter.setTransform(transform);
+  }
+  bool cullingObject = paintingExposed && (m_sliceAxis == neutube::EAxis::Z);
+
   bool visible = true;
   if (target == ZStackObject::TARGET_OBJECT_CANVAS ||
       target == ZStackObject::TARGET_DYNAMIC_OBJECT_CANVAS) {
@@ -2106,7 +2241,9 @@ void ZStackView::paintObjectBuffer(
 #endif
         if ((obj->isSliceVisible(z, m_sliceAxis) || slice < 0) &&
             obj->getTarget() == target) {
-          visibleObject.append(obj);
+          if (!cullingObject || IntersectsArea(obj, exposedArea)) {
+            visibleObject.append(obj);
+          }
         }
       }
       std::sort(visibleObject.begin(), visibleObject.end(),
@@ -2143,6 +2280,10 @@ void ZStackView::paintObjectBuffer(
     }
   }
 
+  if (paintingExposed) {
+    painter.restore();
+  }
+
   if (painter.isPainted()) {
     ZPixmap *canvas = getCanvas(target);
     if (canvas != NULL) {
@@ -2798,8 +2939,10 @@ void ZStackView::setViewPortOffset(int x, int y)
   imageWidget()->blockPaint(true);
   imageWidget()->setViewPortOffset(x, y);
   imageWidget()->blockPaint(false);
+  beginIncrementalPan();
   processViewChange(false, false);
   redraw(UPDATE_DIRECT);
+  endIncrementalPan();
 //  notifyViewChanged(NeuTube::View::EXPLORE_MOVE);
 }
 
@@ -2835,8 +2978,10 @@ void ZStackView::move(const QPoint &src, const QPointF &dst)
 
   updateSliceViewParam();
 
+  beginIncrementalPan();
   processViewChange(false, false);
   redraw(UPDATE_DIRECT);
+  endIncrementalPan();
 }
 
 void ZStackView::moveViewPort(int dx, int dy)
@@ -2844,8 +2989,10 @@ void ZStackView::moveViewPort(int dx, int dy)
   recordViewParam();
 
   imageWidget()->moveViewPort(dx, dy);
+  beginIncrementalPan();
   processViewChange(false, false);
   redraw(UPDATE_DIRECT);
+  endIncrementalPan();
 }
 
 void ZStackView::setViewPortCenter(
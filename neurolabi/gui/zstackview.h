@@ -9,6 +9,8 @@
 #include <QImage>
 #include <QWidget>
 #include <QPixmap>
+#include <QMap>
+#include <QRegion>
 #include <vector>
 #include <QCheckBox>
 
@@ -432,9 +434,32 @@ protected:
   ZPainter* getTileCanvasPainter();
   ZPainter* getObjectCanvasPainter();
 
-  ZPixmap* updateProjCanvas(ZPixmap *canvas, ZPainter *painter);
+  /*!
+   * \brief Update a canvas to the current projection region.
+   *
+   * While panning incrementally, the content of the canvas of \a target is
+   * shifted instead of cleaned whenever possible, leaving only the exposed
+   * area to repaint.
+   */
+  ZPixmap* updateProjCanvas(
+      ZPixmap *canvas, ZPainter *painter,
+      ZStackObject::ETarget target = ZStackObject::TARGET_NULL);
   ZPixmap* updateViewPortCanvas(ZPixmap *canvas);
 
+  /*!
+   * \brief Start or finish redrawing for moving the viewport without changing
+   * its size, zoom or slice.
+   *
+   * Between the two calls, the stack and mask canvases are kept as they are
+   * and the object and tile canvases are shifted, so that only the newly
+   * exposed strips are painted.
+   */
+  void beginIncrementalPan();
+  void endIncrementalPan();
+  bool shiftProjCanvas(
+      ZPixmap *canvas, ZPainter *painter, const ZStTransform &oldTransform,
+      ZStackObject::ETarget target);
+
   void connectSignalSlot();
 
   /*!
@@ -662,6 +687,9 @@ protected:
   ZStackViewParam m_oldViewParam;
   bool m_viewParamRecorded = false;
   bool m_viewParamRecordOnce = false;
+  bool m_panningIncrementally = false;
+  //Canvas areas (in canvas pixels) to paint after an incremental pan
+  QMap<ZStackObject::ETarget, QRegion> m_panExposedRegion;
   ZArbSliceViewParam m_sliceViewParam;
   int m_maxViewPort = 0;
 
@@ -27622,8 +27622,9 @@ void ZTest::test(MainWindow *host)
   blockSource.setBlockSize(blockFactory->getDvidInfo().getBlockSize());
   blockSource.setGridSize(blockFactory->getDvidInfo().getEndBlockIndex() + 1);
 
-  ZStack *stack = blockSource.getStack(150, 150, 150, 1);
+  ZStack *stack = blockSource.makeStack(150, 150, 150, 1);
   stack->save(GET_TEST_DATA_DIR + "/_test.tif");
+  delete stack;
 #endif
 
 #if 0
@@ -28618,5 +28619,136 @@ void ZTest::test(MainWindow *host)
 //  ASSERT_TRUE(obj2.isAdjacentTo(obj1));
 #endif
 
+#if 0
+  //Benchmark of set operations on DVID-sized bodies
+  auto makeBall = [](int cx, int cy, int cz, int r) {
+    ZObject3dScan obj;
+    for (int z = cz - r; z <= cz + r; ++z) {
+      for (int y = cy - r; y <= cy + r; ++y) {
+        int d2 = r * r - (z - cz) * (z - cz) - (y - cy) * (y - cy);
+        if (d2 >= 0) {
+          int dx = iround(std::sqrt(d2));
+          //Holes make several segments per stripe
+          obj.addSegment(z, y, cx - dx, cx - dx / 3);
+          obj.addSegment(z, y, cx + dx / 3, cx + dx);
+        }
+      }
+    }
+    obj.canonize();
+    return obj;
+  };
+
+  //Stripe-wise difference as operator - computed it before the merge-join
+  auto oldMinus = [](const ZObject3dScan &obj1, const ZObject3dScan &obj2) {
+    ZObject3dScan remained;
+    size_t index1 = 0;
+    size_t index2 = 0;
+    while (index1 < obj1.getStripeNumber() &&
+           index2 < obj2.getStripeNumber()) {
+      const ZObject3dStripe &s1 = obj1.getStripe(index1);
+      const ZObject3dStripe &s2 = obj2.getStripe(index2);
+      if (s1.getY() == s2.getY() && s1.getZ() == s2.getZ()) {
+        ZObject3dStripe diff = s1 - s2;
+        if (!diff.isEmpty()) {
+          remained.addStripeFast(diff);
+        }
+        ++index1;
+        ++index2;
+      } else if (s1.getZ() < s2.getZ() ||
+                 (s1.getZ() == s2.getZ() && s1.getY() < s2.getY())) {
+        remained.addStripeFast(s1);
+        ++index1;
+      } else {
+        ++index2;
+      }
+    }
+    for (; index1 < obj1.getStripeNumber(); ++index1) {
+      remained.addStripeFast(obj1.getStripe(index1));
+    }
+    remained.setCanonized(true);
+    return remained;
+  };
+
+  ZObject3dScan obj1 = makeBall(0, 0, 0, 300);
+  ZObject3dScan obj2 = makeBall(200, 100, 150, 300);
+  std::cout << "Stripes: " << obj1.getStripeNumber() << " "
+            << obj2.getStripeNumber() << std::endl;
+
+  ZObject3dScan oldResult;
+  ZObject3dScan newResult;
+
+  {
+    std::cout << "Union (old, concat + canonize): ";
+    oldResult = obj1;
+    tic();
+    oldResult.concat(obj2);
+    oldResult.canonize();
+    ptoc();
+  }
+
+  for (int threadNumber : {1, 0}) {
+    std::cout << "Union (merge, " << threadNumber << " thread): ";
+    newResult = obj1;
+    tic();
+    newResult.unify(obj2, threadNumber);
+    ptoc();
+  }
+  std::cout << "Same union: " << oldResult.equalsLiterally(newResult)
+            << std::endl;
+
+  {
+    //The old subtract(): both parts are collected slice by slice
+    std::cout << "Subtract (old, slice by slice): ";
+    ZObject3dScan remained;
+    ZObject3dScan subtracted;
+    tic();
+    for (int z = obj1.getMinZ(); z <= obj1.getMaxZ(); ++z) {
+      ZObject3dScan slice = obj1.getSlice(z);
+      ZObject3dScan slice2 = obj2.getSlice(z);
+      if (slice2.isEmpty()) {
+        remained.concat(slice);
+      } else {
+        ZObject3dScan diff = oldMinus(slice, slice2);
+        if (diff.isEmpty()) {
+          subtracted.concat(slice);
+        } else {
+          remained.concat(diff);
+          subtracted.concat(oldMinus(slice, diff));
+        }
+      }
+    }
+    remained.canonize();
+    subtracted.canonize();
+    ptoc();
+    oldResult = remained;
+  }
+
+  {
+    std::cout << "Subtract (merge): ";
+    newResult = obj1;
+    tic();
+    newResult.subtract(obj2);
+    ptoc();
+  }
+  std::cout << "Same difference: " << oldResult.equalsLiterally(newResult)
+            << std::endl;
+
+  {
+    std::cout << "Intersect (old, a - (a - b)): ";
+    tic();
+    oldResult = oldMinus(obj1, oldMinus(obj1, obj2));
+    ptoc();
+  }
+
+  for (int threadNumber : {1, 0}) {
+    std::cout << "Intersect (merge, " << threadNumber << " thread): ";
+    tic();
+    newResult = obj1.intersect(obj2, threadNumber);
+    ptoc();
+  }
+  std::cout << "Same intersection: " << oldResult.equalsLiterally(newResult)
+            << std::endl;
+#endif
+
   std::cout << "Done." << std::endl;
 }